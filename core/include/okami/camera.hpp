@@ -52,7 +52,11 @@ namespace okami {
     struct RenderView {
         Camera camera;
         glm::vec2 viewport;
+        // Relative to origin
         Transform viewTransform;
+        // World space origin that world transforms are rebased against
+        // before being converted to float for rendering
+        glm::dvec3 origin = glm::dvec3(0.0, 0.0, 0.0);
 
         glm::mat4x4 GetProjMatrix() const;
         inline glm::mat4x4 GetViewMatrix() const {
@@ -61,5 +65,13 @@ namespace okami {
         inline glm::mat4x4 GetViewProjMatrix() const {
             return GetViewMatrix() * GetProjMatrix();
         }
+
+        // Creates a view whose origin sits at the camera, so that geometry
+        // near the camera keeps full float precision no matter how far it is
+        // from the world origin
+        static RenderView CameraRelative(
+            Camera const& camera,
+            glm::vec2 viewport,
+            WorldTransform const& cameraTransform);
     };
 }
\ No newline at end of file
@@ -3,15 +3,21 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <filesystem>
 #include <cstring>
 #include <vector>
 #include <cstdint>
 #include <array>
+#include <string>
+#include <span>
+#include <limits>
+#include <algorithm>
 
 #include <okami/vertex_format.hpp>
 #include <okami/okami.hpp>
+#include <okami/thread_pool.hpp>
 
 namespace okami {
  	struct BoundingBox {
@@ -28,11 +34,22 @@ namespace okami {
 
 		struct Attribs {
 			uint32_t numVertices = 0;
+
+			template <typename Archive>
+			void serialize(Archive& arr) {
+				arr(numVertices);
+			}
 		};
 
 		struct IndexedAttribs {
 			ValueType indexType = ValueType::UNDEFINED;
 			uint32_t numIndices = 0;
+
+			template <typename Archive>
+			void serialize(Archive& arr) {
+				arr(indexType);
+				arr(numIndices);
+			}
 		};
 
 		struct Desc {
@@ -41,6 +58,15 @@ namespace okami {
 			Attribs attribs;
 			IndexedAttribs indexedAttribs;
 			bool isIndexed;
+
+			template <typename Archive>
+			void serialize(Archive& arr) {
+				arr(layout);
+				arr(topology);
+				arr(attribs);
+				arr(indexedAttribs);
+				arr(isIndexed);
+			}
 		};
 
 		template <typename IndexType = uint32_t,
@@ -228,12 +254,52 @@ namespace okami {
 			}
 		};
 
+		// Number of vertices packed together in one fused pass
+		constexpr size_t kPackChunkSize = 4096;
+
+		// Byte sizes of the buffers that packing a layout produces
+		struct PackSizes {
+			std::vector<size_t> vertexBuffers;
+			size_t indexBuffer = 0;
+		};
+
+		// Describes what Geometry::PackInto wrote, the bytes stay with the caller
+		struct PackResult {
+			Desc desc;
+			BoundingBox bounds;
+		};
+
+		// A small cluster of triangles that is culled as a unit. The
+		// triangles of a meshlet are a contiguous range of the index buffer.
+		struct Meshlet {
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+			uint32_t vertexCount = 0;
+
+			// Bounding sphere in model space
+			glm::vec3 center = glm::vec3(0.0f);
+			float radius = 0.0f;
+
+			// Every triangle faces away from the camera when the view
+			// direction to the sphere is within the cone. A cutoff of 1 or
+			// more means the cluster can never be backface culled.
+			glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+			float coneCutoff = 1.0f;
+		};
+
 		class Geometry {
 		private:
 			Desc desc;
 			std::vector<BufferData> vertexBuffers;
 			BufferData indexBuffer;
 			BoundingBox boundingBox;
+			// Optional, empty unless built with BuildMeshlets
+			std::vector<Meshlet> meshlets;
+
+			template <typename I3T, typename V2T, typename V3T, typename V4T>
+			static Geometry Pack(const VertexFormatInfo& layout,
+				const DataView<I3T, V2T, V3T, V4T>& data,
+				ThreadPool* pool);
 
 		public:
 			const std::vector<BufferData>& GetVertexBuffers() const {
@@ -251,6 +317,28 @@ namespace okami {
 			static Geometry Pack(const VertexFormatInfo& layout,
 				const Data<I3T, V2T, V3T, V4T>& data);
 
+			// Splits the vertices into chunks of kPackChunkSize and packs
+			// them on the workers of pool, each chunk in a single fused pass
+			template <typename I3T, typename V2T, typename V3T, typename V4T>
+			static Geometry Pack(const VertexFormatInfo& layout,
+				const DataView<I3T, V2T, V3T, V4T>& data,
+				ThreadPool& pool);
+
+			static PackSizes GetPackSizes(const VertexFormatInfo& layout,
+				size_t vertexCount,
+				size_t indexCount);
+
+			// Packs into caller owned memory, such as a mapped GPU buffer or
+			// an arena, without allocating the buffers. The spans must be at
+			// least as large as GetPackSizes says. Bytes between attributes
+			// are left untouched.
+			template <typename I3T, typename V2T, typename V3T, typename V4T>
+			static PackResult PackInto(const VertexFormatInfo& layout,
+				const DataView<I3T, V2T, V3T, V4T>& data,
+				std::span<const std::span<uint8_t>> vertexBuffers,
+				std::span<uint8_t> indexBuffer,
+				ThreadPool* pool = nullptr);
+
 			template <typename I3T = uint32_t, 
 				typename V2T = glm::vec2, 
 				typename V3T = glm::vec3, 
@@ -287,8 +375,28 @@ namespace okami {
 
 			Geometry() = default;
 
+			inline Geometry(Desc desc,
+				std::vector<BufferData> vertexBuffers,
+				BufferData indexBuffer,
+				BoundingBox boundingBox,
+				std::vector<Meshlet> meshlets = {}) :
+				desc(std::move(desc)),
+				vertexBuffers(std::move(vertexBuffers)),
+				indexBuffer(std::move(indexBuffer)),
+				boundingBox(boundingBox),
+				meshlets(std::move(meshlets)) {
+			}
+
 			Geometry Duplicate();
-			Geometry ToLayout(const VertexFormatInfo& format);
+
+			// Converts straight from the current layout to format, one
+			// strided pass per attribute. Attributes that keep their format
+			// are copied as bytes, missing ones are filled with defaults.
+			Geometry ToLayout(const VertexFormatInfo& format) const&;
+			// As above, but reuses the vertex buffers when every attribute
+			// keeps its channel, offset and stride and does not grow. Bytes
+			// no longer covered by an attribute keep their old contents.
+			Geometry ToLayout(const VertexFormatInfo& format) &&;
 
 			inline void Dealloc() {
 				vertexBuffers.clear();
@@ -303,11 +411,49 @@ namespace okami {
 				return desc;
 			}
 
+			inline const std::vector<Meshlet>& GetMeshlets() const {
+				return meshlets;
+			}
+
+			inline bool HasMeshlets() const {
+				return !meshlets.empty();
+			}
+
 			inline VertexFormatInfo const& GetLayout() const {
 				return desc.layout;
 			}
 		};
 
+		struct SceneMesh {
+			std::string name;
+			Geometry geometry;
+			uint32_t materialIndex = 0;
+		};
+
+		struct SceneNode {
+			std::string name;
+			// -1 for the root
+			int parent = -1;
+			glm::mat4 localTransform = glm::mat4(1.0f);
+			// Accumulated over all ancestors
+			glm::mat4 globalTransform = glm::mat4(1.0f);
+			// Indices into Scene::meshes
+			std::vector<uint32_t> meshes;
+		};
+
+		struct Scene {
+			std::vector<SceneMesh> meshes;
+			// Parents always come before their children
+			std::vector<SceneNode> nodes;
+
+			// Imports every triangle mesh in the file, packing them in
+			// parallel on the given pool
+			static Scene Load(
+				const std::filesystem::path& path,
+				const VertexFormatInfo& layout,
+				ThreadPool& pool = ThreadPool::Default());
+		};
+
 		namespace prefabs {
 			Geometry MaterialBall(const VertexFormatInfo& layout);
 			Geometry UnitBox(const VertexFormatInfo& layout);
@@ -323,6 +469,21 @@ namespace okami {
 			const std::filesystem::path& path, 
 			const VertexFormatInfo& layout);
 
+		// Reads just the positions out of the packed vertex buffers
+		std::vector<glm::vec3> UnpackPositions(const Geometry& geometry);
+
+		// Smallest index type that can address every vertex. 0xFFFF is
+		// left free, so it never collides with a primitive restart index.
+		inline ValueType SelectIndexType(size_t vertexCount) {
+			return vertexCount <= 0xFFFF ? ValueType::UINT16 : ValueType::UINT32;
+		}
+
+		// Reads the indices widened to 32 bits, whatever the stored type
+		std::vector<uint32_t> UnpackIndices(const Geometry& geometry);
+
+		// Stores indices as indexType, which must be UINT16 or UINT32
+		BufferData PackIndices(std::span<const uint32_t> indices, ValueType indexType);
+
 		template <typename T>
 		struct V4Packer;
 
@@ -335,9 +496,16 @@ namespace okami {
 		template <typename T>
 		struct I3Packer;
 
+		// Packers whose source is already the tightly packed components of
+		// the destination declare kContiguous, so that whole slices can be
+		// moved by the bulk kernels instead of one element at a time
+		template <typename Packer>
+		concept ContiguousPacker = requires { requires Packer::kContiguous; };
+
 		template <>
 		struct V4Packer<glm::vec4> {
 			static constexpr size_t kStride = 1;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const glm::vec4* src) {
 				dest[0] = src->x;
@@ -357,6 +525,7 @@ namespace okami {
 		template <>
 		struct V4Packer<float> {
 			static constexpr size_t kStride = 4;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const float* src) {
 				dest[0] = src[0];
@@ -373,6 +542,7 @@ namespace okami {
 		template <>
 		struct V3Packer<glm::vec3> {
 			static constexpr size_t kStride = 1;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const glm::vec3* src) {
 				dest[0] = src->x;
@@ -390,6 +560,7 @@ namespace okami {
 		template <>
 		struct V3Packer<float> {
 			static constexpr size_t kStride = 3;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const float* src) {
 				dest[0] = src[0];
@@ -405,6 +576,7 @@ namespace okami {
 		template <>
 		struct V2Packer<glm::vec2> {
 			static constexpr size_t kStride = 1;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const glm::vec2* src) {
 				dest[0] = src->x;
@@ -420,6 +592,7 @@ namespace okami {
 		template <>
 		struct V2Packer<float> {
 			static constexpr size_t kStride = 2;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(float* dest, const float* src) {
 				dest[0] = src[0];
@@ -434,6 +607,7 @@ namespace okami {
 		template <>
 		struct I3Packer<uint32_t> {
 			static constexpr size_t kStride = 3;
+			static constexpr bool kContiguous = true;
 
 			inline static void Pack(uint32_t* dest, const uint32_t* src) {
 				dest[0] = src[0];
@@ -510,8 +684,8 @@ namespace okami {
 			size_t srcIndex = 0;
 			for (size_t i = 0; i < count; ++i, srcIndex += stride) {
 				for (size_t component = 0; component < dim; ++component) {
-					upper[component] = std::max<T>(upper[component], arr[srcIndex]);
-					lower[component] = std::min<T>(lower[component], arr[srcIndex]);
+					upper[component] = std::max<T>(upper[component], arr[srcIndex + component]);
+					lower[component] = std::min<T>(lower[component], arr[srcIndex + component]);
 				}
 			}
 		}
@@ -547,18 +721,26 @@ namespace okami {
 			return result;
 		}
 
-		inline BoundingBox ArraySliceBoundingBoxBytes(uint8_t* arr,
-			size_t stride, size_t count) {
-			std::array<float, 3> upper;
-			std::array<float, 3> lower;
+		// SIMD kernels for slices of dim tightly packed floats, where dim is
+		// 2, 3 or 4, to and from an interleaved vertex buffer
+		void ArraySliceCopyFloatsToBytes(uint8_t* dest, const float* source,
+			size_t destStrideBytes, size_t dim, size_t count);
 
-			ArraySliceBoundingBoxBytes<float, 3>(arr, stride, count, lower, upper);
+		void ArraySliceCopyFloatsFromBytes(float* dest, const uint8_t* source,
+			size_t srcStrideBytes, size_t dim, size_t count);
 
-			BoundingBox result;
-			result.mLower = glm::vec3(lower[0], lower[1], lower[2]);
-			result.mUpper = glm::vec3(upper[0], upper[1], upper[2]);
-			return result;
-		}
+		// Bounds of the float3 positions in an interleaved vertex buffer
+		BoundingBox ArraySliceBoundingBoxBytes(const uint8_t* arr,
+			size_t stride, size_t count);
+
+		// Copies float3 positions and reduces their bounds in the same pass
+		BoundingBox ArraySliceCopyPositionsToBytes(uint8_t* dest, const float* source,
+			size_t destStrideBytes, size_t count);
+
+		// Converts between 32 and 16 bit indices. Narrowing assumes every
+		// index fits in 16 bits.
+		void ArraySliceNarrowIndices(uint16_t* dest, const uint32_t* source, size_t count);
+		void ArraySliceWidenIndices(uint32_t* dest, const uint16_t* source, size_t count);
 
 		template <typename destT, size_t componentCount>
 		void ArraySliceFill(destT* dest,
@@ -566,9 +748,10 @@ namespace okami {
 			size_t stride,
 			size_t vertex_count) {
 
-			for (size_t i = 0; i < vertex_count; i += stride) {
+			size_t destIndex = 0;
+			for (size_t i = 0; i < vertex_count; ++i, destIndex += stride) {
 				for (size_t component = 0; component < componentCount; ++component) {
-					dest[i + component] = value;
+					dest[destIndex + component] = value;
 				}
 			}
 		}
@@ -579,14 +762,138 @@ namespace okami {
 			size_t stride,
 			size_t vertex_count) {
 
-			for (size_t i = 0; i < vertex_count; i += stride) {
-				auto dest_cast = reinterpret_cast<destT*>(&dest[i]);
-				for (size_t component = 0; component < componentCount; ++component) {
-					dest_cast[component] = value;
+			std::array<destT, componentCount> element;
+			element.fill(value);
+
+			size_t destIndex = 0;
+			for (size_t i = 0; i < vertex_count; ++i, destIndex += stride) {
+				std::memcpy(&dest[destIndex], element.data(), sizeof(element));
+			}
+		}
+
+		// Copies a slice through Packer, picking the bulk kernels at compile
+		// time when the packer is contiguous
+		template <size_t dim, typename Packer, typename T>
+		void PackerCopyToBytes(uint8_t* dest, const T* source,
+			size_t destStrideBytes, size_t count) {
+			if constexpr (ContiguousPacker<Packer>) {
+				static_assert(sizeof(T) * Packer::kStride == dim * sizeof(float));
+				ArraySliceCopyFloatsToBytes(dest, reinterpret_cast<const float*>(source),
+					destStrideBytes, dim, count);
+			} else {
+				ArraySliceCopyToBytes<float, T, &Packer::Pack>(
+					dest, source, destStrideBytes, Packer::kStride, count);
+			}
+		}
+
+		template <size_t dim, typename Packer, typename T>
+		void PackerCopyFromBytes(T* dest, const uint8_t* source,
+			size_t srcStrideBytes, size_t count) {
+			if constexpr (ContiguousPacker<Packer>) {
+				static_assert(sizeof(T) * Packer::kStride == dim * sizeof(float));
+				ArraySliceCopyFloatsFromBytes(reinterpret_cast<float*>(dest), source,
+					srcStrideBytes, dim, count);
+			} else {
+				ArraySliceCopyFromBytes<T, float, &Packer::Unpack>(
+					dest, source, Packer::kStride, srcStrideBytes, count);
+			}
+		}
+
+		// How the packers treat an attribute that is not stored as FLOAT32.
+		// Normalized integer positions are quantised relative to the
+		// bounding box of the geometry, and normalized integer directions
+		// with two components are octahedral encoded.
+		enum class AttributeSemantic {
+			Generic,
+			Position,
+			Direction
+		};
+
+		bool IsSupportedAttribute(AttributeSemantic semantic, const LayoutElement& element);
+
+		// Maps a unit vector onto the [-1, 1] square and back
+		glm::vec2 OctahedralEncode(const glm::vec3& direction);
+		glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+
+		// Converts count tightly packed float attributes into the format
+		// of element and back again
+		void EncodeAttribute(AttributeSemantic semantic,
+			const LayoutElement& element,
+			const BoundingBox& bounds,
+			const float* src,
+			size_t srcComponents,
+			uint8_t* dest,
+			size_t destStrideBytes,
+			size_t count);
+
+		void DecodeAttribute(AttributeSemantic semantic,
+			const LayoutElement& element,
+			const BoundingBox& bounds,
+			const uint8_t* src,
+			size_t srcStrideBytes,
+			float* dest,
+			size_t destComponents,
+			size_t count);
+
+		// Writes an attribute in the format of element, going through a
+		// float staging buffer unless the element is already FLOAT32
+		template <size_t dim, typename Packer, typename T>
+		void PackAttribute(uint8_t* dest,
+			size_t destStrideBytes,
+			const LayoutElement& element,
+			AttributeSemantic semantic,
+			const BoundingBox& bounds,
+			const T* src,
+			size_t count,
+			float fillValue) {
+			if (element.valueType == ValueType::FLOAT32) {
+				if (src) {
+					PackerCopyToBytes<dim, Packer>(dest, src, destStrideBytes, count);
+				} else {
+					ArraySliceFillBytes<float, dim>(dest, fillValue, destStrideBytes, count);
 				}
+				return;
+			}
+
+			std::vector<float> staging(dim * count, fillValue);
+			if (src) {
+				PackerCopyToBytes<dim, Packer>(reinterpret_cast<uint8_t*>(staging.data()),
+					src, dim * sizeof(float), count);
 			}
+			EncodeAttribute(semantic, element, bounds,
+				staging.data(), dim, dest, destStrideBytes, count);
 		}
 
+		template <size_t dim, typename Packer, typename T>
+		void UnpackAttribute(T* dest,
+			const uint8_t* src,
+			size_t srcStrideBytes,
+			const LayoutElement& element,
+			AttributeSemantic semantic,
+			const BoundingBox& bounds,
+			size_t count) {
+			if (element.valueType == ValueType::FLOAT32) {
+				PackerCopyFromBytes<dim, Packer>(dest, src, srcStrideBytes, count);
+				return;
+			}
+
+			std::vector<float> staging(dim * count);
+			DecodeAttribute(semantic, element, bounds,
+				src, srcStrideBytes, staging.data(), dim, count);
+			PackerCopyFromBytes<dim, Packer>(dest,
+				reinterpret_cast<const uint8_t*>(staging.data()), dim * sizeof(float), count);
+		}
+
+		// Offset and scale that take stored positions back to model space,
+		// the identity unless the positions are quantised
+		struct PositionDequantization {
+			glm::vec3 offset = glm::vec3(0.0f, 0.0f, 0.0f);
+			glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		};
+
+		PositionDequantization GetPositionDequantization(
+			const Desc& desc, const BoundingBox& bounds);
+
 		// Given a vertex layout, compute the offsets, strides, and channel sizes
 		// of each of the geometry elements in the layout
 		void ComputeLayoutProperties(
@@ -633,157 +940,277 @@ namespace okami {
 				size_t vertex_count);
 		};
 
-		template <typename I3T, typename V2T, typename V3T, typename V4T>
-		Geometry Geometry::Pack(const VertexFormatInfo& layout,
-			const DataView<I3T, V2T, V3T, V4T>& data) {
+		// Union of a set of bounds, infinitely inverted when empty
+		BoundingBox MergeBounds(std::span<const BoundingBox> bounds);
 
-			Geometry result;
+		template <typename Packer, typename T>
+		const T* SourceRange(const T* source, size_t begin) {
+			return source ? source + begin * Packer::kStride : nullptr;
+		}
 
-			if (layout.CheckValid().IsError()) {
-				throw std::runtime_error("Invalid vertex format!");
-			}
+		template <typename Packer, typename T>
+		const T* SourceRange(const std::vector<const T*>& sources, size_t index, size_t begin) {
+			return index < sources.size() ? SourceRange<Packer>(sources[index], begin) : nullptr;
+		}
 
-			size_t vertex_count = data.vertexCount;
-			size_t index_count = data.indexCount;
+		// Bounds of the source positions of vertices [begin, end)
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		BoundingBox SourcePositionBounds(const DataView<I3T, V2T, V3T, V4T>& data,
+			size_t begin, size_t end) {
+			using Packer = V3Packer<V3T>;
+			auto src = SourceRange<Packer>(data.positions, begin);
+			size_t count = end - begin;
+
+			if constexpr (ContiguousPacker<Packer>) {
+				return ArraySliceBoundingBoxBytes(
+					reinterpret_cast<const uint8_t*>(src), 3 * sizeof(float), count);
+			} else {
+				std::vector<float> staging(3 * count);
+				auto stagingBytes = reinterpret_cast<uint8_t*>(staging.data());
+				PackerCopyToBytes<3, Packer>(stagingBytes, src, 3 * sizeof(float), count);
+				return ArraySliceBoundingBoxBytes(stagingBytes, 3 * sizeof(float), count);
+			}
+		}
 
-			auto indexing = PackIndexing::From(layout, vertex_count);
+		// Writes every attribute of vertices [begin, end) into the vertex
+		// channels in one pass, so that an interleaved chunk stays in cache.
+		// Quantised positions are encoded against bounds. Returns the bounds
+		// of the chunk when the positions are written as FLOAT32.
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		BoundingBox PackVertexRange(const VertexFormatInfo& layout,
+			const PackIndexing& indexing,
+			const DataView<I3T, V2T, V3T, V4T>& data,
+			const BoundingBox& bounds,
+			std::span<uint8_t* const> channels,
+			size_t begin,
+			size_t end) {
 
-			auto& channel_sizes = indexing.channelSizes;
-			uint32_t channelCount = (uint32_t)channel_sizes.size();
-		
-			std::vector<std::vector<uint8_t>> vert_buffers(channelCount);
-			for (uint32_t i = 0; i < channelCount; ++i)
-				vert_buffers[i] = std::vector<uint8_t>(channel_sizes[i]);
+			using V2P = V2Packer<V2T>;
+			using V3P = V3Packer<V3T>;
+			using V4P = V4Packer<V4T>;
 
-			std::vector<uint8_t> indx_buffer_raw(index_count * sizeof(uint32_t));
-			uint32_t* indx_buffer = (uint32_t*)(&indx_buffer_raw[0]);
+			auto const& elements = layout.elements;
+			size_t count = end - begin;
 
-			BoundingBox aabb;
+			auto destRange = [&](int channel, int offset, int stride) {
+				return channels[channel] + offset + begin * stride;
+			};
 
-			bool hasNormals = data.normals != nullptr;
-			bool hasPositions = data.positions != nullptr;
-			bool hasBitangents = data.bitangents != nullptr;
-			bool hasTangents = data.tangents != nullptr;
+			BoundingBox chunkBounds;
+			chunkBounds.mLower = glm::vec3(std::numeric_limits<float>::infinity());
+			chunkBounds.mUpper = glm::vec3(-std::numeric_limits<float>::infinity());
 
 			if (indexing.positionOffset >= 0) {
-				auto& channel = vert_buffers[indexing.positionChannel];
-				auto arr = &channel[indexing.positionOffset];
-				if (hasPositions) {
-					ArraySliceCopyToBytes<float, V3T, &V3Packer<V3T>::Pack>(
-						arr, &data.positions[0], indexing.positionStride, V3Packer<V3T>::kStride, vertex_count);
-					aabb = ArraySliceBoundingBoxBytes(arr, (size_t)indexing.positionStride, vertex_count);
+				auto arr = destRange(indexing.positionChannel, indexing.positionOffset, indexing.positionStride);
+				auto src = SourceRange<V3P>(data.positions, begin);
+				auto const& element = elements[layout.position];
+				if (src && element.valueType == ValueType::FLOAT32) {
+					if constexpr (ContiguousPacker<V3P>) {
+						chunkBounds = ArraySliceCopyPositionsToBytes(arr,
+							reinterpret_cast<const float*>(src), indexing.positionStride, count);
+					} else {
+						PackerCopyToBytes<3, V3P>(arr, src, indexing.positionStride, count);
+						chunkBounds = ArraySliceBoundingBoxBytes(arr, (size_t)indexing.positionStride, count);
+					}
 				} else {
-					ArraySliceFillBytes<float, 3>(arr, 0.0f, indexing.positionStride, vertex_count);
-					aabb.mLower = glm::vec3(0.0f, 0.0f, 0.0f);
-					aabb.mUpper = glm::vec3(0.0f, 0.0f, 0.0f);
+					PackAttribute<3, V3P>(arr, indexing.positionStride,
+						element, AttributeSemantic::Position, bounds, src, count, 0.0f);
 				}
 			}
 
 			for (uint32_t iuv = 0; iuv < indexing.uvChannels.size(); ++iuv) {
-				auto& vertexChannel = vert_buffers[indexing.uvChannels[iuv]];
-				auto arr = &vertexChannel[indexing.uvOffsets[iuv]];
-				if (iuv < data.uvs.size()) {
-					ArraySliceCopyToBytes<float, V2T, &V2Packer<V2T>::Pack>(
-						arr, &data.uvs[iuv][0], indexing.uvStrides[iuv], V2Packer<V2T>::kStride, vertex_count);
-				} else {
-					ArraySliceFillBytes<float, 2>(arr, 0.0f, indexing.uvStrides[iuv], vertex_count);
-				}
+				auto arr = destRange(indexing.uvChannels[iuv], indexing.uvOffsets[iuv], indexing.uvStrides[iuv]);
+				PackAttribute<2, V2P>(arr, indexing.uvStrides[iuv],
+					elements[layout.uvs[iuv]], AttributeSemantic::Generic, bounds,
+					SourceRange<V2P>(data.uvs, iuv, begin), count, 0.0f);
 			}
 
 			if (indexing.normalOffset >= 0) {
-				auto& channel = vert_buffers[indexing.normalChannel];
-				auto arr = &channel[indexing.normalOffset];
-				if (hasNormals) {
-					ArraySliceCopyToBytes<float, V3T, &V3Packer<V3T>::Pack>(
-						arr, &data.normals[0], indexing.normalStride, V3Packer<V3T>::kStride, vertex_count);
-				} else {
-					ArraySliceFillBytes<float, 3>(arr, 0.0f, indexing.normalStride, vertex_count);
-				}
+				auto arr = destRange(indexing.normalChannel, indexing.normalOffset, indexing.normalStride);
+				PackAttribute<3, V3P>(arr, indexing.normalStride,
+					elements[layout.normal], AttributeSemantic::Direction, bounds,
+					SourceRange<V3P>(data.normals, begin), count, 0.0f);
 			}
 
 			if (indexing.tangentOffset >= 0) {
-				auto& channel = vert_buffers[indexing.tangentChannel];
-				auto arr = &channel[indexing.tangentOffset];
-				if (hasTangents) {
-					ArraySliceCopyToBytes<float, V3T, &V3Packer<V3T>::Pack>(
-						arr, &data.tangents[0], indexing.tangentStride, 
-							V3Packer<V3T>::kStride, vertex_count);
-				} else {
-					ArraySliceFillBytes<float, 3>(arr, 0.0f, indexing.tangentStride, vertex_count);
-				}
+				auto arr = destRange(indexing.tangentChannel, indexing.tangentOffset, indexing.tangentStride);
+				PackAttribute<3, V3P>(arr, indexing.tangentStride,
+					elements[layout.tangent], AttributeSemantic::Direction, bounds,
+					SourceRange<V3P>(data.tangents, begin), count, 0.0f);
 			}
 
 			if (indexing.bitangentOffset >= 0) {
-				auto& channel = vert_buffers[indexing.bitangentChannel];
-				auto arr = &channel[indexing.bitangentOffset];
-				if (hasBitangents) {
-					ArraySliceCopyToBytes<float, V3T, &V3Packer<V3T>::Pack>(
-						arr, &data.bitangents[0], indexing.bitangentStride, 
-							V3Packer<V3T>::kStride, vertex_count);
-				} else {
-					ArraySliceFillBytes<float, 3>(arr, 0.0f, indexing.bitangentStride, vertex_count);
-				}
+				auto arr = destRange(indexing.bitangentChannel, indexing.bitangentOffset, indexing.bitangentStride);
+				PackAttribute<3, V3P>(arr, indexing.bitangentStride,
+					elements[layout.bitangent], AttributeSemantic::Direction, bounds,
+					SourceRange<V3P>(data.bitangents, begin), count, 0.0f);
 			}
 
 			for (uint32_t icolor = 0; icolor < indexing.colorChannels.size(); ++icolor) {
-				auto& vertexChannel = vert_buffers[indexing.colorChannels[icolor]];
-				auto arr = &vertexChannel[indexing.colorOffsets[icolor]];
-				if (icolor < data.colors.size()) {
-					ArraySliceCopyToBytes<float, V4T, &V4Packer<V4T>::Pack>(
-						arr, &data.colors[icolor][0], indexing.colorStrides[icolor], 
-							V4Packer<V4T>::kStride, vertex_count);
-				} else {
-					ArraySliceFillBytes<float, 4>(arr, 1.0f, indexing.colorStrides[icolor], vertex_count);
-				}
+				auto arr = destRange(indexing.colorChannels[icolor], indexing.colorOffsets[icolor], indexing.colorStrides[icolor]);
+				PackAttribute<4, V4P>(arr, indexing.colorStrides[icolor],
+					elements[layout.colors[icolor]], AttributeSemantic::Generic, bounds,
+					SourceRange<V4P>(data.colors, icolor, begin), count, 1.0f);
 			}
 
 			for (uint32_t iuvw = 0; iuvw < indexing.uvwChannels.size(); ++iuvw) {
-				auto& vertexChannel = vert_buffers[indexing.uvwChannels[iuvw]];
-				auto arr = &vertexChannel[indexing.uvwOffsets[iuvw]];
-				if (iuvw < data.uvws.size()) {
-					ArraySliceCopyToBytes<float, V3T, &V3Packer<V3T>::Pack>(
-						arr, &data.uvws[iuvw][0], indexing.uvwStrides[iuvw],
-							V3Packer<V3T>::kStride, vertex_count);
+				auto arr = destRange(indexing.uvwChannels[iuvw], indexing.uvwOffsets[iuvw], indexing.uvwStrides[iuvw]);
+				PackAttribute<3, V3P>(arr, indexing.uvwStrides[iuvw],
+					elements[layout.uvws[iuvw]], AttributeSemantic::Generic, bounds,
+					SourceRange<V3P>(data.uvws, iuvw, begin), count, 0.0f);
+			}
+
+			return chunkBounds;
+		}
+
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		Geometry Geometry::Pack(const VertexFormatInfo& layout,
+			const DataView<I3T, V2T, V3T, V4T>& data) {
+			return Pack(layout, data, nullptr);
+		}
+
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		Geometry Geometry::Pack(const VertexFormatInfo& layout,
+			const DataView<I3T, V2T, V3T, V4T>& data,
+			ThreadPool& pool) {
+			return Pack(layout, data, &pool);
+		}
+
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		PackResult Geometry::PackInto(const VertexFormatInfo& layout,
+			const DataView<I3T, V2T, V3T, V4T>& data,
+			std::span<const std::span<uint8_t>> vertexBuffers,
+			std::span<uint8_t> indexBuffer,
+			ThreadPool* pool) {
+
+			if (layout.CheckValid().IsError()) {
+				throw std::runtime_error("Invalid vertex format!");
+			}
+
+			size_t vertex_count = data.vertexCount;
+			size_t index_count = data.indexCount;
+			bool isIndexed = data.indices != nullptr && index_count > 0;
+
+			auto indexing = PackIndexing::From(layout, vertex_count);
+
+			auto& channel_sizes = indexing.channelSizes;
+			size_t channelCount = channel_sizes.size();
+
+			if (vertexBuffers.size() < channelCount) {
+				throw std::runtime_error("Not enough vertex buffers to pack into!");
+			}
+			std::vector<uint8_t*> channels(channelCount);
+			for (size_t i = 0; i < channelCount; ++i) {
+				if (vertexBuffers[i].size() < channel_sizes[i]) {
+					throw std::runtime_error("Vertex buffer is too small to pack into!");
+				}
+				channels[i] = vertexBuffers[i].data();
+			}
+			auto indexType = SelectIndexType(vertex_count);
+			if (isIndexed && indexBuffer.size() < index_count * GetSize(indexType)) {
+				throw std::runtime_error("Index buffer is too small to pack into!");
+			}
+
+			size_t chunkCount = (vertex_count + kPackChunkSize - 1) / kPackChunkSize;
+			auto forEachChunk = [&](auto const& body) {
+				if (pool) {
+					pool->ParallelFor(chunkCount, [&](size_t chunk) {
+						body(chunk, chunk * kPackChunkSize,
+							std::min(vertex_count, (chunk + 1) * kPackChunkSize));
+					});
 				} else {
-					ArraySliceFillBytes<float, 3>(arr, 0.0f, indexing.uvwStrides[iuvw], vertex_count);
+					for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+						body(chunk, chunk * kPackChunkSize,
+							std::min(vertex_count, (chunk + 1) * kPackChunkSize));
+					}
 				}
+			};
+
+			BoundingBox aabb;
+			aabb.mLower = glm::vec3(0.0f, 0.0f, 0.0f);
+			aabb.mUpper = glm::vec3(0.0f, 0.0f, 0.0f);
+
+			bool hasPositions = data.positions != nullptr && indexing.positionOffset >= 0;
+			bool quantisedPositions = hasPositions &&
+				layout.elements[layout.position].valueType != ValueType::FLOAT32;
+
+			std::vector<BoundingBox> chunkBounds(chunkCount);
+
+			// Quantised positions need the bounds before anything is written
+			if (quantisedPositions) {
+				forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+					chunkBounds[chunk] = SourcePositionBounds(data, begin, end);
+				});
+				aabb = MergeBounds(chunkBounds);
 			}
 
-			if (data.indices != nullptr && data.indexCount > 0) {
-				ArraySliceCopy<uint32_t, I3T, &I3Packer<I3T>::Pack>(
-					&indx_buffer[0], &data.indices[0], 3, 
-					I3Packer<I3T>::kStride, index_count / 3);
+			forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+				chunkBounds[chunk] = PackVertexRange(layout, indexing, data, aabb, channels, begin, end);
+			});
+
+			if (hasPositions && !quantisedPositions) {
+				aabb = MergeBounds(chunkBounds);
 			}
 
-			IndexedAttribs indexedAttribs;
-			indexedAttribs.indexType = ValueType::UINT32;
-			indexedAttribs.numIndices = (uint32_t)(indx_buffer_raw.size() / sizeof(uint32_t));
-			
-			Attribs attribs;
-			attribs.numVertices = vertex_count;
+			if (isIndexed && indexType == ValueType::UINT16) {
+				auto indx_buffer = reinterpret_cast<uint16_t*>(indexBuffer.data());
+				if constexpr (ContiguousPacker<I3Packer<I3T>>) {
+					ArraySliceNarrowIndices(&indx_buffer[0],
+						reinterpret_cast<const uint32_t*>(&data.indices[0]),
+						(index_count / 3) * 3);
+				} else {
+					for (size_t i = 0; i < index_count / 3; ++i) {
+						uint32_t triangle[3];
+						I3Packer<I3T>::Pack(triangle, &data.indices[i * I3Packer<I3T>::kStride]);
+						ArraySliceNarrowIndices(&indx_buffer[3 * i], triangle, 3);
+					}
+				}
+			} else if (isIndexed) {
+				auto indx_buffer = reinterpret_cast<uint32_t*>(indexBuffer.data());
+				if constexpr (ContiguousPacker<I3Packer<I3T>>) {
+					std::memcpy(&indx_buffer[0], &data.indices[0],
+						(index_count / 3) * 3 * sizeof(uint32_t));
+				} else {
+					ArraySliceCopy<uint32_t, I3T, &I3Packer<I3T>::Pack>(
+						&indx_buffer[0], &data.indices[0], 3, 
+						I3Packer<I3T>::kStride, index_count / 3);
+				}
+			}
 
-			// Write to output geometry buffer
-			result.desc.isIndexed = (data.indices != nullptr && data.indexCount > 0);
-			result.desc.attribs = attribs;
-			result.desc.indexedAttribs = indexedAttribs;
+			PackResult result;
+			result.desc.isIndexed = isIndexed;
+			result.desc.attribs.numVertices = vertex_count;
+			result.desc.indexedAttribs.indexType = indexType;
+			result.desc.indexedAttribs.numIndices = (uint32_t)index_count;
 			result.desc.layout = layout;
 			result.desc.topology = data.topology;
+			result.bounds = aabb;
+			return result;
+		}
+
+		template <typename I3T, typename V2T, typename V3T, typename V4T>
+		Geometry Geometry::Pack(const VertexFormatInfo& layout,
+			const DataView<I3T, V2T, V3T, V4T>& data,
+			ThreadPool* pool) {
 
-			result.vertexBuffers.clear();
+			auto sizes = GetPackSizes(layout, data.vertexCount, data.indexCount);
 
-			for (uint32_t i = 0; i < channelCount; ++i) {
-				BufferData bufferData;
-				bufferData.bytes = std::move(vert_buffers[i]);
-				result.vertexBuffers.emplace_back(std::move(bufferData));
+			std::vector<BufferData> vertexBuffers(sizes.vertexBuffers.size());
+			std::vector<std::span<uint8_t>> vertexBytes;
+			for (size_t i = 0; i < vertexBuffers.size(); ++i) {
+				vertexBuffers[i].bytes.resize(sizes.vertexBuffers[i]);
+				vertexBytes.emplace_back(vertexBuffers[i].bytes);
 			}
 
-			BufferData indxBufferData;
-			indxBufferData.bytes = std::move(indx_buffer_raw);
-			result.indexBuffer = std::move(indxBufferData);
+			BufferData indexBuffer;
+			indexBuffer.bytes.resize(sizes.indexBuffer);
 
-			result.boundingBox = aabb;
+			auto packed = PackInto(layout, data, vertexBytes, indexBuffer.bytes, pool);
 
-			return result;
+			return Geometry(std::move(packed.desc),
+				std::move(vertexBuffers),
+				std::move(indexBuffer),
+				packed.bounds);
 		}
 
 		template <typename I3T, typename V2T, typename V3T, typename V4T>
@@ -798,26 +1225,26 @@ namespace okami {
 
 			size_t vertex_count = 0;
 			if (buffer.desc.isIndexed) {
-				if (buffer.desc.indexedAttribs.indexType != ValueType::UINT32) {
-					throw std::runtime_error("Index type must be VT_UINT32!");
-				}
-
-				result.indices.resize(buffer.desc.indexedAttribs.numIndices);
-				std::memcpy(&result.indices[0], &buffer.indexBuffer.bytes[0],
-					sizeof(uint32_t) * buffer.desc.indexedAttribs.numIndices);
+				auto indices = UnpackIndices(buffer);
+				result.indices.resize(indices.size());
+				std::memcpy(result.indices.data(), indices.data(),
+					sizeof(uint32_t) * indices.size());
 			}
 			
 			vertex_count = buffer.desc.attribs.numVertices;
 			auto& layout = buffer.desc.layout;
 			auto indexing = PackIndexing::From(layout, vertex_count);
 
+			auto const& elements = layout.elements;
+			auto const& bounds = buffer.boundingBox;
+
 			if (layout.position >= 0) {
 				result.positions.resize(V3Packer<V3T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.positionChannel].bytes[indexing.positionOffset];
-				ArraySliceCopyFromBytes<V3T, float, &V3Packer<V3T>::Unpack>(
-					&result.positions[0], arr, V3Packer<V3T>::kStride, 
-					indexing.positionStride, vertex_count);
+				UnpackAttribute<3, V3Packer<V3T>>(
+					&result.positions[0], arr, indexing.positionStride,
+					elements[layout.position], AttributeSemantic::Position, bounds, vertex_count);
 			}
 
 			result.uvs.resize(indexing.uvChannels.size());
@@ -825,36 +1252,36 @@ namespace okami {
 				result.uvs[iuv].resize(V2Packer<V2T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.uvChannels[iuv]].bytes[indexing.uvOffsets[iuv]];
-				ArraySliceCopyFromBytes<V2T, float, &V2Packer<V2T>::Unpack>(
-					&result.uvs[iuv][0], arr, V2Packer<V2T>::kStride,
-					indexing.uvStrides[iuv], vertex_count);
+				UnpackAttribute<2, V2Packer<V2T>>(
+					&result.uvs[iuv][0], arr, indexing.uvStrides[iuv],
+					elements[layout.uvs[iuv]], AttributeSemantic::Generic, bounds, vertex_count);
 			}
 
 			if (layout.normal >= 0) {
 				result.normals.resize(V3Packer<V3T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.normalChannel].bytes[indexing.normalOffset];
-				ArraySliceCopyFromBytes<V3T, float, &V3Packer<V3T>::Unpack>(
-					&result.normals[0], arr, V3Packer<V3T>::kStride,
-					indexing.normalStride, vertex_count);
+				UnpackAttribute<3, V3Packer<V3T>>(
+					&result.normals[0], arr, indexing.normalStride,
+					elements[layout.normal], AttributeSemantic::Direction, bounds, vertex_count);
 			}
 
 			if (layout.tangent >= 0) {
 				result.tangents.resize(V3Packer<V3T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.tangentChannel].bytes[indexing.tangentOffset];
-				ArraySliceCopyFromBytes<V3T, float, &V3Packer<V3T>::Unpack>(
-					&result.tangents[0], arr, V3Packer<V3T>::kStride, 
-					indexing.tangentStride, vertex_count);
+				UnpackAttribute<3, V3Packer<V3T>>(
+					&result.tangents[0], arr, indexing.tangentStride,
+					elements[layout.tangent], AttributeSemantic::Direction, bounds, vertex_count);
 			}
 
 			if (layout.bitangent >= 0) {
 				result.bitangents.resize(V3Packer<V3T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.bitangentChannel].bytes[indexing.bitangentOffset];
-				ArraySliceCopyFromBytes<V3T, float, &V3Packer<V3T>::Unpack>(
-					&result.bitangents[0], arr, V3Packer<V3T>::kStride, 
-					indexing.bitangentStride, vertex_count);
+				UnpackAttribute<3, V3Packer<V3T>>(
+					&result.bitangents[0], arr, indexing.bitangentStride,
+					elements[layout.bitangent], AttributeSemantic::Direction, bounds, vertex_count);
 			}
 
 			result.colors.resize(indexing.colorChannels.size());
@@ -862,9 +1289,9 @@ namespace okami {
 				result.colors[icolor].resize(V4Packer<V4T>::kStride * vertex_count);
 				auto arr = 
 					&buffer.vertexBuffers[indexing.colorChannels[icolor]].bytes[indexing.colorOffsets[icolor]];
-				ArraySliceCopyFromBytes<V4T, float, &V4Packer<V4T>::Unpack>(
-					&result.colors[icolor][0], arr, V4Packer<V4T>::kStride,
-					indexing.colorStrides[icolor], vertex_count);
+				UnpackAttribute<4, V4Packer<V4T>>(
+					&result.colors[icolor][0], arr, indexing.colorStrides[icolor],
+					elements[layout.colors[icolor]], AttributeSemantic::Generic, bounds, vertex_count);
 			}
 
 			return result;
@@ -891,4 +1318,5 @@ namespace okami {
 
 	using Geometry = geometry::Geometry;
 	using GeometryDesc = geometry::Desc;
+	using Scene = geometry::Scene;
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <okami/geometry.hpp>
+#include <okami/camera.hpp>
+#include <okami/transform.hpp>
+
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace okami {
+    // Per view, per instance LOD state, so that hysteresis has something
+    // to compare against
+    struct LODState {
+        uint32_t level = 0;
+    };
+
+    // Returns the diameter of the bounding sphere of bounds, as a fraction
+    // of the viewport height, when placed with the given world view matrix.
+    float ProjectedScreenSize(
+        BoundingBox const& bounds,
+        glm::mat4 const& worldView,
+        glm::mat4 const& proj);
+    float ProjectedScreenSize(
+        BoundingBox const& bounds,
+        WorldTransform const& transform,
+        RenderView const& view);
+
+    // screenSizes[i] is the smallest projected screen size at which LOD i is
+    // still used, and must be decreasing. A level only changes once the
+    // screen size passes the threshold by more than the hysteresis fraction,
+    // so objects sitting near a threshold do not flicker between levels.
+    uint32_t SelectLOD(
+        std::span<float const> screenSizes,
+        float screenSize,
+        uint32_t currentLevel,
+        float hysteresis);
+
+    namespace geometry {
+        struct SimplifyParams {
+            // Fraction of triangles to keep
+            float targetRatio = 0.5f;
+            // Collapses with a larger quadric error than this are not performed
+            float maxError = std::numeric_limits<float>::infinity();
+        };
+
+        // Quadric error edge collapse simplification. Vertices are only ever
+        // collapsed onto other existing vertices, so all attributes stay valid.
+        // Vertices on open boundaries are locked, while attribute seam
+        // vertices are welded and can only slide along their seam.
+        Geometry Simplify(Geometry const& geometry, SimplifyParams const& params);
+
+        struct LODGroup {
+            // Level 0 is the most detailed
+            std::vector<Geometry> levels;
+            std::vector<float> screenSizes;
+
+            inline BoundingBox const& GetBounds() const {
+                return levels.front().GetBounds();
+            }
+
+            inline uint32_t Select(float screenSize, LODState& state, float hysteresis) const {
+                state.level = SelectLOD(screenSizes, screenSize, state.level, hysteresis);
+                return state.level;
+            }
+
+            // Builds a LOD chain from a base mesh by repeated simplification,
+            // meant to be run offline as part of asset cooking. ratios[i] is the
+            // triangle ratio of level i + 1 relative to the base mesh, and
+            // screenSizes needs one entry per level, including the base.
+            static LODGroup Generate(
+                Geometry&& base,
+                std::span<float const> ratios,
+                std::span<float const> screenSizes);
+        };
+    }
+
+    using LODGroup = geometry::LODGroup;
+}
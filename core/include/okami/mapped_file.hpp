@@ -0,0 +1,42 @@
+#pragma once
+
+#include <okami/error.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace okami {
+    // Read only memory mapping of an entire file. Pages are only read from
+    // disk as they are touched.
+    class MappedFile {
+    private:
+        void const* _data = nullptr;
+        size_t _size = 0;
+#ifdef _WIN32
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#else
+        int _file = -1;
+#endif
+
+        void Close();
+
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        inline bool IsOpen() const { return _data != nullptr; }
+        inline size_t GetSize() const { return _size; }
+        inline std::span<uint8_t const> GetBytes() const {
+            return {static_cast<uint8_t const*>(_data), _size};
+        }
+
+        static Expected<MappedFile> Open(std::filesystem::path const& path);
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <okami/geometry.hpp>
+#include <okami/mapped_file.hpp>
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace okami {
+    namespace geometry {
+        // The okmesh format stores geometry exactly as it is uploaded to the GPU:
+        //
+        //   MeshFileHeader
+        //   MeshFileBufferEntry[vertexBufferCount]
+        //   serialized Desc
+        //   vertex buffers and index buffer, each aligned to kMeshFileAlignment
+        //
+        // so that loading is a matter of mapping the file and pointing at it.
+        constexpr char kMeshFileMagic[8] = {'O', 'K', 'M', 'E', 'S', 'H', '\0', '\0'};
+        constexpr uint32_t kMeshFileVersion = 2;
+        constexpr size_t kMeshFileAlignment = 16;
+        constexpr std::string_view kMeshFileExtension = ".okmesh";
+
+        struct MeshFileBufferEntry {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        struct MeshFileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t vertexBufferCount;
+            // Hash of whatever the file was cooked from
+            uint64_t contentHash;
+            BoundingBox bounds;
+            uint32_t reserved;
+            MeshFileBufferEntry desc;
+            MeshFileBufferEntry indexBuffer;
+        };
+
+        // A mapped okmesh file. The buffer views point into the mapping and stay
+        // valid for as long as the MeshFile is alive.
+        class MeshFile {
+        private:
+            MappedFile _file;
+            Desc _desc;
+            BoundingBox _bounds;
+            uint64_t _contentHash = 0;
+            std::vector<std::span<uint8_t const>> _vertexBuffers;
+            std::span<uint8_t const> _indexBuffer;
+
+        public:
+            inline Desc const& GetDesc() const { return _desc; }
+            inline BoundingBox const& GetBounds() const { return _bounds; }
+            inline uint64_t GetContentHash() const { return _contentHash; }
+            inline std::vector<std::span<uint8_t const>> const& GetVertexBuffers() const {
+                return _vertexBuffers;
+            }
+            inline std::span<uint8_t const> GetIndexBuffer() const { return _indexBuffer; }
+
+            // Copies the mapped buffers into a standalone Geometry
+            Geometry ToGeometry() const;
+
+            static Expected<MeshFile> Open(std::filesystem::path const& path);
+            // Views okmesh bytes that are already in memory, which must outlive
+            // the result
+            static Expected<MeshFile> Parse(std::span<uint8_t const> bytes);
+            static Error Write(std::filesystem::path const& path,
+                Geometry const& geometry,
+                uint64_t contentHash = 0);
+        };
+
+        // FNV-1a
+        uint64_t HashBytes(std::span<uint8_t const> bytes,
+            uint64_t seed = 0xcbf29ce484222325ull);
+
+        // Offline cook step. Imports source with Assimp and writes the result to
+        // cacheDirectory, unless an okmesh cooked from identical content with an
+        // identical layout is already there. Returns the path of the okmesh.
+        Expected<std::filesystem::path> CookMesh(
+            std::filesystem::path const& source,
+            std::filesystem::path const& cacheDirectory,
+            VertexFormatInfo const& layout);
+
+        namespace prefabs {
+            // Layouts that the prefab meshes are embedded in, already packed.
+            // The first is lossless and every other layout is remapped from it.
+            constexpr VertexFormat kPrefabMeshFormats[] = {
+                VertexFormat::PositionUVNormalTangentBitangent,
+                VertexFormat::PositionUVNormal,
+                VertexFormat::PositionUV,
+                VertexFormat::PositionUVCompact
+            };
+
+            // Name of the embedded okmesh holding a prefab in format
+            std::string GetPrefabMeshName(std::string_view prefab, VertexFormat format);
+
+            // Views an embedded prefab mesh without copying it, for instance
+            // to upload it straight to the GPU
+            Expected<MeshFile> OpenPrefabMesh(std::string_view prefab, VertexFormat format);
+        }
+    }
+
+    using MeshFile = geometry::MeshFile;
+}
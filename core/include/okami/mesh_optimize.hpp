@@ -0,0 +1,49 @@
+#pragma once
+
+#include <okami/geometry.hpp>
+
+#include <span>
+#include <vector>
+
+namespace okami::geometry {
+    // Average number of post transform cache misses per triangle, simulated
+    // with a FIFO cache. 0.5 is the best possible for a regular grid, 3 is
+    // the worst.
+    float ComputeACMR(std::span<uint32_t const> indices,
+        size_t vertexCount,
+        uint32_t cacheSize = 16);
+    float ComputeACMR(Geometry const& geometry, uint32_t cacheSize = 16);
+
+    // Reorders triangles for post transform cache locality, following
+    // Forsyth's linear speed vertex cache optimisation.
+    void OptimizeVertexCache(std::span<uint32_t> indices,
+        size_t vertexCount,
+        uint32_t cacheSize = 32);
+
+    // Splits an already cache optimised index buffer into clusters and
+    // sorts them so that outward facing clusters are drawn first, following
+    // Sander et al. threshold is how much worse than the input the ACMR
+    // may get in exchange.
+    void OptimizeOverdraw(std::span<uint32_t> indices,
+        std::span<glm::vec3 const> positions,
+        float threshold = 1.05f,
+        uint32_t cacheSize = 16);
+
+    // Renumbers vertices in order of first use, so that vertex fetches walk
+    // memory linearly. Rewrites indices and returns the new index of every
+    // old vertex. Unreferenced vertices are moved to the end.
+    std::vector<uint32_t> OptimizeVertexFetch(std::span<uint32_t> indices,
+        size_t vertexCount);
+
+    struct OptimizeParams {
+        bool vertexCache = true;
+        bool overdraw = true;
+        bool vertexFetch = true;
+        float overdrawThreshold = 1.05f;
+    };
+
+    // Optional post pack stage, returns a copy with reordered triangles and
+    // vertices that renders identically. The ACMR never ends up higher than
+    // the input's.
+    Geometry Optimize(Geometry const& geometry, OptimizeParams const& params = {});
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <okami/geometry.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace okami::geometry {
+    constexpr uint32_t kMeshletMaxVertices = 64;
+    constexpr uint32_t kMeshletMaxTriangles = 124;
+
+    struct MeshletParams {
+        uint32_t maxVertices = kMeshletMaxVertices;
+        uint32_t maxTriangles = kMeshletMaxTriangles;
+    };
+
+    // Greedily grows clusters over shared vertices, preferring triangles
+    // that add the fewest new vertices. Reorders the triangles of indices
+    // so that every meshlet is a contiguous range. Front faces are those
+    // whose normal cross(b - a, c - a) points outwards.
+    std::vector<Meshlet> BuildMeshlets(std::span<uint32_t> indices,
+        std::span<glm::vec3 const> positions,
+        MeshletParams const& params = {});
+
+    // Returns a copy of geometry whose index buffer is grouped into meshlets
+    Geometry BuildMeshlets(Geometry const& geometry, MeshletParams const& params = {});
+
+    // The view of one instance, in the model space of its geometry
+    struct MeshletCullView {
+        // Inward facing, normalized planes
+        std::array<glm::vec4, 6> planes;
+        glm::vec3 eye = glm::vec3(0.0f);
+        // Used instead of the eye for orthographic projections
+        glm::vec3 viewDirection = glm::vec3(0.0f, 0.0f, 1.0f);
+        bool perspective = true;
+        // Only valid when back faces are not drawn
+        bool coneCulling = false;
+
+        static MeshletCullView From(glm::mat4 const& worldView,
+            glm::mat4 const& proj,
+            bool coneCulling = false);
+    };
+
+    bool IsMeshletVisible(Meshlet const& meshlet, MeshletCullView const& view);
+}
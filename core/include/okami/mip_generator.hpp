@@ -1,11 +1,17 @@
 #pragma once
 
+#include <okami/texture.hpp>
+
 #include <cmath>
 #include <array>
 #include <cassert>
 #include <cstdint>
+#include <limits>
 
 namespace okami {
+	// Fills the coarse rows [CoarseRowBegin, CoarseRowEnd), so that a mip can
+	// be split into bands that are generated concurrently. Strides are in
+	// bytes.
 	typedef void (*mip_generator_2d_t)(
         uint32_t NumChannels,
 		bool IsSRGB,
@@ -16,7 +22,9 @@ namespace okami {
 		void* pCoarseMip,
 		uint32_t CoarseMipStride,
 		uint32_t CoarseMipWidth,
-		uint32_t CoarseMipHeight);
+		uint32_t CoarseMipHeight,
+		uint32_t CoarseRowBegin,
+		uint32_t CoarseRowEnd);
 
     inline float LinearToSRGB(float x)
 	{
@@ -68,13 +76,13 @@ namespace okami {
 		std::array<float, 256> m_ToLinear;
 	};
 
-	float LinearToSRGB(uint8_t x)
+	inline float LinearToSRGB(uint8_t x)
 	{
 		static const LinearToSRGBMap map;
 		return map[x];
 	}
 
-	float SRGBToLinear(uint8_t x)
+	inline float SRGBToLinear(uint8_t x)
 	{
 		static const SRGBToLinearMap map;
 		return map[x];
@@ -110,7 +118,7 @@ namespace okami {
 	}
 
 	template <>
-	float LinearAverage<float>(float c0, float c1, float c2, float c3) {
+	inline float LinearAverage<float>(float c0, float c1, float c2, float c3) {
 		return (c0 + c1 + c2 + c3) / 4.0f;
 	}
 
@@ -124,18 +132,22 @@ namespace okami {
 						void*           pCoarseMip,
 						uint32_t        CoarseMipStride,
 						uint32_t        CoarseMipWidth,
-						uint32_t        CoarseMipHeight)
+						uint32_t        CoarseMipHeight,
+						uint32_t        CoarseRowBegin,
+						uint32_t        CoarseRowEnd)
 	{
 		assert(FineMipWidth > 0 && FineMipHeight > 0 && FineMipStride > 0);
 		assert(CoarseMipWidth > 0 && CoarseMipHeight > 0 && CoarseMipStride > 0);
+		assert(CoarseRowBegin <= CoarseRowEnd && CoarseRowEnd <= CoarseMipHeight);
 
-		for (uint32_t row = 0; row < CoarseMipHeight; ++row)
+		for (uint32_t row = CoarseRowBegin; row < CoarseRowEnd; ++row)
 		{
 			auto src_row0 = row * 2;
 			auto src_row1 = std::min(row * 2 + 1, FineMipHeight - 1);
 
-			auto pSrcRow0 = (reinterpret_cast<const ChannelType*>(pFineMip) + src_row0 * FineMipStride);
-			auto pSrcRow1 = (reinterpret_cast<const ChannelType*>(pFineMip) + src_row1 * FineMipStride);
+			auto pSrcRow0 = reinterpret_cast<const ChannelType*>(reinterpret_cast<const uint8_t*>(pFineMip) + src_row0 * FineMipStride);
+			auto pSrcRow1 = reinterpret_cast<const ChannelType*>(reinterpret_cast<const uint8_t*>(pFineMip) + src_row1 * FineMipStride);
+			auto pDstRow = reinterpret_cast<ChannelType*>(reinterpret_cast<uint8_t*>(pCoarseMip) + row * CoarseMipStride);
 
 			for (uint32_t col = 0; col < CoarseMipWidth; ++col)
 			{
@@ -149,7 +161,7 @@ namespace okami {
 					auto Chnl10 = pSrcRow1[src_col0 * NumChannels + c];
 					auto Chnl11 = pSrcRow1[src_col1 * NumChannels + c];
 
-					auto& DstCol = (reinterpret_cast<ChannelType*>(pCoarseMip) + row * CoarseMipStride)[col * NumChannels + c];
+					auto& DstCol = pDstRow[col * NumChannels + c];
 					
                     if (IsSRGB)
 						DstCol = SRGBAverage(Chnl00, Chnl01, Chnl10, Chnl11);
@@ -159,4 +171,32 @@ namespace okami {
 			}
 		}
 	}
-}
\ No newline at end of file
+
+	// Box filter for 4 channel, 8 bit mips, vectorised with SSE2 where
+	// available. sRGB colour channels are decoded through a table, averaged
+	// as 16 bit linear values and encoded through a second table. Alpha is
+	// always averaged linearly. Matches mip_generator_2d_t, NumChannels must
+	// be 4.
+	void ComputeCoarseMip2D_RGBA8(uint32_t NumChannels,
+						bool            IsSRGB,
+						const void*     pFineMip,
+						uint32_t        FineMipStride,
+						uint32_t        FineMipWidth,
+						uint32_t        FineMipHeight,
+						void*           pCoarseMip,
+						uint32_t        CoarseMipStride,
+						uint32_t        CoarseMipWidth,
+						uint32_t        CoarseMipHeight,
+						uint32_t        CoarseRowBegin,
+						uint32_t        CoarseRowEnd);
+
+	// The generator for a pixel format and filter. Unweighted box filtering
+	// uses the 2x2 kernels above. Everything else goes through separable
+	// polyphase filters evaluated in float, vectorised with SSE2 where
+	// available, which also resample odd dimensions properly. Returns nullptr
+	// when the format is not supported.
+	mip_generator_2d_t GetMipGenerator(ValueType Type,
+		uint32_t NumChannels,
+		texture::MipFilter Filter,
+		bool AlphaWeighted);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <okami/geometry.hpp>
+#include <okami/camera.hpp>
+#include <okami/transform.hpp>
+
+#include <span>
+#include <vector>
+
+namespace okami {
+    // A low resolution depth buffer that selected occluders are rasterized
+    // into on the CPU, together with a hierarchical Z pyramid that bounding
+    // boxes are tested against. No GPU readback is involved.
+    //
+    // Usage per view: Clear, RasterizeOccluder for each occluder,
+    // BuildHierarchy and then IsVisible for each candidate.
+    class OcclusionBuffer {
+    private:
+        struct Level {
+            uint32_t width;
+            uint32_t height;
+            std::vector<float> depth;
+        };
+
+        // Width of level 0 is padded to a multiple of the SIMD width
+        uint32_t _width;
+        uint32_t _height;
+        // Level 0 holds the rasterized depth, each level above the farthest
+        // depth of the 2x2 texels below it
+        std::vector<Level> _levels;
+        RenderView _view;
+        glm::mat4 _viewProj;
+
+        std::vector<glm::vec4> _clipScratch;
+
+        void RasterizeTriangle(glm::vec4 const& c0, glm::vec4 const& c1, glm::vec4 const& c2);
+
+    public:
+        OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+        inline uint32_t GetWidth() const { return _width; }
+        inline uint32_t GetHeight() const { return _height; }
+        // Depth is stored in [0, 1], with 1 being the far plane
+        inline std::span<float const> GetDepth() const { return _levels.front().depth; }
+
+        void Clear(RenderView const& view);
+
+        void RasterizeOccluder(
+            std::span<glm::vec3 const> positions,
+            std::span<uint32_t const> indices,
+            WorldTransform const& transform);
+        // Reads positions and indices straight out of the packed buffers
+        void RasterizeOccluder(
+            Geometry const& geometry,
+            WorldTransform const& transform);
+
+        void BuildHierarchy();
+
+        // Conservative, returns true unless the box is certainly hidden
+        bool IsVisible(BoundingBox const& bounds, glm::mat4 const& worldViewProj) const;
+        bool IsVisible(BoundingBox const& bounds, WorldTransform const& transform) const;
+    };
+}
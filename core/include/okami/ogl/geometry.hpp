@@ -1,6 +1,8 @@
 #pragma once
 
 #include <okami/geometry.hpp>
+#include <okami/lod.hpp>
+#include <okami/mesh_file.hpp>
 #include <okami/ogl/utils.hpp>
 
 namespace okami {
@@ -9,11 +11,97 @@ namespace okami {
         GLBuffer indexBuffer;
         GLVertexArray vertexArray;
         GeometryDesc desc;
+        BoundingBox bounds;
+        // Takes quantised positions back to model space in the shader
+        geometry::PositionDequantization dequantization;
+        // Drawn cluster by cluster when not empty
+        std::vector<geometry::Meshlet> meshlets;
 
         GLGeometry() = default;
         OKAMI_MOVE_ONLY(GLGeometry);
 
         static Expected<GLGeometry> Create(Geometry const& geometry);
+        // Frees the CPU side buffers of geometry as soon as they are uploaded
         static Expected<GLGeometry> Create(Geometry&& geometry);
+        // Uploads straight from the mapped file
+        static Expected<GLGeometry> Create(MeshFile const& file);
+        static Expected<GLGeometry> Create(GeometryDesc const& desc,
+            BoundingBox const& bounds,
+            std::span<std::span<uint8_t const> const> vertexBuffers,
+            std::span<uint8_t const> indexBuffer);
+
+        // Packs straight into mapped GL buffers, so the vertex data is
+        // written once instead of packed on the CPU and then copied
+        template <typename I3T, typename V2T, typename V3T, typename V4T>
+        static Expected<GLGeometry> Pack(VertexFormatInfo const& layout,
+            geometry::DataView<I3T, V2T, V3T, V4T> const& data,
+            ThreadPool* pool = nullptr);
+
+        // Binds the vertex array with the per instance elements read from
+        // buffer, starting offset bytes in. GL 3.3 has no base instance, so
+        // instanced draws pick their range of buffer through offset.
+        Error BindInstances(std::span<LayoutElement const> elements,
+            GLBuffer const& buffer,
+            size_t offset) const;
+        // Disables the per instance elements again. The vertex array is
+        // shared with non-instanced draws, which would otherwise still
+        // fetch from the instance buffer.
+        Error UnbindInstances(std::span<LayoutElement const> elements) const;
+
+    private:
+        Error MapBuffers(geometry::PackSizes const& sizes,
+            std::vector<std::span<uint8_t>>& vertexBytes,
+            std::span<uint8_t>& indexBytes);
+        Error UnmapBuffers(geometry::PackSizes const& sizes);
+        // Reports why packing threw and unmaps the buffers again
+        Error AbortPack(geometry::PackSizes const& sizes, std::exception const& e);
+        Error CreateVertexArray();
+    };
+
+    template <typename I3T, typename V2T, typename V3T, typename V4T>
+    Expected<GLGeometry> GLGeometry::Pack(VertexFormatInfo const& layout,
+        geometry::DataView<I3T, V2T, V3T, V4T> const& data,
+        ThreadPool* pool) {
+        GLGeometry geo;
+        std::vector<std::span<uint8_t>> vertexBytes;
+        std::span<uint8_t> indexBytes;
+        auto sizes = Geometry::GetPackSizes(layout, data.vertexCount, data.indexCount);
+        auto err = geo.MapBuffers(sizes, vertexBytes, indexBytes);
+        OKAMI_EXP_RETURN(err);
+
+        geometry::PackResult packed;
+        try {
+            packed = Geometry::PackInto(layout, data, vertexBytes, indexBytes, pool);
+        } catch (std::exception const& e) {
+            err = geo.AbortPack(sizes, e);
+            return MakeUnexpected(std::move(err));
+        }
+
+        err = geo.UnmapBuffers(sizes);
+        OKAMI_EXP_RETURN(err);
+
+        geo.desc = std::move(packed.desc);
+        geo.bounds = packed.bounds;
+        err = geo.CreateVertexArray();
+        OKAMI_EXP_RETURN(err);
+
+        return geo;
+    }
+
+    struct GLLODGroup {
+        std::vector<GLGeometry> levels;
+        std::vector<float> screenSizes;
+        BoundingBox bounds;
+
+        GLLODGroup() = default;
+        OKAMI_MOVE_ONLY(GLLODGroup);
+
+        // Picks the level to draw for an instance in the given view
+        GLGeometry const& Select(RenderView const& view,
+            WorldTransform const& transform,
+            LODState& state,
+            float hysteresis = 0.1f) const;
+
+        static Expected<GLLODGroup> Create(LODGroup const& group);
     };
 }
\ No newline at end of file
@@ -7,5 +7,7 @@ namespace okami {
         glm::vec4 color{1.0f, 1.0f, 1.0f, 1.0f};
         GLTexture const* texture = nullptr;
         SamplerType textureSampler = SamplerType::LINEAR_WRAP;
+        // Layer sampled when texture is a texture array, see GLTextureAtlas
+        uint32_t textureLayer = 0;
     };
 }
\ No newline at end of file
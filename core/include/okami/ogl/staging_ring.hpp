@@ -0,0 +1,75 @@
+#pragma once
+
+#include <okami/ogl/utils.hpp>
+
+#include <deque>
+#include <span>
+
+namespace okami {
+    // Default size of the ring that texture uploads are staged through
+    constexpr size_t kDefaultStagingRingSize = 32 * 1024 * 1024;
+
+    // A GL_PIXEL_UNPACK_BUFFER that uploads are staged through in order.
+    // The buffer stays mapped for its whole life where buffer storage is
+    // available. Fences mark how far the GPU has read, so that space is
+    // only reused once the uploads from it have completed.
+    class GLStagingRing {
+    public:
+        struct Allocation {
+            // Offset to pass to GL while the ring is bound
+            size_t offset;
+            std::span<uint8_t> memory;
+        };
+
+    private:
+        struct PendingFence {
+            GLsync sync;
+            // Ring position up to which the fenced uploads read
+            uint64_t end;
+        };
+
+        GLBuffer _buffer;
+        uint8_t* _mapped = nullptr;
+        size_t _size = 0;
+        bool _isPersistent = false;
+        bool _isMapped = false;
+        // Positions count every byte ever allocated, the offset in the
+        // buffer is the position modulo the size
+        uint64_t _head = 0;
+        uint64_t _tail = 0;
+        uint64_t _fencedHead = 0;
+        // Start of the allocations written since the last Bind
+        uint64_t _boundHead = 0;
+        std::deque<PendingFence> _fences;
+
+        // Frees the space of completed uploads, blocking on the oldest
+        // fence if wait is set
+        void Retire(bool wait);
+
+    public:
+        GLStagingRing() = default;
+        ~GLStagingRing();
+
+        GLStagingRing(GLStagingRing&& other) noexcept;
+        GLStagingRing& operator=(GLStagingRing&& other) noexcept;
+        OKAMI_NO_COPY(GLStagingRing);
+
+        inline size_t GetSize() const { return _size; }
+        inline bool IsPersistent() const { return _isPersistent; }
+        inline GLuint GetBuffer() const { return *_buffer; }
+
+        // Reserves contiguous space, waiting for the GPU to finish with
+        // older uploads if the ring is full. Fails if size exceeds the ring.
+        // Without buffer storage the memory is only mapped until Bind.
+        Expected<Allocation> Allocate(size_t size, size_t alignment = 16);
+
+        // Makes everything allocated so far visible to GL, and binds the
+        // ring to GL_PIXEL_UNPACK_BUFFER. Call before issuing the uploads.
+        Error Bind();
+
+        // Call after issuing the uploads that read the allocations so far
+        Error Fence();
+
+        static Expected<GLStagingRing> Create(size_t size = kDefaultStagingRingSize);
+    };
+}
@@ -6,6 +6,8 @@
 #include <okami/ogl/material.hpp>
 #include <okami/transform.hpp>
 #include <okami/camera.hpp>
+#include <okami/occlusion.hpp>
+#include <okami/meshlet.hpp>
 
 #include <span>
 
@@ -29,6 +31,15 @@ namespace okami {
         void Set(glm::mat4 const& world) const;
     };
 
+    struct GLPositionUniformBlock {
+        GLint uPositionOffset;
+        GLint uPositionScale;
+
+        static Expected<GLPositionUniformBlock> Create(GLProgram const& program);
+
+        void Set(geometry::PositionDequantization const& dequantization) const;
+    };
+
     struct GLTexturedUniformBlock {
         GLint uTextureSampler;
         GLint uColor;
@@ -40,20 +51,53 @@ namespace okami {
             GLDefaultSamplers const& samplers) const;
     };
 
+    struct GLTextureArrayUniformBlock {
+        GLint uTextureLayer;
+
+        static Expected<GLTextureArrayUniformBlock> Create(GLProgram const& program);
+
+        void Set(GLTexturedMaterial const& mat) const;
+    };
+
+    // The static mesh shaders, built either for 2D textures or for layers
+    // of texture arrays, and with the world matrix either in a uniform or
+    // in per instance attributes
+    struct GLStaticMeshProgram {
+        GLProgram program;
+        GLCameraUniformBlock cameraUniforms;
+        // Unset when instanced
+        GLWorldUniformBlock worldUniforms{-1, -1};
+        GLPositionUniformBlock positionUniforms;
+        GLTexturedUniformBlock texturedUniforms;
+        // Only for texture arrays
+        std::optional<GLTextureArrayUniformBlock> arrayUniforms;
+
+        static Expected<GLStaticMeshProgram> Create(bool textureArray, bool instanced);
+    };
+
     struct GLStaticMeshRenderCall {
         GLGeometry const& geometry;
         std::optional<GLTexturedMaterial> material;
-        Transform transform;
+        WorldTransform transform;
     };
 
+    // Drops the calls whose geometry bounds are hidden behind the occluders
+    // in buffer. The hierarchy of buffer must already be built.
+    std::vector<GLStaticMeshRenderCall> CullOccluded(
+        std::span<GLStaticMeshRenderCall const> calls,
+        OcclusionBuffer const& buffer);
+
     class GLStaticMeshRenderer {
     private:
-        GLProgram _renderProgram;
-        GLCameraUniformBlock _cameraUniforms;
-        GLWorldUniformBlock _worldUniforms;
-        GLTexturedUniformBlock _texturedUniforms;
+        GLStaticMeshProgram _renderProgram;
+        GLStaticMeshProgram _arrayProgram;
+        GLStaticMeshProgram _instancedProgram;
+        GLStaticMeshProgram _instancedArrayProgram;
+        // World matrices of the instanced draws, refilled every Draw
+        GLBuffer _instanceBuffer;
         GLDefaultSamplers _samplers;
         GLTexture _defaultTexture;
+        bool _meshletConeCulling = false;
 
     public:
         static Expected<GLStaticMeshRenderer> Create();
@@ -61,6 +105,26 @@ namespace okami {
         inline static VertexFormatInfo GetVertexFormat() {
             return VertexFormatInfo::PositionUV();
         }
+        // Same attributes at a fraction of the memory
+        inline static VertexFormatInfo GetCompactVertexFormat() {
+            return VertexFormatInfo::PositionUVCompact();
+        }
+        // Per instance attributes of the instanced programs, the world
+        // matrix relative to the view origin as four columns
+        static std::span<LayoutElement const> GetInstanceLayout();
+
+        // Also drops meshlets that face away from the camera. Only enable
+        // this when back faces are culled, or open meshes lose clusters.
+        inline void SetMeshletConeCulling(bool enabled) {
+            _meshletConeCulling = enabled;
+        }
+
+        // Calls that share both geometry and material are drawn with a
+        // single instanced draw. The others are drawn one at a time, where
+        // geometry with meshlets is culled cluster by cluster on the CPU
+        // and submitted with a single glMultiDrawElements. Calls whose
+        // material samples a texture array are drawn after the others, and
+        // calls are ordered so that each texture is only bound once.
         Error Draw(RenderView const& camera, std::span<GLStaticMeshRenderCall const> meshes) const;
     };
 }
\ No newline at end of file
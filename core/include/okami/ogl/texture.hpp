@@ -1,17 +1,39 @@
 #pragma once
 
 #include <okami/ogl/utils.hpp>
+#include <okami/ogl/staging_ring.hpp>
 #include <okami/texture.hpp>
 
 namespace okami {
     GLenum ToGL(texture::Format format);
+    // The texture target, Texture1D and Texture3D are not supported
+    GLenum ToGL(texture::Dimension dimension);
     GLenum ToBaseFormatGL(texture::Format format);
     
     void DestroyGLTexture(GLuint id);
     struct GLTexture final : public GLuintObject<DestroyGLTexture> {
         texture::Desc desc;
 
+        inline GLenum GetTarget() const {
+            return ToGL(desc.type);
+        }
+
+        // Allocates immutable storage for every mip and slice of desc,
+        // where the context supports it, without any contents
+        static Expected<GLTexture> CreateStorage(texture::Desc const& desc);
+        // Uploads one mip of one array layer or cube face. data is an
+        // offset if a GL_PIXEL_UNPACK_BUFFER is bound.
+        Error Upload(texture::SubResDataDesc const& subresource, void const* data) const;
+        // Uploads every subresource of buffer, with its slices offset by
+        // firstSlice, e.g. into one layer of a texture array
+        Error Upload(texture::Buffer const& buffer, uint32_t firstSlice = 0) const;
+        Error Upload(texture::Buffer const& buffer, GLStagingRing& ring, 
+            uint32_t firstSlice = 0) const;
+
         static Expected<GLTexture> Create(texture::Buffer const& buffer);
         static Expected<GLTexture> Create(texture::Buffer&& buffer);
+        // Copies the mips into ring and uploads them from there, so the
+        // driver does not have to copy them synchronously
+        static Expected<GLTexture> Create(texture::Buffer const& buffer, GLStagingRing& ring);
     };
 }
\ No newline at end of file
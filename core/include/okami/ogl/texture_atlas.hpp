@@ -0,0 +1,56 @@
+#pragma once
+
+#include <okami/ogl/texture.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace okami {
+    // Most layers per texture array that the atlas allocates at once
+    constexpr uint32_t kDefaultAtlasPageLayers = 64;
+    // Memory a page may reserve up front, large textures get fewer layers
+    constexpr size_t kDefaultAtlasPageBytes = 64 * 1024 * 1024;
+
+    struct GLAtlasEntry {
+        // A GL_TEXTURE_2D_ARRAY shared with every texture of the same
+        // size, mip count and format
+        GLTexture const* texture = nullptr;
+        uint32_t layer = 0;
+    };
+
+    // Packs 2D textures into the layers of texture arrays, so that draws
+    // with different materials can share one binding and only differ in
+    // the layer they sample.
+    class GLTextureAtlas {
+    private:
+        struct Page {
+            GLTexture texture;
+            std::vector<uint32_t> freeLayers;
+        };
+
+        uint32_t _pageLayers;
+        size_t _pageBytes;
+        // Pointers so that handed out textures never move
+        std::vector<std::unique_ptr<Page>> _pages;
+
+        Expected<Page*> FindOrCreatePage(texture::Desc const& desc);
+
+    public:
+        // Pages get as many layers as fit in pageBytes, at least one and
+        // at most pageLayers
+        explicit GLTextureAtlas(uint32_t pageLayers = kDefaultAtlasPageLayers,
+            size_t pageBytes = kDefaultAtlasPageBytes);
+
+        OKAMI_MOVE_ONLY(GLTextureAtlas);
+
+        // Copies a 2D texture into a free layer of a page that matches it,
+        // allocating a new page if there is none
+        Expected<GLAtlasEntry> Add(texture::Buffer const& buffer);
+        Expected<GLAtlasEntry> Add(texture::Buffer const& buffer, GLStagingRing& ring);
+
+        // Frees the layer of entry for reuse, the page itself is kept
+        void Remove(GLAtlasEntry const& entry);
+
+        inline size_t GetPageCount() const { return _pages.size(); }
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <okami/ogl/texture.hpp>
+#include <okami/thread_pool.hpp>
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace okami {
+    // Bytes of texture data uploaded per Update by default
+    constexpr size_t kDefaultTextureUploadBudget = 8 * 1024 * 1024;
+
+    // Decodes textures and generates their mips on a thread pool, then
+    // uploads them on the GL thread a few at a time. The textures handed
+    // out are empty until uploaded, which the static mesh renderer draws
+    // with its default checkerboard. Uploads go through a staging ring.
+    class GLTextureLoader {
+    private:
+        struct Completed {
+            size_t slot;
+            Expected<texture::Buffer> buffer;
+        };
+
+        // Shared with the decode tasks, so that it outlives the loader
+        // if the loader is destroyed while they are in flight
+        struct CompletionQueue {
+            std::mutex mutex;
+            std::deque<Completed> completed;
+        };
+
+        ThreadPool* _pool;
+        std::shared_ptr<CompletionQueue> _queue;
+        // Created on the first Update, since that is on the GL thread
+        std::optional<GLStagingRing> _stagingRing;
+        bool _stagingRingFailed = false;
+        // A deque so that handed out textures never move
+        std::deque<GLTexture> _textures;
+        std::unordered_map<std::string, size_t> _slots;
+        size_t _pendingCount = 0;
+
+    public:
+        explicit GLTextureLoader(ThreadPool& pool = ThreadPool::Default());
+
+        OKAMI_MOVE_ONLY(GLTextureLoader);
+
+        // Starts decoding path and returns the texture it will be uploaded
+        // into. Loading a path again returns the same texture.
+        GLTexture const& Load(std::filesystem::path const& path,
+            texture::LoadParams const& params = {});
+
+        // Uploads finished textures until budget bytes have been uploaded,
+        // but always at least one. Call once a frame on the GL thread.
+        Error Update(size_t budget = kDefaultTextureUploadBudget);
+
+        // Textures requested but not uploaded yet
+        inline size_t GetPendingCount() const { return _pendingCount; }
+
+        inline static bool IsReady(GLTexture const& texture) {
+            return *texture != 0u;
+        }
+    };
+}
@@ -54,10 +54,13 @@ namespace okami {
     };
 
     void DestroyGLBuffer(GLuint id);
-    struct GLBuffer final : public GLuintObject<DestroyGLProgram> {
+    struct GLBuffer final : public GLuintObject<DestroyGLBuffer> {
         using GLuintObject::GLuintObject;
 
         static Expected<GLBuffer> Create(BufferData const& buffer);
+        static Expected<GLBuffer> Create(std::span<uint8_t const> bytes);
+        // Allocates size bytes of uninitialised storage
+        static Expected<GLBuffer> Create(size_t size);
     };
 
     void DestroyGLVertexArray(GLuint id);
@@ -72,6 +75,16 @@ namespace okami {
         using GLuintObject::GLuintObject;
     };
 
+    void DestroyGLFramebuffer(GLuint id);
+    struct GLFramebuffer final : public GLuintObject<DestroyGLFramebuffer> {
+        using GLuintObject::GLuintObject;
+    };
+
+    void DestroyGLRenderbuffer(GLuint id);
+    struct GLRenderbuffer final : public GLuintObject<DestroyGLRenderbuffer> {
+        using GLuintObject::GLuintObject;
+    };
+
     Expected<GLShader> LoadEmbeddedGLShader(
         std::string_view path, 
         GLenum shaderType,
@@ -81,6 +94,16 @@ namespace okami {
 
     ErrorDetails GetErrorGL();
 
+    // Features beyond the 3.3 core profile, from the context version or
+    // the equivalent extension
+    struct GLCapabilities {
+        bool bufferStorage = false;
+        bool textureStorage = false;
+
+        // Queried once, the current context must be the one rendered with
+        static GLCapabilities const& Get();
+    };
+
     GLenum ToGL(ValueType valueType);
     GLenum ToGL(Topology topo);
 
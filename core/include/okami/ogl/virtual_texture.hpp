@@ -0,0 +1,135 @@
+#pragma once
+
+#include <okami/virtual_texture.hpp>
+#include <okami/ogl/staticmesh.hpp>
+
+#include <array>
+
+namespace okami {
+    // Physical tiles kept on the GPU by default, about 18MB for RGBA8
+    constexpr uint32_t kDefaultVirtualTextureSlots = 256;
+    // Tiles uploaded per Update by default
+    constexpr size_t kDefaultVirtualTileUploads = 16;
+
+    struct GLVirtualTextureUniformBlock {
+        GLint uVirtualPhysical;
+        GLint uVirtualIndirection;
+        GLint uVirtualSize;
+        GLint uVirtualMipCount;
+        GLint uVirtualMipBias;
+
+        static Expected<GLVirtualTextureUniformBlock> Create(GLProgram const& program);
+    };
+
+    // Streams the tiles of a cooked virtual texture into a fixed size
+    // texture array, so that GPU memory stays bounded however large the
+    // texture is. An indirection texture maps every tile of every mip to
+    // the layer of the finest resident tile that covers it.
+    class GLVirtualTexture {
+    private:
+        texture::VirtualTextureFile _file;
+        texture::VirtualPageTable _pageTable;
+        GLTexture _physical;
+        GLTexture _indirection;
+        texture::Buffer _indirectionData;
+
+    public:
+        inline texture::VirtualPageTable const& GetPageTable() const { return _pageTable; }
+
+        // Requests the tiles in feedback, uploads up to maxUploads of the
+        // missing ones from the file and updates the indirection. Call once
+        // a frame on the GL thread.
+        Error Update(std::span<uint32_t const> feedback,
+            size_t maxUploads = kDefaultVirtualTileUploads);
+
+        // Binds the physical tiles and the indirection to two texture units
+        void Bind(GLVirtualTextureUniformBlock const& uniforms,
+            GLDefaultSamplers const& samplers,
+            float mipBias = 0.0f) const;
+
+        static Expected<GLVirtualTexture> Create(std::filesystem::path const& path,
+            uint32_t slotCount = kDefaultVirtualTextureSlots);
+    };
+
+    // Low resolution render target that the feedback pass writes the
+    // packed tile of every pixel into. Read back asynchronously through
+    // two pixel pack buffers, so results arrive a frame or two late.
+    class GLVirtualTextureFeedback {
+    private:
+        GLFramebuffer _framebuffer;
+        GLTexture _target;
+        GLRenderbuffer _depth;
+        std::array<GLBuffer, 2> _readbacks;
+        std::array<GLsync, 2> _fences{};
+        uint32_t _nextReadback = 0;
+        uint32_t _width = 0;
+        uint32_t _height = 0;
+
+    public:
+        GLVirtualTextureFeedback() = default;
+        ~GLVirtualTextureFeedback();
+
+        GLVirtualTextureFeedback(GLVirtualTextureFeedback&& other) noexcept;
+        GLVirtualTextureFeedback& operator=(GLVirtualTextureFeedback&& other) noexcept;
+        OKAMI_NO_COPY(GLVirtualTextureFeedback);
+
+        inline uint32_t GetWidth() const { return _width; }
+        inline uint32_t GetHeight() const { return _height; }
+
+        // Offsets the mip selected at the feedback resolution so that it
+        // matches the one selected at the full resolution of the view
+        float GetMipBias(uint32_t viewWidth) const;
+
+        // Binds and clears the target, the feedback pass draws after this
+        Error Begin();
+        // Starts reading the target back and binds the default framebuffer
+        Error End();
+        // Copies the oldest completed readback into feedback. Returns false
+        // if none has completed yet.
+        Expected<bool> Read(std::vector<uint32_t>& feedback);
+
+        static Expected<GLVirtualTextureFeedback> Create(uint32_t width, uint32_t height);
+    };
+
+    struct GLVirtualTextureRenderCall {
+        GLGeometry const& geometry;
+        GLVirtualTexture const& texture;
+        glm::vec4 color{1.0f, 1.0f, 1.0f, 1.0f};
+        WorldTransform transform;
+    };
+
+    // Draws static meshes textured with virtual textures, and the feedback
+    // pass that decides which of their tiles are streamed in
+    class GLVirtualTextureRenderer {
+    private:
+        struct Program {
+            GLProgram program;
+            GLCameraUniformBlock cameraUniforms;
+            GLWorldUniformBlock worldUniforms;
+            GLPositionUniformBlock positionUniforms;
+            GLVirtualTextureUniformBlock virtualUniforms;
+            GLint uColor = -1;
+
+            static Expected<Program> Create(ShaderPreprocessorConfig const& fsConfig);
+        };
+
+        Program _colorProgram;
+        Program _feedbackProgram;
+        GLDefaultSamplers _samplers;
+
+        Error Draw(Program const& program,
+            RenderView const& camera,
+            std::span<GLVirtualTextureRenderCall const> calls,
+            float mipBias) const;
+
+    public:
+        static Expected<GLVirtualTextureRenderer> Create();
+
+        Error Draw(RenderView const& camera, std::span<GLVirtualTextureRenderCall const> calls) const;
+        // Draws into feedback, between its Begin and End
+        Error DrawFeedback(RenderView const& camera,
+            std::span<GLVirtualTextureRenderCall const> calls,
+            GLVirtualTextureFeedback const& feedback,
+            uint32_t viewWidth) const;
+    };
+}
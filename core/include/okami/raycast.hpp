@@ -0,0 +1,106 @@
+#pragma once
+
+#include <okami/okami.hpp>
+#include <okami/geometry.hpp>
+#include <okami/camera.hpp>
+#include <okami/transform.hpp>
+#include <okami/input.hpp>
+
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace okami {
+    struct Ray {
+        glm::vec3 origin;
+        // Hit distances are in units of the length of direction
+        glm::vec3 direction;
+    };
+
+    struct RayHit {
+        float distance;
+        uint32_t triangle;
+        // Weights of the second and third vertex of the triangle
+        glm::vec2 barycentrics;
+    };
+
+    // Returns the ray through the given pixel, with y pointing down as with
+    // mouse coordinates. The ray is relative to view.origin and normalized.
+    Ray ScreenRay(RenderView const& view, glm::vec2 screenPos);
+
+    namespace geometry {
+        // Bounding volume hierarchy over the triangles of a mesh. Leaves
+        // hold up to four triangles in SIMD friendly order.
+        class BVH {
+        public:
+            static constexpr uint32_t kLeafSize = 4;
+
+            struct Node {
+                BoundingBox bounds;
+                // Index of the second child for inner nodes, which directly
+                // follow their first child, or of the block for leaves
+                uint32_t index;
+                // Zero for inner nodes
+                uint32_t triangleCount;
+            };
+
+            // Triangles of one leaf as v0 and edges, stored component wise
+            struct TriangleBlock {
+                float v0[3][kLeafSize];
+                float e1[3][kLeafSize];
+                float e2[3][kLeafSize];
+                uint32_t triangles[kLeafSize];
+            };
+
+        private:
+            std::vector<Node> _nodes;
+            std::vector<TriangleBlock> _blocks;
+
+        public:
+            inline std::vector<Node> const& GetNodes() const { return _nodes; }
+            inline std::vector<TriangleBlock> const& GetBlocks() const { return _blocks; }
+
+            inline BoundingBox GetBounds() const {
+                return _nodes.empty() ? BoundingBox{} : _nodes.front().bounds;
+            }
+
+            // Triangles are double sided
+            std::optional<RayHit> RayCast(Ray const& ray,
+                float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+            static BVH Build(
+                std::span<glm::vec3 const> positions,
+                std::span<uint32_t const> indices);
+            // Reads positions and indices straight out of the packed buffers
+            static BVH Build(Geometry const& geometry);
+        };
+    }
+
+    // Makes an entity a target for RayCast. Entities also need a
+    // WorldTransform or Transform, otherwise they are placed at the origin.
+    struct RayCastMesh {
+        std::shared_ptr<geometry::BVH const> bvh;
+    };
+
+    struct RayCastHit {
+        entity target = null;
+        RayHit hit;
+    };
+
+    // The ray is relative to origin
+    std::optional<RayCastHit> RayCast(Registry const& registry,
+        Ray const& ray,
+        glm::dvec3 const& origin = glm::dvec3(0.0, 0.0, 0.0),
+        float maxDistance = std::numeric_limits<float>::infinity());
+    std::optional<RayCastHit> RayCast(Registry const& registry,
+        RenderView const& view,
+        glm::vec2 screenPos);
+
+    inline std::optional<RayCastHit> RayCast(Registry const& registry,
+        RenderView const& view,
+        MouseState const& mouse) {
+        return RayCast(registry, view,
+            glm::vec2(static_cast<float>(mouse.X()), static_cast<float>(mouse.Y())));
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// SSE2 is part of the x86-64 baseline, so any 64-bit x86 build can use it
+// unconditionally. Everything else falls back to the scalar paths.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define OKAMI_SIMD_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define OKAMI_SIMD_SSE2 0
+#endif
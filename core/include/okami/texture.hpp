@@ -8,6 +8,8 @@
 #include <span>
 
 namespace okami {
+    class ThreadPool;
+
     glm::uvec1 ColorToBytes(glm::vec1 x);
     glm::uvec2 ColorToBytes(glm::vec2 x);
     glm::uvec3 ColorToBytes(glm::vec3 x);
@@ -40,11 +42,22 @@ namespace okami {
             }
         }
 
+        // Block compression, every block encodes 4x4 texels
+        enum class Compression {
+            None,
+            BC1,
+            BC3,
+            BC4,
+            BC5,
+            BC7
+        };
+
         struct Format {
             uint32_t channels;
             ValueType valueType;
             bool isNormalized;
             bool isLinear;
+            Compression compression = Compression::None;
 
             static Format UNKNOWN();
             static Format RGBA32_FLOAT();
@@ -88,26 +101,97 @@ namespace okami {
             static Format RGBA16_UINT();
             static Format RGBA16_SNORM();
             static Format RGBA16_UNORM();
+            static Format RGBA16_FLOAT();
+
+            // BC1 is opaque, BC4 and BC5 are one and two channel formats and
+            // have no sRGB variants
+            static Format BC1_UNORM();
+            static Format BC1_SRGB();
+            static Format BC3_UNORM();
+            static Format BC3_SRGB();
+            static Format BC4_UNORM();
+            static Format BC5_UNORM();
+            static Format BC7_UNORM();
+            static Format BC7_SRGB();
+
+            // The format compression produces from an uncompressed format,
+            // which keeps its sRGB encoding where the compression allows
+            static Format Compressed(Compression compression, bool isSRGB);
+
+            bool operator==(Format const&) const = default;
+
+            inline bool IsCompressed() const {
+                return compression != Compression::None;
+            }
 
             inline uint32_t GetPixelByteSize() const {
                 return GetSize(valueType) * channels;
             }
+
+            // Texels along each side of a block, 1 for uncompressed formats
+            inline uint32_t GetBlockDimension() const {
+                return IsCompressed() ? 4u : 1u;
+            }
+
+            // Bytes per block, the pixel size for uncompressed formats
+            inline uint32_t GetBlockByteSize() const {
+                switch (compression) {
+                    case Compression::None:
+                        return GetPixelByteSize();
+                    case Compression::BC1:
+                    case Compression::BC4:
+                        return 8u;
+                    default:
+                        return 16u;
+                }
+            }
+        };
+
+        // Downsampling filters for mip generation. Box is the fastest, the
+        // others are separable polyphase filters that keep more detail.
+        enum class MipFilter {
+            Box,
+            Kaiser,
+            Lanczos3,
+            Mitchell
         };
 
         struct LoadParams {
             bool isSRGB = false;
             bool generateMips = true;
+            MipFilter mipFilter = MipFilter::Box;
+            // Weights colour by alpha when filtering, so that the colour of
+            // transparent texels in cutout textures does not bleed into mips
+            bool alphaWeightedMips = false;
+            // Block compresses the texture after its mips are generated
+            Compression compression = Compression::None;
+            // Converts to FLOAT16 or FLOAT32 after the mips are generated,
+            // decoding sRGB. Ignored when compressing.
+            ValueType valueType = ValueType::UINT8;
+            // Maps KTX2 and DDS files rather than reading them. Containers
+            // are loaded as they were cooked and ignore the params above.
+            bool memoryMap = true;
 
             template <class Archive>
             void save(Archive& archive) const {
                 archive(generateMips);
                 archive(isSRGB);
+                archive(mipFilter);
+                archive(alphaWeightedMips);
+                archive(compression);
+                archive(valueType);
+                archive(memoryMap);
             }
 
             template <class Archive>
             void load(Archive& archive) {
                 archive(generateMips);
                 archive(isSRGB);
+                archive(mipFilter);
+                archive(alphaWeightedMips);
+                archive(compression);
+                archive(valueType);
+                archive(memoryMap);
             }
         };
 
@@ -120,6 +204,7 @@ namespace okami {
             const uint32_t height, 
             const uint32_t depth);
 
+        // For compressed formats the strides are between rows of blocks
         struct SubResDataDesc {
             uint64_t depthStride;
             uint64_t srcOffset;
@@ -142,7 +227,7 @@ namespace okami {
                 return format.GetPixelByteSize();
             }
 
-            uint32_t GetByteSize() const;
+            uint64_t GetByteSize() const;
             std::vector<SubResDataDesc> GetSubresourceDescs() const;
 
             uint32_t GetMipCount() const {
@@ -169,11 +254,20 @@ namespace okami {
             }
         };
 
+        // Target number of coarse pixels per parallel mip generation task
+        constexpr uint32_t kMipBandPixels = 64 * 1024;
+
         struct Buffer {
             Desc desc;
             std::vector<uint8_t> data;
 
-            void GenerateMips();
+            // Filters every mip from the one above it. Array slices and bands
+            // of rows are filtered in parallel on pool.
+            void GenerateMips(MipFilter filter = MipFilter::Box,
+                bool alphaWeighted = false);
+            void GenerateMips(ThreadPool& pool,
+                MipFilter filter = MipFilter::Box,
+                bool alphaWeighted = false);
             static Buffer Alloc(const Desc& desc);
             static Expected<Buffer> Load(
                 const std::filesystem::path& path,
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <okami/texture.hpp>
+
+#include <array>
+
+namespace okami::texture {
+    // Block encoders, each takes the 4x4 texels of one block in row order.
+    // Colour endpoints are fitted along the principal axis of the block and
+    // then refined by least squares against the chosen indices.
+    std::array<uint8_t, 8> EncodeBC1(uint8_t const (&rgba)[16][4]);
+    std::array<uint8_t, 16> EncodeBC3(uint8_t const (&rgba)[16][4]);
+    std::array<uint8_t, 8> EncodeBC4(uint8_t const (&values)[16]);
+    std::array<uint8_t, 16> EncodeBC5(uint8_t const (&rgba)[16][4]);
+    // Only emits mode 6, a single RGBA subset with 4 bit indices
+    std::array<uint8_t, 16> EncodeBC7(uint8_t const (&rgba)[16][4]);
+
+    // Block compresses every subresource of an RGBA8 buffer. BC4 keeps the
+    // red channel, BC5 red and green. Blocks are encoded in parallel.
+    Buffer Compress(Buffer const& source, Compression compression);
+    Buffer Compress(ThreadPool& pool, Buffer const& source, Compression compression);
+}
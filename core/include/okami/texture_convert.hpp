@@ -0,0 +1,23 @@
+#pragma once
+
+#include <okami/texture.hpp>
+
+#include <span>
+
+namespace okami::texture {
+    // Converts the texels in source from one format to another. Formats
+    // with 1 to 4 channels of normalized UINT8, FLOAT16 or FLOAT32 are
+    // supported, with sRGB encoded or decoded when isLinear differs.
+    // Channels missing from the source read as 0, or 1 for alpha.
+    //
+    // RGBA8 to and from RGBA32F, sRGB to and from linear RGBA8, RGB8 to
+    // RGBA8 and FLOAT32 to and from FLOAT16 have vectorized paths.
+    void ConvertPixels(Format const& srcFormat,
+        Format const& dstFormat,
+        std::span<uint8_t const> source,
+        std::span<uint8_t> dest);
+
+    // Converts every subresource of an uncompressed buffer, in parallel
+    Buffer ConvertPixels(Buffer const& source, Format const& format);
+    Buffer ConvertPixels(ThreadPool& pool, Buffer const& source, Format const& format);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <okami/texture.hpp>
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace okami::texture {
+    // Containers for textures that are already in their GPU format, with
+    // their whole mip chain, so that loading them is a copy.
+    constexpr uint8_t kKTX2Identifier[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+    constexpr std::string_view kKTX2Extension = ".ktx2";
+    constexpr std::string_view kDDSExtension = ".dds";
+
+    // Both support 2D textures, 2D arrays and cube maps without
+    // supercompression. Formats that texture::Format cannot describe,
+    // such as BGRA or BC6H, are rejected.
+    Expected<Buffer> ParseKTX2(std::span<uint8_t const> bytes);
+    Expected<Buffer> ParseDDS(std::span<uint8_t const> bytes);
+
+    Error WriteKTX2(std::filesystem::path const& path, Buffer const& buffer);
+
+    // Offline cook step. Decodes source with params and writes the result
+    // as KTX2 to cacheDirectory, unless a file cooked from identical content
+    // with identical params is already there. Returns the path of the KTX2.
+    Expected<std::filesystem::path> CookTexture(
+        std::filesystem::path const& source,
+        std::filesystem::path const& cacheDirectory,
+        LoadParams const& params);
+}
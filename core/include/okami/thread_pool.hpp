@@ -0,0 +1,54 @@
+#pragma once
+
+#include <okami/error.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace okami {
+    // A fixed set of worker threads pulling tasks from a shared queue.
+    class ThreadPool {
+    private:
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _tasks;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _stop = false;
+
+        void WorkerLoop();
+
+    public:
+        // Zero picks one thread per hardware thread
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        OKAMI_NO_COPY(ThreadPool);
+
+        inline size_t GetThreadCount() const { return _workers.size(); }
+
+        void Submit(std::function<void()> task);
+
+        template <typename F>
+        auto Async(F&& func) -> std::future<std::invoke_result_t<F>> {
+            using result_t = std::invoke_result_t<F>;
+            auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(func));
+            auto future = task->get_future();
+            Submit([task]() { (*task)(); });
+            return future;
+        }
+
+        // Runs body(i) for every i in [0, count) and blocks until all of them
+        // are done. The calling thread helps out, so this is safe to call from
+        // within a task. The first exception thrown by body is rethrown here.
+        void ParallelFor(size_t count, std::function<void(size_t)> const& body);
+
+        // Shared pool for engine wide CPU work
+        static ThreadPool& Default();
+    };
+}
@@ -4,6 +4,8 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <span>
+
 namespace okami {
     struct Transform {
         glm::vec3 translation;
@@ -43,4 +45,41 @@ namespace okami {
     glm::vec3 operator*(Transform const& a, glm::vec3 const& b);
 
     Transform Inverse(Transform const& transform);
+
+    // A transform with a double precision translation, for entities placed
+    // in worlds too large for float positions. Rendering rebases these
+    // against a double precision origin (usually the camera position) and
+    // only then converts to float.
+    struct WorldTransform {
+        glm::dvec3 translation;
+        float scale;
+        glm::quat rotation;
+
+        explicit inline WorldTransform(glm::dvec3 translation,
+            glm::quat rotation = glm::identity<glm::quat>(),
+            float scale = 1.0f) :
+            translation(translation),
+            rotation(rotation),
+            scale(scale) {}
+        inline WorldTransform() : WorldTransform(glm::dvec3(0.0, 0.0, 0.0)) {}
+        inline WorldTransform(Transform const& transform) :
+            WorldTransform(glm::dvec3(transform.translation), 
+                transform.rotation, 
+                transform.scale) {}
+
+        WorldTransform& operator*=(Transform const& other);
+
+        // Returns this transform with translation expressed relative to origin
+        Transform RelativeTo(glm::dvec3 origin) const;
+        glm::mat4x4 ToRelativeMatrix4x4(glm::dvec3 origin) const;
+    };
+
+    WorldTransform operator*(WorldTransform const& a, Transform const& b);
+
+    // Computes the float world matrices of a batch of transforms relative to
+    // origin. out must be at least as large as transforms.
+    void ToRelativeMatrices(
+        std::span<WorldTransform const> transforms,
+        glm::dvec3 origin,
+        std::span<glm::mat4x4> out);
 }
\ No newline at end of file
@@ -132,6 +132,8 @@ namespace okami {
         PositionUVNormal,
         PositionUVNormalTangent,
         PositionUVNormalTangentBitangent,
+        PositionUVCompact,
+        PositionUVNormalTangentCompact,
         Custom
     };
 
@@ -174,6 +176,12 @@ namespace okami {
         static VertexFormatInfo Position();
         static VertexFormatInfo PositionColor();
 
+        // Quantised layouts for large static meshes. Positions are unorm16
+        // relative to the bounding box, UVs are half floats and normals and
+        // tangents are octahedral snorm16.
+        static VertexFormatInfo PositionUVCompact();
+        static VertexFormatInfo PositionUVNormalTangentCompact();
+
 		template <class Archive>
 		void serialize(Archive& archive) {
 			archive(elements);
@@ -186,6 +194,8 @@ namespace okami {
 			archive(uvs);
             archive(uvws);
 			archive(colors);
+
+			archive(formatTag);
 		}
 
         Error AutoLayout();
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <okami/texture.hpp>
+#include <okami/mapped_file.hpp>
+
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace okami::texture {
+    // Texels of the virtual texture per tile side
+    constexpr uint32_t kVirtualTileSize = 128;
+    // Texels copied from the neighbouring tiles around every tile, so that
+    // filtering never reads across into an unrelated physical tile. A
+    // multiple of 4 keeps tiles aligned to compressed blocks.
+    constexpr uint32_t kVirtualTileBorder = 4;
+    constexpr uint32_t kVirtualTilePaddedSize = kVirtualTileSize + 2 * kVirtualTileBorder;
+    constexpr std::string_view kVirtualTextureExtension = ".okvt";
+
+    struct VirtualTileId {
+        uint32_t mip = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        bool operator==(VirtualTileId const&) const = default;
+
+        // Encoding written by the feedback pass, 0 means no request
+        uint32_t Pack() const;
+        static std::optional<VirtualTileId> Unpack(uint32_t packed);
+    };
+
+    struct VirtualTextureDesc {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        Format format;
+
+        inline uint32_t GetMipWidth(uint32_t mip) const {
+            return std::max(1u, width >> mip);
+        }
+        inline uint32_t GetMipHeight(uint32_t mip) const {
+            return std::max(1u, height >> mip);
+        }
+        inline uint32_t GetTilesX(uint32_t mip) const {
+            return (GetMipWidth(mip) + kVirtualTileSize - 1) / kVirtualTileSize;
+        }
+        inline uint32_t GetTilesY(uint32_t mip) const {
+            return (GetMipHeight(mip) + kVirtualTileSize - 1) / kVirtualTileSize;
+        }
+
+        // Bytes of one tile including its border
+        size_t GetTileByteSize() const;
+        // Tiles of all mips, finest first
+        size_t GetTileCount() const;
+        size_t GetTileIndex(VirtualTileId const& tile) const;
+
+        // Desc of a single physical tile
+        Desc GetTileDesc() const;
+        // Desc of the indirection texture. Level 0 has a texel per tile of
+        // mip 0, rounded up to a power of two so that every level halves.
+        Desc GetIndirectionDesc() const;
+    };
+
+    // Splits every mip of source into bordered tiles and writes them to
+    // path. Mips of source beyond the one that fits a single tile are
+    // dropped, and it fails if source has no mip that small.
+    Error WriteVirtualTexture(std::filesystem::path const& path, Buffer const& source);
+
+    // Cooked tiles, memory mapped so that only the tiles read are paged in
+    class VirtualTextureFile {
+    private:
+        MappedFile _file;
+        VirtualTextureDesc _desc;
+        size_t _dataOffset = 0;
+
+    public:
+        inline VirtualTextureDesc const& GetDesc() const { return _desc; }
+
+        std::span<uint8_t const> GetTile(VirtualTileId const& tile) const;
+
+        static Expected<VirtualTextureFile> Open(std::filesystem::path const& path);
+    };
+
+    // CPU side of virtual texturing. Tracks which tiles are resident in
+    // which slot of a fixed size physical cache, which are requested but
+    // missing, and evicts the least recently used tiles to make room. The
+    // tiles of the coarsest mip are never evicted, so every texel has
+    // something to fall back to.
+    //
+    // Usage per frame: BeginFrame, Request for each tile in the feedback,
+    // GetMissing, Insert the ones loaded, then BuildIndirection if dirty.
+    class VirtualPageTable {
+    private:
+        struct Slot {
+            VirtualTileId tile;
+            uint64_t lastUsedFrame = 0;
+            bool isPinned = false;
+            // Position in the LRU list, front is the most recently used
+            std::list<uint32_t>::iterator lruPosition;
+        };
+
+        VirtualTextureDesc _desc;
+        std::vector<Slot> _slots;
+        std::list<uint32_t> _lru;
+        // Slot of every tile of every mip, or -1 when not resident
+        std::vector<int32_t> _residency;
+        std::vector<uint32_t> _freeSlots;
+        std::unordered_set<uint32_t> _missing;
+        uint64_t _frame = 1;
+        bool _isDirty = true;
+
+        int32_t& Residency(VirtualTileId const& tile);
+        int32_t Residency(VirtualTileId const& tile) const;
+        void Touch(uint32_t slot);
+
+    public:
+        VirtualPageTable() = default;
+        VirtualPageTable(VirtualTextureDesc const& desc, uint32_t slotCount);
+
+        inline uint32_t GetSlotCount() const { return static_cast<uint32_t>(_slots.size()); }
+        inline uint32_t GetResidentCount() const {
+            return GetSlotCount() - static_cast<uint32_t>(_freeSlots.size());
+        }
+        inline VirtualTextureDesc const& GetDesc() const { return _desc; }
+        // Set whenever residency changed since the last BuildIndirection
+        inline bool IsDirty() const { return _isDirty; }
+
+        void BeginFrame();
+
+        // Marks a tile as needed this frame. Tiles outside the texture are
+        // ignored.
+        void Request(VirtualTileId const& tile);
+        // Requests every tile packed in the feedback
+        void Request(std::span<uint32_t const> feedback);
+
+        // Requested tiles that are not resident, coarsest mip first, at
+        // most maxCount of them. The coarsest mip is always requested.
+        std::vector<VirtualTileId> GetMissing(size_t maxCount) const;
+
+        std::optional<uint32_t> FindSlot(VirtualTileId const& tile) const;
+
+        // Takes a free slot for tile, or evicts the least recently used
+        // tile that was not requested this frame. Returns nothing when
+        // every slot is needed this frame.
+        std::optional<uint32_t> Insert(VirtualTileId const& tile);
+
+        // Writes the indirection texture, see GetIndirectionDesc. Every
+        // texel holds the slot in RG, low byte first, and the mip of the
+        // finest resident tile that covers it in B. A is 255 if any tile
+        // covers it.
+        void BuildIndirection(Buffer& indirection);
+    };
+}
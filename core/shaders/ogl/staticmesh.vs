@@ -5,9 +5,19 @@ uniform mat4 uView;
 uniform mat4 uProj;
 uniform mat4 uViewProj;
 
+#ifdef INSTANCED
+// World matrix of each instance, one column per location, see
+// GLStaticMeshRenderer::GetInstanceLayout
+layout (location = 8) in mat4 aWorld;
+#else
 // World uniform block
 uniform mat4 uWorld;
 uniform mat4 uWorldInvTrans;
+#endif
+
+// Position dequantisation, the identity for float positions
+uniform vec3 uPositionOffset;
+uniform vec3 uPositionScale;
 
 out vec2 vsUV;
 out vec4 vsWorld;
@@ -17,7 +27,12 @@ layout (location = 1) in vec2 aUV;
 
 void main()
 {   
-    vsWorld = uWorld * vec4(aPos, 1.0);
+    vec3 position = uPositionOffset + aPos * uPositionScale;
+#ifdef INSTANCED
+    vsWorld = aWorld * vec4(position, 1.0);
+#else
+    vsWorld = uWorld * vec4(position, 1.0);
+#endif
     gl_Position = uViewProj * vsWorld;
     
     vsUV = aUV;
@@ -2,12 +2,21 @@
 
 in vec2 vsUV;
 
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray uTextureSampler;
+uniform float uTextureLayer;
+#else
 uniform sampler2D uTextureSampler;
+#endif
 uniform vec4 uColor;
 
 layout (location = 0) out vec4 FragColor;
 
 void main()
 {
+#ifdef TEXTURE_ARRAY
+    FragColor = texture(uTextureSampler, vec3(vsUV, uTextureLayer)) * uColor;
+#else
     FragColor = texture(uTextureSampler, vsUV) * uColor;
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,67 @@
+#version 330 core
+
+in vec2 vsUV;
+
+// Must match the tiles of okami/virtual_texture.hpp
+#define kTileSize 128.0
+#define kTileBorder 4.0
+#define kTilePaddedSize 136.0
+
+#ifndef FEEDBACK
+uniform sampler2DArray uVirtualPhysical;
+uniform usampler2D uVirtualIndirection;
+#endif
+uniform vec2 uVirtualSize;
+uniform float uVirtualMipCount;
+uniform float uVirtualMipBias;
+
+#ifdef FEEDBACK
+layout (location = 0) out uint FragFeedback;
+#else
+uniform vec4 uColor;
+
+layout (location = 0) out vec4 FragColor;
+#endif
+
+vec2 VirtualMipSize(float mip)
+{
+    return max(floor(uVirtualSize / exp2(mip)), vec2(1.0));
+}
+
+// Texel of mip, clamped so that the edge stays within the last tile
+vec2 VirtualTexel(vec2 uv, float mip)
+{
+    vec2 size = VirtualMipSize(mip);
+    return clamp(uv * size, vec2(0.0), size - 0.5);
+}
+
+void main()
+{
+    vec2 uv = clamp(vsUV, 0.0, 1.0);
+
+    vec2 dx = dFdx(vsUV * uVirtualSize);
+    vec2 dy = dFdy(vsUV * uVirtualSize);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + uVirtualMipBias;
+    float mip = clamp(floor(lod), 0.0, uVirtualMipCount - 1.0);
+
+    ivec2 tile = ivec2(VirtualTexel(uv, mip) / kTileSize);
+
+#ifdef FEEDBACK
+    FragFeedback = ((uint(mip) + 1u) << 28u) | (uint(tile.y) << 14u) | uint(tile.x);
+#else
+    // The finest resident tile that covers this one
+    uvec4 entry = texelFetch(uVirtualIndirection, tile, int(mip));
+    if (entry.a == 0u) {
+        FragColor = uColor;
+        return;
+    }
+
+    float residentMip = float(entry.b);
+    vec2 texel = VirtualTexel(uv, residentMip);
+    vec2 inTile = texel - floor(texel / kTileSize) * kTileSize;
+    vec2 physicalUV = (inTile + kTileBorder) / kTilePaddedSize;
+    float layer = float(entry.r | (entry.g << 8u));
+
+    FragColor = texture(uVirtualPhysical, vec3(physicalUV, layer)) * uColor;
+#endif
+}
@@ -41,4 +41,16 @@ glm::mat4x4 okami::Camera::GetProjMatrix(glm::vec2 viewport) const {
 
 glm::mat4x4 okami::RenderView::GetProjMatrix() const {
     return camera.GetProjMatrix(viewport);
+}
+
+RenderView okami::RenderView::CameraRelative(
+    Camera const& camera,
+    glm::vec2 viewport,
+    WorldTransform const& cameraTransform) {
+    return RenderView {
+        .camera = camera,
+        .viewport = viewport,
+        .viewTransform = Inverse(cameraTransform.RelativeTo(cameraTransform.translation)),
+        .origin = cameraTransform.translation
+    };
 }
\ No newline at end of file
@@ -1,161 +1,23 @@
 #include <okami/geometry.hpp>
-
-using namespace okami;
-using namespace okami::geometry;
-
-namespace matball {
-	#include <matballmesh.hpp>
-}
-
-namespace box {
-	#include <boxmesh.hpp>
-}
-
-namespace bunny {
-	#include <bunnymesh.hpp>
-}
-
-namespace monkey {
-	#include <monkeymesh.hpp>
-}
-
-namespace plane {
-	#include <planemesh.hpp>
-}
-
-namespace sphere {
-	#include <spheremesh.hpp>
-}
-
-namespace torus {
-	#include <torusmesh.hpp>
-}
-
-namespace teapot {
-	#include <teapotmesh.hpp>
-}
+#include <okami/simd.hpp>
 
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 
-#include <iostream>
+#include <glm/gtc/packing.hpp>
 
-Geometry okami::geometry::prefabs::MaterialBall(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            matball::vertexCount,
-            matball::indexCount,
-            matball::indices,
-            matball::positions,
-            matball::uvs,
-            matball::normals,
-            matball::tangents,
-            matball::bitangents));
-}
-
-Geometry okami::geometry::prefabs::UnitBox(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            box::vertexCount,
-            box::indexCount,
-            box::indices,
-            box::positions,
-            box::uvs,
-            box::normals,
-            box::tangents,
-            box::bitangents));
-}
-
-Geometry okami::geometry::prefabs::UnitSphere(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            sphere::vertexCount,
-            sphere::indexCount,
-            sphere::indices,
-            sphere::positions,
-            sphere::uvs,
-            sphere::normals,
-            sphere::tangents,
-            sphere::bitangents));
-}
-
-Geometry okami::geometry::prefabs::BlenderMonkey(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            monkey::vertexCount,
-            monkey::indexCount,
-            monkey::indices,
-            monkey::positions,
-            monkey::uvs,
-            monkey::normals,
-            monkey::tangents,
-            monkey::bitangents));
-}
-
-Geometry okami::geometry::prefabs::Torus(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            torus::vertexCount,
-            torus::indexCount,
-            torus::indices,
-            torus::positions,
-            torus::uvs,
-            torus::normals,
-            torus::tangents,
-            torus::bitangents));
-}
-
-Geometry okami::geometry::prefabs::Plane(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            plane::vertexCount,
-            plane::indexCount,
-            plane::indices,
-            plane::positions,
-            plane::uvs,
-            plane::normals,
-            plane::tangents,
-            plane::bitangents));
-}
-
-Geometry okami::geometry::prefabs::StanfordBunny(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            bunny::vertexCount,
-            bunny::indexCount,
-            bunny::indices,
-            bunny::positions,
-            bunny::uvs,
-            bunny::normals,
-            bunny::tangents,
-            bunny::bitangents));
-}
+#include <iostream>
+#include <limits>
+#include <type_traits>
 
-Geometry okami::geometry::prefabs::UtahTeapot(const VertexFormatInfo& layout) {
-    return Geometry(layout, 
-        DataView
-            <uint32_t, float, float, float>(
-            teapot::vertexCount,
-            teapot::indexCount,
-            teapot::indices,
-            teapot::positions,
-            teapot::uvs,
-            teapot::normals,
-            teapot::tangents,
-            teapot::bitangents));
-}
+using namespace okami;
+using namespace okami::geometry;
 
 template <>
 struct V3Packer<aiVector3D> {
     static constexpr size_t kStride = 1;
+    static constexpr bool kContiguous = std::is_same_v<ai_real, float>;
 
     inline static void Pack(float* dest, const aiVector3D* src) {
         dest[0] = src->x;
@@ -185,6 +47,232 @@ struct I3Packer<aiFace> {
     }
 };
 
+namespace {
+#if OKAMI_SIMD_SSE2
+    // Loads and stores of float3 that never touch the fourth float, so
+    // that they are safe at the end of a buffer and between attributes
+    inline __m128 Load3(const uint8_t* src) {
+        __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(src)));
+        __m128 z = _mm_load_ss(reinterpret_cast<const float*>(src + 2 * sizeof(float)));
+        return _mm_movelh_ps(xy, z);
+    }
+
+    inline void Store3(uint8_t* dest, __m128 value) {
+        _mm_store_sd(reinterpret_cast<double*>(dest), _mm_castps_pd(value));
+        _mm_store_ss(reinterpret_cast<float*>(dest + 2 * sizeof(float)), _mm_movehl_ps(value, value));
+    }
+
+    inline __m128 Load2(const uint8_t* src) {
+        return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(src)));
+    }
+
+    inline void Store2(uint8_t* dest, __m128 value) {
+        _mm_store_sd(reinterpret_cast<double*>(dest), _mm_castps_pd(value));
+    }
+
+    inline __m128 Load4(const uint8_t* src) {
+        return _mm_loadu_ps(reinterpret_cast<const float*>(src));
+    }
+
+    inline void Store4(uint8_t* dest, __m128 value) {
+        _mm_storeu_ps(reinterpret_cast<float*>(dest), value);
+    }
+
+    template <__m128(*Load)(const uint8_t*), void(*Store)(uint8_t*, __m128)>
+    void StridedCopy(uint8_t* dest, const uint8_t* src,
+        size_t destStride, size_t srcStride, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = Load(src);
+            __m128 b = Load(src + srcStride);
+            __m128 c = Load(src + 2 * srcStride);
+            __m128 d = Load(src + 3 * srcStride);
+            Store(dest, a);
+            Store(dest + destStride, b);
+            Store(dest + 2 * destStride, c);
+            Store(dest + 3 * destStride, d);
+            src += 4 * srcStride;
+            dest += 4 * destStride;
+        }
+        for (; i < count; ++i, src += srcStride, dest += destStride) {
+            Store(dest, Load(src));
+        }
+    }
+
+    BoundingBox ToBoundingBox(__m128 lower, __m128 upper) {
+        alignas(16) float l[4];
+        alignas(16) float u[4];
+        _mm_store_ps(l, lower);
+        _mm_store_ps(u, upper);
+        BoundingBox result;
+        result.mLower = glm::vec3(l[0], l[1], l[2]);
+        result.mUpper = glm::vec3(u[0], u[1], u[2]);
+        return result;
+    }
+
+    // Streams float3 positions through two sets of min/max accumulators,
+    // optionally writing them out on the way
+    template <bool kWrite>
+    BoundingBox StreamPositions(uint8_t* dest, const uint8_t* src,
+        size_t destStride, size_t srcStride, size_t count) {
+        __m128 lower0 = _mm_set1_ps(std::numeric_limits<float>::infinity());
+        __m128 upper0 = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+        __m128 lower1 = lower0;
+        __m128 upper1 = upper0;
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128 a = Load3(src);
+            __m128 b = Load3(src + srcStride);
+            if constexpr (kWrite) {
+                Store3(dest, a);
+                Store3(dest + destStride, b);
+                dest += 2 * destStride;
+            }
+            lower0 = _mm_min_ps(lower0, a);
+            upper0 = _mm_max_ps(upper0, a);
+            lower1 = _mm_min_ps(lower1, b);
+            upper1 = _mm_max_ps(upper1, b);
+            src += 2 * srcStride;
+        }
+        if (i < count) {
+            __m128 a = Load3(src);
+            if constexpr (kWrite) {
+                Store3(dest, a);
+            }
+            lower0 = _mm_min_ps(lower0, a);
+            upper0 = _mm_max_ps(upper0, a);
+        }
+
+        return ToBoundingBox(_mm_min_ps(lower0, lower1), _mm_max_ps(upper0, upper1));
+    }
+#else
+    void StridedCopy(uint8_t* dest, const uint8_t* src,
+        size_t destStride, size_t srcStride, size_t size, size_t count) {
+        for (size_t i = 0; i < count; ++i, src += srcStride, dest += destStride) {
+            std::memcpy(dest, src, size);
+        }
+    }
+
+    template <bool kWrite>
+    BoundingBox StreamPositions(uint8_t* dest, const uint8_t* src,
+        size_t destStride, size_t srcStride, size_t count) {
+        glm::vec3 lower(std::numeric_limits<float>::infinity());
+        glm::vec3 upper(-std::numeric_limits<float>::infinity());
+        for (size_t i = 0; i < count; ++i, src += srcStride) {
+            glm::vec3 position;
+            std::memcpy(&position, src, sizeof(position));
+            if constexpr (kWrite) {
+                std::memcpy(dest, &position, sizeof(position));
+                dest += destStride;
+            }
+            for (int c = 0; c < 3; ++c) {
+                lower[c] = std::min(lower[c], position[c]);
+                upper[c] = std::max(upper[c], position[c]);
+            }
+        }
+        BoundingBox result;
+        result.mLower = lower;
+        result.mUpper = upper;
+        return result;
+    }
+#endif
+
+    void CopyFloats(uint8_t* dest, const uint8_t* src,
+        size_t destStride, size_t srcStride, size_t dim, size_t count) {
+#if OKAMI_SIMD_SSE2
+        switch (dim) {
+            case 2:
+                StridedCopy<&Load2, &Store2>(dest, src, destStride, srcStride, count);
+                return;
+            case 3:
+                StridedCopy<&Load3, &Store3>(dest, src, destStride, srcStride, count);
+                return;
+            case 4:
+                StridedCopy<&Load4, &Store4>(dest, src, destStride, srcStride, count);
+                return;
+            default:
+                throw std::runtime_error("Slice dimension must be 2, 3 or 4!");
+        }
+#else
+        if (dim < 2 || dim > 4) {
+            throw std::runtime_error("Slice dimension must be 2, 3 or 4!");
+        }
+        StridedCopy(dest, src, destStride, srcStride, dim * sizeof(float), count);
+#endif
+    }
+}
+
+BoundingBox okami::geometry::MergeBounds(std::span<const BoundingBox> bounds) {
+    BoundingBox result;
+    result.mLower = glm::vec3(std::numeric_limits<float>::infinity());
+    result.mUpper = glm::vec3(-std::numeric_limits<float>::infinity());
+    for (auto const& box : bounds) {
+        for (int c = 0; c < 3; ++c) {
+            result.mLower[c] = std::min(result.mLower[c], box.mLower[c]);
+            result.mUpper[c] = std::max(result.mUpper[c], box.mUpper[c]);
+        }
+    }
+    return result;
+}
+
+void okami::geometry::ArraySliceCopyFloatsToBytes(uint8_t* dest, const float* source,
+    size_t destStrideBytes, size_t dim, size_t count) {
+    CopyFloats(dest, reinterpret_cast<const uint8_t*>(source),
+        destStrideBytes, dim * sizeof(float), dim, count);
+}
+
+void okami::geometry::ArraySliceCopyFloatsFromBytes(float* dest, const uint8_t* source,
+    size_t srcStrideBytes, size_t dim, size_t count) {
+    CopyFloats(reinterpret_cast<uint8_t*>(dest), source,
+        dim * sizeof(float), srcStrideBytes, dim, count);
+}
+
+BoundingBox okami::geometry::ArraySliceBoundingBoxBytes(const uint8_t* arr,
+    size_t stride, size_t count) {
+    return StreamPositions<false>(nullptr, arr, 0, stride, count);
+}
+
+BoundingBox okami::geometry::ArraySliceCopyPositionsToBytes(uint8_t* dest, const float* source,
+    size_t destStrideBytes, size_t count) {
+    return StreamPositions<true>(dest, reinterpret_cast<const uint8_t*>(source),
+        destStrideBytes, 3 * sizeof(float), count);
+}
+
+void okami::geometry::ArraySliceNarrowIndices(uint16_t* dest, const uint32_t* source, size_t count) {
+    size_t i = 0;
+#if OKAMI_SIMD_SSE2
+    // packs_epi32 saturates signed values, so shift into the signed range
+    // first and flip the sign bit back afterwards
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), bias);
+        __m128i b = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 4)), bias);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+            _mm_xor_si128(_mm_packs_epi32(a, b), flip));
+    }
+#endif
+    for (; i < count; ++i) {
+        dest[i] = static_cast<uint16_t>(source[i]);
+    }
+}
+
+void okami::geometry::ArraySliceWidenIndices(uint32_t* dest, const uint16_t* source, size_t count) {
+    size_t i = 0;
+#if OKAMI_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_unpacklo_epi16(a, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 4), _mm_unpackhi_epi16(a, zero));
+    }
+#endif
+    for (; i < count; ++i) {
+        dest[i] = source[i];
+    }
+}
+
 void okami::geometry::ComputeLayoutProperties(
     size_t vertex_count,
     const VertexFormatInfo& layout,
@@ -250,7 +338,7 @@ void okami::geometry::ComputeLayoutProperties(
 
             strides.emplace_back(stride);
 
-            size_t lastIndex = offset + size + (nVerts - 1) * stride;
+            size_t lastIndex = nVerts > 0 ? offset + size + (nVerts - 1) * stride : 0;
 
             channel_sizes[channel] = std::max<size_t>(channel_sizes[channel], lastIndex);
 
@@ -272,15 +360,15 @@ PackIndexing okami::geometry::PackIndexing::From(
     auto& layoutElements = layout.elements;	
     ComputeLayoutProperties(vertex_count, layout, offsets, strides, indexing.channelSizes);
 
-    auto verifyAttrib = [](const LayoutElement& element) {
-        if (element.valueType != ValueType::FLOAT32) {
-            throw std::runtime_error("Attribute type must be VT_FLOAT32!");
+    auto verifyAttrib = [](const LayoutElement& element, AttributeSemantic semantic) {
+        if (!IsSupportedAttribute(semantic, element)) {
+            throw std::runtime_error("Unsupported attribute format!");
         }
     };
 
     if (layout.position >= 0) {
         auto& posAttrib = layoutElements[layout.position];
-        verifyAttrib(posAttrib);
+        verifyAttrib(posAttrib, AttributeSemantic::Position);
         indexing.positionOffset = offsets[layout.position];
         indexing.positionChannel = posAttrib.bufferSlot;
         indexing.positionStride = strides[layout.position];
@@ -288,7 +376,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     for (auto& uv : layout.uvs) {
         auto& uvAttrib = layoutElements[uv];
-        verifyAttrib(uvAttrib);
+        verifyAttrib(uvAttrib, AttributeSemantic::Generic);
         indexing.uvOffsets.emplace_back((int)offsets[uv]);
         indexing.uvChannels.emplace_back(uvAttrib.bufferSlot);
         indexing.uvStrides.emplace_back(strides[uv]);
@@ -296,7 +384,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     if (layout.normal >= 0) {
         auto& normalAttrib = layoutElements[layout.normal];
-        verifyAttrib(normalAttrib);
+        verifyAttrib(normalAttrib, AttributeSemantic::Direction);
         indexing.normalOffset = offsets[layout.normal];
         indexing.normalChannel = normalAttrib.bufferSlot;
         indexing.normalStride = strides[layout.normal];
@@ -304,7 +392,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     if (layout.tangent >= 0) {
         auto& tangentAttrib = layoutElements[layout.tangent];
-        verifyAttrib(tangentAttrib);
+        verifyAttrib(tangentAttrib, AttributeSemantic::Direction);
         indexing.tangentOffset = offsets[layout.tangent];
         indexing.tangentChannel = tangentAttrib.bufferSlot;
         indexing.tangentStride = strides[layout.tangent];
@@ -312,7 +400,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     if (layout.bitangent >= 0) {
         auto& bitangentAttrib = layoutElements[layout.bitangent];
-        verifyAttrib(bitangentAttrib);
+        verifyAttrib(bitangentAttrib, AttributeSemantic::Direction);
         indexing.bitangentOffset = offsets[layout.bitangent];
         indexing.bitangentChannel = bitangentAttrib.bufferSlot;
         indexing.bitangentStride = strides[layout.bitangent];
@@ -320,7 +408,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     for (auto& color : layout.colors) {
         auto& colorAttrib = layoutElements[color];
-        verifyAttrib(colorAttrib);
+        verifyAttrib(colorAttrib, AttributeSemantic::Generic);
         indexing.colorOffsets.emplace_back(offsets[color]);
         indexing.colorChannels.emplace_back(colorAttrib.bufferSlot);
         indexing.colorStrides.emplace_back(strides[color]);
@@ -328,7 +416,7 @@ PackIndexing okami::geometry::PackIndexing::From(
 
     for (auto& uvw : layout.uvws) {
         auto& uvwAttrib = layoutElements[uvw];
-        verifyAttrib(uvwAttrib);
+        verifyAttrib(uvwAttrib, AttributeSemantic::Generic);
         indexing.uvwOffsets.emplace_back(offsets[uvw]);
         indexing.uvwChannels.emplace_back(uvwAttrib.bufferSlot);
         indexing.uvwStrides.emplace_back(strides[uvw]);
@@ -337,17 +425,529 @@ PackIndexing okami::geometry::PackIndexing::From(
     return indexing;
 }
 
-Geometry okami::geometry::Geometry::ToLayout(const VertexFormatInfo& format) {
-    return Geometry::Pack<
-        uint32_t,
-        glm::vec2,
-        glm::vec3,
-        glm::vec4>(format, 
-            Geometry::Unpack<
-                uint32_t,
-                glm::vec2,
-                glm::vec3,
-                glm::vec4>(*this));
+namespace {
+    bool IsNormalizedInteger(const LayoutElement& element) {
+        switch (element.valueType) {
+            case ValueType::INT8:
+            case ValueType::INT16:
+            case ValueType::UINT8:
+            case ValueType::UINT16:
+                return element.isNormalized;
+            default:
+                return false;
+        }
+    }
+
+    bool IsSigned(ValueType type) {
+        return type == ValueType::INT8 || type == ValueType::INT16;
+    }
+
+    bool IsOctahedral(AttributeSemantic semantic, const LayoutElement& element) {
+        return semantic == AttributeSemantic::Direction &&
+            element.valueType != ValueType::FLOAT32 &&
+            element.numComponents == 2;
+    }
+
+    void WriteComponent(uint8_t* dest, ValueType type, float value) {
+        switch (type) {
+            case ValueType::FLOAT32:
+                std::memcpy(dest, &value, sizeof(float));
+                break;
+            case ValueType::FLOAT16: {
+                uint16_t half = glm::packHalf1x16(value);
+                std::memcpy(dest, &half, sizeof(half));
+                break;
+            }
+            case ValueType::INT8:
+                *dest = glm::packSnorm1x8(value);
+                break;
+            case ValueType::UINT8:
+                *dest = glm::packUnorm1x8(value);
+                break;
+            case ValueType::INT16: {
+                uint16_t snorm = glm::packSnorm1x16(value);
+                std::memcpy(dest, &snorm, sizeof(snorm));
+                break;
+            }
+            case ValueType::UINT16: {
+                uint16_t unorm = glm::packUnorm1x16(value);
+                std::memcpy(dest, &unorm, sizeof(unorm));
+                break;
+            }
+            default:
+                throw std::runtime_error("Unsupported attribute format!");
+        }
+    }
+
+    float ReadComponent(const uint8_t* src, ValueType type) {
+        switch (type) {
+            case ValueType::FLOAT32: {
+                float value;
+                std::memcpy(&value, src, sizeof(float));
+                return value;
+            }
+            case ValueType::FLOAT16: {
+                uint16_t half;
+                std::memcpy(&half, src, sizeof(half));
+                return glm::unpackHalf1x16(half);
+            }
+            case ValueType::INT8:
+                return glm::unpackSnorm1x8(*src);
+            case ValueType::UINT8:
+                return glm::unpackUnorm1x8(*src);
+            case ValueType::INT16: {
+                uint16_t snorm;
+                std::memcpy(&snorm, src, sizeof(snorm));
+                return glm::unpackSnorm1x16(snorm);
+            }
+            case ValueType::UINT16: {
+                uint16_t unorm;
+                std::memcpy(&unorm, src, sizeof(unorm));
+                return glm::unpackUnorm1x16(unorm);
+            }
+            default:
+                throw std::runtime_error("Unsupported attribute format!");
+        }
+    }
+
+    float SignNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    PositionDequantization DequantizationFrom(const BoundingBox& bounds) {
+        PositionDequantization result;
+        result.offset = bounds.mLower;
+        result.scale = bounds.mUpper - bounds.mLower;
+        return result;
+    }
+}
+
+bool okami::geometry::IsSupportedAttribute(AttributeSemantic semantic, const LayoutElement& element) {
+    if (element.valueType == ValueType::FLOAT32 || element.valueType == ValueType::FLOAT16) {
+        return true;
+    }
+    if (!IsNormalizedInteger(element)) {
+        return false;
+    }
+
+    switch (semantic) {
+        case AttributeSemantic::Position:
+            // Quantised against the bounding box, which maps onto [0, 1]
+            return !IsSigned(element.valueType);
+        case AttributeSemantic::Direction:
+            return IsSigned(element.valueType) && element.numComponents >= 2;
+        default:
+            return true;
+    }
+}
+
+glm::vec2 okami::geometry::OctahedralEncode(const glm::vec3& direction) {
+    float l1 = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+
+    glm::vec3 n = direction / l1;
+    if (n.z >= 0.0f) {
+        return glm::vec2(n.x, n.y);
+    }
+
+    // Fold the lower hemisphere over the diagonals
+    return glm::vec2(
+        (1.0f - std::abs(n.y)) * SignNotZero(n.x),
+        (1.0f - std::abs(n.x)) * SignNotZero(n.y));
+}
+
+glm::vec3 okami::geometry::OctahedralDecode(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return n / std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+}
+
+void okami::geometry::EncodeAttribute(AttributeSemantic semantic,
+    const LayoutElement& element,
+    const BoundingBox& bounds,
+    const float* src,
+    size_t srcComponents,
+    uint8_t* dest,
+    size_t destStrideBytes,
+    size_t count) {
+
+    if (!IsSupportedAttribute(semantic, element)) {
+        throw std::runtime_error("Unsupported attribute format!");
+    }
+
+    auto type = element.valueType;
+    size_t componentSize = GetSize(type);
+    size_t components = element.numComponents;
+    bool quantised = semantic == AttributeSemantic::Position && IsNormalizedInteger(element);
+    bool octahedral = IsOctahedral(semantic, element);
+
+    auto dequant = DequantizationFrom(bounds);
+    glm::vec3 invScale(
+        dequant.scale.x > 0.0f ? 1.0f / dequant.scale.x : 0.0f,
+        dequant.scale.y > 0.0f ? 1.0f / dequant.scale.y : 0.0f,
+        dequant.scale.z > 0.0f ? 1.0f / dequant.scale.z : 0.0f);
+
+    for (size_t i = 0; i < count; ++i, src += srcComponents, dest += destStrideBytes) {
+        float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (size_t c = 0; c < std::min<size_t>(srcComponents, 4); ++c) {
+            values[c] = src[c];
+        }
+
+        if (octahedral) {
+            auto encoded = OctahedralEncode(glm::vec3(values[0], values[1], values[2]));
+            values[0] = encoded.x;
+            values[1] = encoded.y;
+        } else if (quantised) {
+            for (int c = 0; c < 3; ++c) {
+                values[c] = (values[c] - dequant.offset[c]) * invScale[c];
+            }
+        }
+
+        for (size_t c = 0; c < components; ++c) {
+            WriteComponent(dest + c * componentSize, type, c < 4 ? values[c] : 0.0f);
+        }
+    }
+}
+
+void okami::geometry::DecodeAttribute(AttributeSemantic semantic,
+    const LayoutElement& element,
+    const BoundingBox& bounds,
+    const uint8_t* src,
+    size_t srcStrideBytes,
+    float* dest,
+    size_t destComponents,
+    size_t count) {
+
+    if (!IsSupportedAttribute(semantic, element)) {
+        throw std::runtime_error("Unsupported attribute format!");
+    }
+
+    auto type = element.valueType;
+    size_t componentSize = GetSize(type);
+    size_t components = std::min<size_t>(element.numComponents, 4);
+    bool quantised = semantic == AttributeSemantic::Position && IsNormalizedInteger(element);
+    bool octahedral = IsOctahedral(semantic, element);
+
+    auto dequant = DequantizationFrom(bounds);
+
+    for (size_t i = 0; i < count; ++i, src += srcStrideBytes, dest += destComponents) {
+        float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (size_t c = 0; c < components; ++c) {
+            values[c] = ReadComponent(src + c * componentSize, type);
+        }
+
+        if (octahedral) {
+            auto decoded = OctahedralDecode(glm::vec2(values[0], values[1]));
+            values[0] = decoded.x;
+            values[1] = decoded.y;
+            values[2] = decoded.z;
+        } else if (quantised) {
+            for (int c = 0; c < 3; ++c) {
+                values[c] = dequant.offset[c] + values[c] * dequant.scale[c];
+            }
+        }
+
+        for (size_t c = 0; c < destComponents; ++c) {
+            dest[c] = c < 4 ? values[c] : 0.0f;
+        }
+    }
+}
+
+PositionDequantization okami::geometry::GetPositionDequantization(
+    const Desc& desc, const BoundingBox& bounds) {
+    if (desc.layout.position < 0) {
+        return {};
+    }
+    auto const& element = desc.layout.elements[desc.layout.position];
+    if (!IsNormalizedInteger(element)) {
+        return {};
+    }
+    return DequantizationFrom(bounds);
+}
+
+PackSizes okami::geometry::Geometry::GetPackSizes(const VertexFormatInfo& layout,
+    size_t vertexCount,
+    size_t indexCount) {
+    std::vector<size_t> offsets;
+    std::vector<size_t> strides;
+
+    PackSizes sizes;
+    ComputeLayoutProperties(vertexCount, layout, offsets, strides, sizes.vertexBuffers);
+    sizes.indexBuffer = indexCount * GetSize(SelectIndexType(vertexCount));
+    return sizes;
+}
+
+namespace {
+    // Where one attribute lives in a packed layout
+    struct AttributeSlot {
+        const LayoutElement* element = nullptr;
+        int channel = -1;
+        int offset = -1;
+        int stride = -1;
+
+        inline size_t GetSize() const {
+            return (size_t)okami::GetSize(element->valueType) * element->numComponents;
+        }
+    };
+
+    // Moves one attribute from the source layout to the destination layout.
+    // A missing source element means the attribute is filled with fillValue.
+    struct AttributeCopy {
+        AttributeSemantic semantic;
+        size_t dim;
+        float fillValue;
+        AttributeSlot src;
+        AttributeSlot dest;
+
+        inline bool IsFill() const {
+            return src.element == nullptr;
+        }
+
+        inline bool IsByteCopy() const {
+            return src.element->valueType == dest.element->valueType &&
+                src.element->numComponents == dest.element->numComponents &&
+                src.element->isNormalized == dest.element->isNormalized;
+        }
+    };
+
+    AttributeSlot Slot(const VertexFormatInfo& layout, int element,
+        int channel, int offset, int stride) {
+        if (element < 0 || offset < 0) {
+            return {};
+        }
+        return AttributeSlot{&layout.elements[element], channel, offset, stride};
+    }
+
+    AttributeSlot Slot(const VertexFormatInfo& layout, const std::vector<int>& elements,
+        const std::vector<int>& channels, const std::vector<int>& offsets,
+        const std::vector<int>& strides, size_t index) {
+        if (index >= elements.size()) {
+            return {};
+        }
+        return AttributeSlot{&layout.elements[elements[index]],
+            channels[index], offsets[index], strides[index]};
+    }
+
+    // Pairs every attribute of the destination layout with the same
+    // attribute of the source layout
+    std::vector<AttributeCopy> MakeCopyPlan(
+        const VertexFormatInfo& srcLayout, const PackIndexing& srcIndexing,
+        const VertexFormatInfo& destLayout, const PackIndexing& destIndexing) {
+
+        std::vector<AttributeCopy> plan;
+
+        auto add = [&](AttributeSemantic semantic, size_t dim, float fillValue,
+            AttributeSlot src, AttributeSlot dest) {
+            if (dest.element) {
+                plan.emplace_back(AttributeCopy{semantic, dim, fillValue, src, dest});
+            }
+        };
+
+        add(AttributeSemantic::Position, 3, 0.0f,
+            Slot(srcLayout, srcLayout.position, srcIndexing.positionChannel,
+                srcIndexing.positionOffset, srcIndexing.positionStride),
+            Slot(destLayout, destLayout.position, destIndexing.positionChannel,
+                destIndexing.positionOffset, destIndexing.positionStride));
+
+        for (size_t i = 0; i < destLayout.uvs.size(); ++i) {
+            add(AttributeSemantic::Generic, 2, 0.0f,
+                Slot(srcLayout, srcLayout.uvs, srcIndexing.uvChannels,
+                    srcIndexing.uvOffsets, srcIndexing.uvStrides, i),
+                Slot(destLayout, destLayout.uvs, destIndexing.uvChannels,
+                    destIndexing.uvOffsets, destIndexing.uvStrides, i));
+        }
+
+        add(AttributeSemantic::Direction, 3, 0.0f,
+            Slot(srcLayout, srcLayout.normal, srcIndexing.normalChannel,
+                srcIndexing.normalOffset, srcIndexing.normalStride),
+            Slot(destLayout, destLayout.normal, destIndexing.normalChannel,
+                destIndexing.normalOffset, destIndexing.normalStride));
+
+        add(AttributeSemantic::Direction, 3, 0.0f,
+            Slot(srcLayout, srcLayout.tangent, srcIndexing.tangentChannel,
+                srcIndexing.tangentOffset, srcIndexing.tangentStride),
+            Slot(destLayout, destLayout.tangent, destIndexing.tangentChannel,
+                destIndexing.tangentOffset, destIndexing.tangentStride));
+
+        add(AttributeSemantic::Direction, 3, 0.0f,
+            Slot(srcLayout, srcLayout.bitangent, srcIndexing.bitangentChannel,
+                srcIndexing.bitangentOffset, srcIndexing.bitangentStride),
+            Slot(destLayout, destLayout.bitangent, destIndexing.bitangentChannel,
+                destIndexing.bitangentOffset, destIndexing.bitangentStride));
+
+        for (size_t i = 0; i < destLayout.colors.size(); ++i) {
+            add(AttributeSemantic::Generic, 4, 1.0f,
+                Slot(srcLayout, srcLayout.colors, srcIndexing.colorChannels,
+                    srcIndexing.colorOffsets, srcIndexing.colorStrides, i),
+                Slot(destLayout, destLayout.colors, destIndexing.colorChannels,
+                    destIndexing.colorOffsets, destIndexing.colorStrides, i));
+        }
+
+        for (size_t i = 0; i < destLayout.uvws.size(); ++i) {
+            add(AttributeSemantic::Generic, 3, 0.0f,
+                Slot(srcLayout, srcLayout.uvws, srcIndexing.uvwChannels,
+                    srcIndexing.uvwOffsets, srcIndexing.uvwStrides, i),
+                Slot(destLayout, destLayout.uvws, destIndexing.uvwChannels,
+                    destIndexing.uvwOffsets, destIndexing.uvwStrides, i));
+        }
+
+        return plan;
+    }
+
+    // Converting in place is safe when every destination attribute starts
+    // where its source does, is no larger and keeps the stride, since then
+    // each attribute only ever overwrites its own source bytes. Filled
+    // attributes may land on dropped ones, so they are written last.
+    bool CanConvertInPlace(const std::vector<AttributeCopy>& plan,
+        const PackIndexing& srcIndexing, const PackIndexing& destIndexing) {
+        if (destIndexing.channelSizes.size() > srcIndexing.channelSizes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < destIndexing.channelSizes.size(); ++i) {
+            if (destIndexing.channelSizes[i] > srcIndexing.channelSizes[i]) {
+                return false;
+            }
+        }
+        for (auto const& copy : plan) {
+            if (copy.IsFill()) {
+                continue;
+            }
+            if (copy.src.channel != copy.dest.channel ||
+                copy.src.offset != copy.dest.offset ||
+                copy.src.stride != copy.dest.stride ||
+                copy.dest.GetSize() > copy.src.GetSize()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CopyAttribute(const AttributeCopy& copy, const BoundingBox& bounds,
+        std::span<const uint8_t* const> srcChannels,
+        std::span<uint8_t* const> destChannels,
+        size_t count) {
+
+        auto const& dest = copy.dest;
+        uint8_t* destBytes = destChannels[dest.channel] + dest.offset;
+
+        if (copy.IsFill()) {
+            // Encode a single vertex and repeat it
+            uint8_t value[4 * sizeof(double)] = {};
+            float fill[4] = { copy.fillValue, copy.fillValue, copy.fillValue, copy.fillValue };
+            EncodeAttribute(copy.semantic, *dest.element, bounds, fill, copy.dim, value, 0, 1);
+            size_t size = dest.GetSize();
+            for (size_t i = 0; i < count; ++i, destBytes += dest.stride) {
+                std::memcpy(destBytes, value, size);
+            }
+            return;
+        }
+
+        auto const& src = copy.src;
+        const uint8_t* srcBytes = srcChannels[src.channel] + src.offset;
+
+        if (copy.IsByteCopy()) {
+            if (srcBytes == destBytes) {
+                return;
+            }
+            size_t size = dest.GetSize();
+            if (dest.element->valueType == ValueType::FLOAT32 &&
+                dest.element->numComponents >= 2 && dest.element->numComponents <= 4) {
+                CopyFloats(destBytes, srcBytes, dest.stride, src.stride,
+                    dest.element->numComponents, count);
+            } else {
+                for (size_t i = 0; i < count; ++i, srcBytes += src.stride, destBytes += dest.stride) {
+                    std::memcpy(destBytes, srcBytes, size);
+                }
+            }
+            return;
+        }
+
+        // Formats differ, so go through floats a chunk at a time. The whole
+        // chunk is decoded before any of it is written, which keeps this
+        // correct when converting in place.
+        std::vector<float> staging(std::min(count, kPackChunkSize) * copy.dim);
+        for (size_t begin = 0; begin < count; begin += kPackChunkSize) {
+            size_t chunk = std::min(count - begin, kPackChunkSize);
+            DecodeAttribute(copy.semantic, *src.element, bounds,
+                srcBytes + begin * src.stride, src.stride,
+                staging.data(), copy.dim, chunk);
+            EncodeAttribute(copy.semantic, *dest.element, bounds,
+                staging.data(), copy.dim,
+                destBytes + begin * dest.stride, dest.stride, chunk);
+        }
+    }
+
+    void ExecuteCopyPlan(const std::vector<AttributeCopy>& plan, const BoundingBox& bounds,
+        std::span<const uint8_t* const> srcChannels,
+        std::span<uint8_t* const> destChannels,
+        size_t count) {
+        for (auto const& copy : plan) {
+            if (!copy.IsFill()) {
+                CopyAttribute(copy, bounds, srcChannels, destChannels, count);
+            }
+        }
+        for (auto const& copy : plan) {
+            if (copy.IsFill()) {
+                CopyAttribute(copy, bounds, srcChannels, destChannels, count);
+            }
+        }
+    }
+}
+
+Geometry okami::geometry::Geometry::ToLayout(const VertexFormatInfo& format) const& {
+    size_t vertexCount = desc.attribs.numVertices;
+    auto srcIndexing = PackIndexing::From(desc.layout, vertexCount);
+    auto destIndexing = PackIndexing::From(format, vertexCount);
+    auto plan = MakeCopyPlan(desc.layout, srcIndexing, format, destIndexing);
+
+    std::vector<BufferData> buffers;
+    std::vector<uint8_t*> destChannels;
+    buffers.reserve(destIndexing.channelSizes.size());
+    for (auto size : destIndexing.channelSizes) {
+        buffers.emplace_back(BufferData{std::vector<uint8_t>(size)});
+        destChannels.emplace_back(buffers.back().bytes.data());
+    }
+
+    std::vector<const uint8_t*> srcChannels;
+    for (auto const& buffer : vertexBuffers) {
+        srcChannels.emplace_back(buffer.bytes.data());
+    }
+
+    ExecuteCopyPlan(plan, boundingBox, srcChannels, destChannels, vertexCount);
+
+    Desc result = desc;
+    result.layout = format;
+    return Geometry(std::move(result), std::move(buffers), indexBuffer, boundingBox, meshlets);
+}
+
+Geometry okami::geometry::Geometry::ToLayout(const VertexFormatInfo& format) && {
+    size_t vertexCount = desc.attribs.numVertices;
+    auto srcIndexing = PackIndexing::From(desc.layout, vertexCount);
+    auto destIndexing = PackIndexing::From(format, vertexCount);
+    auto plan = MakeCopyPlan(desc.layout, srcIndexing, format, destIndexing);
+
+    if (!CanConvertInPlace(plan, srcIndexing, destIndexing)) {
+        return static_cast<const Geometry&>(*this).ToLayout(format);
+    }
+
+    std::vector<uint8_t*> channels;
+    for (auto& buffer : vertexBuffers) {
+        channels.emplace_back(buffer.bytes.data());
+    }
+    std::vector<const uint8_t*> srcChannels(channels.begin(), channels.end());
+
+    ExecuteCopyPlan(plan, boundingBox, srcChannels, channels, vertexCount);
+
+    vertexBuffers.resize(destIndexing.channelSizes.size());
+    for (size_t i = 0; i < vertexBuffers.size(); ++i) {
+        vertexBuffers[i].bytes.resize(destIndexing.channelSizes[i]);
+    }
+    desc.layout = format;
+    return std::move(*this);
 }
 
 Geometry okami::geometry::Geometry::Duplicate() {
@@ -356,58 +956,189 @@ Geometry okami::geometry::Geometry::Duplicate() {
     buf.desc = desc;
     buf.indexBuffer = indexBuffer;
     buf.vertexBuffers = vertexBuffers;
+    buf.meshlets = meshlets;
     return buf;
 }
 
-Geometry okami::geometry::Geometry::Load(
-    const std::filesystem::path& path,
-    const VertexFormatInfo& layout) {
-
-    Assimp::Importer importer;
-
-    unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | 
+namespace {
+    unsigned int kImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | 
         aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices |
         aiProcess_GenUVCoords | aiProcess_CalcTangentSpace | 
         aiProcess_ConvertToLeftHanded | aiProcessPreset_TargetRealtime_Quality;
 
-    auto pathStr = path.string();
-    const aiScene* scene = importer.ReadFile(pathStr.c_str(), flags);
-    
-    if (!scene) {
-        std::cout << importer.GetErrorString() << std::endl;
-        throw std::runtime_error("Failed to load geometry!");
-    }
+    const aiScene* ImportScene(Assimp::Importer& importer, const std::filesystem::path& path) {
+        auto pathStr = path.string();
+        const aiScene* scene = importer.ReadFile(pathStr.c_str(), kImportFlags);
+        
+        if (!scene) {
+            std::cout << importer.GetErrorString() << std::endl;
+            throw std::runtime_error("Failed to load geometry!");
+        }
+
+        if (!scene->HasMeshes()) {
+            throw std::runtime_error("Geometry has no meshes!");
+        }
 
-    if (!scene->HasMeshes()) {
-        throw std::runtime_error("Geometry has no meshes!");
+        return scene;
     }
 
-    size_t nVerts;
-    size_t nIndices;
+    Geometry PackMesh(const aiMesh* mesh, const VertexFormatInfo& layout, ThreadPool& pool) {
+        size_t nVerts = mesh->mNumVertices;
+        size_t nIndices = mesh->mNumFaces * 3;
+
+        DataView<aiFace, aiVector3D, aiVector3D> data(
+            nVerts, nIndices,
+            mesh->mFaces,
+            mesh->mVertices,
+            mesh->mTextureCoords[0],
+            mesh->mNormals,
+            mesh->mTangents,
+            mesh->mBitangents);
 
-    if (!scene->HasMeshes()) {
-        throw std::runtime_error("Assimp scene has no meshes!");
+        return Geometry::Pack<aiFace, aiVector3D, aiVector3D>(layout, data, pool);
     }
 
-    aiMesh* mesh = scene->mMeshes[0];
+    glm::mat4 ToGLM(const aiMatrix4x4& m) {
+        // Assimp matrices are row major
+        return glm::mat4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+    }
+}
+
+Geometry okami::geometry::Geometry::Load(
+    const std::filesystem::path& path,
+    const VertexFormatInfo& layout) {
+
+    Assimp::Importer importer;
+    const aiScene* scene = ImportScene(importer, path);
+
+    return PackMesh(scene->mMeshes[0], layout, ThreadPool::Default());
+}
+
+Scene okami::geometry::Scene::Load(
+    const std::filesystem::path& path,
+    const VertexFormatInfo& layout,
+    ThreadPool& pool) {
+
+    Assimp::Importer importer;
+    const aiScene* scene = ImportScene(importer, path);
+
+    // Point and line meshes can survive triangulation, skip them
+    Scene result;
+    std::vector<uint32_t> sourceMeshes;
+    std::vector<int> meshRemap(scene->mNumMeshes, -1);
+    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+        if (scene->mMeshes[i]->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            meshRemap[i] = static_cast<int>(sourceMeshes.size());
+            sourceMeshes.emplace_back(i);
+        }
+    }
 
-    nVerts = mesh->mNumVertices;
-    nIndices = mesh->mNumFaces * 3;
+    // Meshes are independent of each other, so pack them all at once
+    result.meshes.resize(sourceMeshes.size());
+    pool.ParallelFor(sourceMeshes.size(), [&](size_t i) {
+        const aiMesh* mesh = scene->mMeshes[sourceMeshes[i]];
+        auto& dest = result.meshes[i];
+        dest.name = mesh->mName.C_Str();
+        dest.materialIndex = mesh->mMaterialIndex;
+        // Large meshes also split their vertices over the pool
+        dest.geometry = PackMesh(mesh, layout, pool);
+    });
+
+    // Flatten the node hierarchy breadth first
+    std::vector<std::pair<const aiNode*, int>> queue;
+    if (scene->mRootNode) {
+        queue.emplace_back(scene->mRootNode, -1);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        auto [node, parent] = queue[head];
+
+        SceneNode dest;
+        dest.name = node->mName.C_Str();
+        dest.parent = parent;
+        dest.localTransform = ToGLM(node->mTransformation);
+        dest.globalTransform = parent >= 0 ? 
+            result.nodes[parent].globalTransform * dest.localTransform :
+            dest.localTransform;
+        for (uint32_t i = 0; i < node->mNumMeshes; ++i) {
+            auto mesh = meshRemap[node->mMeshes[i]];
+            if (mesh >= 0) {
+                dest.meshes.emplace_back(static_cast<uint32_t>(mesh));
+            }
+        }
 
-    DataView<aiFace, aiVector3D, aiVector3D> data(
-        nVerts, nIndices,
-        mesh->mFaces,
-        mesh->mVertices,
-        mesh->mTextureCoords[0],
-        mesh->mNormals,
-        mesh->mTangents,
-        mesh->mBitangents);
+        auto index = static_cast<int>(result.nodes.size());
+        result.nodes.emplace_back(std::move(dest));
+        for (uint32_t i = 0; i < node->mNumChildren; ++i) {
+            queue.emplace_back(node->mChildren[i], index);
+        }
+    }
 
-    return Geometry::Pack<aiFace, aiVector3D, aiVector3D>(layout, data);
+    return result;
 }
 
 Geometry okami::geometry::Load(
     const std::filesystem::path& path, 
     const VertexFormatInfo& layout) {
     return Geometry::Load(path, layout);
+}
+
+std::vector<uint32_t> okami::geometry::UnpackIndices(const Geometry& geometry) {
+    auto const& desc = geometry.GetDesc();
+    auto const& bytes = geometry.GetIndexBuffer().bytes;
+    std::vector<uint32_t> indices(desc.indexedAttribs.numIndices);
+    if (indices.empty()) {
+        return indices;
+    }
+
+    switch (desc.indexedAttribs.indexType) {
+        case ValueType::UINT16:
+            ArraySliceWidenIndices(indices.data(),
+                reinterpret_cast<const uint16_t*>(bytes.data()), indices.size());
+            break;
+        case ValueType::UINT32:
+            std::memcpy(indices.data(), bytes.data(), indices.size() * sizeof(uint32_t));
+            break;
+        default:
+            throw std::runtime_error("Index type must be VT_UINT16 or VT_UINT32!");
+    }
+    return indices;
+}
+
+BufferData okami::geometry::PackIndices(std::span<const uint32_t> indices, ValueType indexType) {
+    BufferData buffer;
+    switch (indexType) {
+        case ValueType::UINT16:
+            buffer.bytes.resize(indices.size() * sizeof(uint16_t));
+            ArraySliceNarrowIndices(reinterpret_cast<uint16_t*>(buffer.bytes.data()),
+                indices.data(), indices.size());
+            break;
+        case ValueType::UINT32:
+            buffer.bytes.resize(indices.size() * sizeof(uint32_t));
+            std::memcpy(buffer.bytes.data(), indices.data(), buffer.bytes.size());
+            break;
+        default:
+            throw std::runtime_error("Index type must be VT_UINT16 or VT_UINT32!");
+    }
+    return buffer;
+}
+
+std::vector<glm::vec3> okami::geometry::UnpackPositions(const Geometry& geometry) {
+    size_t vertexCount = geometry.GetDesc().attribs.numVertices;
+    auto indexing = PackIndexing::From(geometry.GetLayout(), vertexCount);
+    if (indexing.positionOffset < 0) {
+        throw std::runtime_error("Geometry has no positions!");
+    }
+
+    auto const& channel = geometry.GetVertexBuffers()[indexing.positionChannel].bytes;
+    auto src = &channel[indexing.positionOffset];
+    std::vector<glm::vec3> positions(vertexCount);
+    DecodeAttribute(AttributeSemantic::Position,
+        geometry.GetLayout().elements[geometry.GetLayout().position],
+        geometry.GetBounds(), src, indexing.positionStride,
+        &positions[0].x, 3, vertexCount);
+    return positions;
 }
\ No newline at end of file
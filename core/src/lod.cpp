@@ -0,0 +1,439 @@
+#include <okami/lod.hpp>
+
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+using namespace okami;
+using namespace okami::geometry;
+
+float okami::ProjectedScreenSize(
+    BoundingBox const& bounds,
+    glm::mat4 const& worldView,
+    glm::mat4 const& proj) {
+    auto center = 0.5f * (bounds.mLower + bounds.mUpper);
+    auto extents = 0.5f * (bounds.mUpper - bounds.mLower);
+
+    // Account for the largest scale along any axis of the world transform
+    float scale = std::max(glm::length(glm::vec3(worldView[0])),
+        std::max(glm::length(glm::vec3(worldView[1])),
+            glm::length(glm::vec3(worldView[2]))));
+    float radius = glm::length(extents) * scale;
+
+    auto viewCenter = worldView * glm::vec4(center, 1.0f);
+    auto clipCenter = proj * viewCenter;
+    float w = std::abs(clipCenter.w);
+
+    // The camera is inside the bounding sphere
+    if (glm::length(glm::vec3(viewCenter)) <= radius ||
+        w <= std::numeric_limits<float>::epsilon()) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    // The radius in NDC over the NDC height of 2 is the diameter as a
+    // fraction of the viewport height. This covers orthographic projections
+    // as well, where w is always 1.
+    return radius * std::abs(proj[1][1]) / w;
+}
+
+float okami::ProjectedScreenSize(
+    BoundingBox const& bounds,
+    WorldTransform const& transform,
+    RenderView const& view) {
+    return ProjectedScreenSize(bounds,
+        view.GetViewMatrix() * transform.ToRelativeMatrix4x4(view.origin),
+        view.GetProjMatrix());
+}
+
+uint32_t okami::SelectLOD(
+    std::span<float const> screenSizes,
+    float screenSize,
+    uint32_t currentLevel,
+    float hysteresis) {
+    if (screenSizes.empty()) {
+        return 0;
+    }
+
+    uint32_t levelCount = static_cast<uint32_t>(screenSizes.size());
+    uint32_t level = std::min(currentLevel, levelCount - 1);
+
+    while (level + 1 < levelCount &&
+        screenSize < screenSizes[level] * (1.0f - hysteresis)) {
+        ++level;
+    }
+    while (level > 0 &&
+        screenSize > screenSizes[level - 1] * (1.0f + hysteresis)) {
+        --level;
+    }
+
+    return level;
+}
+
+namespace {
+    // Symmetric 4x4 error quadric, stored as its upper triangle
+    struct Quadric {
+        std::array<double, 10> m = {};
+
+        static Quadric FromPlane(glm::dvec3 n, double d, double weight) {
+            Quadric q;
+            q.m = {
+                n.x * n.x, n.x * n.y, n.x * n.z, n.x * d,
+                n.y * n.y, n.y * n.z, n.y * d,
+                n.z * n.z, n.z * d,
+                d * d
+            };
+            for (auto& x : q.m) {
+                x *= weight;
+            }
+            return q;
+        }
+
+        Quadric& operator+=(Quadric const& other) {
+            for (size_t i = 0; i < m.size(); ++i) {
+                m[i] += other.m[i];
+            }
+            return *this;
+        }
+
+        double Evaluate(glm::dvec3 p) const {
+            return m[0] * p.x * p.x + 2.0 * m[1] * p.x * p.y + 2.0 * m[2] * p.x * p.z + 2.0 * m[3] * p.x +
+                m[4] * p.y * p.y + 2.0 * m[5] * p.y * p.z + 2.0 * m[6] * p.y +
+                m[7] * p.z * p.z + 2.0 * m[8] * p.z +
+                m[9];
+        }
+    };
+
+    struct Collapse {
+        double cost = std::numeric_limits<double>::infinity();
+        uint32_t from = 0;
+        uint32_t to = 0;
+        uint32_t fromVersion = 0;
+        uint32_t toVersion = 0;
+
+        bool operator>(Collapse const& other) const {
+            return cost > other.cost;
+        }
+    };
+
+    inline uint64_t EdgeKey(uint32_t a, uint32_t b) {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    }
+
+    struct PositionHash {
+        size_t operator()(glm::vec3 const& p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct PositionEqual {
+        bool operator()(glm::vec3 const& a, glm::vec3 const& b) const {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+
+    template <typename T>
+    std::vector<T> Gather(std::vector<T> const& source, std::vector<uint32_t> const& vertices) {
+        std::vector<T> result;
+        if (source.empty()) {
+            return result;
+        }
+        result.reserve(vertices.size());
+        for (auto v : vertices) {
+            result.emplace_back(source[v]);
+        }
+        return result;
+    }
+}
+
+Geometry okami::geometry::Simplify(Geometry const& geometry, SimplifyParams const& params) {
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed || desc.topology != Topology::TRIANGLE_LIST) {
+        throw std::runtime_error("Simplification requires an indexed triangle list!");
+    }
+
+    auto data = Geometry::Unpack(geometry);
+    auto& indices = data.indices;
+    auto const& positions = data.positions;
+
+    size_t vertexCount = positions.size();
+    size_t triCount = indices.size() / 3;
+
+    // Vertices that only differ in their attributes (i.e., on a UV seam) are
+    // welded into one group. Collapses are decided per group, so the surface
+    // is simplified as a whole and seams move together.
+    std::vector<uint32_t> groupOf(vertexCount);
+    std::vector<std::vector<uint32_t>> groupVertices;
+    {
+        std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> groupByPosition;
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            auto [it, isNew] = groupByPosition.emplace(positions[v],
+                static_cast<uint32_t>(groupVertices.size()));
+            if (isNew) {
+                groupVertices.emplace_back();
+            }
+            groupOf[v] = it->second;
+            groupVertices[it->second].emplace_back(v);
+        }
+    }
+    size_t groupCount = groupVertices.size();
+
+    auto position = [&](uint32_t group) {
+        return glm::dvec3(positions[groupVertices[group].front()]);
+    };
+
+    // Accumulate area weighted plane quadrics at every group
+    std::vector<Quadric> quadrics(groupCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        auto tri = &indices[3 * t];
+        auto p0 = glm::dvec3(positions[tri[0]]);
+        auto n = glm::cross(glm::dvec3(positions[tri[1]]) - p0, glm::dvec3(positions[tri[2]]) - p0);
+        double area2 = glm::length(n);
+        if (area2 <= 0.0) {
+            continue;
+        }
+        n /= area2;
+        auto q = Quadric::FromPlane(n, -glm::dot(n, p0), 0.5 * area2);
+        for (int i = 0; i < 3; ++i) {
+            quadrics[groupOf[tri[i]]] += q;
+        }
+    }
+
+    // Welded edges used by only one triangle are on an open boundary
+    std::unordered_map<uint64_t, uint32_t> edgeUseCounts;
+    for (size_t t = 0; t < triCount; ++t) {
+        auto tri = &indices[3 * t];
+        for (int i = 0; i < 3; ++i) {
+            auto a = groupOf[tri[i]];
+            auto b = groupOf[tri[(i + 1) % 3]];
+            if (a != b) {
+                ++edgeUseCounts[EdgeKey(a, b)];
+            }
+        }
+    }
+
+    std::vector<bool> locked(groupCount, false);
+    for (auto const& [key, count] : edgeUseCounts) {
+        if (count == 1) {
+            locked[key >> 32] = true;
+            locked[key & 0xFFFFFFFFu] = true;
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> vertexTris(vertexCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            vertexTris[indices[3 * t + i]].emplace_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    std::vector<bool> triAlive(triCount, true);
+    std::vector<bool> removed(groupCount, false);
+    std::vector<uint32_t> versions(groupCount, 0);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+        Collapse best;
+        auto consider = [&](uint32_t from, uint32_t to) {
+            if (locked[from]) {
+                return;
+            }
+            auto q = quadrics[from];
+            q += quadrics[to];
+            double cost = q.Evaluate(position(to));
+            if (cost < best.cost) {
+                best = Collapse{cost, from, to, versions[from], versions[to]};
+            }
+        };
+        consider(a, b);
+        consider(b, a);
+        if (best.cost < std::numeric_limits<double>::infinity()) {
+            queue.push(best);
+        }
+    };
+
+    for (auto const& [key, count] : edgeUseCounts) {
+        pushEdge(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFFu));
+    }
+
+    auto containsGroup = [&](uint32_t t, uint32_t group) -> int64_t {
+        auto tri = &indices[3 * t];
+        for (int i = 0; i < 3; ++i) {
+            if (groupOf[tri[i]] == group) {
+                return tri[i];
+            }
+        }
+        return -1;
+    };
+
+    // Every vertex of the source group has to move onto a vertex of the
+    // target group it shares a triangle with. Seam vertices can therefore
+    // only slide along their seam. Also rejects collapses that would flip a
+    // triangle.
+    std::vector<std::pair<uint32_t, uint32_t>> moves;
+    auto planCollapse = [&](uint32_t from, uint32_t to) {
+        moves.clear();
+        auto target = position(to);
+
+        for (auto v : groupVertices[from]) {
+            int64_t match = -1;
+            for (auto t : vertexTris[v]) {
+                if (!triAlive[t]) {
+                    continue;
+                }
+                auto other = containsGroup(t, to);
+                if (other >= 0) {
+                    match = other;
+                    continue;
+                }
+
+                auto tri = &indices[3 * t];
+                glm::dvec3 p[3];
+                glm::dvec3 moved[3];
+                for (int i = 0; i < 3; ++i) {
+                    p[i] = glm::dvec3(positions[tri[i]]);
+                    moved[i] = tri[i] == v ? target : p[i];
+                }
+                auto before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                auto after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) <= 0.0) {
+                    return false;
+                }
+            }
+            if (match < 0) {
+                return false;
+            }
+            moves.emplace_back(v, static_cast<uint32_t>(match));
+        }
+        return !moves.empty();
+    };
+
+    size_t aliveCount = triCount;
+    size_t targetCount = static_cast<size_t>(
+        static_cast<double>(triCount) * std::clamp(params.targetRatio, 0.0f, 1.0f));
+
+    while (aliveCount > targetCount && !queue.empty()) {
+        auto collapse = queue.top();
+        queue.pop();
+
+        auto from = collapse.from;
+        auto to = collapse.to;
+
+        if (removed[from] || removed[to] ||
+            versions[from] != collapse.fromVersion ||
+            versions[to] != collapse.toVersion) {
+            continue;
+        }
+        if (collapse.cost > params.maxError) {
+            break;
+        }
+        if (!planCollapse(from, to)) {
+            continue;
+        }
+
+        for (auto [v, target] : moves) {
+            for (auto t : vertexTris[v]) {
+                if (!triAlive[t]) {
+                    continue;
+                }
+                if (containsGroup(t, to) >= 0) {
+                    triAlive[t] = false;
+                    --aliveCount;
+                    continue;
+                }
+                auto tri = &indices[3 * t];
+                for (int i = 0; i < 3; ++i) {
+                    if (tri[i] == v) {
+                        tri[i] = target;
+                    }
+                }
+                vertexTris[target].emplace_back(t);
+            }
+            vertexTris[v].clear();
+        }
+
+        removed[from] = true;
+        quadrics[to] += quadrics[from];
+        ++versions[to];
+
+        // Drop dead triangles and requeue every edge around the merged group
+        for (auto v : groupVertices[to]) {
+            auto& tris = vertexTris[v];
+            tris.erase(std::remove_if(tris.begin(), tris.end(),
+                [&](uint32_t t) { return !triAlive[t]; }), tris.end());
+            for (auto t : tris) {
+                auto tri = &indices[3 * t];
+                for (int i = 0; i < 3; ++i) {
+                    auto group = groupOf[tri[i]];
+                    if (group != to) {
+                        pushEdge(to, group);
+                    }
+                }
+            }
+        }
+    }
+
+    // Compact the surviving vertices in order of first use
+    std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> vertices;
+    Data<> result;
+    result.topology = data.topology;
+    result.indices.reserve(aliveCount * 3);
+
+    for (size_t t = 0; t < triCount; ++t) {
+        if (!triAlive[t]) {
+            continue;
+        }
+        for (int i = 0; i < 3; ++i) {
+            auto v = indices[3 * t + i];
+            if (remap[v] == std::numeric_limits<uint32_t>::max()) {
+                remap[v] = static_cast<uint32_t>(vertices.size());
+                vertices.emplace_back(v);
+            }
+            result.indices.emplace_back(remap[v]);
+        }
+    }
+
+    result.positions = Gather(data.positions, vertices);
+    result.normals = Gather(data.normals, vertices);
+    result.tangents = Gather(data.tangents, vertices);
+    result.bitangents = Gather(data.bitangents, vertices);
+    for (auto const& uv : data.uvs) {
+        result.uvs.emplace_back(Gather(uv, vertices));
+    }
+    for (auto const& color : data.colors) {
+        result.colors.emplace_back(Gather(color, vertices));
+    }
+    for (auto const& uvw : data.uvws) {
+        result.uvws.emplace_back(Gather(uvw, vertices));
+    }
+
+    return Geometry::Pack(geometry.GetLayout(), result);
+}
+
+LODGroup okami::geometry::LODGroup::Generate(
+    Geometry&& base,
+    std::span<float const> ratios,
+    std::span<float const> screenSizes) {
+    if (screenSizes.size() != ratios.size() + 1) {
+        throw std::runtime_error("LOD group needs one screen size per level!");
+    }
+
+    LODGroup group;
+    group.levels.emplace_back(std::move(base));
+    group.screenSizes.assign(screenSizes.begin(), screenSizes.end());
+
+    // Each level is simplified from the one before it, which is much cheaper
+    // than starting over from the base mesh every time
+    float lastRatio = 1.0f;
+    for (auto ratio : ratios) {
+        SimplifyParams params;
+        params.targetRatio = ratio / lastRatio;
+        group.levels.emplace_back(Simplify(group.levels.back(), params));
+        lastRatio = ratio;
+    }
+
+    return group;
+}
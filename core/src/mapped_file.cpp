@@ -0,0 +1,108 @@
+#include <okami/mapped_file.hpp>
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace okami;
+
+okami::MappedFile::~MappedFile() {
+    Close();
+}
+
+okami::MappedFile::MappedFile(MappedFile&& other) noexcept :
+    _data(std::exchange(other._data, nullptr)),
+    _size(std::exchange(other._size, 0)),
+#ifdef _WIN32
+    _file(std::exchange(other._file, nullptr)),
+    _mapping(std::exchange(other._mapping, nullptr)) {
+#else
+    _file(std::exchange(other._file, -1)) {
+#endif
+}
+
+MappedFile& okami::MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#ifdef _WIN32
+        _file = std::exchange(other._file, nullptr);
+        _mapping = std::exchange(other._mapping, nullptr);
+#else
+        _file = std::exchange(other._file, -1);
+#endif
+    }
+    return *this;
+}
+
+void okami::MappedFile::Close() {
+#ifdef _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+    }
+    if (_file) {
+        CloseHandle(_file);
+    }
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_data) {
+        munmap(const_cast<void*>(_data), _size);
+    }
+    if (_file >= 0) {
+        close(_file);
+    }
+    _file = -1;
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+Expected<MappedFile> okami::MappedFile::Open(std::filesystem::path const& path) {
+    MappedFile result;
+
+#ifdef _WIN32
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    OKAMI_EXP_RETURN_IF(file == INVALID_HANDLE_VALUE, InvalidPathError{path.string()});
+    result._file = file;
+
+    LARGE_INTEGER size;
+    OKAMI_EXP_RETURN_IF(!GetFileSizeEx(file, &size), RuntimeError{"Failed to get file size!"});
+    result._size = static_cast<size_t>(size.QuadPart);
+    OKAMI_EXP_RETURN_IF(result._size == 0, RuntimeError{"Cannot map an empty file!"});
+
+    result._mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    OKAMI_EXP_RETURN_IF(!result._mapping, RuntimeError{"Failed to create file mapping!"});
+
+    result._data = MapViewOfFile(result._mapping, FILE_MAP_READ, 0, 0, 0);
+    OKAMI_EXP_RETURN_IF(!result._data, RuntimeError{"Failed to map file!"});
+#else
+    result._file = open(path.c_str(), O_RDONLY);
+    OKAMI_EXP_RETURN_IF(result._file < 0, InvalidPathError{path.string()});
+
+    struct stat info;
+    OKAMI_EXP_RETURN_IF(fstat(result._file, &info) != 0, RuntimeError{"Failed to get file size!"});
+    result._size = static_cast<size_t>(info.st_size);
+    OKAMI_EXP_RETURN_IF(result._size == 0, RuntimeError{"Cannot map an empty file!"});
+
+    auto data = mmap(nullptr, result._size, PROT_READ, MAP_PRIVATE, result._file, 0);
+    OKAMI_EXP_RETURN_IF(data == MAP_FAILED, RuntimeError{"Failed to map file!"});
+    result._data = data;
+#endif
+
+    return result;
+}
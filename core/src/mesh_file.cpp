@@ -0,0 +1,316 @@
+#include <okami/mesh_file.hpp>
+
+#include <plog/Log.h>
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace {
+    template <typename T>
+    struct IsVector : std::false_type {};
+    template <typename T>
+    struct IsVector<std::vector<T>> : std::true_type {};
+
+    template <typename T, typename Archive>
+    concept Serializable = requires(T& value, Archive& archive) {
+        value.serialize(archive);
+    };
+
+    // Archives for the serialize methods of the geometry and layout types
+    class BinaryWriter {
+    private:
+        std::vector<uint8_t>& _bytes;
+
+    public:
+        inline BinaryWriter(std::vector<uint8_t>& bytes) : _bytes(bytes) {}
+
+        template <typename T>
+        void operator()(T const& value) {
+            if constexpr (IsVector<T>::value) {
+                (*this)(static_cast<uint64_t>(value.size()));
+                for (auto const& element : value) {
+                    (*this)(element);
+                }
+            } else if constexpr (Serializable<T, BinaryWriter>) {
+                const_cast<T&>(value).serialize(*this);
+            } else {
+                static_assert(std::is_trivially_copyable_v<T>);
+                auto bytes = reinterpret_cast<uint8_t const*>(&value);
+                _bytes.insert(_bytes.end(), bytes, bytes + sizeof(T));
+            }
+        }
+    };
+
+    class BinaryReader {
+    private:
+        std::span<uint8_t const> _bytes;
+        size_t _position = 0;
+        bool _failed = false;
+
+    public:
+        inline BinaryReader(std::span<uint8_t const> bytes) : _bytes(bytes) {}
+
+        inline bool Failed() const { return _failed; }
+
+        template <typename T>
+        void operator()(T& value) {
+            if constexpr (IsVector<T>::value) {
+                uint64_t size = 0;
+                (*this)(size);
+                // Guard against corrupt sizes before allocating anything
+                if (_failed || size > _bytes.size() - _position) {
+                    _failed = true;
+                    return;
+                }
+                value.resize(size);
+                for (auto& element : value) {
+                    (*this)(element);
+                }
+            } else if constexpr (Serializable<T, BinaryReader>) {
+                value.serialize(*this);
+            } else {
+                static_assert(std::is_trivially_copyable_v<T>);
+                if (_failed || sizeof(T) > _bytes.size() - _position) {
+                    _failed = true;
+                    return;
+                }
+                std::memcpy(&value, &_bytes[_position], sizeof(T));
+                _position += sizeof(T);
+            }
+        }
+    };
+
+    size_t AlignUp(size_t offset) {
+        return (offset + kMeshFileAlignment - 1) / kMeshFileAlignment * kMeshFileAlignment;
+    }
+
+    bool InFile(MeshFileBufferEntry const& entry, size_t fileSize) {
+        return entry.offset <= fileSize && entry.size <= fileSize - entry.offset;
+    }
+
+    std::span<uint8_t const> View(std::span<uint8_t const> file, MeshFileBufferEntry const& entry) {
+        return file.subspan(entry.offset, entry.size);
+    }
+
+    BufferData Copy(std::span<uint8_t const> bytes) {
+        return BufferData{std::vector<uint8_t>(bytes.begin(), bytes.end())};
+    }
+}
+
+uint64_t okami::geometry::HashBytes(std::span<uint8_t const> bytes, uint64_t seed) {
+    uint64_t hash = seed;
+    for (auto byte : bytes) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+Geometry okami::geometry::MeshFile::ToGeometry() const {
+    std::vector<BufferData> vertexBuffers;
+    vertexBuffers.reserve(_vertexBuffers.size());
+    for (auto buffer : _vertexBuffers) {
+        vertexBuffers.emplace_back(Copy(buffer));
+    }
+    return Geometry(_desc, std::move(vertexBuffers), Copy(_indexBuffer), _bounds);
+}
+
+Expected<MeshFile> okami::geometry::MeshFile::Open(std::filesystem::path const& path) {
+    Error err;
+    auto file = OKAMI_EXP_UNWRAP(MappedFile::Open(path), err);
+
+    auto result = OKAMI_EXP_UNWRAP(Parse(file.GetBytes()), err);
+    result._file = std::move(file);
+    return result;
+}
+
+Expected<MeshFile> okami::geometry::MeshFile::Parse(std::span<uint8_t const> bytes) {
+    MeshFile result;
+
+    OKAMI_EXP_RETURN_IF(bytes.size() < sizeof(MeshFileHeader),
+        RuntimeError{"File is too small to be an okmesh!"});
+
+    MeshFileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    OKAMI_EXP_RETURN_IF(std::memcmp(header.magic, kMeshFileMagic, sizeof(kMeshFileMagic)) != 0,
+        RuntimeError{"File is not an okmesh!"});
+    OKAMI_EXP_RETURN_IF(header.version != kMeshFileVersion,
+        RuntimeError{"Unsupported okmesh version!"});
+
+    size_t entriesSize = header.vertexBufferCount * sizeof(MeshFileBufferEntry);
+    OKAMI_EXP_RETURN_IF(entriesSize > bytes.size() - sizeof(MeshFileHeader),
+        RuntimeError{"Corrupt okmesh buffer table!"});
+
+    std::vector<MeshFileBufferEntry> entries(header.vertexBufferCount);
+    std::memcpy(entries.data(), &bytes[sizeof(MeshFileHeader)], entriesSize);
+
+    OKAMI_EXP_RETURN_IF(!InFile(header.desc, bytes.size()) ||
+        !InFile(header.indexBuffer, bytes.size()),
+        RuntimeError{"Corrupt okmesh header!"});
+
+    BinaryReader reader(View(bytes, header.desc));
+    reader(result._desc);
+    OKAMI_EXP_RETURN_IF(reader.Failed(), RuntimeError{"Corrupt okmesh description!"});
+
+    // The buffers must hold everything the description says they do
+    auto const& desc = result._desc;
+    for (auto const& element : desc.layout.elements) {
+        OKAMI_EXP_RETURN_IF(element.bufferSlot >= header.vertexBufferCount,
+            RuntimeError{"Corrupt okmesh description!"});
+    }
+
+    std::vector<size_t> offsets;
+    std::vector<size_t> strides;
+    std::vector<size_t> channelSizes;
+    ComputeLayoutProperties(desc.attribs.numVertices, desc.layout,
+        offsets, strides, channelSizes);
+    OKAMI_EXP_RETURN_IF(channelSizes.size() != header.vertexBufferCount,
+        RuntimeError{"Corrupt okmesh!"});
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto const& entry = entries[i];
+        OKAMI_EXP_RETURN_IF(!InFile(entry, bytes.size()),
+            RuntimeError{"Corrupt okmesh buffer table!"});
+        OKAMI_EXP_RETURN_IF(entry.size < channelSizes[i],
+            RuntimeError{"Corrupt okmesh!"});
+        result._vertexBuffers.emplace_back(View(bytes, entry));
+    }
+
+    if (desc.isIndexed) {
+        auto indexType = desc.indexedAttribs.indexType;
+        OKAMI_EXP_RETURN_IF(indexType != ValueType::UINT16 && indexType != ValueType::UINT32,
+            RuntimeError{"Corrupt okmesh!"});
+        OKAMI_EXP_RETURN_IF(header.indexBuffer.size <
+            uint64_t(desc.indexedAttribs.numIndices) * GetSize(indexType),
+            RuntimeError{"Corrupt okmesh!"});
+    }
+    result._indexBuffer = View(bytes, header.indexBuffer);
+    result._bounds = header.bounds;
+    result._contentHash = header.contentHash;
+
+    return result;
+}
+
+Error okami::geometry::MeshFile::Write(std::filesystem::path const& path,
+    Geometry const& geometry,
+    uint64_t contentHash) {
+
+    auto const& vertexBuffers = geometry.GetVertexBuffers();
+
+    std::vector<uint8_t> descBytes;
+    BinaryWriter writer(descBytes);
+    writer(geometry.GetDesc());
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, kMeshFileMagic, sizeof(kMeshFileMagic));
+    header.version = kMeshFileVersion;
+    header.vertexBufferCount = static_cast<uint32_t>(vertexBuffers.size());
+    header.contentHash = contentHash;
+    header.bounds = geometry.GetBounds();
+
+    // Lay out the file, with every buffer aligned for direct use
+    size_t offset = sizeof(MeshFileHeader) + vertexBuffers.size() * sizeof(MeshFileBufferEntry);
+    header.desc = MeshFileBufferEntry{offset, descBytes.size()};
+    offset += descBytes.size();
+
+    std::vector<MeshFileBufferEntry> entries;
+    for (auto const& buffer : vertexBuffers) {
+        offset = AlignUp(offset);
+        entries.emplace_back(MeshFileBufferEntry{offset, buffer.size()});
+        offset += buffer.size();
+    }
+    offset = AlignUp(offset);
+    header.indexBuffer = MeshFileBufferEntry{offset, geometry.GetIndexBuffer().size()};
+    offset += geometry.GetIndexBuffer().size();
+
+    std::vector<uint8_t> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    if (!entries.empty()) {
+        std::memcpy(&file[sizeof(header)], entries.data(),
+            entries.size() * sizeof(MeshFileBufferEntry));
+    }
+    std::copy(descBytes.begin(), descBytes.end(), file.begin() + header.desc.offset);
+    for (size_t i = 0; i < vertexBuffers.size(); ++i) {
+        std::copy(vertexBuffers[i].bytes.begin(), vertexBuffers[i].bytes.end(),
+            file.begin() + entries[i].offset);
+    }
+    auto const& indexBytes = geometry.GetIndexBuffer().bytes;
+    std::copy(indexBytes.begin(), indexBytes.end(), file.begin() + header.indexBuffer.offset);
+
+    // Write to a temporary first, so that readers never see a partial file
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        OKAMI_ERR_RETURN_IF(!stream, InvalidPathError{tempPath.string()});
+        stream.write(reinterpret_cast<char const*>(file.data()), file.size());
+        OKAMI_ERR_RETURN_IF(!stream, RuntimeError{"Failed to write okmesh!"});
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    OKAMI_ERR_RETURN_IF(ec, RuntimeError{"Failed to move okmesh into place!"});
+
+    return {};
+}
+
+Expected<std::filesystem::path> okami::geometry::CookMesh(
+    std::filesystem::path const& source,
+    std::filesystem::path const& cacheDirectory,
+    VertexFormatInfo const& layout) {
+
+    std::vector<uint8_t> sourceBytes;
+    {
+        std::ifstream stream(source, std::ios::binary);
+        OKAMI_EXP_RETURN_IF(!stream, InvalidPathError{source.string()});
+        sourceBytes.assign(std::istreambuf_iterator<char>(stream),
+            std::istreambuf_iterator<char>());
+    }
+
+    // The cooked result depends on the source, the layout and the format
+    std::vector<uint8_t> keyBytes;
+    BinaryWriter writer(keyBytes);
+    writer(kMeshFileVersion);
+    writer(layout);
+
+    uint64_t hash = HashBytes(keyBytes, HashBytes(sourceBytes));
+
+    std::stringstream name;
+    name << source.stem().string() << "."
+        << std::hex << std::setw(16) << std::setfill('0') << hash
+        << kMeshFileExtension;
+    auto cooked = cacheDirectory / name.str();
+
+    if (std::filesystem::exists(cooked)) {
+        auto existing = MeshFile::Open(cooked);
+        if (existing && existing->GetContentHash() == hash) {
+            return cooked;
+        }
+        PLOG_WARNING << "Recooking stale or corrupt mesh " << cooked;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    OKAMI_EXP_RETURN_IF(ec, InvalidPathError{cacheDirectory.string()});
+
+    PLOG_INFO << "Cooking mesh " << source << " to " << cooked;
+
+    Geometry geometry;
+    try {
+        geometry = Geometry::Load(source, layout);
+    } catch (std::exception const& e) {
+        PLOG_ERROR << e.what();
+        return MakeUnexpected(OKAMI_ERR_MAKE(RuntimeError{"Failed to import mesh!"}));
+    }
+
+    auto err = MeshFile::Write(cooked, geometry, hash);
+    OKAMI_EXP_RETURN(err);
+
+    return cooked;
+}
@@ -0,0 +1,410 @@
+#include <okami/mesh_optimize.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace {
+    constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+
+    // Scoring constants from Forsyth's article
+    constexpr float kCacheDecayPower = 1.5f;
+    constexpr float kLastTriScore = 0.75f;
+    constexpr float kValenceBoostScale = 2.0f;
+    constexpr float kValenceBoostPower = 0.5f;
+
+    float VertexScore(int cachePosition, uint32_t remainingTriangles, uint32_t cacheSize) {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // The vertices of the last triangle are deliberately scored
+                // lower, as they are likely to be reused anyway
+                score = kLastTriScore;
+            } else {
+                float scaler = 1.0f / static_cast<float>(cacheSize - 3);
+                score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler,
+                    kCacheDecayPower);
+            }
+        }
+
+        // Favour vertices with few triangles left, so they are finished off
+        // rather than left behind as isolated triangles
+        score += kValenceBoostScale *
+            std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+        return score;
+    }
+
+    // FIFO cache simulation shared by the ACMR and overdraw code
+    class CacheSimulator {
+    private:
+        std::vector<uint32_t> _timestamps;
+        uint32_t _cacheSize;
+        uint32_t _time;
+
+    public:
+        CacheSimulator(size_t vertexCount, uint32_t cacheSize) :
+            _timestamps(vertexCount, 0),
+            _cacheSize(cacheSize),
+            _time(cacheSize + 1) {
+        }
+
+        uint32_t Misses(uint32_t const* triangle) {
+            uint32_t misses = 0;
+            for (int i = 0; i < 3; ++i) {
+                auto v = triangle[i];
+                if (_time - _timestamps[v] > _cacheSize) {
+                    _timestamps[v] = _time++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+        void Flush() {
+            _time += _cacheSize + 1;
+        }
+    };
+
+    float ClusterACMR(std::span<uint32_t const> indices,
+        size_t begin,
+        size_t end,
+        CacheSimulator& cache) {
+        cache.Flush();
+        uint32_t misses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            misses += cache.Misses(&indices[3 * t]);
+        }
+        return static_cast<float>(misses) / static_cast<float>(end - begin);
+    }
+}
+
+float okami::geometry::ComputeACMR(std::span<uint32_t const> indices,
+    size_t vertexCount,
+    uint32_t cacheSize) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) {
+        return 0.0f;
+    }
+
+    CacheSimulator cache(vertexCount, cacheSize);
+    return ClusterACMR(indices, 0, triCount, cache);
+}
+
+float okami::geometry::ComputeACMR(Geometry const& geometry, uint32_t cacheSize) {
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed) {
+        throw std::runtime_error("ACMR requires an index buffer!");
+    }
+
+    auto indices = UnpackIndices(geometry);
+    return ComputeACMR(indices, desc.attribs.numVertices, cacheSize);
+}
+
+void okami::geometry::OptimizeVertexCache(std::span<uint32_t> indices,
+    size_t vertexCount,
+    uint32_t cacheSize) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) {
+        return;
+    }
+    cacheSize = std::max(cacheSize, 4u);
+
+    // Triangles of every vertex, as ranges into one shared array. The first
+    // remaining[v] entries of each range are the unemitted triangles.
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (auto v : indices) {
+        ++remaining[v];
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = VertexScore(-1, remaining[v], cacheSize);
+    }
+
+    std::vector<float> triangleScores(triCount);
+    auto scoreTriangle = [&](uint32_t t) {
+        triangleScores[t] = vertexScores[indices[3 * t]] +
+            vertexScores[indices[3 * t + 1]] +
+            vertexScores[indices[3 * t + 2]];
+    };
+    for (uint32_t t = 0; t < triCount; ++t) {
+        scoreTriangle(t);
+    }
+
+    std::vector<bool> emitted(triCount, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(cacheSize + 3);
+    nextCache.reserve(cacheSize + 3);
+
+    uint32_t best = static_cast<uint32_t>(std::distance(triangleScores.begin(),
+        std::max_element(triangleScores.begin(), triangleScores.end())));
+    size_t cursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triCount; ++emittedCount) {
+        // Nothing adjacent to the cache is left, continue with the next
+        // unemitted triangle in input order, which keeps this linear
+        if (best == kUnused) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<uint32_t>(cursor);
+        }
+
+        auto tri = &indices[3 * best];
+        output.insert(output.end(), tri, tri + 3);
+        emitted[best] = true;
+
+        for (int i = 0; i < 3; ++i) {
+            auto v = tri[i];
+            auto begin = adjacency.begin() + offsets[v];
+            auto end = begin + remaining[v];
+            auto it = std::find(begin, end, best);
+            std::iter_swap(it, end - 1);
+            --remaining[v];
+        }
+
+        // The triangle's vertices move to the front of the LRU cache
+        nextCache.assign(tri, tri + 3);
+        for (auto v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                nextCache.emplace_back(v);
+            }
+        }
+
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            auto v = nextCache[i];
+            cachePosition[v] = i < cacheSize ? static_cast<int>(i) : -1;
+            vertexScores[v] = VertexScore(cachePosition[v], remaining[v], cacheSize);
+        }
+        for (auto v : nextCache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                scoreTriangle(adjacency[offsets[v] + i]);
+            }
+        }
+
+        if (nextCache.size() > cacheSize) {
+            nextCache.resize(cacheSize);
+        }
+        std::swap(cache, nextCache);
+
+        // Only triangles touching the cache can have gained score
+        best = kUnused;
+        float bestScore = -std::numeric_limits<float>::infinity();
+        for (auto v : cache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                auto t = adjacency[offsets[v] + i];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void okami::geometry::OptimizeOverdraw(std::span<uint32_t> indices,
+    std::span<glm::vec3 const> positions,
+    float threshold,
+    uint32_t cacheSize) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) {
+        return;
+    }
+
+    CacheSimulator cache(positions.size(), cacheSize);
+
+    // Hard boundaries are where the cache optimiser had to start over,
+    // i.e., triangles that miss on all of their vertices
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < triCount; ++t) {
+        if (cache.Misses(&indices[3 * t]) == 3 || t == 0) {
+            hardClusters.emplace_back(t);
+        }
+    }
+    hardClusters.emplace_back(triCount);
+
+    // Split those further wherever a prefix of the cluster is already
+    // within threshold of the cluster's ACMR
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+        size_t begin = hardClusters[c];
+        size_t end = hardClusters[c + 1];
+        float target = ClusterACMR(indices, begin, end, cache) * threshold;
+
+        cache.Flush();
+        size_t start = begin;
+        uint32_t misses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            misses += cache.Misses(&indices[3 * t]);
+            if (t + 1 < end &&
+                static_cast<float>(misses) <= target * static_cast<float>(t + 1 - start)) {
+                clusters.emplace_back(start);
+                start = t + 1;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+        clusters.emplace_back(start);
+    }
+    clusters.emplace_back(triCount);
+
+    size_t clusterCount = clusters.size() - 1;
+
+    // Area weighted centroid and normal of every cluster
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; ++c) {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            auto const& p0 = positions[indices[3 * t]];
+            auto const& p1 = positions[indices[3 * t + 1]];
+            auto const& p2 = positions[indices[3 * t + 2]];
+            auto n = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(n);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += n;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the center occlude the rest, draw them first
+    std::vector<float> keys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float normalLength = glm::length(normals[c]);
+        if (areas[c] > 0.0f && normalLength > 0.0f) {
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+        }
+    }
+
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (auto c : order) {
+        output.insert(output.end(),
+            indices.begin() + 3 * clusters[c],
+            indices.begin() + 3 * clusters[c + 1]);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+std::vector<uint32_t> okami::geometry::OptimizeVertexFetch(std::span<uint32_t> indices,
+    size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, kUnused);
+    uint32_t next = 0;
+    for (auto& index : indices) {
+        if (remap[index] == kUnused) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    for (auto& target : remap) {
+        if (target == kUnused) {
+            target = next++;
+        }
+    }
+    return remap;
+}
+
+Geometry okami::geometry::Optimize(Geometry const& geometry, OptimizeParams const& params) {
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed || desc.topology != Topology::TRIANGLE_LIST) {
+        throw std::runtime_error("Optimization requires an indexed triangle list!");
+    }
+
+    size_t vertexCount = desc.attribs.numVertices;
+    auto indices = UnpackIndices(geometry);
+    float inputACMR = ComputeACMR(indices, vertexCount);
+
+    if (params.vertexCache) {
+        auto input = indices;
+        OptimizeVertexCache(indices, vertexCount);
+        // Inputs that were already optimised for another cache size can
+        // come out slightly worse
+        if (ComputeACMR(indices, vertexCount) > inputACMR) {
+            indices = std::move(input);
+        }
+    }
+    if (params.overdraw && desc.layout.position >= 0) {
+        // Clusters start with a cold cache once reordered, so the total can
+        // end up past the threshold. Keep the cache order if it does, or if
+        // the result would be worse than the input.
+        float cacheACMR = ComputeACMR(indices, vertexCount);
+        auto positions = UnpackPositions(geometry);
+        auto reordered = indices;
+        OptimizeOverdraw(reordered, positions, params.overdrawThreshold);
+
+        float acmr = ComputeACMR(reordered, vertexCount);
+        if (acmr <= cacheACMR * params.overdrawThreshold && acmr <= inputACMR) {
+            indices = std::move(reordered);
+        }
+    }
+
+    auto vertexBuffers = geometry.GetVertexBuffers();
+    if (params.vertexFetch) {
+        auto remap = OptimizeVertexFetch(indices, vertexCount);
+
+        std::vector<size_t> offsets;
+        std::vector<size_t> strides;
+        std::vector<size_t> channelSizes;
+        ComputeLayoutProperties(vertexCount, desc.layout, offsets, strides, channelSizes);
+
+        auto const& source = geometry.GetVertexBuffers();
+        for (size_t i = 0; i < desc.layout.elements.size(); ++i) {
+            auto const& element = desc.layout.elements[i];
+            if (element.frequency != InputElementFrequency::PER_VERTEX) {
+                continue;
+            }
+            size_t size = GetSize(element.valueType) * element.numComponents;
+            auto src = &source[element.bufferSlot].bytes[offsets[i]];
+            auto dest = &vertexBuffers[element.bufferSlot].bytes[offsets[i]];
+            for (size_t v = 0; v < vertexCount; ++v) {
+                std::memcpy(dest + remap[v] * strides[i], src + v * strides[i], size);
+            }
+        }
+    }
+
+    auto indexBuffer = PackIndices(indices, desc.indexedAttribs.indexType);
+
+    return Geometry(desc, std::move(vertexBuffers), std::move(indexBuffer), geometry.GetBounds());
+}
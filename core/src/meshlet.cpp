@@ -0,0 +1,368 @@
+#include <okami/meshlet.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace {
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    // Cones narrower than this are not worth testing
+    constexpr float kMinConeDot = 0.1f;
+
+    struct PositionHash {
+        size_t operator()(glm::vec3 const& p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    // Vertices split along UV or normal seams share a position, and the
+    // clusters should grow across those seams
+    std::vector<uint32_t> WeldPositions(std::span<glm::vec3 const> positions) {
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> first;
+        first.reserve(positions.size());
+        std::vector<uint32_t> welded(positions.size());
+        for (size_t v = 0; v < positions.size(); ++v) {
+            welded[v] = first.emplace(positions[v], static_cast<uint32_t>(v)).first->second;
+        }
+        return welded;
+    }
+
+    struct TriangleAdjacency {
+        // Triangles around welded vertex v are triangles[offsets[v]..offsets[v + 1])
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        TriangleAdjacency(std::span<uint32_t const> indices, std::span<uint32_t const> welded) :
+            offsets(welded.size() + 1, 0),
+            triangles(indices.size()) {
+            for (auto index : indices) {
+                ++offsets[welded[index] + 1];
+            }
+            for (size_t v = 0; v < welded.size(); ++v) {
+                offsets[v + 1] += offsets[v];
+            }
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[fill[welded[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+    };
+
+    // Ritter's bounding sphere, within a few percent of the optimum
+    void ComputeSphere(Meshlet& meshlet,
+        std::span<uint32_t const> vertices,
+        std::span<glm::vec3 const> positions) {
+        uint32_t lower[3] = { vertices[0], vertices[0], vertices[0] };
+        uint32_t upper[3] = { vertices[0], vertices[0], vertices[0] };
+        for (auto v : vertices) {
+            for (int c = 0; c < 3; ++c) {
+                if (positions[v][c] < positions[lower[c]][c]) {
+                    lower[c] = v;
+                }
+                if (positions[v][c] > positions[upper[c]][c]) {
+                    upper[c] = v;
+                }
+            }
+        }
+
+        int axis = 0;
+        float widest = -1.0f;
+        for (int c = 0; c < 3; ++c) {
+            auto d = positions[upper[c]] - positions[lower[c]];
+            float distance = glm::dot(d, d);
+            if (distance > widest) {
+                widest = distance;
+                axis = c;
+            }
+        }
+
+        glm::vec3 center = (positions[lower[axis]] + positions[upper[axis]]) * 0.5f;
+        float radius = std::sqrt(widest) * 0.5f;
+
+        for (auto v : vertices) {
+            auto d = positions[v] - center;
+            float distance = std::sqrt(glm::dot(d, d));
+            if (distance > radius) {
+                float grow = (distance - radius) * 0.5f;
+                center += d * (grow / distance);
+                radius += grow;
+            }
+        }
+
+        meshlet.center = center;
+        meshlet.radius = radius;
+    }
+
+    void ComputeCone(Meshlet& meshlet,
+        std::span<uint32_t const> indices,
+        std::span<glm::vec3 const> positions) {
+        std::vector<glm::vec3> normals;
+        normals.reserve(indices.size() / 3);
+        glm::vec3 sum(0.0f);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            auto a = positions[indices[i]];
+            auto n = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+            float length = std::sqrt(glm::dot(n, n));
+            if (length > 0.0f) {
+                normals.emplace_back(n / length);
+                sum += normals.back();
+            }
+        }
+
+        float sumLength = std::sqrt(glm::dot(sum, sum));
+        if (normals.empty() || sumLength <= 0.0f) {
+            return;
+        }
+
+        auto axis = sum / sumLength;
+        float minDot = 1.0f;
+        for (auto const& n : normals) {
+            minDot = std::min(minDot, glm::dot(axis, n));
+        }
+
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = minDot <= kMinConeDot ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+
+    // A meshlet under construction
+    struct Cluster {
+        std::vector<uint32_t> triangles;
+        std::vector<uint32_t> vertices;
+    };
+}
+
+std::vector<Meshlet> okami::geometry::BuildMeshlets(std::span<uint32_t> indices,
+    std::span<glm::vec3 const> positions,
+    MeshletParams const& params) {
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error("Meshlets require a triangle list!");
+    }
+    if (params.maxVertices < 3 || params.maxTriangles < 1) {
+        throw std::runtime_error("Meshlet limits are too small!");
+    }
+    for (auto index : indices) {
+        if (index >= positions.size()) {
+            throw std::runtime_error("Index out of range!");
+        }
+    }
+
+    size_t vertexCount = positions.size();
+    size_t triangleCount = indices.size() / 3;
+    auto welded = WeldPositions(positions);
+    TriangleAdjacency adjacency(indices, welded);
+
+    // Cluster of every triangle, kNone until emitted
+    std::vector<uint32_t> owner(triangleCount, kNone);
+    // Cluster that each vertex was last added to
+    std::vector<uint32_t> vertexCluster(vertexCount, kNone);
+    std::vector<Cluster> clusters;
+
+    std::vector<uint32_t> candidates;
+    size_t seed = 0;
+    glm::vec3 positionSum(0.0f);
+    glm::vec3 centroid(0.0f);
+
+    auto distance = [&](uint32_t triangle) {
+        auto d = positions[indices[3 * triangle]] +
+            positions[indices[3 * triangle + 1]] +
+            positions[indices[3 * triangle + 2]] - 3.0f * centroid;
+        return glm::dot(d, d);
+    };
+
+    while (true) {
+        // Continue next to the previous cluster, so that fewer pockets of
+        // triangles are left behind, and only jump when it is enclosed
+        uint32_t start = kNone;
+        float startDistance = std::numeric_limits<float>::infinity();
+        for (auto triangle : candidates) {
+            if (owner[triangle] == kNone) {
+                float d = distance(triangle);
+                if (d < startDistance) {
+                    start = triangle;
+                    startDistance = d;
+                }
+            }
+        }
+        if (start == kNone) {
+            while (seed < triangleCount && owner[seed] != kNone) {
+                ++seed;
+            }
+            if (seed == triangleCount) {
+                break;
+            }
+            start = static_cast<uint32_t>(seed);
+        }
+
+        auto id = static_cast<uint32_t>(clusters.size());
+        auto& cluster = clusters.emplace_back();
+        candidates.clear();
+        positionSum = glm::vec3(0.0f);
+
+        auto newVertices = [&](uint32_t triangle) {
+            uint32_t count = 0;
+            for (int k = 0; k < 3; ++k) {
+                count += vertexCluster[indices[3 * triangle + k]] != id;
+            }
+            return count;
+        };
+
+        auto add = [&](uint32_t triangle) {
+            owner[triangle] = id;
+            cluster.triangles.emplace_back(triangle);
+            for (int k = 0; k < 3; ++k) {
+                auto v = indices[3 * triangle + k];
+                if (vertexCluster[v] != id) {
+                    vertexCluster[v] = id;
+                    cluster.vertices.emplace_back(v);
+                    positionSum += positions[v];
+                    auto w = welded[v];
+                    for (auto i = adjacency.offsets[w]; i < adjacency.offsets[w + 1]; ++i) {
+                        if (owner[adjacency.triangles[i]] == kNone) {
+                            candidates.emplace_back(adjacency.triangles[i]);
+                        }
+                    }
+                }
+            }
+        };
+
+        add(start);
+
+        while (cluster.triangles.size() < params.maxTriangles) {
+            centroid = positionSum / static_cast<float>(cluster.vertices.size());
+            uint32_t best = kNone;
+            uint32_t bestNew = 4;
+            float bestDistance = std::numeric_limits<float>::infinity();
+
+            for (size_t i = 0; i < candidates.size();) {
+                auto triangle = candidates[i];
+                if (owner[triangle] != kNone) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                // Triangles that close gaps come first, then the ones
+                // nearest the middle, which keeps the cluster round
+                auto count = newVertices(triangle);
+                if (count <= bestNew && cluster.vertices.size() + count <= params.maxVertices) {
+                    float d = distance(triangle);
+                    if (count < bestNew || d < bestDistance) {
+                        best = triangle;
+                        bestNew = count;
+                        bestDistance = d;
+                    }
+                }
+                ++i;
+            }
+
+            // Disconnected triangles would only loosen the bounds
+            if (best == kNone) {
+                break;
+            }
+            add(best);
+        }
+    }
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    std::vector<Meshlet> meshlets;
+
+    for (auto const& cluster : clusters) {
+        Meshlet meshlet;
+        meshlet.indexOffset = static_cast<uint32_t>(reordered.size());
+        meshlet.indexCount = static_cast<uint32_t>(3 * cluster.triangles.size());
+        meshlet.vertexCount = static_cast<uint32_t>(cluster.vertices.size());
+        for (auto triangle : cluster.triangles) {
+            for (int k = 0; k < 3; ++k) {
+                reordered.emplace_back(indices[3 * triangle + k]);
+            }
+        }
+
+        ComputeSphere(meshlet, cluster.vertices, positions);
+        ComputeCone(meshlet,
+            std::span<uint32_t const>(reordered).subspan(meshlet.indexOffset, meshlet.indexCount),
+            positions);
+        meshlets.emplace_back(meshlet);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+    return meshlets;
+}
+
+Geometry okami::geometry::BuildMeshlets(Geometry const& geometry, MeshletParams const& params) {
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed || desc.topology != Topology::TRIANGLE_LIST) {
+        throw std::runtime_error("Meshlets require an indexed triangle list!");
+    }
+
+    auto indices = UnpackIndices(geometry);
+
+    auto positions = UnpackPositions(geometry);
+    auto meshlets = BuildMeshlets(indices, positions, params);
+
+    auto indexBuffer = PackIndices(indices, desc.indexedAttribs.indexType);
+
+    return Geometry(desc, geometry.GetVertexBuffers(), std::move(indexBuffer),
+        geometry.GetBounds(), std::move(meshlets));
+}
+
+MeshletCullView okami::geometry::MeshletCullView::From(glm::mat4 const& worldView,
+    glm::mat4 const& proj,
+    bool coneCulling) {
+    MeshletCullView view;
+
+    // Gribb and Hartmann, for clip space z in [-w, w]
+    auto m = proj * worldView;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    view.planes = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+    for (auto& plane : view.planes) {
+        plane /= std::sqrt(glm::dot(glm::vec3(plane), glm::vec3(plane)));
+    }
+
+    auto viewToModel = glm::inverse(worldView);
+    view.eye = glm::vec3(viewToModel[3]);
+    view.viewDirection = glm::normalize(glm::vec3(viewToModel[2]));
+    view.perspective = proj[3][3] == 0.0f;
+    view.coneCulling = coneCulling;
+    return view;
+}
+
+bool okami::geometry::IsMeshletVisible(Meshlet const& meshlet, MeshletCullView const& view) {
+    for (auto const& plane : view.planes) {
+        if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+            return false;
+        }
+    }
+
+    if (view.coneCulling && meshlet.coneCutoff < 1.0f) {
+        if (view.perspective) {
+            auto d = meshlet.center - view.eye;
+            float distance = std::sqrt(glm::dot(d, d));
+            if (glm::dot(d, meshlet.coneAxis) >= meshlet.coneCutoff * distance + meshlet.radius) {
+                return false;
+            }
+        } else if (glm::dot(view.viewDirection, meshlet.coneAxis) >= meshlet.coneCutoff) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,640 @@
+#include <okami/mip_generator.hpp>
+#include <okami/simd.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    // sRGB bytes to linear values scaled to 16 bits
+    struct SRGBDecodeTable {
+        std::array<uint16_t, 256> values;
+
+        SRGBDecodeTable() {
+            for (uint32_t i = 0; i < values.size(); ++i) {
+                values[i] = static_cast<uint16_t>(
+                    std::lround(SRGBToLinear(static_cast<float>(i) / 255.0f) * 65535.0f));
+            }
+        }
+    };
+
+    // 16 bit linear values to the nearest sRGB byte, which replaces a pow
+    // per channel with a single lookup
+    struct SRGBEncodeTable {
+        std::array<uint8_t, 65536> values;
+
+        SRGBEncodeTable() {
+            for (uint32_t i = 0; i < values.size(); ++i) {
+                float srgb = LinearToSRGB(static_cast<float>(i) / 65535.0f);
+                values[i] = static_cast<uint8_t>(
+                    std::lround(std::clamp(srgb, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    };
+
+    SRGBEncodeTable const& GetSRGBEncodeTable() {
+        static const SRGBEncodeTable table;
+        return table;
+    }
+
+    inline uint16_t Average16(uint32_t a, uint32_t b) {
+        return static_cast<uint16_t>((a + b + 1) >> 1);
+    }
+
+    void FilterRowLinear(const uint8_t* row0,
+        const uint8_t* row1,
+        uint32_t fineWidth,
+        uint8_t* dest,
+        uint32_t coarseWidth) {
+
+        uint32_t col = 0;
+
+#if OKAMI_SIMD_SSE2
+        // Four coarse pixels from eight fine pixels of each row, as long as
+        // none of them needs its right neighbour clamped
+        uint32_t simdEnd = std::min(coarseWidth, fineWidth / 2) & ~3u;
+        __m128i zero = _mm_setzero_si128();
+        for (; col < simdEnd; col += 4) {
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + col * 8));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + col * 8 + 16));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + col * 8));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + col * 8 + 16));
+
+            // Vertical sums as 16 bit, two fine pixels per register
+            __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+            // Horizontal sums of even and odd fine pixels
+            __m128i c01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+            __m128i c23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+
+            c01 = _mm_srli_epi16(c01, 2);
+            c23 = _mm_srli_epi16(c23, 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + col * 4), _mm_packus_epi16(c01, c23));
+        }
+#endif
+
+        for (; col < coarseWidth; ++col) {
+            uint32_t col0 = col * 2;
+            uint32_t col1 = std::min(col * 2 + 1, fineWidth - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sum = row0[col0 * 4 + c] + row0[col1 * 4 + c] +
+                    row1[col0 * 4 + c] + row1[col1 * 4 + c];
+                dest[col * 4 + c] = static_cast<uint8_t>(sum / 4);
+            }
+        }
+    }
+
+    void DecodeRowSRGB(const uint8_t* src,
+        uint32_t width,
+        uint16_t* dest,
+        SRGBDecodeTable const& table) {
+        for (uint32_t i = 0; i < width * 4; i += 4) {
+            dest[i + 0] = table.values[src[i + 0]];
+            dest[i + 1] = table.values[src[i + 1]];
+            dest[i + 2] = table.values[src[i + 2]];
+            dest[i + 3] = static_cast<uint16_t>(src[i + 3] * 257);
+        }
+    }
+
+    // Averages the vertical pairs first and the horizontal pairs second,
+    // rounding both times, so that the vector and scalar paths agree
+    void FilterRowLinear16(const uint16_t* row0,
+        const uint16_t* row1,
+        uint32_t fineWidth,
+        uint16_t* dest,
+        uint32_t coarseWidth) {
+
+        uint32_t col = 0;
+
+#if OKAMI_SIMD_SSE2
+        uint32_t simdEnd = std::min(coarseWidth, fineWidth / 2) & ~1u;
+        for (; col < simdEnd; col += 2) {
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + col * 8));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + col * 8 + 8));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + col * 8));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + col * 8 + 8));
+
+            __m128i v01 = _mm_avg_epu16(a0, b0);
+            __m128i v23 = _mm_avg_epu16(a1, b1);
+
+            __m128i c = _mm_avg_epu16(_mm_unpacklo_epi64(v01, v23), _mm_unpackhi_epi64(v01, v23));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + col * 4), c);
+        }
+#endif
+
+        for (; col < coarseWidth; ++col) {
+            uint32_t col0 = col * 2;
+            uint32_t col1 = std::min(col * 2 + 1, fineWidth - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                dest[col * 4 + c] = Average16(
+                    Average16(row0[col0 * 4 + c], row1[col0 * 4 + c]),
+                    Average16(row0[col1 * 4 + c], row1[col1 * 4 + c]));
+            }
+        }
+    }
+
+    void EncodeRowSRGB(const uint16_t* src,
+        uint32_t width,
+        uint8_t* dest,
+        SRGBEncodeTable const& table) {
+        for (uint32_t i = 0; i < width * 4; i += 4) {
+            dest[i + 0] = table.values[src[i + 0]];
+            dest[i + 1] = table.values[src[i + 1]];
+            dest[i + 2] = table.values[src[i + 2]];
+            dest[i + 3] = static_cast<uint8_t>((src[i + 3] + 128) / 257);
+        }
+    }
+}
+
+void okami::ComputeCoarseMip2D_RGBA8(uint32_t NumChannels,
+    bool IsSRGB,
+    const void* pFineMip,
+    uint32_t FineMipStride,
+    uint32_t FineMipWidth,
+    uint32_t FineMipHeight,
+    void* pCoarseMip,
+    uint32_t CoarseMipStride,
+    uint32_t CoarseMipWidth,
+    uint32_t CoarseMipHeight,
+    uint32_t CoarseRowBegin,
+    uint32_t CoarseRowEnd) {
+
+    assert(NumChannels == 4);
+    assert(FineMipWidth > 0 && FineMipHeight > 0 && FineMipStride > 0);
+    assert(CoarseMipWidth > 0 && CoarseMipHeight > 0 && CoarseMipStride > 0);
+    assert(CoarseRowBegin <= CoarseRowEnd && CoarseRowEnd <= CoarseMipHeight);
+
+    auto fine = static_cast<const uint8_t*>(pFineMip);
+    auto coarse = static_cast<uint8_t*>(pCoarseMip);
+
+    if (!IsSRGB) {
+        for (uint32_t row = CoarseRowBegin; row < CoarseRowEnd; ++row) {
+            uint32_t row0 = row * 2;
+            uint32_t row1 = std::min(row * 2 + 1, FineMipHeight - 1);
+            FilterRowLinear(fine + row0 * FineMipStride,
+                fine + row1 * FineMipStride,
+                FineMipWidth,
+                coarse + row * CoarseMipStride,
+                CoarseMipWidth);
+        }
+        return;
+    }
+
+    static const SRGBDecodeTable decode;
+    auto const& encode = GetSRGBEncodeTable();
+
+    // Every fine pixel is decoded exactly once
+    std::vector<uint16_t> linear(FineMipWidth * 8 + CoarseMipWidth * 4);
+    uint16_t* linearRow0 = linear.data();
+    uint16_t* linearRow1 = linearRow0 + FineMipWidth * 4;
+    uint16_t* linearCoarse = linearRow1 + FineMipWidth * 4;
+
+    for (uint32_t row = CoarseRowBegin; row < CoarseRowEnd; ++row) {
+        uint32_t row0 = row * 2;
+        uint32_t row1 = std::min(row * 2 + 1, FineMipHeight - 1);
+
+        DecodeRowSRGB(fine + row0 * FineMipStride, FineMipWidth, linearRow0, decode);
+        DecodeRowSRGB(fine + row1 * FineMipStride, FineMipWidth, linearRow1, decode);
+        FilterRowLinear16(linearRow0, linearRow1, FineMipWidth, linearCoarse, CoarseMipWidth);
+        EncodeRowSRGB(linearCoarse, CoarseMipWidth, coarse + row * CoarseMipStride, encode);
+    }
+}
+
+namespace {
+    constexpr float kPi = 3.14159265358979f;
+
+    float Sinc(float x) {
+        if (std::abs(x) < 1e-5f) {
+            return 1.0f;
+        }
+        x *= kPi;
+        return std::sin(x) / x;
+    }
+
+    // Zeroth order modified Bessel function of the first kind
+    float BesselI0(float x) {
+        float sum = 1.0f;
+        float term = 1.0f;
+        float quarterX2 = x * x / 4.0f;
+        for (int k = 1; k < 32 && term > sum * 1e-8f; ++k) {
+            term *= quarterX2 / static_cast<float>(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Filters are evaluated in units of coarse pixels
+    struct FilterKernel {
+        float radius;
+        float (*eval)(float x);
+    };
+
+    FilterKernel GetKernel(MipFilter filter) {
+        switch (filter) {
+            case MipFilter::Kaiser:
+                return {3.0f, [](float x) {
+                    constexpr float kRadius = 3.0f;
+                    constexpr float kAlpha = 4.0f;
+                    float t = x / kRadius;
+                    if (std::abs(t) >= 1.0f) {
+                        return 0.0f;
+                    }
+                    return Sinc(x) * BesselI0(kAlpha * std::sqrt(1.0f - t * t)) / BesselI0(kAlpha);
+                }};
+            case MipFilter::Lanczos3:
+                return {3.0f, [](float x) {
+                    return std::abs(x) < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+                }};
+            case MipFilter::Mitchell:
+                // B = C = 1/3
+                return {2.0f, [](float x) {
+                    x = std::abs(x);
+                    if (x < 1.0f) {
+                        return (7.0f * x * x * x - 12.0f * x * x + 16.0f / 3.0f) / 6.0f;
+                    } else if (x < 2.0f) {
+                        return (-7.0f / 3.0f * x * x * x + 12.0f * x * x - 20.0f * x + 32.0f / 3.0f) / 6.0f;
+                    }
+                    return 0.0f;
+                }};
+            default:
+                return {0.5f, [](float x) {
+                    return std::abs(x) <= 0.5f ? 1.0f : 0.0f;
+                }};
+        }
+    }
+
+    // The weights of every coarse pixel along one axis. Every coarse pixel
+    // gets the same number of taps, padded with zero weights, and the fine
+    // pixel indices are clamped to the edge.
+    struct PolyphaseTaps {
+        uint32_t tapCount = 0;
+        std::vector<uint32_t> indices;
+        std::vector<float> weights;
+    };
+
+    PolyphaseTaps ComputeTaps(MipFilter filter, uint32_t fineSize, uint32_t coarseSize) {
+        auto kernel = GetKernel(filter);
+
+        // Odd sizes do not halve exactly, so the phase of the kernel differs
+        // from one coarse pixel to the next
+        float scale = static_cast<float>(fineSize) / static_cast<float>(coarseSize);
+        float support = kernel.radius * scale;
+
+        PolyphaseTaps taps;
+        taps.tapCount = static_cast<uint32_t>(std::ceil(2.0f * support)) + 1;
+        taps.indices.resize(coarseSize * taps.tapCount);
+        taps.weights.resize(coarseSize * taps.tapCount);
+
+        // Exact halving has a single phase, so the kernel is only evaluated
+        // for the first coarse pixel
+        bool singlePhase = fineSize == coarseSize * 2;
+
+        for (uint32_t i = 0; i < coarseSize; ++i) {
+            float center = (static_cast<float>(i) + 0.5f) * scale;
+            int first = static_cast<int>(std::floor(center - support));
+
+            float sum = 0.0f;
+            for (uint32_t t = 0; t < taps.tapCount; ++t) {
+                int j = first + static_cast<int>(t);
+                float weight = singlePhase && i > 0 ? taps.weights[t] :
+                    kernel.eval((static_cast<float>(j) + 0.5f - center) / scale);
+                taps.indices[i * taps.tapCount + t] = static_cast<uint32_t>(
+                    std::clamp(j, 0, static_cast<int>(fineSize) - 1));
+                taps.weights[i * taps.tapCount + t] = weight;
+                sum += weight;
+            }
+
+            if (singlePhase && i > 0) {
+                continue;
+            }
+            for (uint32_t t = 0; t < taps.tapCount; ++t) {
+                taps.weights[i * taps.tapCount + t] /= sum;
+            }
+        }
+
+        return taps;
+    }
+
+    // Bytes to floats, either as unorm or as sRGB decoded to linear
+    struct Unorm8DecodeTable {
+        std::array<float, 256> unorm;
+        std::array<float, 256> srgb;
+
+        Unorm8DecodeTable() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                unorm[i] = static_cast<float>(i) / 255.0f;
+                srgb[i] = SRGBToLinear(unorm[i]);
+            }
+        }
+    };
+
+    // Which channels are sRGB encoded, alpha never is
+    std::array<bool, 4> GetSRGBChannels(uint32_t channels, bool isSRGB) {
+        std::array<bool, 4> result;
+        for (uint32_t c = 0; c < 4; ++c) {
+            result[c] = isSRGB && !(channels == 4 && c == 3);
+        }
+        return result;
+    }
+
+    template <typename ChannelType>
+    void DecodeRow(const ChannelType* src,
+        uint32_t width,
+        uint32_t channels,
+        bool isSRGB,
+        bool alphaWeighted,
+        float* dest) {
+
+        auto srgbChannels = GetSRGBChannels(channels, isSRGB);
+
+        if constexpr (std::is_same_v<ChannelType, uint8_t>) {
+            static const Unorm8DecodeTable table;
+            std::array<const float*, 4> lookups;
+            for (uint32_t c = 0; c < 4; ++c) {
+                lookups[c] = srgbChannels[c] ? table.srgb.data() : table.unorm.data();
+            }
+            for (uint32_t i = 0; i < width * channels; i += channels) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    dest[i + c] = lookups[c][src[i + c]];
+                }
+            }
+        } else {
+            for (uint32_t i = 0; i < width * channels; i += channels) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    float value = static_cast<float>(src[i + c]);
+                    if constexpr (!std::is_floating_point_v<ChannelType>) {
+                        value /= static_cast<float>(std::numeric_limits<ChannelType>::max());
+                    }
+                    dest[i + c] = srgbChannels[c] ? SRGBToLinear(value) : value;
+                }
+            }
+        }
+
+        if (alphaWeighted && channels == 4) {
+            for (uint32_t i = 0; i < width * 4; i += 4) {
+                float alpha = dest[i + 3];
+                dest[i + 0] *= alpha;
+                dest[i + 1] *= alpha;
+                dest[i + 2] *= alpha;
+            }
+        }
+    }
+
+    template <typename ChannelType>
+    void EncodeRow(float* src,
+        uint32_t width,
+        uint32_t channels,
+        bool isSRGB,
+        bool alphaWeighted,
+        ChannelType* dest) {
+
+        if (alphaWeighted && channels == 4) {
+            for (uint32_t i = 0; i < width * 4; i += 4) {
+                // Where nothing is visible there is no colour to recover
+                float alpha = src[i + 3];
+                float invAlpha = alpha > 1.0f / 1024.0f ? 1.0f / alpha : 0.0f;
+                src[i + 0] *= invAlpha;
+                src[i + 1] *= invAlpha;
+                src[i + 2] *= invAlpha;
+            }
+        }
+
+        auto srgbChannels = GetSRGBChannels(channels, isSRGB);
+
+        for (uint32_t i = 0; i < width * channels; i += channels) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                float value = src[i + c];
+
+                if constexpr (std::is_floating_point_v<ChannelType>) {
+                    dest[i + c] = srgbChannels[c] ? LinearToSRGB(value) : value;
+                } else {
+                    constexpr float kMax = static_cast<float>(std::numeric_limits<ChannelType>::max());
+
+                    // The negative lobes of the filters can ring past [0, 1]
+                    value = std::clamp(value, 0.0f, 1.0f);
+                    if (!srgbChannels[c]) {
+                        dest[i + c] = static_cast<ChannelType>(value * kMax + 0.5f);
+                    } else if constexpr (std::is_same_v<ChannelType, uint8_t>) {
+                        dest[i + c] = GetSRGBEncodeTable().values[
+                            static_cast<uint32_t>(value * 65535.0f + 0.5f)];
+                    } else {
+                        dest[i + c] = static_cast<ChannelType>(LinearToSRGB(value) * kMax + 0.5f);
+                    }
+                }
+            }
+        }
+    }
+
+    void FilterHorizontal(const float* src,
+        uint32_t channels,
+        PolyphaseTaps const& taps,
+        uint32_t coarseWidth,
+        float* dest) {
+
+        auto indices = taps.indices.data();
+        auto weights = taps.weights.data();
+
+#if OKAMI_SIMD_SSE2
+        // One pixel per register
+        if (channels == 4) {
+            for (uint32_t i = 0; i < coarseWidth; ++i) {
+                __m128 acc = _mm_setzero_ps();
+                for (uint32_t t = 0; t < taps.tapCount; ++t, ++indices, ++weights) {
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(*weights),
+                        _mm_loadu_ps(src + *indices * 4)));
+                }
+                _mm_storeu_ps(dest + i * 4, acc);
+            }
+            return;
+        }
+#endif
+
+        for (uint32_t i = 0; i < coarseWidth; ++i) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                float acc = 0.0f;
+                for (uint32_t t = 0; t < taps.tapCount; ++t) {
+                    acc += weights[t] * src[indices[t] * channels + c];
+                }
+                dest[i * channels + c] = acc;
+            }
+            indices += taps.tapCount;
+            weights += taps.tapCount;
+        }
+    }
+
+    void FilterVertical(const float* const* rows,
+        const float* weights,
+        uint32_t tapCount,
+        uint32_t length,
+        float* dest) {
+
+        std::fill(dest, dest + length, 0.0f);
+
+        for (uint32_t t = 0; t < tapCount; ++t) {
+            auto row = rows[t];
+            float weight = weights[t];
+            uint32_t x = 0;
+
+#if OKAMI_SIMD_SSE2
+            __m128 weight4 = _mm_set1_ps(weight);
+            for (; x + 4 <= length; x += 4) {
+                _mm_storeu_ps(dest + x, _mm_add_ps(_mm_loadu_ps(dest + x),
+                    _mm_mul_ps(weight4, _mm_loadu_ps(row + x))));
+            }
+#endif
+
+            for (; x < length; ++x) {
+                dest[x] += weight * row[x];
+            }
+        }
+    }
+
+    template <typename ChannelType>
+    void FilterMip2D(MipFilter filter,
+        bool alphaWeighted,
+        uint32_t numChannels,
+        bool isSRGB,
+        const void* pFineMip,
+        uint32_t fineStride,
+        uint32_t fineWidth,
+        uint32_t fineHeight,
+        void* pCoarseMip,
+        uint32_t coarseStride,
+        uint32_t coarseWidth,
+        uint32_t coarseHeight,
+        uint32_t rowBegin,
+        uint32_t rowEnd) {
+
+        assert(fineWidth > 0 && fineHeight > 0 && fineStride > 0);
+        assert(coarseWidth > 0 && coarseHeight > 0 && coarseStride > 0);
+        assert(rowBegin <= rowEnd && rowEnd <= coarseHeight);
+
+        if (rowBegin == rowEnd) {
+            return;
+        }
+
+        auto horizontal = ComputeTaps(filter, fineWidth, coarseWidth);
+        auto vertical = ComputeTaps(filter, fineHeight, coarseHeight);
+
+        // Fine rows under the band, including the overlap of the kernel
+        uint32_t firstRow = fineHeight;
+        uint32_t lastRow = 0;
+        for (uint32_t i = rowBegin * vertical.tapCount; i < rowEnd * vertical.tapCount; ++i) {
+            firstRow = std::min(firstRow, vertical.indices[i]);
+            lastRow = std::max(lastRow, vertical.indices[i]);
+        }
+
+        // Every fine row is decoded and filtered horizontally exactly once
+        uint32_t rowLength = coarseWidth * numChannels;
+        std::vector<float> decoded(fineWidth * numChannels);
+        std::vector<float> filtered((lastRow - firstRow + 1) * rowLength);
+
+        auto fine = static_cast<const uint8_t*>(pFineMip);
+        for (uint32_t row = firstRow; row <= lastRow; ++row) {
+            DecodeRow(reinterpret_cast<const ChannelType*>(fine + row * fineStride),
+                fineWidth, numChannels, isSRGB, alphaWeighted, decoded.data());
+            FilterHorizontal(decoded.data(), numChannels, horizontal, coarseWidth,
+                &filtered[(row - firstRow) * rowLength]);
+        }
+
+        std::vector<float> result(rowLength);
+        std::vector<const float*> rows(vertical.tapCount);
+
+        auto coarse = static_cast<uint8_t*>(pCoarseMip);
+        for (uint32_t row = rowBegin; row < rowEnd; ++row) {
+            for (uint32_t t = 0; t < vertical.tapCount; ++t) {
+                auto index = vertical.indices[row * vertical.tapCount + t];
+                rows[t] = &filtered[(index - firstRow) * rowLength];
+            }
+            FilterVertical(rows.data(), &vertical.weights[row * vertical.tapCount],
+                vertical.tapCount, rowLength, result.data());
+            EncodeRow(result.data(), coarseWidth, numChannels, isSRGB, alphaWeighted,
+                reinterpret_cast<ChannelType*>(coarse + row * coarseStride));
+        }
+    }
+
+    template <typename ChannelType, MipFilter Filter, bool AlphaWeighted>
+    void ComputeFilteredMip2D(uint32_t NumChannels,
+        bool IsSRGB,
+        const void* pFineMip,
+        uint32_t FineMipStride,
+        uint32_t FineMipWidth,
+        uint32_t FineMipHeight,
+        void* pCoarseMip,
+        uint32_t CoarseMipStride,
+        uint32_t CoarseMipWidth,
+        uint32_t CoarseMipHeight,
+        uint32_t CoarseRowBegin,
+        uint32_t CoarseRowEnd) {
+        FilterMip2D<ChannelType>(Filter, AlphaWeighted, NumChannels, IsSRGB,
+            pFineMip, FineMipStride, FineMipWidth, FineMipHeight,
+            pCoarseMip, CoarseMipStride, CoarseMipWidth, CoarseMipHeight,
+            CoarseRowBegin, CoarseRowEnd);
+    }
+
+    template <typename ChannelType, bool AlphaWeighted>
+    mip_generator_2d_t GetFilteredMipGenerator(MipFilter filter) {
+        switch (filter) {
+            case MipFilter::Box:
+                return &ComputeFilteredMip2D<ChannelType, MipFilter::Box, AlphaWeighted>;
+            case MipFilter::Kaiser:
+                return &ComputeFilteredMip2D<ChannelType, MipFilter::Kaiser, AlphaWeighted>;
+            case MipFilter::Lanczos3:
+                return &ComputeFilteredMip2D<ChannelType, MipFilter::Lanczos3, AlphaWeighted>;
+            case MipFilter::Mitchell:
+                return &ComputeFilteredMip2D<ChannelType, MipFilter::Mitchell, AlphaWeighted>;
+            default:
+                return nullptr;
+        }
+    }
+
+    template <typename ChannelType>
+    mip_generator_2d_t GetFilteredMipGenerator(MipFilter filter, bool alphaWeighted) {
+        return alphaWeighted ?
+            GetFilteredMipGenerator<ChannelType, true>(filter) :
+            GetFilteredMipGenerator<ChannelType, false>(filter);
+    }
+}
+
+mip_generator_2d_t okami::GetMipGenerator(ValueType Type,
+    uint32_t NumChannels,
+    MipFilter Filter,
+    bool AlphaWeighted) {
+
+    if (Filter == MipFilter::Box && !AlphaWeighted) {
+        switch (Type) {
+            case ValueType::UINT8:
+                if (NumChannels == 4) {
+                    return &ComputeCoarseMip2D_RGBA8;
+                }
+                return &ComputeCoarseMip2D<uint8_t>;
+            case ValueType::UINT16:
+                return &ComputeCoarseMip2D<uint16_t>;
+            case ValueType::UINT32:
+                return &ComputeCoarseMip2D<uint32_t>;
+            case ValueType::FLOAT32:
+                return &ComputeCoarseMip2D<float>;
+            default:
+                return nullptr;
+        }
+    }
+
+    // 32 bit integers do not survive a round trip through float
+    switch (Type) {
+        case ValueType::UINT8:
+            return GetFilteredMipGenerator<uint8_t>(Filter, AlphaWeighted);
+        case ValueType::UINT16:
+            return GetFilteredMipGenerator<uint16_t>(Filter, AlphaWeighted);
+        case ValueType::FLOAT32:
+            return GetFilteredMipGenerator<float>(Filter, AlphaWeighted);
+        default:
+            return nullptr;
+    }
+}
@@ -0,0 +1,357 @@
+#include <okami/occlusion.hpp>
+#include <okami/simd.hpp>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace {
+    constexpr uint32_t kSimdWidth = 4;
+    constexpr float kMinW = 1e-5f;
+
+    // Edge function E(p) = a * p.x + b * p.y + c, positive on the inside of
+    // a counter clockwise triangle
+    struct Edge {
+        float a;
+        float b;
+        float c;
+
+        Edge() = default;
+        inline Edge(glm::vec2 const& from, glm::vec2 const& to) :
+            a(from.y - to.y),
+            b(to.x - from.x),
+            c(-(a * from.x + b * from.y)) {
+        }
+
+        inline float operator()(float x, float y) const {
+            return a * x + b * y + c;
+        }
+    };
+}
+
+okami::OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+    _width((std::max(width, 1u) + kSimdWidth - 1) / kSimdWidth * kSimdWidth),
+    _height(std::max(height, 1u)),
+    _view{},
+    _viewProj(1.0f) {
+
+    uint32_t w = _width;
+    uint32_t h = _height;
+    _levels.emplace_back(Level{w, h, std::vector<float>(w * h, 1.0f)});
+    while (w > 1 || h > 1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        _levels.emplace_back(Level{w, h, std::vector<float>(w * h, 1.0f)});
+    }
+}
+
+void okami::OcclusionBuffer::Clear(RenderView const& view) {
+    _view = view;
+    _viewProj = view.GetProjMatrix() * view.GetViewMatrix();
+    for (auto& level : _levels) {
+        std::fill(level.depth.begin(), level.depth.end(), 1.0f);
+    }
+}
+
+void okami::OcclusionBuffer::RasterizeTriangle(
+    glm::vec4 const& c0,
+    glm::vec4 const& c1,
+    glm::vec4 const& c2) {
+
+    // Triangles crossing the near plane are dropped rather than clipped.
+    // Occluders only ever remove candidates, so rasterizing less is safe.
+    if (c0.w <= kMinW || c1.w <= kMinW || c2.w <= kMinW ||
+        c0.z < -c0.w || c1.z < -c1.w || c2.z < -c2.w) {
+        return;
+    }
+    if (c0.z > c0.w && c1.z > c1.w && c2.z > c2.w) {
+        return;
+    }
+
+    auto toScreen = [this](glm::vec4 const& c) {
+        float invW = 1.0f / c.w;
+        return glm::vec3(
+            (c.x * invW * 0.5f + 0.5f) * static_cast<float>(_width),
+            (c.y * invW * 0.5f + 0.5f) * static_cast<float>(_height),
+            c.z * invW * 0.5f + 0.5f);
+    };
+
+    glm::vec3 v0 = toScreen(c0);
+    glm::vec3 v1 = toScreen(c1);
+    glm::vec3 v2 = toScreen(c2);
+
+    // Occluders are rasterized double sided, so just fix up the winding
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) <= std::numeric_limits<float>::epsilon()) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    int minX = std::max(0, static_cast<int>(std::floor(std::min({v0.x, v1.x, v2.x}))));
+    int maxX = std::min(static_cast<int>(_width) - 1,
+        static_cast<int>(std::ceil(std::max({v0.x, v1.x, v2.x}))));
+    int minY = std::max(0, static_cast<int>(std::floor(std::min({v0.y, v1.y, v2.y}))));
+    int maxY = std::min(static_cast<int>(_height) - 1,
+        static_cast<int>(std::ceil(std::max({v0.y, v1.y, v2.y}))));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    Edge e0{glm::vec2(v1), glm::vec2(v2)};
+    Edge e1{glm::vec2(v2), glm::vec2(v0)};
+    Edge e2{glm::vec2(v0), glm::vec2(v1)};
+
+    // Depth is affine in screen space: z = d0 + b1 (d1 - d0) + b2 (d2 - d0),
+    // with the barycentrics b1 = e1 / area and b2 = e2 / area
+    float invArea = 1.0f / area;
+    float dz1 = (v1.z - v0.z) * invArea;
+    float dz2 = (v2.z - v0.z) * invArea;
+    Edge depth;
+    depth.a = e1.a * dz1 + e2.a * dz2;
+    depth.b = e1.b * dz1 + e2.b * dz2;
+    depth.c = v0.z + e1.c * dz1 + e2.c * dz2;
+
+    // Rows are padded to the SIMD width, so blocks never leave the row
+    int startX = minX & ~static_cast<int>(kSimdWidth - 1);
+    auto& buffer = _levels.front().depth;
+
+#if OKAMI_SIMD_SSE2
+    auto const offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    auto const zero = _mm_setzero_ps();
+    auto const step = static_cast<float>(kSimdWidth);
+
+    auto const e0a = _mm_set1_ps(e0.a);
+    auto const e1a = _mm_set1_ps(e1.a);
+    auto const e2a = _mm_set1_ps(e2.a);
+    auto const da = _mm_set1_ps(depth.a);
+    auto const e0Step = _mm_set1_ps(e0.a * step);
+    auto const e1Step = _mm_set1_ps(e1.a * step);
+    auto const e2Step = _mm_set1_ps(e2.a * step);
+    auto const dStep = _mm_set1_ps(depth.a * step);
+
+    for (int y = minY; y <= maxY; ++y) {
+        float py = static_cast<float>(y) + 0.5f;
+        auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(startX)), offsets);
+
+        auto w0 = _mm_add_ps(_mm_mul_ps(e0a, px), _mm_set1_ps(e0.b * py + e0.c));
+        auto w1 = _mm_add_ps(_mm_mul_ps(e1a, px), _mm_set1_ps(e1.b * py + e1.c));
+        auto w2 = _mm_add_ps(_mm_mul_ps(e2a, px), _mm_set1_ps(e2.b * py + e2.c));
+        auto z = _mm_add_ps(_mm_mul_ps(da, px), _mm_set1_ps(depth.b * py + depth.c));
+
+        float* row = &buffer[static_cast<size_t>(y) * _width];
+        for (int x = startX; x <= maxX; x += kSimdWidth) {
+            auto inside = _mm_and_ps(_mm_and_ps(
+                _mm_cmpge_ps(w0, zero),
+                _mm_cmpge_ps(w1, zero)),
+                _mm_cmpge_ps(w2, zero));
+
+            if (_mm_movemask_ps(inside)) {
+                auto current = _mm_loadu_ps(&row[x]);
+                auto nearest = _mm_min_ps(current, z);
+                _mm_storeu_ps(&row[x], _mm_or_ps(
+                    _mm_and_ps(inside, nearest),
+                    _mm_andnot_ps(inside, current)));
+            }
+
+            w0 = _mm_add_ps(w0, e0Step);
+            w1 = _mm_add_ps(w1, e1Step);
+            w2 = _mm_add_ps(w2, e2Step);
+            z = _mm_add_ps(z, dStep);
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; ++y) {
+        float py = static_cast<float>(y) + 0.5f;
+        float* row = &buffer[static_cast<size_t>(y) * _width];
+        for (int x = startX; x <= maxX; ++x) {
+            float px = static_cast<float>(x) + 0.5f;
+            if (e0(px, py) >= 0.0f && e1(px, py) >= 0.0f && e2(px, py) >= 0.0f) {
+                row[x] = std::min(row[x], depth(px, py));
+            }
+        }
+    }
+#endif
+}
+
+void okami::OcclusionBuffer::RasterizeOccluder(
+    std::span<glm::vec3 const> positions,
+    std::span<uint32_t const> indices,
+    WorldTransform const& transform) {
+
+    auto worldViewProj = _viewProj * transform.ToRelativeMatrix4x4(_view.origin);
+
+    _clipScratch.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        _clipScratch[i] = worldViewProj * glm::vec4(positions[i], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        RasterizeTriangle(
+            _clipScratch[indices[i]],
+            _clipScratch[indices[i + 1]],
+            _clipScratch[indices[i + 2]]);
+    }
+}
+
+void okami::OcclusionBuffer::RasterizeOccluder(
+    Geometry const& geometry,
+    WorldTransform const& transform) {
+
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed || desc.topology != Topology::TRIANGLE_LIST) {
+        throw std::runtime_error("Occluders must be indexed triangle lists!");
+    }
+    auto indexType = desc.indexedAttribs.indexType;
+    if (indexType != ValueType::UINT16 && indexType != ValueType::UINT32) {
+        throw std::runtime_error("Occluder index type must be VT_UINT16 or VT_UINT32!");
+    }
+
+    size_t vertexCount = desc.attribs.numVertices;
+    auto indexing = PackIndexing::From(desc.layout, vertexCount);
+    if (indexing.positionOffset < 0) {
+        throw std::runtime_error("Occluders must have positions!");
+    }
+
+    auto worldViewProj = _viewProj * transform.ToRelativeMatrix4x4(_view.origin);
+
+    _clipScratch.resize(vertexCount);
+    auto const& element = desc.layout.elements[desc.layout.position];
+    if (element.valueType == ValueType::FLOAT32) {
+        auto const& channel = geometry.GetVertexBuffers()[indexing.positionChannel].bytes;
+        auto src = &channel[indexing.positionOffset];
+        for (size_t i = 0; i < vertexCount; ++i) {
+            glm::vec3 position;
+            std::memcpy(&position, src + i * indexing.positionStride, sizeof(glm::vec3));
+            _clipScratch[i] = worldViewProj * glm::vec4(position, 1.0f);
+        }
+    } else {
+        // Half and quantised positions are decoded up front
+        auto positions = UnpackPositions(geometry);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            _clipScratch[i] = worldViewProj * glm::vec4(positions[i], 1.0f);
+        }
+    }
+
+    auto const& indexBytes = geometry.GetIndexBuffer().bytes;
+    size_t indexCount = desc.indexedAttribs.numIndices;
+    auto rasterize = [&](auto const* indices) {
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            RasterizeTriangle(
+                _clipScratch[indices[i]],
+                _clipScratch[indices[i + 1]],
+                _clipScratch[indices[i + 2]]);
+        }
+    };
+    if (indexType == ValueType::UINT16) {
+        rasterize(reinterpret_cast<uint16_t const*>(indexBytes.data()));
+    } else {
+        rasterize(reinterpret_cast<uint32_t const*>(indexBytes.data()));
+    }
+}
+
+void okami::OcclusionBuffer::BuildHierarchy() {
+    for (size_t l = 1; l < _levels.size(); ++l) {
+        auto const& src = _levels[l - 1];
+        auto& dst = _levels[l];
+
+        for (uint32_t y = 0; y < dst.height; ++y) {
+            float const* row0 = &src.depth[static_cast<size_t>(2 * y) * src.width];
+            float const* row1 = &src.depth[
+                static_cast<size_t>(std::min(2 * y + 1, src.height - 1)) * src.width];
+            float* out = &dst.depth[static_cast<size_t>(y) * dst.width];
+
+            uint32_t x = 0;
+#if OKAMI_SIMD_SSE2
+            for (; 2 * x + 8 <= src.width; x += 4) {
+                auto a = _mm_max_ps(_mm_loadu_ps(&row0[2 * x]), _mm_loadu_ps(&row1[2 * x]));
+                auto b = _mm_max_ps(_mm_loadu_ps(&row0[2 * x + 4]), _mm_loadu_ps(&row1[2 * x + 4]));
+                _mm_storeu_ps(&out[x], _mm_max_ps(
+                    _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                    _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+            }
+#endif
+            for (; x < dst.width; ++x) {
+                uint32_t x0 = 2 * x;
+                uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+                out[x] = std::max(
+                    std::max(row0[x0], row0[x1]),
+                    std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool okami::OcclusionBuffer::IsVisible(
+    BoundingBox const& bounds,
+    glm::mat4 const& worldViewProj) const {
+
+    glm::vec2 screenMin(std::numeric_limits<float>::infinity());
+    glm::vec2 screenMax(-std::numeric_limits<float>::infinity());
+    float minDepth = std::numeric_limits<float>::infinity();
+
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner(
+            (i & 1) ? bounds.mUpper.x : bounds.mLower.x,
+            (i & 2) ? bounds.mUpper.y : bounds.mLower.y,
+            (i & 4) ? bounds.mUpper.z : bounds.mLower.z);
+        auto clip = worldViewProj * glm::vec4(corner, 1.0f);
+
+        // The box reaches past the near plane
+        if (clip.w <= kMinW || clip.z < -clip.w) {
+            return true;
+        }
+
+        float invW = 1.0f / clip.w;
+        glm::vec2 screen(
+            (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(_width),
+            (clip.y * invW * 0.5f + 0.5f) * static_cast<float>(_height));
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        minDepth = std::min(minDepth, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Off screen boxes are left to frustum culling
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f ||
+        screenMin.x >= static_cast<float>(_width) ||
+        screenMin.y >= static_cast<float>(_height)) {
+        return true;
+    }
+
+    int x0 = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+    int y0 = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+    int x1 = std::min(static_cast<int>(_width) - 1, static_cast<int>(std::floor(screenMax.x)));
+    int y1 = std::min(static_cast<int>(_height) - 1, static_cast<int>(std::floor(screenMax.y)));
+
+    // Pick the finest level at which the box covers at most 2x2 texels
+    size_t l = 0;
+    while (l + 1 < _levels.size() &&
+        ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) {
+        ++l;
+    }
+
+    auto const& level = _levels[l];
+    float maxDepth = 0.0f;
+    for (int y = y0 >> l; y <= (y1 >> l); ++y) {
+        for (int x = x0 >> l; x <= (x1 >> l); ++x) {
+            maxDepth = std::max(maxDepth, level.depth[static_cast<size_t>(y) * level.width + x]);
+        }
+    }
+
+    return minDepth <= maxDepth;
+}
+
+bool okami::OcclusionBuffer::IsVisible(
+    BoundingBox const& bounds,
+    WorldTransform const& transform) const {
+    return IsVisible(bounds, _viewProj * transform.ToRelativeMatrix4x4(_view.origin));
+}
@@ -5,46 +5,207 @@
 using namespace okami;
 
 Expected<GLGeometry> GLGeometry::Create(Geometry const& geometry) {
+    std::vector<std::span<uint8_t const>> vertexBuffers;
+    for (auto const& buffer : geometry.GetVertexBuffers()) {
+        vertexBuffers.emplace_back(buffer.bytes);
+    }
+    Error err;
+    auto result = OKAMI_EXP_UNWRAP(Create(geometry.GetDesc(), geometry.GetBounds(),
+        vertexBuffers, geometry.GetIndexBuffer().bytes), err);
+    result.meshlets = geometry.GetMeshlets();
+    return result;
+}
+
+Expected<GLGeometry> GLGeometry::Create(MeshFile const& file) {
+    return Create(file.GetDesc(), file.GetBounds(),
+        file.GetVertexBuffers(), file.GetIndexBuffer());
+}
+
+Expected<GLGeometry> GLGeometry::Create(GeometryDesc const& desc,
+    BoundingBox const& bounds,
+    std::span<std::span<uint8_t const> const> vertexBuffers,
+    std::span<uint8_t const> indexBuffer) {
     GLGeometry geo;
-    geo.desc = geometry.GetDesc();
-    auto err = geo.desc.layout.AutoLayout();
-    OKAMI_EXP_RETURN(err);
+    geo.desc = desc;
+    geo.bounds = bounds;
 
-    for (auto const& buffer : geometry.GetVertexBuffers()) {
+    Error err;
+    for (auto buffer : vertexBuffers) {
         auto vertBufferGL = OKAMI_EXP_UNWRAP(GLBuffer::Create(buffer), err);
         geo.vertexBuffers.emplace_back(std::move(vertBufferGL));
     }
 
     if (geo.desc.isIndexed) {
-        geo.indexBuffer = OKAMI_EXP_UNWRAP(
-            GLBuffer::Create(geometry.GetIndexBuffer()), err);
+        geo.indexBuffer = OKAMI_EXP_UNWRAP(GLBuffer::Create(indexBuffer), err);
     }
 
-    OKAMI_EXP_GL(glGenVertexArrays(1, &*geo.vertexArray));
-    OKAMI_EXP_GL(glBindVertexArray(*geo.vertexArray));
+    err = geo.CreateVertexArray();
+    OKAMI_EXP_RETURN(err);
+
+    return geo;
+}
+
+Expected<GLGeometry> GLGeometry::Create(Geometry&& geometry) {
+    auto result = Create(geometry);
+    geometry.Dealloc();
+    return result;
+}
+
+Error GLGeometry::CreateVertexArray() {
+    dequantization = geometry::GetPositionDequantization(desc, bounds);
+    auto err = desc.layout.AutoLayout();
+    OKAMI_ERR_RETURN(err);
+
+    OKAMI_ERR_GL(glGenVertexArrays(1, &*vertexArray));
+    OKAMI_ERR_GL(glBindVertexArray(*vertexArray));
     
-    for (auto const& layoutElement : geo.desc.layout.elements) {
-        OKAMI_EXP_RETURN_IF(layoutElement.bufferSlot >= geo.vertexBuffers.size(),
+    for (auto const& layoutElement : desc.layout.elements) {
+        OKAMI_ERR_RETURN_IF(layoutElement.bufferSlot >= vertexBuffers.size(),
             RuntimeError{"Layout element buffer slot is outside of acceptible range!"})
-        OKAMI_EXP_GL(glBindBuffer(GL_ARRAY_BUFFER, *geo.vertexBuffers[layoutElement.bufferSlot]));
-        OKAMI_EXP_GL(glEnableVertexAttribArray(layoutElement.inputIndex));
-        OKAMI_EXP_GL(glVertexAttribPointer(layoutElement.inputIndex, 
+        OKAMI_ERR_GL(glBindBuffer(GL_ARRAY_BUFFER, *vertexBuffers[layoutElement.bufferSlot]));
+        OKAMI_ERR_GL(glEnableVertexAttribArray(layoutElement.inputIndex));
+        OKAMI_ERR_GL(glVertexAttribPointer(layoutElement.inputIndex, 
             layoutElement.numComponents,
             ToGL(layoutElement.valueType),
             layoutElement.isNormalized,
             layoutElement.stride,
             (GLvoid*)layoutElement.relativeOffset));
+        if (layoutElement.frequency == InputElementFrequency::PER_INSTANCE) {
+            OKAMI_ERR_GL(glVertexAttribDivisor(layoutElement.inputIndex,
+                layoutElement.instanceDataStepRate));
+        }
     }
 
-    if (geo.desc.isIndexed) {
-        OKAMI_EXP_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *geo.indexBuffer));
+    if (desc.isIndexed) {
+        OKAMI_ERR_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *indexBuffer));
     }
 
-    OKAMI_EXP_GL(glBindVertexArray(0));
+    OKAMI_ERR_GL(glBindVertexArray(0));
 
-    return geo;
+    return {};
 }
 
-Expected<GLGeometry> GLGeometry::Create(Geometry&& geometry) {
-    return Create(geometry);
+Error GLGeometry::BindInstances(std::span<LayoutElement const> elements,
+    GLBuffer const& buffer,
+    size_t offset) const {
+    OKAMI_ERR_GL(glBindVertexArray(*vertexArray));
+    OKAMI_ERR_GL(glBindBuffer(GL_ARRAY_BUFFER, *buffer));
+
+    for (auto const& element : elements) {
+        OKAMI_ERR_GL(glEnableVertexAttribArray(element.inputIndex));
+        OKAMI_ERR_GL(glVertexAttribPointer(element.inputIndex,
+            element.numComponents,
+            ToGL(element.valueType),
+            element.isNormalized,
+            element.stride,
+            (GLvoid*)(offset + element.relativeOffset)));
+        OKAMI_ERR_GL(glVertexAttribDivisor(element.inputIndex, element.instanceDataStepRate));
+    }
+
+    return {};
+}
+
+Error GLGeometry::UnbindInstances(std::span<LayoutElement const> elements) const {
+    OKAMI_ERR_GL(glBindVertexArray(*vertexArray));
+
+    for (auto const& element : elements) {
+        OKAMI_ERR_GL(glVertexAttribDivisor(element.inputIndex, 0));
+        OKAMI_ERR_GL(glDisableVertexAttribArray(element.inputIndex));
+    }
+
+    return {};
+}
+
+namespace {
+    Error MapBuffer(GLBuffer const& buffer, size_t size, std::span<uint8_t>& bytes) {
+        bytes = {};
+        if (size == 0) {
+            return {};
+        }
+
+        OKAMI_ERR_GL(glBindBuffer(GL_ARRAY_BUFFER, *buffer));
+        // Invalidating lets the driver hand out fresh memory without a sync
+        auto ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        OKAMI_ERR_RETURN_IF(ptr == nullptr, RuntimeError{"Failed to map buffer!"});
+        bytes = std::span<uint8_t>(static_cast<uint8_t*>(ptr), size);
+        return {};
+    }
+
+    Error UnmapBuffer(GLBuffer const& buffer) {
+        OKAMI_ERR_GL(glBindBuffer(GL_ARRAY_BUFFER, *buffer));
+        auto intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+        OKAMI_ERR_RETURN_IF(intact == GL_FALSE, RuntimeError{"Buffer contents were lost while mapped!"});
+        return {};
+    }
+}
+
+Error GLGeometry::MapBuffers(geometry::PackSizes const& sizes,
+    std::vector<std::span<uint8_t>>& vertexBytes,
+    std::span<uint8_t>& indexBytes) {
+    Error err;
+    for (auto size : sizes.vertexBuffers) {
+        auto buffer = OKAMI_ERR_UNWRAP(GLBuffer::Create(size), err);
+        vertexBuffers.emplace_back(std::move(buffer));
+        vertexBytes.emplace_back();
+        err = MapBuffer(vertexBuffers.back(), size, vertexBytes.back());
+        OKAMI_ERR_RETURN(err);
+    }
+
+    indexBuffer = OKAMI_ERR_UNWRAP(GLBuffer::Create(sizes.indexBuffer), err);
+    return MapBuffer(indexBuffer, sizes.indexBuffer, indexBytes);
+}
+
+Error GLGeometry::UnmapBuffers(geometry::PackSizes const& sizes) {
+    // Keep going on failure so that nothing is left mapped
+    Error result;
+    auto unmap = [&](GLBuffer const& buffer, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        auto err = UnmapBuffer(buffer);
+        if (IsError(err) && !IsError(result)) {
+            result = err;
+        }
+    };
+
+    for (size_t i = 0; i < vertexBuffers.size(); ++i) {
+        unmap(vertexBuffers[i], sizes.vertexBuffers[i]);
+    }
+    unmap(indexBuffer, sizes.indexBuffer);
+    return result;
+}
+
+Error GLGeometry::AbortPack(geometry::PackSizes const& sizes, std::exception const& e) {
+    PLOG_ERROR << "Failed to pack geometry: " << e.what();
+    auto err = OKAMI_ERR_MAKE(RuntimeError{"Failed to pack geometry!"});
+    err += UnmapBuffers(sizes);
+    return err;
+}
+
+Expected<GLLODGroup> GLLODGroup::Create(LODGroup const& group) {
+    OKAMI_EXP_RETURN_IF(group.levels.empty(), RuntimeError{"LOD group has no levels!"});
+    OKAMI_EXP_RETURN_IF(group.levels.size() != group.screenSizes.size(),
+        RuntimeError{"LOD group needs one screen size per level!"});
+
+    Error err;
+    GLLODGroup result;
+    result.screenSizes = group.screenSizes;
+    result.bounds = group.GetBounds();
+
+    for (auto const& level : group.levels) {
+        auto levelGL = OKAMI_EXP_UNWRAP(GLGeometry::Create(level), err);
+        result.levels.emplace_back(std::move(levelGL));
+    }
+
+    return result;
+}
+
+GLGeometry const& GLLODGroup::Select(RenderView const& view,
+    WorldTransform const& transform,
+    LODState& state,
+    float hysteresis) const {
+    auto screenSize = ProjectedScreenSize(bounds, transform, view);
+    state.level = SelectLOD(screenSizes, screenSize, state.level, hysteresis);
+    return levels[state.level];
 }
\ No newline at end of file
@@ -66,13 +66,19 @@ Error okami::GLRendererModule::PostExecute(Registry& registry) const {
                 .value_or(CameraReference{}).entity;
 
             auto camera = GetProperty<Camera>(registry, cameraEntity).value_or(Camera{});
-            auto transform = GetProperty<Transform>(registry, cameraEntity).value_or(Transform{});
 
-            RenderView renderCamera {
-                .camera = camera,
-                .viewport = windowSize.AsVec2(),
-                .viewTransform = Inverse(transform)
-            };
+            RenderView renderCamera;
+            if (auto worldTransform = GetProperty<WorldTransform>(registry, cameraEntity)) {
+                renderCamera = RenderView::CameraRelative(
+                    camera, windowSize.AsVec2(), *worldTransform);
+            } else {
+                auto transform = GetProperty<Transform>(registry, cameraEntity).value_or(Transform{});
+                renderCamera = RenderView {
+                    .camera = camera,
+                    .viewport = windowSize.AsVec2(),
+                    .viewTransform = Inverse(transform)
+                };
+            }
 
             err += renderer.BeginColorPass();
             //err += renderer.DrawIm3d(renderCamera, im3d);
@@ -0,0 +1,169 @@
+#include <okami/ogl/staging_ring.hpp>
+
+#include <utility>
+
+using namespace okami;
+
+namespace {
+    // Longest single wait on a fence before checking again
+    constexpr GLuint64 kFenceTimeout = 1000000000ull;
+    // Keeps every allocation aligned however the ring wraps
+    constexpr size_t kRingGranularity = 256;
+
+    uint64_t AlignUp(uint64_t position, size_t alignment) {
+        return (position + alignment - 1) / alignment * alignment;
+    }
+}
+
+GLStagingRing::GLStagingRing(GLStagingRing&& other) noexcept {
+    *this = std::move(other);
+}
+
+GLStagingRing& GLStagingRing::operator=(GLStagingRing&& other) noexcept {
+    for (auto const& fence : _fences) {
+        glDeleteSync(fence.sync);
+    }
+
+    _buffer = std::move(other._buffer);
+    _mapped = std::exchange(other._mapped, nullptr);
+    _size = std::exchange(other._size, 0);
+    _isPersistent = std::exchange(other._isPersistent, false);
+    _isMapped = std::exchange(other._isMapped, false);
+    _head = std::exchange(other._head, 0);
+    _tail = std::exchange(other._tail, 0);
+    _fencedHead = std::exchange(other._fencedHead, 0);
+    _boundHead = std::exchange(other._boundHead, 0);
+    _fences = std::exchange(other._fences, {});
+    return *this;
+}
+
+GLStagingRing::~GLStagingRing() {
+    // Deleting the buffer also unmaps it
+    for (auto const& fence : _fences) {
+        glDeleteSync(fence.sync);
+    }
+}
+
+void GLStagingRing::Retire(bool wait) {
+    while (!_fences.empty()) {
+        auto const& fence = _fences.front();
+        auto status = glClientWaitSync(fence.sync, 
+            wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 
+            wait ? kFenceTimeout : 0);
+
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (wait) {
+                continue;
+            }
+            return;
+        }
+
+        // A failed wait means the context is lost, so nothing will read
+        // from the ring again either way
+        _tail = fence.end;
+        glDeleteSync(fence.sync);
+        _fences.pop_front();
+
+        if (wait) {
+            return;
+        }
+    }
+}
+
+Expected<GLStagingRing::Allocation> GLStagingRing::Allocate(size_t size, size_t alignment) {
+    OKAMI_EXP_RETURN_IF(size > _size, RuntimeError{"Allocation is larger than the staging ring!"});
+    OKAMI_EXP_RETURN_IF(kRingGranularity % alignment != 0, 
+        RuntimeError{"Staging ring alignment is too large!"});
+
+    Retire(false);
+
+    uint64_t begin;
+    while (true) {
+        begin = AlignUp(_head, alignment);
+        // Allocations never straddle the end of the buffer
+        if (begin % _size + size > _size) {
+            begin = AlignUp(begin, _size);
+        }
+        if (begin + size - _tail <= _size) {
+            break;
+        }
+
+        OKAMI_EXP_RETURN_IF(_fences.empty(), 
+            RuntimeError{"Staging ring is full of uploads that were never fenced!"});
+        Retire(true);
+    }
+
+    if (!_isPersistent && !_isMapped) {
+        // Unsynchronized, the fences already keep us off the regions in use
+        OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, *_buffer));
+        _mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _size,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+        OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        OKAMI_EXP_RETURN_IF(!_mapped, RuntimeError{"Failed to map staging ring!"});
+        _isMapped = true;
+        _boundHead = _head;
+    }
+
+    _head = begin + size;
+
+    size_t offset = begin % _size;
+    return Allocation{offset, std::span<uint8_t>(_mapped + offset, size)};
+}
+
+Error GLStagingRing::Bind() {
+    OKAMI_ERR_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, *_buffer));
+
+    if (_isMapped) {
+        uint64_t start = _boundHead % _size;
+        uint64_t length = _head - _boundHead;
+        if (start + length <= _size) {
+            OKAMI_ERR_GL(glFlushMappedBufferRange(GL_PIXEL_UNPACK_BUFFER, start, length));
+        } else {
+            OKAMI_ERR_GL(glFlushMappedBufferRange(GL_PIXEL_UNPACK_BUFFER, start, _size - start));
+            OKAMI_ERR_GL(glFlushMappedBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, 
+                length - (_size - start)));
+        }
+        OKAMI_ERR_GL(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+        _mapped = nullptr;
+        _isMapped = false;
+    }
+    _boundHead = _head;
+
+    return {};
+}
+
+Error GLStagingRing::Fence() {
+    if (_head == _fencedHead) {
+        return {};
+    }
+
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    OKAMI_ERR_RETURN_IF(!sync, RuntimeError{"Failed to create staging ring fence!"});
+    _fences.emplace_back(PendingFence{sync, _head});
+    _fencedHead = _head;
+
+    return {};
+}
+
+Expected<GLStagingRing> GLStagingRing::Create(size_t size) {
+    GLStagingRing result;
+    result._size = AlignUp(std::max<size_t>(size, 1u), kRingGranularity);
+    result._isPersistent = GLCapabilities::Get().bufferStorage;
+
+    OKAMI_EXP_GL(glGenBuffers(1, &*result._buffer));
+    OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, *result._buffer));
+
+    if (result._isPersistent) {
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        OKAMI_EXP_GL(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, result._size, nullptr, flags));
+        result._mapped = static_cast<uint8_t*>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, result._size, flags));
+        OKAMI_EXP_RETURN_IF(!result._mapped, RuntimeError{"Failed to map staging ring!"});
+    } else {
+        OKAMI_EXP_GL(glBufferData(GL_PIXEL_UNPACK_BUFFER, result._size, nullptr, GL_STREAM_DRAW));
+    }
+
+    OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    return result;
+}
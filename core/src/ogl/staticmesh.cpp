@@ -2,8 +2,159 @@
 
 #include <plog/Log.h>
 
+#include <algorithm>
+#include <tuple>
+
 using namespace okami;
 
+namespace {
+    // Submits the meshlets of geometry that pass the view, merging the ones
+    // that are neighbours in the index buffer into a single range
+    Error DrawMeshlets(GLGeometry const& geometry,
+        geometry::MeshletCullView const& view,
+        std::vector<GLsizei>& counts,
+        std::vector<void const*>& offsets) {
+        counts.clear();
+        offsets.clear();
+
+        auto indexType = geometry.desc.indexedAttribs.indexType;
+        size_t indexSize = GetSize(indexType);
+        uint32_t rangeEnd = 0;
+
+        for (auto const& meshlet : geometry.meshlets) {
+            if (!geometry::IsMeshletVisible(meshlet, view)) {
+                continue;
+            }
+            if (!counts.empty() && rangeEnd == meshlet.indexOffset) {
+                counts.back() += meshlet.indexCount;
+            } else {
+                counts.emplace_back(meshlet.indexCount);
+                offsets.emplace_back(reinterpret_cast<void const*>(meshlet.indexOffset * indexSize));
+            }
+            rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+        }
+
+        if (counts.empty()) {
+            return {};
+        }
+
+        OKAMI_ERR_GL(glMultiDrawElements(ToGL(geometry.desc.topology), counts.data(),
+            ToGL(indexType), offsets.data(), static_cast<GLsizei>(counts.size())));
+        return {};
+    }
+
+    Error DrawGeometry(GLGeometry const& geometry,
+        glm::mat4 const& worldView,
+        glm::mat4 const& proj,
+        bool coneCulling,
+        std::vector<GLsizei>& meshletCounts,
+        std::vector<void const*>& meshletOffsets) {
+        OKAMI_ERR_GL(glBindVertexArray(*geometry.vertexArray));
+
+        GLenum topology = ToGL(geometry.desc.topology);
+
+        if (!geometry.desc.isIndexed) {
+            OKAMI_ERR_GL(glDrawArrays(topology, 0, geometry.desc.attribs.numVertices));
+        } else if (!geometry.meshlets.empty()) {
+            auto cullView = geometry::MeshletCullView::From(worldView, proj, coneCulling);
+            auto err = DrawMeshlets(geometry, cullView, meshletCounts, meshletOffsets);
+            OKAMI_ERR_RETURN(err);
+        } else {
+            OKAMI_ERR_GL(glDrawElements(topology, geometry.desc.indexedAttribs.numIndices,
+                ToGL(geometry.desc.indexedAttribs.indexType), nullptr));
+        }
+        return {};
+    }
+
+    Error DrawInstanced(GLGeometry const& geometry, GLsizei instanceCount) {
+        GLenum topology = ToGL(geometry.desc.topology);
+
+        if (!geometry.desc.isIndexed) {
+            OKAMI_ERR_GL(glDrawArraysInstanced(topology, 0, 
+                geometry.desc.attribs.numVertices, instanceCount));
+        } else {
+            OKAMI_ERR_GL(glDrawElementsInstanced(topology, geometry.desc.indexedAttribs.numIndices,
+                ToGL(geometry.desc.indexedAttribs.indexType), nullptr, instanceCount));
+        }
+        return {};
+    }
+
+    bool IsTextureArray(std::optional<GLTexturedMaterial> const& material) {
+        return material && material->texture && **material->texture != 0u &&
+            material->texture->desc.type == texture::Dimension::Texture2DArray;
+    }
+
+    GLuint GetTextureId(GLTexturedMaterial const& material) {
+        return material.texture ? **material.texture : 0u;
+    }
+
+    // Orders by texture first so that binds are shared, then by everything
+    // else that the calls of an instanced draw have in common
+    bool DrawOrderLess(GLStaticMeshRenderCall const& a, GLStaticMeshRenderCall const& b) {
+        auto matA = a.material.value_or(GLTexturedMaterial{});
+        auto matB = b.material.value_or(GLTexturedMaterial{});
+        auto keyA = std::make_tuple(GetTextureId(matA), matA.textureSampler, &a.geometry, matA.textureLayer);
+        auto keyB = std::make_tuple(GetTextureId(matB), matB.textureSampler, &b.geometry, matB.textureLayer);
+        if (keyA != keyB) {
+            return keyA < keyB;
+        }
+        return std::lexicographical_compare(&matA.color[0], &matA.color[0] + 4,
+            &matB.color[0], &matB.color[0] + 4);
+    }
+
+    // Calls that share geometry and material, drawn in a single instanced
+    // draw. Their world matrices start at instance firstInstance.
+    struct InstanceGroup {
+        size_t call;
+        size_t firstInstance;
+        size_t instanceCount;
+    };
+
+    // Splits sorted calls into instance groups and single calls, and
+    // appends the world matrices of the groups to instanceWorlds
+    void GroupInstances(std::span<GLStaticMeshRenderCall const> meshes,
+        std::span<glm::mat4 const> worlds,
+        std::span<size_t const> calls,
+        std::vector<InstanceGroup>& groups,
+        std::vector<size_t>& singles,
+        std::vector<glm::mat4>& instanceWorlds) {
+        for (size_t begin = 0; begin < calls.size();) {
+            size_t end = begin + 1;
+            while (end < calls.size() && !DrawOrderLess(meshes[calls[begin]], meshes[calls[end]])) {
+                ++end;
+            }
+
+            if (end - begin == 1) {
+                singles.emplace_back(calls[begin]);
+            } else {
+                groups.emplace_back(InstanceGroup{calls[begin], instanceWorlds.size(), end - begin});
+                for (size_t i = begin; i < end; ++i) {
+                    instanceWorlds.emplace_back(worlds[calls[i]]);
+                }
+            }
+            begin = end;
+        }
+    }
+
+    // Binds the texture of material unless the last one bound is the same
+    void SetMaterial(GLStaticMeshProgram const& program,
+        GLTexturedMaterial const& material,
+        GLTexture const& defaultTexture,
+        GLDefaultSamplers const& samplers,
+        std::optional<std::pair<GLuint, SamplerType>>& bound) {
+        auto binding = std::make_pair(GetTextureId(material), material.textureSampler);
+        if (bound != binding) {
+            program.texturedUniforms.Set(material, defaultTexture, samplers);
+            bound = binding;
+        } else {
+            glUniform4fv(program.texturedUniforms.uColor, 1, &material.color[0]);
+        }
+        if (program.arrayUniforms) {
+            program.arrayUniforms->Set(material);
+        }
+    }
+}
+
 Expected<GLWorldUniformBlock> GLWorldUniformBlock::Create(GLProgram const& program) {
     GLWorldUniformBlock block;
     block.uWorld = UnwrapAndWarn(program.GetUniformLocation("uWorld"), -1);
@@ -12,9 +163,12 @@ Expected<GLWorldUniformBlock> GLWorldUniformBlock::Create(GLProgram const& progr
 }
 
 void GLWorldUniformBlock::Set(glm::mat4 const& world) const {
-    auto invTrans = glm::transpose(glm::inverse(world));
     glUniformMatrix4fv(uWorld, 1, false, &world[0][0]);
-    glUniformMatrix4fv(uWorldInvTrans, 1, false, &invTrans[0][0]);
+    // Skip the inverse for shaders that do not read it
+    if (uWorldInvTrans != -1) {
+        auto invTrans = glm::transpose(glm::inverse(world));
+        glUniformMatrix4fv(uWorldInvTrans, 1, false, &invTrans[0][0]);
+    }
 }
 
 Expected<GLCameraUniformBlock> GLCameraUniformBlock::Create(GLProgram const& program) {
@@ -32,6 +186,18 @@ void GLCameraUniformBlock::Set(glm::mat4 const& view, glm::mat4 const& proj) con
     glUniformMatrix4fv(uViewProj, 1, false, &viewProj[0][0]);
 }
 
+Expected<GLPositionUniformBlock> GLPositionUniformBlock::Create(GLProgram const& program) {
+    GLPositionUniformBlock block;
+    block.uPositionOffset = UnwrapAndWarn(program.GetUniformLocation("uPositionOffset"), -1);
+    block.uPositionScale = UnwrapAndWarn(program.GetUniformLocation("uPositionScale"), -1);
+    return block;
+}
+
+void GLPositionUniformBlock::Set(geometry::PositionDequantization const& dequantization) const {
+    glUniform3fv(uPositionOffset, 1, &dequantization.offset[0]);
+    glUniform3fv(uPositionScale, 1, &dequantization.scale[0]);
+}
+
 Expected<GLTexturedUniformBlock> GLTexturedUniformBlock::Create(GLProgram const& program) {
     GLTexturedUniformBlock result;
     result.uTextureSampler = UnwrapAndWarn(program.GetUniformLocation("uTextureSampler"), -1);
@@ -44,8 +210,9 @@ void GLTexturedUniformBlock::Set(
     GLTexture const& defaultTex,
     GLDefaultSamplers const& samplers) const {
     glActiveTexture(GL_TEXTURE0);
-    if (mat.texture) {
-        glBindTexture(GL_TEXTURE_2D, **mat.texture);
+    // Textures that are still streaming in are empty until uploaded
+    if (mat.texture && **mat.texture != 0u) {
+        glBindTexture(mat.texture->GetTarget(), **mat.texture);
         glBindSampler(0, *samplers.Select(mat.textureSampler));
     } else {
         glBindTexture(GL_TEXTURE_2D, *defaultTex);
@@ -55,6 +222,64 @@ void GLTexturedUniformBlock::Set(
     glUniform4fv(uColor, 1, &mat.color[0]);
 }
 
+Expected<GLTextureArrayUniformBlock> GLTextureArrayUniformBlock::Create(GLProgram const& program) {
+    GLTextureArrayUniformBlock result;
+    result.uTextureLayer = UnwrapAndWarn(program.GetUniformLocation("uTextureLayer"), -1);
+    return result;
+}
+
+void GLTextureArrayUniformBlock::Set(GLTexturedMaterial const& mat) const {
+    glUniform1f(uTextureLayer, static_cast<float>(mat.textureLayer));
+}
+
+Expected<GLStaticMeshProgram> GLStaticMeshProgram::Create(bool textureArray, bool instanced) {
+    Error err;
+    GLStaticMeshProgram result;
+
+    ShaderPreprocessorConfig vsConfig;
+    if (instanced) {
+        vsConfig.defines.emplace("INSTANCED", "");
+    }
+    ShaderPreprocessorConfig fsConfig;
+    if (textureArray) {
+        fsConfig.defines.emplace("TEXTURE_ARRAY", "");
+    }
+
+    auto vs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("staticmesh.vs", GL_VERTEX_SHADER, vsConfig), err);
+    auto fs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("textured.fs", GL_FRAGMENT_SHADER, fsConfig), err);
+
+    result.program = OKAMI_EXP_UNWRAP(CreateProgram(std::array{*vs, *fs}), err);
+    result.cameraUniforms = OKAMI_EXP_UNWRAP(GLCameraUniformBlock::Create(result.program), err);
+    if (!instanced) {
+        result.worldUniforms = OKAMI_EXP_UNWRAP(GLWorldUniformBlock::Create(result.program), err);
+    }
+    result.positionUniforms = OKAMI_EXP_UNWRAP(GLPositionUniformBlock::Create(result.program), err);
+    result.texturedUniforms = OKAMI_EXP_UNWRAP(GLTexturedUniformBlock::Create(result.program), err);
+    if (textureArray) {
+        result.arrayUniforms = OKAMI_EXP_UNWRAP(GLTextureArrayUniformBlock::Create(result.program), err);
+    }
+
+    return result;
+}
+
+std::span<LayoutElement const> GLStaticMeshRenderer::GetInstanceLayout() {
+    // Must match aWorld in staticmesh.vs
+    constexpr uint32_t kWorldLocation = 8;
+    constexpr uint32_t kStride = sizeof(glm::mat4);
+
+    static const std::array<LayoutElement, 4> layout{
+        LayoutElement(kWorldLocation + 0, 0, 4, ValueType::FLOAT32, false,
+            0 * sizeof(glm::vec4), kStride, InputElementFrequency::PER_INSTANCE, 1),
+        LayoutElement(kWorldLocation + 1, 0, 4, ValueType::FLOAT32, false,
+            1 * sizeof(glm::vec4), kStride, InputElementFrequency::PER_INSTANCE, 1),
+        LayoutElement(kWorldLocation + 2, 0, 4, ValueType::FLOAT32, false,
+            2 * sizeof(glm::vec4), kStride, InputElementFrequency::PER_INSTANCE, 1),
+        LayoutElement(kWorldLocation + 3, 0, 4, ValueType::FLOAT32, false,
+            3 * sizeof(glm::vec4), kStride, InputElementFrequency::PER_INSTANCE, 1),
+    };
+    return layout;
+}
+
 Expected<GLStaticMeshRenderer> GLStaticMeshRenderer::Create() {
     Error err;
     GLStaticMeshRenderer result;
@@ -62,48 +287,136 @@ Expected<GLStaticMeshRenderer> GLStaticMeshRenderer::Create() {
     auto texture = texture::prefabs::CheckerBoard(16, 16, 8, 8);
     result._defaultTexture = OKAMI_EXP_UNWRAP(GLTexture::Create(std::move(texture)), err);
 
-    auto vs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("staticmesh.vs", GL_VERTEX_SHADER, {}), err);
-    auto fs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("textured.fs", GL_FRAGMENT_SHADER, {}), err);
-
-    result._renderProgram = OKAMI_EXP_UNWRAP(CreateProgram(std::array{*vs, *fs}), err);
-    result._cameraUniforms = OKAMI_EXP_UNWRAP(GLCameraUniformBlock::Create(result._renderProgram), err);
-    result._worldUniforms = OKAMI_EXP_UNWRAP(GLWorldUniformBlock::Create(result._renderProgram), err);
+    result._renderProgram = OKAMI_EXP_UNWRAP(GLStaticMeshProgram::Create(false, false), err);
+    result._arrayProgram = OKAMI_EXP_UNWRAP(GLStaticMeshProgram::Create(true, false), err);
+    result._instancedProgram = OKAMI_EXP_UNWRAP(GLStaticMeshProgram::Create(false, true), err);
+    result._instancedArrayProgram = OKAMI_EXP_UNWRAP(GLStaticMeshProgram::Create(true, true), err);
+    result._instanceBuffer = OKAMI_EXP_UNWRAP(GLBuffer::Create(size_t{0}), err);
     result._samplers = OKAMI_EXP_UNWRAP(GLDefaultSamplers::Create(), err);
-    result._texturedUniforms = OKAMI_EXP_UNWRAP(GLTexturedUniformBlock::Create(result._renderProgram), err);
 
     return result;
 }
 
 Error GLStaticMeshRenderer::Draw(RenderView const& camera, std::span<GLStaticMeshRenderCall const> meshes) const {
-    OKAMI_ERR_GL(glUseProgram(*_renderProgram));
+    auto view = camera.GetViewMatrix();
+    auto proj = camera.GetProjMatrix();
+
+    // Rebase all world transforms against the view origin in one pass
+    std::vector<WorldTransform> transforms;
+    transforms.reserve(meshes.size());
+    for (auto const& mesh : meshes) {
+        transforms.emplace_back(mesh.transform);
+    }
+    std::vector<glm::mat4> worlds(meshes.size());
+    ToRelativeMatrices(transforms, camera.origin, worlds);
+
+    // Split off the calls that sample texture arrays
+    std::vector<size_t> textureCalls;
+    std::vector<size_t> arrayCalls;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        auto formatTag = meshes[i].geometry.desc.layout.formatTag;
+        if (formatTag != VertexFormat::PositionUV && formatTag != VertexFormat::PositionUVCompact) {
+            PLOG_WARNING << "Vertex format is not PositionUV!";
+        } else if (IsTextureArray(meshes[i].material)) {
+            arrayCalls.emplace_back(i);
+        } else {
+            textureCalls.emplace_back(i);
+        }
+    }
 
-    // Set the camera view and projection transforms
-    _cameraUniforms.Set(camera.GetViewMatrix(), camera.GetProjMatrix());
-    
-    for (auto mesh : meshes) {
-        if (mesh.geometry.desc.layout.formatTag == VertexFormat::PositionUV) {
-            // Set the world transform
-            _worldUniforms.Set(mesh.transform.ToMatrix4x4());
+    auto drawOrder = [&](size_t a, size_t b) {
+        return DrawOrderLess(meshes[a], meshes[b]);
+    };
+    std::sort(textureCalls.begin(), textureCalls.end(), drawOrder);
+    std::sort(arrayCalls.begin(), arrayCalls.end(), drawOrder);
 
-            // Bind the material
-            auto material = mesh.material.value_or(GLTexturedMaterial{});
-            _texturedUniforms.Set(material, _defaultTexture, _samplers);
+    std::vector<InstanceGroup> textureGroups;
+    std::vector<InstanceGroup> arrayGroups;
+    std::vector<size_t> textureSingles;
+    std::vector<size_t> arraySingles;
+    std::vector<glm::mat4> instanceWorlds;
+    GroupInstances(meshes, worlds, textureCalls, textureGroups, textureSingles, instanceWorlds);
+    GroupInstances(meshes, worlds, arrayCalls, arrayGroups, arraySingles, instanceWorlds);
 
-            // Bind the mesh
-            OKAMI_ERR_GL(glBindVertexArray(*mesh.geometry.vertexArray));
+    if (!instanceWorlds.empty()) {
+        // Orphans last frame's storage rather than waiting for its draws
+        OKAMI_ERR_GL(glBindBuffer(GL_ARRAY_BUFFER, *_instanceBuffer));
+        OKAMI_ERR_GL(glBufferData(GL_ARRAY_BUFFER, instanceWorlds.size() * sizeof(glm::mat4),
+            instanceWorlds.data(), GL_STREAM_DRAW));
+    }
 
-            GLenum topology = ToGL(mesh.geometry.desc.topology);
+    // Scratch space for meshlet draws, shared by all calls
+    std::vector<GLsizei> meshletCounts;
+    std::vector<void const*> meshletOffsets;
 
-            if (!mesh.geometry.desc.isIndexed) {
-                OKAMI_ERR_GL(glDrawArrays(topology, 0, mesh.geometry.desc.attribs.numVertices));
-            } else {
-                OKAMI_ERR_GL(glDrawElements(topology, mesh.geometry.desc.indexedAttribs.numIndices,
-                    ToGL(mesh.geometry.desc.indexedAttribs.indexType), nullptr));
+    auto drawInstanced = [&](GLStaticMeshProgram const& program, 
+        std::span<InstanceGroup const> groups) -> Error {
+        if (groups.empty()) {
+            return {};
+        }
+
+        OKAMI_ERR_GL(glUseProgram(*program.program));
+        program.cameraUniforms.Set(view, proj);
+
+        std::optional<std::pair<GLuint, SamplerType>> bound;
+        for (auto const& group : groups) {
+            auto const& mesh = meshes[group.call];
+            program.positionUniforms.Set(mesh.geometry.dequantization);
+            SetMaterial(program, mesh.material.value_or(GLTexturedMaterial{}),
+                _defaultTexture, _samplers, bound);
+
+            auto err = mesh.geometry.BindInstances(GetInstanceLayout(), 
+                _instanceBuffer, group.firstInstance * sizeof(glm::mat4));
+            if (err.IsOk()) {
+                err = DrawInstanced(mesh.geometry, static_cast<GLsizei>(group.instanceCount));
             }
-        } else {
-            PLOG_WARNING << "Vertex format is not PositionUV!";
+            err |= mesh.geometry.UnbindInstances(GetInstanceLayout());
+            OKAMI_ERR_RETURN(err);
         }
-    }
+        return {};
+    };
+
+    auto drawSingles = [&](GLStaticMeshProgram const& program,
+        std::span<size_t const> calls) -> Error {
+        if (calls.empty()) {
+            return {};
+        }
+
+        OKAMI_ERR_GL(glUseProgram(*program.program));
+        program.cameraUniforms.Set(view, proj);
+
+        std::optional<std::pair<GLuint, SamplerType>> bound;
+        for (auto i : calls) {
+            auto const& mesh = meshes[i];
+            program.worldUniforms.Set(worlds[i]);
+            program.positionUniforms.Set(mesh.geometry.dequantization);
+            SetMaterial(program, mesh.material.value_or(GLTexturedMaterial{}),
+                _defaultTexture, _samplers, bound);
+
+            auto err = DrawGeometry(mesh.geometry, view * worlds[i], proj, 
+                _meshletConeCulling, meshletCounts, meshletOffsets);
+            OKAMI_ERR_RETURN(err);
+        }
+        return {};
+    };
+
+    OKAMI_ERR_RETURN_IF_FAIL(drawInstanced(_instancedProgram, textureGroups));
+    OKAMI_ERR_RETURN_IF_FAIL(drawSingles(_renderProgram, textureSingles));
+    OKAMI_ERR_RETURN_IF_FAIL(drawInstanced(_instancedArrayProgram, arrayGroups));
+    OKAMI_ERR_RETURN_IF_FAIL(drawSingles(_arrayProgram, arraySingles));
 
     return {};
-}
\ No newline at end of file
+}
+
+std::vector<GLStaticMeshRenderCall> okami::CullOccluded(
+    std::span<GLStaticMeshRenderCall const> calls,
+    OcclusionBuffer const& buffer) {
+    std::vector<GLStaticMeshRenderCall> result;
+    result.reserve(calls.size());
+    for (auto const& call : calls) {
+        if (buffer.IsVisible(call.geometry.bounds, call.transform)) {
+            result.emplace_back(call);
+        }
+    }
+    return result;
+}
@@ -1,13 +1,69 @@
 #include <okami/ogl/texture.hpp>
 
+#include <algorithm>
+#include <cstring>
+
+// S3TC is an extension rather than core, RGTC and BPTC are core in 3.0
+// and 4.2 but widely available as extensions before that
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
 using namespace okami;
 using namespace okami::texture;
 
+namespace {
+    GLenum ToCompressedGL(texture::Format format) {
+        switch (format.compression) {
+            case Compression::BC1:
+                return format.isLinear ? 
+                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+            case Compression::BC3:
+                return format.isLinear ? 
+                    GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+            case Compression::BC4:
+                return GL_COMPRESSED_RED_RGTC1;
+            case Compression::BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            case Compression::BC7:
+                return format.isLinear ? 
+                    GL_COMPRESSED_RGBA_BPTC_UNORM : GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+            default:
+                return GL_INVALID_ENUM;
+        }
+    }
+}
+
 void okami::DestroyGLTexture(GLuint id) {
     glDeleteTextures(1, &id);
 }
 
 GLenum okami::ToGL(texture::Format format) {
+    if (format.IsCompressed()) {
+        return ToCompressedGL(format);
+    }
+
     switch (format.channels) {
         case 1:
             if (!format.isLinear) {
@@ -42,7 +98,7 @@ GLenum okami::ToGL(texture::Format format) {
                         return GL_R8I;
                     }
                 case ValueType::UINT8:
-                    return GL_R8UI;
+                    return format.isNormalized ? GL_R8 : GL_R8UI;
                 default:
                     return GL_INVALID_ENUM;
             }
@@ -77,18 +133,18 @@ GLenum okami::ToGL(texture::Format format) {
                         return GL_RG8I;
                     }
                 case ValueType::UINT8:
-                    return GL_RG8UI;
+                    return format.isNormalized ? GL_RG8 : GL_RG8UI;
                 default:
                     return GL_INVALID_ENUM;
             }
         case 3:
             if (format.valueType == ValueType::UINT8) {
                 if (format.isLinear) {
-                    return GL_RGB8UI;
+                    return format.isNormalized ? GL_RGB8 : GL_RGB8UI;
                 } else {
                     return GL_SRGB8;
                 }
-            } else if (format.isLinear) {
+            } else if (!format.isLinear) {
                 return GL_INVALID_ENUM;
             }
 
@@ -126,11 +182,11 @@ GLenum okami::ToGL(texture::Format format) {
         case 4:
             if (format.valueType == ValueType::UINT8) {
                 if (format.isLinear) {
-                    return GL_RGBA8UI;
+                    return format.isNormalized ? GL_RGBA8 : GL_RGBA8UI;
                 } else {
                     return GL_SRGB8_ALPHA8;
                 }
-            } else if (format.isLinear) {
+            } else if (!format.isLinear) {
                 return GL_INVALID_ENUM;
             }
 
@@ -171,16 +227,36 @@ GLenum okami::ToGL(texture::Format format) {
     return GL_INVALID_ENUM;
 }
 
+GLenum okami::ToGL(texture::Dimension dimension) {
+    switch (dimension) {
+        case Dimension::Texture2D:
+            return GL_TEXTURE_2D;
+        case Dimension::Texture2DArray:
+            return GL_TEXTURE_2D_ARRAY;
+        case Dimension::TextureCube:
+            return GL_TEXTURE_CUBE_MAP;
+        case Dimension::TextureCubeArray:
+            return GL_TEXTURE_CUBE_MAP_ARRAY;
+        default:
+            return GL_INVALID_ENUM;
+    }
+}
+
 GLenum okami::ToBaseFormatGL(texture::Format format) {
+    // Integer textures are read as is instead of normalized
+    bool isInteger = !format.isNormalized && 
+        format.valueType != ValueType::FLOAT32 && 
+        format.valueType != ValueType::FLOAT16;
+
     switch (format.channels) {
         case 1:
-            return GL_RED;
+            return isInteger ? GL_RED_INTEGER : GL_RED;
         case 2:
-            return GL_RG;
+            return isInteger ? GL_RG_INTEGER : GL_RG;
         case 3:
-            return GL_RGB;
+            return isInteger ? GL_RGB_INTEGER : GL_RGB;
         case 4:
-            return GL_RGBA;
+            return isInteger ? GL_RGBA_INTEGER : GL_RGBA;
         default:
             return GL_INVALID_ENUM;
     }
@@ -189,31 +265,172 @@ GLenum okami::ToBaseFormatGL(texture::Format format) {
 }
 
 Expected<GLTexture> GLTexture::Create(texture::Buffer const& buffer) {
+    Error err;
+    auto tex = OKAMI_EXP_UNWRAP(CreateStorage(buffer.desc), err);
+    err = tex.Upload(buffer);
+    OKAMI_EXP_RETURN(err);
+    return tex;
+}
+
+Expected<GLTexture> GLTexture::Create(texture::Buffer const& buffer, GLStagingRing& ring) {
+    Error err;
+    auto tex = OKAMI_EXP_UNWRAP(CreateStorage(buffer.desc), err);
+    err = tex.Upload(buffer, ring);
+    OKAMI_EXP_RETURN(err);
+    return tex;
+}
+
+Error GLTexture::Upload(texture::Buffer const& buffer, uint32_t firstSlice) const {
+    for (auto subresource : buffer.desc.GetSubresourceDescs()) {
+        auto data = &buffer.data[subresource.srcOffset];
+        subresource.slice += firstSlice;
+        OKAMI_ERR_RETURN_IF_FAIL(Upload(subresource, data));
+    }
+    return {};
+}
+
+Error GLTexture::Upload(texture::Buffer const& buffer, GLStagingRing& ring, uint32_t firstSlice) const {
+    Error err;
+
+    for (auto subresource : buffer.desc.GetSubresourceDescs()) {
+        auto source = std::span<uint8_t const>(&buffer.data[subresource.srcOffset], 
+            subresource.length);
+        subresource.slice += firstSlice;
+
+        // Mips that could never fit go straight from client memory
+        if (source.size() > ring.GetSize()) {
+            OKAMI_ERR_RETURN_IF_FAIL(Upload(subresource, source.data()));
+            continue;
+        }
+
+        auto allocation = OKAMI_ERR_UNWRAP(ring.Allocate(source.size()), err);
+        std::memcpy(allocation.memory.data(), source.data(), source.size());
+
+        OKAMI_ERR_RETURN_IF_FAIL(ring.Bind());
+        err = Upload(subresource, reinterpret_cast<void const*>(allocation.offset));
+        OKAMI_ERR_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        OKAMI_ERR_RETURN(err);
+
+        // Fenced one at a time, so a texture larger than the ring can wait
+        // on its own earlier mips to free space
+        OKAMI_ERR_RETURN_IF_FAIL(ring.Fence());
+    }
+
+    return {};
+}
+
+Expected<GLTexture> GLTexture::CreateStorage(texture::Desc const& desc) {
     GLTexture tex;
-    tex.desc = buffer.GetDesc();
+    tex.desc = desc;
 
-    OKAMI_EXP_RETURN_IF(buffer.desc.type != Dimension::Texture2D, 
-        RuntimeError{"Only 2D textures are currently supported!"});
+    auto target = ToGL(desc.type);
+    OKAMI_EXP_RETURN_IF(target == GL_INVALID_ENUM, 
+        RuntimeError{"Texture dimension is not supported!"});
+
+    auto internalFormat = ToGL(desc.format);
+    OKAMI_EXP_RETURN_IF(internalFormat == GL_INVALID_ENUM,
+        RuntimeError{"Texture format is not supported!"});
     
     OKAMI_EXP_GL(glGenTextures(1, &*tex));
-    OKAMI_EXP_GL(glBindTexture(GL_TEXTURE_2D, *tex));
+    OKAMI_EXP_GL(glBindTexture(target, *tex));
+
+    // Cube maps have six layers in the description, but only one in GL
+    bool isLayered = desc.type == Dimension::Texture2DArray || 
+        desc.type == Dimension::TextureCubeArray;
+    GLsizei mipCount = desc.GetMipCount();
 
-    // Get all the mips
-    for (auto const& subresource : tex.desc.GetSubresourceDescs()) {
-        int width = tex.desc.width >> subresource.mip;
-        int height = tex.desc.height >> subresource.mip;
+    if (GLCapabilities::Get().textureStorage) {
+        if (isLayered) {
+            OKAMI_EXP_GL(glTexStorage3D(target, mipCount, internalFormat, 
+                desc.width, desc.height, desc.arraySizeOrDepth));
+        } else {
+            OKAMI_EXP_GL(glTexStorage2D(target, mipCount, internalFormat, 
+                desc.width, desc.height));
+        }
+        return tex;
+    }
 
-        auto internalFormat = ToGL(tex.desc.format);
-        auto dataFormat = ToBaseFormatGL(tex.desc.format);
+    // Without immutable storage, allocate every mip and stop sampling
+    // from the ones that do not exist
+    for (GLsizei mip = 0; mip < mipCount; ++mip) {
+        GLsizei width = std::max(1u, desc.width >> mip);
+        GLsizei height = std::max(1u, desc.height >> mip);
+        GLsizei blocks = ((width + 3) / 4) * ((height + 3) / 4);
+        GLsizei compressedSize = blocks * desc.format.GetBlockByteSize();
+        auto dataFormat = ToBaseFormatGL(desc.format);
+        auto dataType = ToGL(desc.format.valueType);
 
-        OKAMI_EXP_GL(glTexImage2D(GL_TEXTURE_2D, subresource.mip, internalFormat, 
-            width, height, 0, dataFormat, ToGL(tex.desc.format.valueType), 
-            &buffer.data[subresource.srcOffset]));
+        if (isLayered) {
+            GLsizei layers = desc.arraySizeOrDepth;
+            if (desc.format.IsCompressed()) {
+                OKAMI_EXP_GL(glCompressedTexImage3D(target, mip, internalFormat, 
+                    width, height, layers, 0, compressedSize * layers, nullptr));
+            } else {
+                OKAMI_EXP_GL(glTexImage3D(target, mip, internalFormat, 
+                    width, height, layers, 0, dataFormat, dataType, nullptr));
+            }
+            continue;
+        }
+
+        GLsizei faceCount = desc.type == Dimension::TextureCube ? 6 : 1;
+        for (GLsizei face = 0; face < faceCount; ++face) {
+            GLenum faceTarget = faceCount == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            if (desc.format.IsCompressed()) {
+                OKAMI_EXP_GL(glCompressedTexImage2D(faceTarget, mip, internalFormat, 
+                    width, height, 0, compressedSize, nullptr));
+            } else {
+                OKAMI_EXP_GL(glTexImage2D(faceTarget, mip, internalFormat, 
+                    width, height, 0, dataFormat, dataType, nullptr));
+            }
+        }
     }
+    OKAMI_EXP_GL(glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, mipCount - 1));
 
     return tex;
 }
 
+Error GLTexture::Upload(texture::SubResDataDesc const& subresource, void const* data) const {
+    GLsizei width = std::max(1u, desc.width >> subresource.mip);
+    GLsizei height = std::max(1u, desc.height >> subresource.mip);
+    auto target = ToGL(desc.type);
+    auto internalFormat = ToGL(desc.format);
+    auto dataFormat = ToBaseFormatGL(desc.format);
+    auto dataType = ToGL(desc.format.valueType);
+    GLsizei length = (GLsizei)subresource.length;
+
+    OKAMI_ERR_GL(glBindTexture(target, id));
+    // Rows are tightly packed
+    OKAMI_ERR_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    switch (desc.type) {
+        case Dimension::Texture2DArray:
+        case Dimension::TextureCubeArray:
+            // Layers of cube map arrays count faces, as slices do
+            if (desc.format.IsCompressed()) {
+                OKAMI_ERR_GL(glCompressedTexSubImage3D(target, subresource.mip, 
+                    0, 0, subresource.slice, width, height, 1, internalFormat, length, data));
+            } else {
+                OKAMI_ERR_GL(glTexSubImage3D(target, subresource.mip, 
+                    0, 0, subresource.slice, width, height, 1, dataFormat, dataType, data));
+            }
+            break;
+        default: {
+            GLenum faceTarget = desc.type == Dimension::TextureCube ?
+                GL_TEXTURE_CUBE_MAP_POSITIVE_X + subresource.slice : target;
+            if (desc.format.IsCompressed()) {
+                OKAMI_ERR_GL(glCompressedTexSubImage2D(faceTarget, subresource.mip, 
+                    0, 0, width, height, internalFormat, length, data));
+            } else {
+                OKAMI_ERR_GL(glTexSubImage2D(faceTarget, subresource.mip, 
+                    0, 0, width, height, dataFormat, dataType, data));
+            }
+            break;
+        }
+    }
+
+    return {};
+}
+
 Expected<GLTexture> GLTexture::Create(texture::Buffer&& buffer) {
     return Create(buffer);
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include <okami/ogl/texture_atlas.hpp>
+
+#include <algorithm>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    bool IsSameLayout(Desc const& page, Desc const& desc) {
+        return page.width == desc.width &&
+            page.height == desc.height &&
+            page.GetMipCount() == desc.GetMipCount() &&
+            page.format == desc.format;
+    }
+}
+
+GLTextureAtlas::GLTextureAtlas(uint32_t pageLayers, size_t pageBytes) :
+    _pageLayers(pageLayers),
+    _pageBytes(pageBytes) {
+}
+
+Expected<GLTextureAtlas::Page*> GLTextureAtlas::FindOrCreatePage(Desc const& desc) {
+    OKAMI_EXP_RETURN_IF(desc.type != Dimension::Texture2D,
+        RuntimeError{"Only 2D textures can be added to an atlas!"});
+
+    for (auto& page : _pages) {
+        if (!page->freeLayers.empty() && IsSameLayout(page->texture.desc, desc)) {
+            return page.get();
+        }
+    }
+
+    GLint maxLayers = 0;
+    OKAMI_EXP_GL(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+    uint64_t layerBytes = std::max<uint64_t>(desc.GetByteSize(), 1u);
+    uint64_t budgetLayers = std::max<uint64_t>(_pageBytes / layerBytes, 1u);
+    uint32_t layers = (uint32_t)std::clamp<uint64_t>(budgetLayers, 1u,
+        std::min<uint64_t>(std::max(_pageLayers, 1u), std::max<GLint>(maxLayers, 1)));
+
+    Desc pageDesc = desc;
+    pageDesc.type = Dimension::Texture2DArray;
+    pageDesc.arraySizeOrDepth = layers;
+    pageDesc.mipLevels = desc.GetMipCount();
+
+    Error err;
+    auto texture = OKAMI_EXP_UNWRAP(GLTexture::CreateStorage(pageDesc), err);
+
+    auto page = std::make_unique<Page>();
+    page->texture = std::move(texture);
+    // Hand out the lowest layers first
+    page->freeLayers.reserve(layers);
+    for (uint32_t layer = layers; layer > 0; --layer) {
+        page->freeLayers.push_back(layer - 1);
+    }
+
+    _pages.emplace_back(std::move(page));
+    return _pages.back().get();
+}
+
+Expected<GLAtlasEntry> GLTextureAtlas::Add(Buffer const& buffer) {
+    Error err;
+    auto page = OKAMI_EXP_UNWRAP(FindOrCreatePage(buffer.desc), err);
+
+    uint32_t layer = page->freeLayers.back();
+    err = page->texture.Upload(buffer, layer);
+    OKAMI_EXP_RETURN(err);
+
+    page->freeLayers.pop_back();
+    return GLAtlasEntry{&page->texture, layer};
+}
+
+Expected<GLAtlasEntry> GLTextureAtlas::Add(Buffer const& buffer, GLStagingRing& ring) {
+    Error err;
+    auto page = OKAMI_EXP_UNWRAP(FindOrCreatePage(buffer.desc), err);
+
+    uint32_t layer = page->freeLayers.back();
+    err = page->texture.Upload(buffer, ring, layer);
+    OKAMI_EXP_RETURN(err);
+
+    page->freeLayers.pop_back();
+    return GLAtlasEntry{&page->texture, layer};
+}
+
+void GLTextureAtlas::Remove(GLAtlasEntry const& entry) {
+    for (auto& page : _pages) {
+        if (&page->texture == entry.texture) {
+            page->freeLayers.push_back(entry.layer);
+            return;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include <okami/ogl/texture_loader.hpp>
+
+#include <plog/Log.h>
+
+using namespace okami;
+
+GLTextureLoader::GLTextureLoader(ThreadPool& pool) :
+    _pool(&pool),
+    _queue(std::make_shared<CompletionQueue>()) {
+}
+
+GLTexture const& GLTextureLoader::Load(std::filesystem::path const& path,
+    texture::LoadParams const& params) {
+    auto key = path.string();
+    if (auto it = _slots.find(key); it != _slots.end()) {
+        return _textures[it->second];
+    }
+
+    size_t slot = _textures.size();
+    _textures.emplace_back();
+    _slots.emplace(key, slot);
+    ++_pendingCount;
+
+    _pool->Submit([queue = _queue, slot, path, params]() {
+        Expected<texture::Buffer> buffer;
+        try {
+            buffer = texture::Load(path, params);
+        } catch (std::exception const& e) {
+            PLOG_ERROR << path << ": " << e.what();
+            buffer = MakeUnexpected(OKAMI_ERR_MAKE(RuntimeError{"Failed to decode texture!"}));
+        }
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->completed.emplace_back(Completed{slot, std::move(buffer)});
+    });
+
+    return _textures[slot];
+}
+
+Error GLTextureLoader::Update(size_t budget) {
+    Error err;
+    size_t uploaded = 0;
+
+    if (!_stagingRing && !_stagingRingFailed) {
+        auto ring = GLStagingRing::Create();
+        if (ring) {
+            _stagingRing.emplace(std::move(*ring));
+        } else {
+            PLOG_WARNING << "Uploading textures without a staging ring: " << ring.error();
+            _stagingRingFailed = true;
+        }
+    }
+
+    while (uploaded == 0 || uploaded < budget) {
+        std::optional<Completed> completed;
+        {
+            std::lock_guard<std::mutex> lock(_queue->mutex);
+            if (_queue->completed.empty()) {
+                break;
+            }
+            completed.emplace(std::move(_queue->completed.front()));
+            _queue->completed.pop_front();
+        }
+        --_pendingCount;
+
+        // A texture that fails to load keeps rendering as the default
+        if (!completed->buffer) {
+            PLOG_WARNING << "Failed to load texture: " << completed->buffer.error();
+            continue;
+        }
+
+        uploaded += std::max<size_t>(1u, completed->buffer->data.size());
+
+        auto texture = _stagingRing ?
+            GLTexture::Create(*completed->buffer, *_stagingRing) :
+            GLTexture::Create(*completed->buffer);
+        if (!texture) {
+            err += MakeError(texture);
+            continue;
+        }
+        _textures[completed->slot] = std::move(*texture);
+    }
+
+    return err;
+}
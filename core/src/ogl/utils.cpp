@@ -5,6 +5,28 @@
 
 using namespace okami;
 
+namespace {
+    bool HasGLExtension(std::string_view name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            auto extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && name == extension) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsGLVersionAtLeast(GLint major, GLint minor) {
+        GLint contextMajor = 0;
+        GLint contextMinor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+}
+
 void okami::DestroyGLShader(GLuint id) {
     glDeleteShader(id);
 }
@@ -25,12 +47,44 @@ void okami::DestroyGLSampler(GLuint id) {
     glDeleteSamplers(1, &id);
 }
 
+void okami::DestroyGLFramebuffer(GLuint id) {
+    glDeleteFramebuffers(1, &id);
+}
+
+void okami::DestroyGLRenderbuffer(GLuint id) {
+    glDeleteRenderbuffers(1, &id);
+}
+
+GLCapabilities const& okami::GLCapabilities::Get() {
+    static GLCapabilities capabilities = []() {
+        GLCapabilities result;
+        result.bufferStorage = IsGLVersionAtLeast(4, 4) || 
+            HasGLExtension("GL_ARB_buffer_storage");
+        result.textureStorage = IsGLVersionAtLeast(4, 2) || 
+            HasGLExtension("GL_ARB_texture_storage");
+        return result;
+    }();
+    return capabilities;
+}
+
 Expected<GLBuffer> okami::GLBuffer::Create(BufferData const& buffer) {
+    return Create(std::span<uint8_t const>(buffer.bytes));
+}
+
+Expected<GLBuffer> okami::GLBuffer::Create(std::span<uint8_t const> bytes) {
     GLBuffer result;
     OKAMI_EXP_GL(glGenBuffers(1, &*result));
     OKAMI_EXP_GL(glBindBuffer(GL_ARRAY_BUFFER, *result));
     OKAMI_EXP_GL(glBufferData(GL_ARRAY_BUFFER, 
-        buffer.size(), buffer.vdata(), GL_STATIC_READ));
+        bytes.size(), bytes.data(), GL_STATIC_READ));
+    return result;
+}
+
+Expected<GLBuffer> okami::GLBuffer::Create(size_t size) {
+    GLBuffer result;
+    OKAMI_EXP_GL(glGenBuffers(1, &*result));
+    OKAMI_EXP_GL(glBindBuffer(GL_ARRAY_BUFFER, *result));
+    OKAMI_EXP_GL(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW));
     return result;
 }
 
@@ -49,7 +103,7 @@ GLenum okami::ToGL(ValueType valueType) {
         case ValueType::INT8:
             return GL_BYTE;
         case ValueType::UINT16:
-            return GL_UNSIGNED_INT;
+            return GL_UNSIGNED_SHORT;
         case ValueType::UINT8:
             return GL_UNSIGNED_BYTE;
         case ValueType::NULL_T:
@@ -0,0 +1,332 @@
+#include <okami/ogl/virtual_texture.hpp>
+
+#include <plog/Log.h>
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    // Texture units the virtual texture is bound to
+    constexpr GLint kPhysicalUnit = 0;
+    constexpr GLint kIndirectionUnit = 1;
+}
+
+Expected<GLVirtualTextureUniformBlock> GLVirtualTextureUniformBlock::Create(GLProgram const& program) {
+    GLVirtualTextureUniformBlock block;
+    // The feedback pass samples neither
+    block.uVirtualPhysical = program.GetUniformLocation("uVirtualPhysical").value_or(-1);
+    block.uVirtualIndirection = program.GetUniformLocation("uVirtualIndirection").value_or(-1);
+    block.uVirtualSize = UnwrapAndWarn(program.GetUniformLocation("uVirtualSize"), -1);
+    block.uVirtualMipCount = UnwrapAndWarn(program.GetUniformLocation("uVirtualMipCount"), -1);
+    block.uVirtualMipBias = UnwrapAndWarn(program.GetUniformLocation("uVirtualMipBias"), -1);
+    return block;
+}
+
+Error GLVirtualTexture::Update(std::span<uint32_t const> feedback, size_t maxUploads) {
+    _pageTable.BeginFrame();
+    _pageTable.Request(feedback);
+
+    auto tileDesc = _file.GetDesc().GetTileDesc();
+    auto tileSubresource = tileDesc.GetSubresourceDescs().front();
+
+    for (auto const& tile : _pageTable.GetMissing(maxUploads)) {
+        auto slot = _pageTable.Insert(tile);
+        if (!slot) {
+            // Every slot holds a tile that is on screen
+            break;
+        }
+
+        auto subresource = tileSubresource;
+        subresource.slice = *slot;
+        auto err = _physical.Upload(subresource, _file.GetTile(tile).data());
+        OKAMI_ERR_RETURN(err);
+    }
+
+    if (_pageTable.IsDirty()) {
+        _pageTable.BuildIndirection(_indirectionData);
+        auto err = _indirection.Upload(_indirectionData);
+        OKAMI_ERR_RETURN(err);
+    }
+
+    return {};
+}
+
+void GLVirtualTexture::Bind(GLVirtualTextureUniformBlock const& uniforms,
+    GLDefaultSamplers const& samplers,
+    float mipBias) const {
+    auto const& desc = _file.GetDesc();
+
+    glActiveTexture(GL_TEXTURE0 + kPhysicalUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *_physical);
+    glBindSampler(kPhysicalUnit, *samplers.Select(SamplerType::LINEAR_CLAMP));
+
+    // Integer textures are fetched without a sampler
+    glActiveTexture(GL_TEXTURE0 + kIndirectionUnit);
+    glBindTexture(GL_TEXTURE_2D, *_indirection);
+    glBindSampler(kIndirectionUnit, 0);
+
+    glUniform1i(uniforms.uVirtualPhysical, kPhysicalUnit);
+    glUniform1i(uniforms.uVirtualIndirection, kIndirectionUnit);
+    glUniform2f(uniforms.uVirtualSize, (float)desc.width, (float)desc.height);
+    glUniform1f(uniforms.uVirtualMipCount, (float)desc.mipLevels);
+    glUniform1f(uniforms.uVirtualMipBias, mipBias);
+}
+
+Expected<GLVirtualTexture> GLVirtualTexture::Create(std::filesystem::path const& path,
+    uint32_t slotCount) {
+    Error err;
+    GLVirtualTexture result;
+    result._file = OKAMI_EXP_UNWRAP(VirtualTextureFile::Open(path), err);
+    auto const& desc = result._file.GetDesc();
+
+    GLint maxLayers = 0;
+    OKAMI_EXP_GL(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+    slotCount = std::min<uint32_t>(slotCount, std::max<GLint>(maxLayers, 1));
+
+    try {
+        result._pageTable = VirtualPageTable(desc, slotCount);
+    } catch (std::exception const& e) {
+        PLOG_ERROR << path << ": " << e.what();
+        return MakeUnexpected(OKAMI_ERR_MAKE(RuntimeError{"Virtual texture cache is too small!"}));
+    }
+
+    auto physicalDesc = desc.GetTileDesc();
+    physicalDesc.type = Dimension::Texture2DArray;
+    physicalDesc.arraySizeOrDepth = slotCount;
+    result._physical = OKAMI_EXP_UNWRAP(GLTexture::CreateStorage(physicalDesc), err);
+
+    result._indirection = OKAMI_EXP_UNWRAP(GLTexture::CreateStorage(desc.GetIndirectionDesc()), err);
+    OKAMI_EXP_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST));
+    OKAMI_EXP_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+
+    // Upload an empty indirection, the coarsest mip arrives on the first Update
+    result._pageTable.BuildIndirection(result._indirectionData);
+    err = result._indirection.Upload(result._indirectionData);
+    OKAMI_EXP_RETURN(err);
+
+    return result;
+}
+
+GLVirtualTextureFeedback::GLVirtualTextureFeedback(GLVirtualTextureFeedback&& other) noexcept {
+    *this = std::move(other);
+}
+
+GLVirtualTextureFeedback& GLVirtualTextureFeedback::operator=(GLVirtualTextureFeedback&& other) noexcept {
+    for (auto fence : _fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    _framebuffer = std::move(other._framebuffer);
+    _target = std::move(other._target);
+    _depth = std::move(other._depth);
+    _readbacks = std::move(other._readbacks);
+    _fences = std::exchange(other._fences, {});
+    _nextReadback = std::exchange(other._nextReadback, 0);
+    _width = std::exchange(other._width, 0);
+    _height = std::exchange(other._height, 0);
+    return *this;
+}
+
+GLVirtualTextureFeedback::~GLVirtualTextureFeedback() {
+    for (auto fence : _fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+}
+
+float GLVirtualTextureFeedback::GetMipBias(uint32_t viewWidth) const {
+    // Derivatives grow with the downscale, so the mip has to come down
+    return -std::log2((float)viewWidth / (float)std::max(_width, 1u));
+}
+
+Error GLVirtualTextureFeedback::Begin() {
+    OKAMI_ERR_GL(glBindFramebuffer(GL_FRAMEBUFFER, *_framebuffer));
+    OKAMI_ERR_GL(glViewport(0, 0, _width, _height));
+
+    GLuint const noRequest[4] = {0, 0, 0, 0};
+    OKAMI_ERR_GL(glClearBufferuiv(GL_COLOR, 0, noRequest));
+    OKAMI_ERR_GL(glClear(GL_DEPTH_BUFFER_BIT));
+    return {};
+}
+
+Error GLVirtualTextureFeedback::End() {
+    auto& fence = _fences[_nextReadback];
+    if (fence) {
+        // Never read, the next one replaces it
+        glDeleteSync(fence);
+    }
+
+    OKAMI_ERR_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, *_readbacks[_nextReadback]));
+    OKAMI_ERR_GL(glReadBuffer(GL_COLOR_ATTACHMENT0));
+    OKAMI_ERR_GL(glReadPixels(0, 0, _width, _height, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+    OKAMI_ERR_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _nextReadback = (_nextReadback + 1) % _readbacks.size();
+    OKAMI_ERR_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    return {};
+}
+
+Expected<bool> GLVirtualTextureFeedback::Read(std::vector<uint32_t>& feedback) {
+    // The readback after the one just issued is the oldest
+    for (size_t i = 0; i < _readbacks.size(); ++i) {
+        auto index = (_nextReadback + i) % _readbacks.size();
+        auto& fence = _fences[index];
+        if (!fence) {
+            continue;
+        }
+
+        auto status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+        OKAMI_EXP_RETURN_IF(status == GL_WAIT_FAILED, RuntimeError{"Failed to wait on feedback!"});
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        size_t size = (size_t)_width * _height * sizeof(uint32_t);
+        feedback.resize((size_t)_width * _height);
+        OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, *_readbacks[index]));
+        auto mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (mapped) {
+            std::memcpy(feedback.data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        OKAMI_EXP_RETURN_IF(!mapped, RuntimeError{"Failed to map feedback!"});
+        return true;
+    }
+
+    return false;
+}
+
+Expected<GLVirtualTextureFeedback> GLVirtualTextureFeedback::Create(uint32_t width, uint32_t height) {
+    Error err;
+    GLVirtualTextureFeedback result;
+    result._width = width;
+    result._height = height;
+
+    Desc targetDesc;
+    targetDesc.type = Dimension::Texture2D;
+    targetDesc.width = width;
+    targetDesc.height = height;
+    targetDesc.format = Format::R32_UINT();
+    result._target = OKAMI_EXP_UNWRAP(GLTexture::CreateStorage(targetDesc), err);
+    OKAMI_EXP_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    OKAMI_EXP_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+
+    OKAMI_EXP_GL(glGenRenderbuffers(1, &*result._depth));
+    OKAMI_EXP_GL(glBindRenderbuffer(GL_RENDERBUFFER, *result._depth));
+    OKAMI_EXP_GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+
+    OKAMI_EXP_GL(glGenFramebuffers(1, &*result._framebuffer));
+    OKAMI_EXP_GL(glBindFramebuffer(GL_FRAMEBUFFER, *result._framebuffer));
+    OKAMI_EXP_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_TEXTURE_2D, *result._target, 0));
+    OKAMI_EXP_GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        GL_RENDERBUFFER, *result._depth));
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    OKAMI_EXP_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    OKAMI_EXP_RETURN_IF(status != GL_FRAMEBUFFER_COMPLETE,
+        RuntimeError{"Feedback framebuffer is incomplete!"});
+
+    for (auto& readback : result._readbacks) {
+        OKAMI_EXP_GL(glGenBuffers(1, &*readback));
+        OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, *readback));
+        OKAMI_EXP_GL(glBufferData(GL_PIXEL_PACK_BUFFER,
+            (size_t)width * height * sizeof(uint32_t), nullptr, GL_STREAM_READ));
+    }
+    OKAMI_EXP_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    return result;
+}
+
+Expected<GLVirtualTextureRenderer::Program> GLVirtualTextureRenderer::Program::Create(
+    ShaderPreprocessorConfig const& fsConfig) {
+    Error err;
+    Program result;
+
+    auto vs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("staticmesh.vs", GL_VERTEX_SHADER, {}), err);
+    auto fs = OKAMI_EXP_UNWRAP(LoadEmbeddedGLShader("virtual_texture.fs", GL_FRAGMENT_SHADER, fsConfig), err);
+
+    result.program = OKAMI_EXP_UNWRAP(CreateProgram(std::array{*vs, *fs}), err);
+    result.cameraUniforms = OKAMI_EXP_UNWRAP(GLCameraUniformBlock::Create(result.program), err);
+    result.worldUniforms = OKAMI_EXP_UNWRAP(GLWorldUniformBlock::Create(result.program), err);
+    result.positionUniforms = OKAMI_EXP_UNWRAP(GLPositionUniformBlock::Create(result.program), err);
+    result.virtualUniforms = OKAMI_EXP_UNWRAP(GLVirtualTextureUniformBlock::Create(result.program), err);
+    // The feedback pass has no color
+    result.uColor = result.program.GetUniformLocation("uColor").value_or(-1);
+
+    return result;
+}
+
+Expected<GLVirtualTextureRenderer> GLVirtualTextureRenderer::Create() {
+    Error err;
+    GLVirtualTextureRenderer result;
+
+    result._colorProgram = OKAMI_EXP_UNWRAP(Program::Create({}), err);
+    result._feedbackProgram = OKAMI_EXP_UNWRAP(Program::Create(
+        ShaderPreprocessorConfig{ .defines = {{"FEEDBACK", ""}} }), err);
+    result._samplers = OKAMI_EXP_UNWRAP(GLDefaultSamplers::Create(), err);
+
+    return result;
+}
+
+Error GLVirtualTextureRenderer::Draw(Program const& program,
+    RenderView const& camera,
+    std::span<GLVirtualTextureRenderCall const> calls,
+    float mipBias) const {
+    OKAMI_ERR_GL(glUseProgram(*program.program));
+    program.cameraUniforms.Set(camera.GetViewMatrix(), camera.GetProjMatrix());
+
+    std::vector<WorldTransform> transforms;
+    transforms.reserve(calls.size());
+    for (auto const& call : calls) {
+        transforms.emplace_back(call.transform);
+    }
+    std::vector<glm::mat4> worlds(calls.size());
+    ToRelativeMatrices(transforms, camera.origin, worlds);
+
+    GLVirtualTexture const* bound = nullptr;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        auto const& call = calls[i];
+        program.worldUniforms.Set(worlds[i]);
+        program.positionUniforms.Set(call.geometry.dequantization);
+        glUniform4fv(program.uColor, 1, &call.color[0]);
+
+        if (bound != &call.texture) {
+            call.texture.Bind(program.virtualUniforms, _samplers, mipBias);
+            bound = &call.texture;
+        }
+
+        OKAMI_ERR_GL(glBindVertexArray(*call.geometry.vertexArray));
+        GLenum topology = ToGL(call.geometry.desc.topology);
+        if (call.geometry.desc.isIndexed) {
+            OKAMI_ERR_GL(glDrawElements(topology, call.geometry.desc.indexedAttribs.numIndices,
+                ToGL(call.geometry.desc.indexedAttribs.indexType), nullptr));
+        } else {
+            OKAMI_ERR_GL(glDrawArrays(topology, 0, call.geometry.desc.attribs.numVertices));
+        }
+    }
+
+    return {};
+}
+
+Error GLVirtualTextureRenderer::Draw(RenderView const& camera,
+    std::span<GLVirtualTextureRenderCall const> calls) const {
+    return Draw(_colorProgram, camera, calls, 0.0f);
+}
+
+Error GLVirtualTextureRenderer::DrawFeedback(RenderView const& camera,
+    std::span<GLVirtualTextureRenderCall const> calls,
+    GLVirtualTextureFeedback const& feedback,
+    uint32_t viewWidth) const {
+    return Draw(_feedbackProgram, camera, calls, feedback.GetMipBias(viewWidth));
+}
@@ -0,0 +1,111 @@
+#include <okami/embed.hpp>
+#include <okami/geometry.hpp>
+#include <okami/mesh_file.hpp>
+
+#include <sstream>
+
+using namespace okami;
+using namespace okami::geometry;
+
+// Generated by embedfile from embed/meshes
+void MakePrefabMeshMap(file_map_t&);
+
+namespace {
+    EmbeddedFileLoader const& GetPrefabMeshes() {
+        static EmbeddedFileLoader loader{&MakePrefabMeshMap};
+        return loader;
+    }
+
+    std::string_view GetFormatName(VertexFormat format) {
+        switch (format) {
+            case VertexFormat::Position:
+                return "Position";
+            case VertexFormat::PositionColor:
+                return "PositionColor";
+            case VertexFormat::PositionUV:
+                return "PositionUV";
+            case VertexFormat::PositionUVNormal:
+                return "PositionUVNormal";
+            case VertexFormat::PositionUVNormalTangent:
+                return "PositionUVNormalTangent";
+            case VertexFormat::PositionUVNormalTangentBitangent:
+                return "PositionUVNormalTangentBitangent";
+            case VertexFormat::PositionUVCompact:
+                return "PositionUVCompact";
+            case VertexFormat::PositionUVNormalTangentCompact:
+                return "PositionUVNormalTangentCompact";
+            default:
+                return "Custom";
+        }
+    }
+
+    MeshFile OpenOrThrow(std::string_view prefab, VertexFormat format) {
+        auto file = prefabs::OpenPrefabMesh(prefab, format);
+        if (!file) {
+            throw std::runtime_error("Failed to open embedded prefab mesh!");
+        }
+        return std::move(*file);
+    }
+
+    Geometry LoadPrefab(std::string_view prefab, const VertexFormatInfo& layout) {
+        // Baked layouts only need copying out of the binary
+        if (layout.formatTag != VertexFormat::Custom) {
+            for (auto format : prefabs::kPrefabMeshFormats) {
+                if (format == layout.formatTag) {
+                    return OpenOrThrow(prefab, format).ToGeometry();
+                }
+            }
+        }
+
+        auto master = OpenOrThrow(prefab, prefabs::kPrefabMeshFormats[0]).ToGeometry();
+        return std::move(master).ToLayout(layout);
+    }
+}
+
+std::string okami::geometry::prefabs::GetPrefabMeshName(
+    std::string_view prefab, VertexFormat format) {
+    std::stringstream ss;
+    ss << prefab << "." << GetFormatName(format) << kMeshFileExtension;
+    return ss.str();
+}
+
+Expected<MeshFile> okami::geometry::prefabs::OpenPrefabMesh(
+    std::string_view prefab, VertexFormat format) {
+    Error err;
+    auto contents = OKAMI_EXP_UNWRAP(
+        GetPrefabMeshes().Find(GetPrefabMeshName(prefab, format)), err);
+    return MeshFile::Parse(std::span<uint8_t const>(
+        reinterpret_cast<uint8_t const*>(contents.data()), contents.size()));
+}
+
+Geometry okami::geometry::prefabs::MaterialBall(const VertexFormatInfo& layout) {
+    return LoadPrefab("matball", layout);
+}
+
+Geometry okami::geometry::prefabs::UnitBox(const VertexFormatInfo& layout) {
+    return LoadPrefab("box", layout);
+}
+
+Geometry okami::geometry::prefabs::UnitSphere(const VertexFormatInfo& layout) {
+    return LoadPrefab("sphere", layout);
+}
+
+Geometry okami::geometry::prefabs::BlenderMonkey(const VertexFormatInfo& layout) {
+    return LoadPrefab("monkey", layout);
+}
+
+Geometry okami::geometry::prefabs::Torus(const VertexFormatInfo& layout) {
+    return LoadPrefab("torus", layout);
+}
+
+Geometry okami::geometry::prefabs::Plane(const VertexFormatInfo& layout) {
+    return LoadPrefab("plane", layout);
+}
+
+Geometry okami::geometry::prefabs::StanfordBunny(const VertexFormatInfo& layout) {
+    return LoadPrefab("bunny", layout);
+}
+
+Geometry okami::geometry::prefabs::UtahTeapot(const VertexFormatInfo& layout) {
+    return LoadPrefab("teapot", layout);
+}
@@ -0,0 +1,371 @@
+#include <okami/raycast.hpp>
+#include <okami/simd.hpp>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace {
+    constexpr uint32_t kNoTriangle = std::numeric_limits<uint32_t>::max();
+    constexpr size_t kMaxDepth = 64;
+
+    struct BuildContext {
+        std::span<glm::vec3 const> positions;
+        std::span<uint32_t const> indices;
+        std::vector<uint32_t> order;
+        std::vector<glm::vec3> centroids;
+        std::vector<BVH::Node>& nodes;
+        std::vector<BVH::TriangleBlock>& blocks;
+
+        glm::vec3 const& Vertex(uint32_t triangle, int corner) const {
+            return positions[indices[3 * triangle + corner]];
+        }
+    };
+
+    void Grow(BoundingBox& box, glm::vec3 const& p) {
+        box.mLower = glm::min(box.mLower, p);
+        box.mUpper = glm::max(box.mUpper, p);
+    }
+
+    BoundingBox EmptyBox() {
+        return BoundingBox{
+            glm::vec3(std::numeric_limits<float>::infinity()),
+            glm::vec3(-std::numeric_limits<float>::infinity())};
+    }
+
+    uint32_t BuildNode(BuildContext& ctx, size_t begin, size_t end) {
+        auto nodeIndex = static_cast<uint32_t>(ctx.nodes.size());
+        ctx.nodes.emplace_back();
+
+        auto bounds = EmptyBox();
+        auto centroidBounds = EmptyBox();
+        for (size_t i = begin; i < end; ++i) {
+            auto triangle = ctx.order[i];
+            for (int corner = 0; corner < 3; ++corner) {
+                Grow(bounds, ctx.Vertex(triangle, corner));
+            }
+            Grow(centroidBounds, ctx.centroids[triangle]);
+        }
+        ctx.nodes[nodeIndex].bounds = bounds;
+
+        auto extent = centroidBounds.mUpper - centroidBounds.mLower;
+        int axis = 0;
+        if (extent.y > extent[axis]) {
+            axis = 1;
+        }
+        if (extent.z > extent[axis]) {
+            axis = 2;
+        }
+
+        // Split at the centroid median along the longest axis. Halving the
+        // range keeps the depth logarithmic, well below kMaxDepth.
+        size_t count = end - begin;
+        if (count > BVH::kLeafSize) {
+            size_t mid = begin + count / 2;
+            std::nth_element(
+                ctx.order.begin() + begin,
+                ctx.order.begin() + mid,
+                ctx.order.begin() + end,
+                [&ctx, axis](uint32_t a, uint32_t b) {
+                    return ctx.centroids[a][axis] < ctx.centroids[b][axis];
+                });
+
+            BuildNode(ctx, begin, mid);
+            auto second = BuildNode(ctx, mid, end);
+            ctx.nodes[nodeIndex].index = second;
+            ctx.nodes[nodeIndex].triangleCount = 0;
+            return nodeIndex;
+        }
+
+        // Padding lanes get zero edges, which never produce a hit
+        BVH::TriangleBlock block{};
+        for (uint32_t lane = 0; lane < BVH::kLeafSize; ++lane) {
+            block.triangles[lane] = kNoTriangle;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            auto lane = i - begin;
+            auto triangle = ctx.order[i];
+            auto const& v0 = ctx.Vertex(triangle, 0);
+            auto e1 = ctx.Vertex(triangle, 1) - v0;
+            auto e2 = ctx.Vertex(triangle, 2) - v0;
+            for (int c = 0; c < 3; ++c) {
+                block.v0[c][lane] = v0[c];
+                block.e1[c][lane] = e1[c];
+                block.e2[c][lane] = e2[c];
+            }
+            block.triangles[lane] = triangle;
+        }
+
+        ctx.nodes[nodeIndex].index = static_cast<uint32_t>(ctx.blocks.size());
+        ctx.nodes[nodeIndex].triangleCount = static_cast<uint32_t>(count);
+        ctx.blocks.emplace_back(block);
+        return nodeIndex;
+    }
+
+    // Returns the entry distance, or infinity on a miss
+    float IntersectBox(BoundingBox const& box,
+        Ray const& ray,
+        glm::vec3 const& invDirection,
+        float maxDistance) {
+        auto t0 = (box.mLower - ray.origin) * invDirection;
+        auto t1 = (box.mUpper - ray.origin) * invDirection;
+        auto tNear = glm::min(t0, t1);
+        auto tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+    }
+
+    // Moller-Trumbore against the four triangles of a block. Updates hit
+    // and returns true if any of them is closer than hit.distance.
+    bool IntersectBlock(BVH::TriangleBlock const& block, Ray const& ray, RayHit& hit) {
+        float t[BVH::kLeafSize];
+        float u[BVH::kLeafSize];
+        float v[BVH::kLeafSize];
+        int mask = 0;
+
+#if OKAMI_SIMD_SSE2
+        auto const zero = _mm_setzero_ps();
+        auto const one = _mm_set1_ps(1.0f);
+
+        auto dx = _mm_set1_ps(ray.direction.x);
+        auto dy = _mm_set1_ps(ray.direction.y);
+        auto dz = _mm_set1_ps(ray.direction.z);
+
+        auto e1x = _mm_loadu_ps(block.e1[0]);
+        auto e1y = _mm_loadu_ps(block.e1[1]);
+        auto e1z = _mm_loadu_ps(block.e1[2]);
+        auto e2x = _mm_loadu_ps(block.e2[0]);
+        auto e2y = _mm_loadu_ps(block.e2[1]);
+        auto e2z = _mm_loadu_ps(block.e2[2]);
+
+        // p = d x e2
+        auto px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        auto py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        auto pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+        auto det = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        auto invDet = _mm_div_ps(one, det);
+
+        // s = o - v0
+        auto sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(block.v0[0]));
+        auto sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(block.v0[1]));
+        auto sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(block.v0[2]));
+
+        auto uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+        // q = s x e1
+        auto qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        auto qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        auto qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+        auto vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+        auto tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+        auto valid = _mm_cmpneq_ps(det, zero);
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(uu, zero));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(vv, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(uu, vv), one));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(tt, zero));
+        valid = _mm_and_ps(valid, _mm_cmplt_ps(tt, _mm_set1_ps(hit.distance)));
+
+        mask = _mm_movemask_ps(valid);
+        if (!mask) {
+            return false;
+        }
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, uu);
+        _mm_storeu_ps(v, vv);
+#else
+        for (uint32_t lane = 0; lane < BVH::kLeafSize; ++lane) {
+            glm::vec3 e1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+            glm::vec3 e2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+            glm::vec3 v0(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+
+            auto p = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, p);
+            if (det == 0.0f) {
+                continue;
+            }
+            float invDet = 1.0f / det;
+            auto s = ray.origin - v0;
+            auto q = glm::cross(s, e1);
+            u[lane] = glm::dot(s, p) * invDet;
+            v[lane] = glm::dot(ray.direction, q) * invDet;
+            t[lane] = glm::dot(e2, q) * invDet;
+            if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f &&
+                t[lane] >= 0.0f && t[lane] < hit.distance) {
+                mask |= 1 << lane;
+            }
+        }
+        if (!mask) {
+            return false;
+        }
+#endif
+
+        for (uint32_t lane = 0; lane < BVH::kLeafSize; ++lane) {
+            if ((mask & (1 << lane)) && t[lane] < hit.distance) {
+                hit.distance = t[lane];
+                hit.triangle = block.triangles[lane];
+                hit.barycentrics = glm::vec2(u[lane], v[lane]);
+            }
+        }
+        return true;
+    }
+}
+
+Ray okami::ScreenRay(RenderView const& view, glm::vec2 screenPos) {
+    glm::vec2 ndc(
+        2.0f * screenPos.x / view.viewport.x - 1.0f,
+        1.0f - 2.0f * screenPos.y / view.viewport.y);
+
+    auto invViewProj = glm::inverse(view.GetProjMatrix() * view.GetViewMatrix());
+    auto nearPoint = invViewProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+    auto farPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+    auto origin = glm::vec3(nearPoint) / nearPoint.w;
+    auto target = glm::vec3(farPoint) / farPoint.w;
+
+    return Ray{origin, glm::normalize(target - origin)};
+}
+
+std::optional<RayHit> okami::geometry::BVH::RayCast(Ray const& ray, float maxDistance) const {
+    if (_nodes.empty()) {
+        return {};
+    }
+
+    auto invDirection = 1.0f / ray.direction;
+
+    RayHit hit{maxDistance, kNoTriangle, glm::vec2(0.0f, 0.0f)};
+    bool found = false;
+
+    uint32_t stack[kMaxDepth];
+    size_t stackSize = 0;
+    if (IntersectBox(_nodes[0].bounds, ray, invDirection, hit.distance) <
+        std::numeric_limits<float>::infinity()) {
+        stack[stackSize++] = 0;
+    }
+
+    while (stackSize > 0) {
+        auto const& node = _nodes[stack[--stackSize]];
+
+        if (node.triangleCount > 0) {
+            found |= IntersectBlock(_blocks[node.index], ray, hit);
+            continue;
+        }
+
+        uint32_t first = static_cast<uint32_t>(&node - _nodes.data()) + 1;
+        uint32_t second = node.index;
+        float firstEntry = IntersectBox(_nodes[first].bounds, ray, invDirection, hit.distance);
+        float secondEntry = IntersectBox(_nodes[second].bounds, ray, invDirection, hit.distance);
+
+        // Push the farther child first, so the nearer one is visited first
+        if (secondEntry < firstEntry) {
+            std::swap(first, second);
+            std::swap(firstEntry, secondEntry);
+        }
+        if (secondEntry < std::numeric_limits<float>::infinity()) {
+            stack[stackSize++] = second;
+        }
+        if (firstEntry < std::numeric_limits<float>::infinity()) {
+            stack[stackSize++] = first;
+        }
+    }
+
+    if (!found) {
+        return {};
+    }
+    return hit;
+}
+
+BVH okami::geometry::BVH::Build(
+    std::span<glm::vec3 const> positions,
+    std::span<uint32_t const> indices) {
+    BVH result;
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return result;
+    }
+
+    BuildContext ctx{
+        .positions = positions,
+        .indices = indices,
+        .nodes = result._nodes,
+        .blocks = result._blocks
+    };
+
+    ctx.order.resize(triangleCount);
+    ctx.centroids.resize(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; ++i) {
+        ctx.order[i] = i;
+        ctx.centroids[i] = (ctx.Vertex(i, 0) + ctx.Vertex(i, 1) + ctx.Vertex(i, 2)) / 3.0f;
+    }
+
+    result._nodes.reserve(2 * (triangleCount / kLeafSize) + 1);
+    result._blocks.reserve(triangleCount / kLeafSize + 1);
+    BuildNode(ctx, 0, triangleCount);
+
+    return result;
+}
+
+BVH okami::geometry::BVH::Build(Geometry const& geometry) {
+    auto const& desc = geometry.GetDesc();
+    if (!desc.isIndexed || desc.topology != Topology::TRIANGLE_LIST) {
+        throw std::runtime_error("BVH requires an indexed triangle list!");
+    }
+
+    auto positions = UnpackPositions(geometry);
+    auto indices = UnpackIndices(geometry);
+    return Build(positions, indices);
+}
+
+std::optional<RayCastHit> okami::RayCast(Registry const& registry,
+    Ray const& ray,
+    glm::dvec3 const& origin,
+    float maxDistance) {
+    std::optional<RayCastHit> result;
+
+    auto view = registry.view<RayCastMesh const>();
+    for (auto e : view) {
+        auto const& mesh = view.get<RayCastMesh const>(e);
+        if (!mesh.bvh) {
+            continue;
+        }
+
+        WorldTransform transform;
+        if (auto worldTransform = registry.try_get<WorldTransform>(e)) {
+            transform = *worldTransform;
+        } else if (auto localTransform = registry.try_get<Transform>(e)) {
+            transform = *localTransform;
+        }
+
+        // Without normalizing the direction, distances along the object
+        // space ray match the ones along the original ray
+        auto invWorld = glm::inverse(transform.ToRelativeMatrix4x4(origin));
+        Ray objectRay{
+            glm::vec3(invWorld * glm::vec4(ray.origin, 1.0f)),
+            glm::vec3(invWorld * glm::vec4(ray.direction, 0.0f))
+        };
+
+        float closest = result ? result->hit.distance : maxDistance;
+        if (auto hit = mesh.bvh->RayCast(objectRay, closest)) {
+            result = RayCastHit{e, *hit};
+        }
+    }
+
+    return result;
+}
+
+std::optional<RayCastHit> okami::RayCast(Registry const& registry,
+    RenderView const& view,
+    glm::vec2 screenPos) {
+    return RayCast(registry, ScreenRay(view, screenPos), view.origin);
+}
@@ -1,13 +1,22 @@
 #include <okami/texture.hpp>
 #include <okami/mip_generator.hpp>
+#include <okami/texture_compress.hpp>
+#include <okami/texture_convert.hpp>
+#include <okami/texture_file.hpp>
+#include <okami/mapped_file.hpp>
+#include <okami/thread_pool.hpp>
 
 #include <lodepng.h>
 
 #include <filesystem>
+#include <fstream>
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstring>
 #include <span>
+#include <vector>
 
 using namespace okami;
 using namespace okami::texture;
@@ -68,12 +77,12 @@ Format Format::R32_FLOAT() {
 }
 Format Format::R32_SINT() {
     return Format{
-        1, ValueType::UINT32, false, true
+        1, ValueType::INT32, false, true
     };
 }
 Format Format::R32_UINT() {
     return Format{
-        2, ValueType::INT32, false, true
+        1, ValueType::UINT32, false, true
     };
 }
 Format Format::RG32_FLOAT() {
@@ -236,6 +245,69 @@ Format Format::RGBA16_UNORM() {
         4, ValueType::UINT16, true, true 
     };
 }
+Format Format::RGBA16_FLOAT() {
+    return Format{
+        4, ValueType::FLOAT16, false, true
+    };
+}
+
+Format Format::BC1_UNORM() {
+    return Format{
+        3, ValueType::UINT8, true, true, Compression::BC1
+    };
+}
+Format Format::BC1_SRGB() {
+    return Format{
+        3, ValueType::UINT8, true, false, Compression::BC1
+    };
+}
+Format Format::BC3_UNORM() {
+    return Format{
+        4, ValueType::UINT8, true, true, Compression::BC3
+    };
+}
+Format Format::BC3_SRGB() {
+    return Format{
+        4, ValueType::UINT8, true, false, Compression::BC3
+    };
+}
+Format Format::BC4_UNORM() {
+    return Format{
+        1, ValueType::UINT8, true, true, Compression::BC4
+    };
+}
+Format Format::BC5_UNORM() {
+    return Format{
+        2, ValueType::UINT8, true, true, Compression::BC5
+    };
+}
+Format Format::BC7_UNORM() {
+    return Format{
+        4, ValueType::UINT8, true, true, Compression::BC7
+    };
+}
+Format Format::BC7_SRGB() {
+    return Format{
+        4, ValueType::UINT8, true, false, Compression::BC7
+    };
+}
+
+Format Format::Compressed(Compression compression, bool isSRGB) {
+    switch (compression) {
+        case Compression::BC1:
+            return isSRGB ? BC1_SRGB() : BC1_UNORM();
+        case Compression::BC3:
+            return isSRGB ? BC3_SRGB() : BC3_UNORM();
+        case Compression::BC4:
+            return BC4_UNORM();
+        case Compression::BC5:
+            return BC5_UNORM();
+        case Compression::BC7:
+            return isSRGB ? BC7_SRGB() : BC7_UNORM();
+        default:
+            return UNKNOWN();
+    }
+}
 
 uint texture::MipCount(
     const uint width, 
@@ -256,28 +328,33 @@ std::vector<SubResDataDesc>
 
     std::vector<SubResDataDesc> descs;
 
-    auto pixelSize = GetPixelByteSize();
+    auto blockSize = format.GetBlockByteSize();
+    auto blockDim = format.GetBlockDimension();
     size_t mip_count = GetMipCount();
 
     // Compute subresources and sizes
     size_t currentOffset = 0;
-    for (size_t iarray = 0; iarray < arraySizeOrDepth; ++iarray) {
+    for (size_t iarray = 0; iarray < GetArraySize(); ++iarray) {
         for (size_t imip = 0; imip < mip_count; ++imip) {
             size_t mip_width = width;
             size_t mip_height = height;
-            size_t mip_depth = arraySizeOrDepth;
+            size_t mip_depth = GetDepth();
 
             mip_width = std::max<size_t>(mip_width >> imip, 1u);
             mip_height = std::max<size_t>(mip_height >> imip, 1u);
             mip_depth = std::max<size_t>(mip_depth >> imip, 1u);
 
+            // Partial blocks at the edges are stored whole
+            mip_width = (mip_width + blockDim - 1) / blockDim;
+            mip_height = (mip_height + blockDim - 1) / blockDim;
+
             size_t increment = mip_width * mip_height * 
-                mip_depth * pixelSize * sampleCount;
+                mip_depth * blockSize * sampleCount;
 
             SubResDataDesc subDesc;
             subDesc.srcOffset = currentOffset;
-            subDesc.depthStride = mip_width * mip_height * pixelSize * sampleCount;
-            subDesc.stride = mip_width * pixelSize * sampleCount;
+            subDesc.depthStride = mip_width * mip_height * blockSize * sampleCount;
+            subDesc.stride = mip_width * blockSize * sampleCount;
             subDesc.length = increment;
             subDesc.mip = imip;
             subDesc.slice = iarray;
@@ -290,24 +367,28 @@ std::vector<SubResDataDesc>
     return descs;
 }
 
-uint32_t Desc::GetByteSize() const {
-    auto pixelSize = GetPixelByteSize();
+uint64_t Desc::GetByteSize() const {
+    auto blockSize = format.GetBlockByteSize();
+    auto blockDim = format.GetBlockDimension();
     size_t mip_count = GetMipCount();
 
     // Compute subresources and sizes
     size_t currentOffset = 0;
-    for (size_t iarray = 0; iarray < arraySizeOrDepth; ++iarray) {
+    for (size_t iarray = 0; iarray < GetArraySize(); ++iarray) {
         for (size_t imip = 0; imip < mip_count; ++imip) {
             size_t mip_width = width;
             size_t mip_height = height;
-            size_t mip_depth = arraySizeOrDepth;
+            size_t mip_depth = GetDepth();
 
             mip_width = std::max<size_t>(mip_width >> imip, 1u);
             mip_height = std::max<size_t>(mip_height >> imip, 1u);
             mip_depth = std::max<size_t>(mip_depth >> imip, 1u);
 
+            mip_width = (mip_width + blockDim - 1) / blockDim;
+            mip_height = (mip_height + blockDim - 1) / blockDim;
+
             size_t increment = mip_width * mip_height * 
-                mip_depth * pixelSize * sampleCount;
+                mip_depth * blockSize * sampleCount;
             currentOffset += increment;
         }
     }
@@ -325,8 +406,12 @@ Buffer Buffer::Alloc(const Desc& desc) {
     return result;
 }
 
-void Buffer::GenerateMips() {
-    size_t mipCount = desc.mipLevels;
+void Buffer::GenerateMips(MipFilter filter, bool alphaWeighted) {
+    GenerateMips(ThreadPool::Default(), filter, alphaWeighted);
+}
+
+void Buffer::GenerateMips(ThreadPool& pool, MipFilter filter, bool alphaWeighted) {
+    size_t mipCount = desc.GetMipCount();
     bool isSRGB = !desc.format.isLinear;
     size_t pixelSize = desc.GetPixelByteSize();
     uint componentCount = desc.format.channels * desc.sampleCount;
@@ -349,50 +434,38 @@ void Buffer::GenerateMips() {
             throw std::runtime_error("GenerateMips does not support this resource dimension type!");
     }
 
-    uint iSubresource = 0;
-    for (size_t arrayIndex = 0; arrayIndex < arrayLength; ++arrayIndex) {
-        auto& baseSubDesc = subresources[iSubresource];
-        auto last_mip_data = &data[baseSubDesc.srcOffset];
-        ++iSubresource;
-
-        for (size_t i = 1; i < mipCount; ++i) {
-            auto& subDesc = subresources[iSubresource];
-            auto new_mip_data = &data[subDesc.srcOffset];
-
-            uint fineWidth = std::max<uint>(1u, desc.width >> (i - 1));
-            uint fineHeight = std::max<uint>(1u, desc.height >> (i - 1));
-            uint coarseWidth = std::max<uint>(1u, desc.width >> i);
-            uint coarseHeight = std::max<uint>(1u, desc.height >> i);
-
-            uint fineStride = (uint)(fineWidth * pixelSize);
-            uint coarseStride = (uint)(coarseWidth * pixelSize);
-
-            mip_generator_2d_t mip_gen;
-
-            switch (valueType) {
-                case ValueType::UINT8:
-                    mip_gen = &ComputeCoarseMip2D<uint8_t>;
-                    break;
-                case ValueType::UINT16:
-                    mip_gen = &ComputeCoarseMip2D<uint16_t>;
-                    break;
-                case ValueType::UINT32:
-                    mip_gen = &ComputeCoarseMip2D<uint32_t>;
-                    break;
-                case ValueType::FLOAT32:
-                    mip_gen = &ComputeCoarseMip2D<float>;
-                    break;
-                default:
-                    throw std::runtime_error("Mip generation for texture type is not supported!");
-            }
-
-            mip_gen(componentCount, isSRGB, last_mip_data, fineStride, 
-                fineWidth, fineHeight, new_mip_data, 
-                coarseStride, coarseWidth, coarseHeight);
-
-            last_mip_data = new_mip_data;
-            ++iSubresource;
-        }
+    auto mip_gen = GetMipGenerator(valueType, componentCount, filter, alphaWeighted);
+    if (!mip_gen) {
+        throw std::runtime_error("Mip generation for texture type is not supported!");
+    }
+
+    // Each mip depends on the one before it, but the slices and the row
+    // bands within a mip are independent
+    for (size_t i = 1; i < mipCount; ++i) {
+        uint fineWidth = std::max<uint>(1u, desc.width >> (i - 1));
+        uint fineHeight = std::max<uint>(1u, desc.height >> (i - 1));
+        uint coarseWidth = std::max<uint>(1u, desc.width >> i);
+        uint coarseHeight = std::max<uint>(1u, desc.height >> i);
+
+        uint fineStride = (uint)(fineWidth * pixelSize);
+        uint coarseStride = (uint)(coarseWidth * pixelSize);
+
+        uint bandHeight = std::max<uint>(1u, kMipBandPixels / coarseWidth);
+        uint bandCount = (coarseHeight + bandHeight - 1) / bandHeight;
+
+        pool.ParallelFor(arrayLength * bandCount, [&](size_t job) {
+            size_t arrayIndex = job / bandCount;
+            uint rowBegin = (uint)(job % bandCount) * bandHeight;
+            uint rowEnd = std::min(coarseHeight, rowBegin + bandHeight);
+
+            auto& fineSubDesc = subresources[arrayIndex * mipCount + i - 1];
+            auto& coarseSubDesc = subresources[arrayIndex * mipCount + i];
+
+            mip_gen(componentCount, isSRGB,
+                &data[fineSubDesc.srcOffset], fineStride, fineWidth, fineHeight,
+                &data[coarseSubDesc.srcOffset], coarseStride, coarseWidth, coarseHeight,
+                rowBegin, rowEnd);
+        });
     }
 }
 
@@ -401,12 +474,6 @@ Buffer LoadFromBytes_RGBA8_UNORM(
     const std::vector<uint8_t>& image,
     uint32_t width, uint32_t height) {
     
-    std::vector<uint8_t> rawData;
-    std::vector<SubResDataDesc> subDatas;
-    rawData.resize(image.size() * 2);
-
-    size_t currentIndx = 0;
-
     Format format;
 
     if (params.isSRGB) {
@@ -429,7 +496,13 @@ Buffer LoadFromBytes_RGBA8_UNORM(
     std::memcpy(&result.data[0], &image[0], subresources[0].length);
 
     if (params.generateMips)
-        result.GenerateMips();
+        result.GenerateMips(params.mipFilter, params.alphaWeightedMips);
+
+    if (params.compression != Compression::None)
+        return Compress(result, params.compression);
+
+    if (params.valueType != ValueType::UINT8)
+        return ConvertPixels(result, Format{4, params.valueType, false, true});
 
     return result;
 }
@@ -454,17 +527,62 @@ Expected<Buffer> LoadPNG(
     return LoadFromBytes_RGBA8_UNORM(params, image, width, height);
 }
 
+Expected<Buffer> LoadContainer(
+    const std::filesystem::path& path,
+    const TextureLoadParams& params,
+    Expected<Buffer> (*parse)(std::span<uint8_t const>)) {
+
+    if (params.memoryMap) {
+        Error err;
+        auto file = OKAMI_EXP_UNWRAP(MappedFile::Open(path), err);
+        return parse(file.GetBytes());
+    }
+
+    std::ifstream stream(path, std::ios::binary);
+    OKAMI_EXP_RETURN_IF(!stream, InvalidPathError{path});
+    std::vector<uint8_t> bytes(
+        (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return parse(bytes);
+}
+
 Expected<Buffer> Buffer::Load(
     const std::filesystem::path& path,
     const TextureLoadParams& params) {
     
-    auto ext = path.extension();
+    auto ext = path.extension().string();
+
+    if (ext == kKTX2Extension) {
+        return LoadContainer(path, params, &ParseKTX2);
+    } else if (ext == kDDSExtension) {
+        return LoadContainer(path, params, &ParseDDS);
+    }
 
     OKAMI_EXP_RETURN_IF(ext != ".png", RuntimeError{"Unsupported file type!"});
 
     return LoadPNG(path, params);
 }
 
+namespace {
+    // Prefab colors are given already sRGB encoded, so that they convert
+    // to SRGBA8 without a transfer
+    Format const kPrefabColorFormat{4, ValueType::FLOAT32, false, false};
+
+    std::array<uint8_t, 4> ToPrefabTexel(glm::vec4 color) {
+        std::array<uint8_t, 4> texel;
+        ConvertPixels(kPrefabColorFormat, Format::SRGBA8_UNORM(),
+            std::span{reinterpret_cast<uint8_t const*>(&color[0]), sizeof(color)}, texel);
+        return texel;
+    }
+
+    // Repeats the first patternSize bytes of dest across all of it, doubling
+    // the copied run each time
+    void FillRepeat(std::span<uint8_t> dest, size_t patternSize) {
+        for (size_t filled = patternSize; filled < dest.size(); filled *= 2) {
+            std::memcpy(&dest[filled], &dest[0], std::min(filled, dest.size() - filled));
+        }
+    }
+}
+
 Buffer prefabs::SolidColor(
     uint width,
     uint height,
@@ -477,15 +595,10 @@ Buffer prefabs::SolidColor(
     desc.format = Format::SRGBA8_UNORM();
 
     auto data = Buffer::Alloc(desc);
-    auto ucolor = ColorToBytes(color);
-    auto src = SpanOf(ucolor);
+    auto texel = ToPrefabTexel(color);
 
-    for (uint y = 0; y < height; ++y) {
-        for (uint x = 0; x < width; ++x) {
-            auto dest = std::span{&data.data[(x + y * width) * 4], 4};
-            std::copy(src.begin(), src.end(), dest.begin());
-        }
-    }
+    std::memcpy(&data.data[0], texel.data(), texel.size());
+    FillRepeat(data.data, texel.size());
 
     return Buffer(std::move(data));
 }
@@ -506,29 +619,29 @@ Buffer prefabs::CheckerBoard(
 
     auto data = Buffer::Alloc(desc);
 
-    auto ucolor1 = ColorToBytes(color1);
-    auto ucolor2 = ColorToBytes(color2);
-
-    auto src1 = SpanOf(ucolor1);
-    auto src2 = SpanOf(ucolor2);
+    std::array<std::array<uint8_t, 4>, 2> texels{ToPrefabTexel(color1), ToPrefabTexel(color2)};
 
     uint32_t xSubdivSize = width / widthSubdivisions;
     uint32_t ySubdivSize = height / heightSubdivisions;
+    size_t stride = width * 4;
+
+    // Builds the two rows the board alternates between, a tile at a time,
+    // then copies them down
+    std::vector<uint8_t> rows(stride * 2);
+    for (uint32_t row = 0; row < 2; ++row) {
+        auto dest = std::span{&rows[row * stride], stride};
+        for (uint32_t x = 0; x < width; x += xSubdivSize) {
+            auto const& texel = texels[(x / xSubdivSize + row) % 2];
+            auto tile = dest.subspan(x * 4, std::min(xSubdivSize, width - x) * 4);
+            std::memcpy(tile.data(), texel.data(), texel.size());
+            FillRepeat(tile, texel.size());
+        }
+    }
 
     for (uint y = 0; y < height; ++y) {
-        for (uint x = 0; x < width; ++x) {
-            auto dest = std::span{&data.data[(x + y * width) * 4], 4};
-            
-            auto tileX = x / xSubdivSize;
-            auto tileY = y / ySubdivSize;
-
-            if ((tileX + tileY) % 2 == 0) {
-                std::copy(src1.begin(), src1.end(), dest.begin());
-            } else {
-                std::copy(src2.begin(), src2.end(), dest.begin());
-            }
-        }
+        auto tileY = y / ySubdivSize;
+        std::memcpy(&data.data[y * stride], &rows[(tileY % 2) * stride], stride);
     }
 
     return data;
-}
\ No newline at end of file
+}
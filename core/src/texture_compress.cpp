@@ -0,0 +1,550 @@
+#include <okami/texture_compress.hpp>
+#include <okami/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    // Blocks handed to a single job when compressing in parallel
+    constexpr uint32_t kCompressBandBlocks = 4096;
+
+    template <int N>
+    float DistanceSquared(float const* a, float const* b) {
+        float result = 0.0f;
+        for (int c = 0; c < N; ++c) {
+            float d = a[c] - b[c];
+            result += d * d;
+        }
+        return result;
+    }
+
+    // Places lo and hi at the extremes of the texels projected onto their
+    // principal axis, found by power iteration on the covariance matrix
+    template <int N>
+    void FitEndpoints(float const (&texels)[16][N], float (&lo)[N], float (&hi)[N]) {
+        float mean[N] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < N; ++c) {
+                mean[c] += texels[i][c];
+            }
+        }
+        for (int c = 0; c < N; ++c) {
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int a = 0; a < N; ++a) {
+                for (int b = 0; b < N; ++b) {
+                    covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+                }
+            }
+        }
+
+        float axis[N];
+        for (int c = 0; c < N; ++c) {
+            axis[c] = 1.0f;
+        }
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int a = 0; a < N; ++a) {
+                for (int b = 0; b < N; ++b) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length = std::max(length, std::abs(next[a]));
+            }
+            if (length < 1e-6f) {
+                break;
+            }
+            for (int c = 0; c < N; ++c) {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float minT = 0.0f;
+        float maxT = 0.0f;
+        float axisLength2 = 0.0f;
+        for (int c = 0; c < N; ++c) {
+            axisLength2 += axis[c] * axis[c];
+        }
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < N; ++c) {
+                t += (texels[i][c] - mean[c]) * axis[c];
+            }
+            t /= axisLength2;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        for (int c = 0; c < N; ++c) {
+            lo[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+            hi[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        }
+    }
+
+    // Solves for the endpoints that best reproduce the texels given each
+    // texel's interpolation weight towards e1. Returns false if the weights
+    // do not constrain both endpoints.
+    template <int N>
+    bool RefineEndpoints(float const (&texels)[16][N], float const (&weights)[16],
+        float (&e0)[N], float (&e1)[N]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ap[N] = {};
+        float bp[N] = {};
+        for (int i = 0; i < 16; ++i) {
+            float b = weights[i];
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < N; ++c) {
+                ap[c] += a * texels[i][c];
+                bp[c] += b * texels[i][c];
+            }
+        }
+
+        float det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f) {
+            return false;
+        }
+
+        float invDet = 1.0f / det;
+        for (int c = 0; c < N; ++c) {
+            e0[c] = std::clamp((ap[c] * bb - bp[c] * ab) * invDet, 0.0f, 255.0f);
+            e1[c] = std::clamp((bp[c] * aa - ap[c] * ab) * invDet, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    template <size_t Size>
+    void StoreLittleEndian(std::array<uint8_t, Size>& dest, size_t offset, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) {
+            dest[offset + i] = (uint8_t)(value >> (8 * i));
+        }
+    }
+
+    uint16_t QuantizeRGB565(float const (&color)[3]) {
+        auto r = (uint16_t)std::lround(color[0] * 31.0f / 255.0f);
+        auto g = (uint16_t)std::lround(color[1] * 63.0f / 255.0f);
+        auto b = (uint16_t)std::lround(color[2] * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void ExpandRGB565(uint16_t packed, float (&color)[3]) {
+        uint32_t r = (packed >> 11) & 31;
+        uint32_t g = (packed >> 5) & 63;
+        uint32_t b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+    }
+
+    struct BC1Block {
+        uint16_t color0;
+        uint16_t color1;
+        uint32_t indices;
+    };
+
+    // Always emits the four colour mode, which is also the only mode BC3
+    // colour blocks have
+    BC1Block EncodeBC1Colors(float const (&texels)[16][3]) {
+        // Weight towards color1 of each four colour mode index
+        static constexpr float kWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        float lo[3], hi[3];
+        FitEndpoints<3>(texels, lo, hi);
+
+        BC1Block best{};
+        float bestError = std::numeric_limits<float>::max();
+
+        for (int iteration = 0; iteration < 2; ++iteration) {
+            uint16_t color0 = QuantizeRGB565(hi);
+            uint16_t color1 = QuantizeRGB565(lo);
+
+            float palette[4][3];
+            ExpandRGB565(color0, palette[0]);
+            ExpandRGB565(color1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+
+            uint32_t indices = 0;
+            float error = 0.0f;
+            float weights[16];
+            for (int i = 0; i < 16; ++i) {
+                int bestIndex = 0;
+                float bestDistance = DistanceSquared<3>(texels[i], palette[0]);
+                for (int k = 1; k < 4; ++k) {
+                    float distance = DistanceSquared<3>(texels[i], palette[k]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        bestIndex = k;
+                    }
+                }
+                indices |= (uint32_t)bestIndex << (2 * i);
+                weights[i] = kWeights[bestIndex];
+                error += bestDistance;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                best = BC1Block{color0, color1, indices};
+            }
+
+            if (!RefineEndpoints<3>(texels, weights, hi, lo)) {
+                break;
+            }
+        }
+
+        if (best.color0 < best.color1) {
+            std::swap(best.color0, best.color1);
+            // Swaps 0 with 1 and 2 with 3
+            best.indices ^= 0x55555555u;
+        } else if (best.color0 == best.color1) {
+            best.indices = 0;
+        }
+
+        return best;
+    }
+
+    void StoreBC1(std::array<uint8_t, 16>& dest, size_t offset, BC1Block const& block) {
+        StoreLittleEndian(dest, offset, block.color0, 2);
+        StoreLittleEndian(dest, offset + 2, block.color1, 2);
+        StoreLittleEndian(dest, offset + 4, block.indices, 4);
+    }
+
+    // Uses the eight value mode, with alpha0 the maximum and alpha1 the
+    // minimum of the block
+    uint64_t EncodeBC4Values(uint8_t const (&values)[16]) {
+        uint8_t maxValue = *std::max_element(values, values + 16);
+        uint8_t minValue = *std::min_element(values, values + 16);
+
+        uint64_t result = (uint64_t)maxValue | ((uint64_t)minValue << 8);
+        if (maxValue == minValue) {
+            return result;
+        }
+
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int k = 1; k < 7; ++k) {
+            palette[k + 1] = ((7 - k) * maxValue + k * minValue + 3) / 7;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            int bestDistance = std::abs(values[i] - palette[0]);
+            for (int k = 1; k < 8; ++k) {
+                int distance = std::abs(values[i] - palette[k]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = k;
+                }
+            }
+            result |= (uint64_t)bestIndex << (16 + 3 * i);
+        }
+        return result;
+    }
+
+    struct BitWriter {
+        std::array<uint8_t, 16>& dest;
+        uint32_t position = 0;
+
+        void Write(uint32_t value, uint32_t bitCount) {
+            for (uint32_t i = 0; i < bitCount; ++i, ++position) {
+                if (value & (1u << i)) {
+                    dest[position >> 3] |= (uint8_t)(1u << (position & 7));
+                }
+            }
+        }
+    };
+
+    // Rounds an endpoint to 7 bits per channel plus a shared p-bit, picking
+    // whichever p-bit lands closer
+    void QuantizeBC7Endpoint(float const (&endpoint)[4], uint8_t (&quantized)[4], uint8_t& pBit) {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint8_t p = 0; p < 2; ++p) {
+            uint8_t candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                float q = std::round((endpoint[c] - p) / 2.0f);
+                candidate[c] = (uint8_t)std::clamp(q, 0.0f, 127.0f);
+                float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pBit = p;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    void GatherBlock(Buffer const& source, SubResDataDesc const& subresource,
+        uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY,
+        uint8_t (&rgba)[16][4]) {
+        for (uint32_t y = 0; y < 4; ++y) {
+            uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+            auto row = &source.data[subresource.srcOffset + srcY * subresource.stride];
+            for (uint32_t x = 0; x < 4; ++x) {
+                uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+                std::memcpy(rgba[y * 4 + x], &row[srcX * 4], 4);
+            }
+        }
+    }
+
+    void EncodeBlock(Compression compression, uint8_t const (&rgba)[16][4], uint8_t* dest) {
+        switch (compression) {
+            case Compression::BC1: {
+                auto block = EncodeBC1(rgba);
+                std::memcpy(dest, block.data(), block.size());
+                break;
+            }
+            case Compression::BC3: {
+                auto block = EncodeBC3(rgba);
+                std::memcpy(dest, block.data(), block.size());
+                break;
+            }
+            case Compression::BC4: {
+                uint8_t values[16];
+                for (int i = 0; i < 16; ++i) {
+                    values[i] = rgba[i][0];
+                }
+                auto block = EncodeBC4(values);
+                std::memcpy(dest, block.data(), block.size());
+                break;
+            }
+            case Compression::BC5: {
+                auto block = EncodeBC5(rgba);
+                std::memcpy(dest, block.data(), block.size());
+                break;
+            }
+            case Compression::BC7: {
+                auto block = EncodeBC7(rgba);
+                std::memcpy(dest, block.data(), block.size());
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown compression!");
+        }
+    }
+}
+
+std::array<uint8_t, 8> okami::texture::EncodeBC1(uint8_t const (&rgba)[16][4]) {
+    float texels[16][3];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            texels[i][c] = rgba[i][c];
+        }
+    }
+
+    std::array<uint8_t, 16> block{};
+    StoreBC1(block, 0, EncodeBC1Colors(texels));
+
+    std::array<uint8_t, 8> result;
+    std::memcpy(result.data(), block.data(), result.size());
+    return result;
+}
+
+std::array<uint8_t, 16> okami::texture::EncodeBC3(uint8_t const (&rgba)[16][4]) {
+    float texels[16][3];
+    uint8_t alpha[16];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            texels[i][c] = rgba[i][c];
+        }
+        alpha[i] = rgba[i][3];
+    }
+
+    std::array<uint8_t, 16> result{};
+    StoreLittleEndian(result, 0, EncodeBC4Values(alpha), 8);
+    StoreBC1(result, 8, EncodeBC1Colors(texels));
+    return result;
+}
+
+std::array<uint8_t, 8> okami::texture::EncodeBC4(uint8_t const (&values)[16]) {
+    std::array<uint8_t, 8> result{};
+    StoreLittleEndian(result, 0, EncodeBC4Values(values), 8);
+    return result;
+}
+
+std::array<uint8_t, 16> okami::texture::EncodeBC5(uint8_t const (&rgba)[16][4]) {
+    uint8_t red[16];
+    uint8_t green[16];
+    for (int i = 0; i < 16; ++i) {
+        red[i] = rgba[i][0];
+        green[i] = rgba[i][1];
+    }
+
+    std::array<uint8_t, 16> result{};
+    StoreLittleEndian(result, 0, EncodeBC4Values(red), 8);
+    StoreLittleEndian(result, 8, EncodeBC4Values(green), 8);
+    return result;
+}
+
+std::array<uint8_t, 16> okami::texture::EncodeBC7(uint8_t const (&rgba)[16][4]) {
+    static constexpr int kWeights[16] = {
+        0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+    };
+
+    float texels[16][4];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            texels[i][c] = rgba[i][c];
+        }
+    }
+
+    float e0[4], e1[4];
+    FitEndpoints<4>(texels, e0, e1);
+
+    uint8_t bestEndpoints[2][4] = {};
+    uint8_t bestPBits[2] = {};
+    uint8_t bestIndices[16] = {};
+    float bestError = std::numeric_limits<float>::max();
+
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        uint8_t endpoints[2][4];
+        uint8_t pBits[2];
+        QuantizeBC7Endpoint(e0, endpoints[0], pBits[0]);
+        QuantizeBC7Endpoint(e1, endpoints[1], pBits[1]);
+
+        float palette[16][4];
+        for (int c = 0; c < 4; ++c) {
+            int v0 = (endpoints[0][c] << 1) | pBits[0];
+            int v1 = (endpoints[1][c] << 1) | pBits[1];
+            for (int k = 0; k < 16; ++k) {
+                palette[k][c] = (float)(((64 - kWeights[k]) * v0 + kWeights[k] * v1 + 32) >> 6);
+            }
+        }
+
+        uint8_t indices[16];
+        float weights[16];
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            float bestDistance = DistanceSquared<4>(texels[i], palette[0]);
+            for (int k = 1; k < 16; ++k) {
+                float distance = DistanceSquared<4>(texels[i], palette[k]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = k;
+                }
+            }
+            indices[i] = (uint8_t)bestIndex;
+            weights[i] = kWeights[bestIndex] / 64.0f;
+            error += bestDistance;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+            std::memcpy(bestPBits, pBits, sizeof(pBits));
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+
+        if (!RefineEndpoints<4>(texels, weights, e0, e1)) {
+            break;
+        }
+    }
+
+    // The anchor index has its top bit implied to be zero
+    if (bestIndices[0] & 8) {
+        std::swap(bestEndpoints[0], bestEndpoints[1]);
+        std::swap(bestPBits[0], bestPBits[1]);
+        for (auto& index : bestIndices) {
+            index = (uint8_t)(15 - index);
+        }
+    }
+
+    std::array<uint8_t, 16> result{};
+    BitWriter writer{result};
+    writer.Write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        writer.Write(bestEndpoints[0][c], 7);
+        writer.Write(bestEndpoints[1][c], 7);
+    }
+    writer.Write(bestPBits[0], 1);
+    writer.Write(bestPBits[1], 1);
+    writer.Write(bestIndices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        writer.Write(bestIndices[i], 4);
+    }
+    return result;
+}
+
+Buffer okami::texture::Compress(Buffer const& source, Compression compression) {
+    return Compress(ThreadPool::Default(), source, compression);
+}
+
+Buffer okami::texture::Compress(ThreadPool& pool, Buffer const& source, Compression compression) {
+    auto const& srcFormat = source.desc.format;
+    if (srcFormat.IsCompressed() ||
+        srcFormat.channels != 4 ||
+        srcFormat.valueType != ValueType::UINT8 ||
+        !srcFormat.isNormalized) {
+        throw std::runtime_error("Compression requires an RGBA8 texture!");
+    }
+    if (source.desc.type == Dimension::Texture3D) {
+        throw std::runtime_error("Compression does not support 3D textures!");
+    }
+
+    Desc desc = source.desc;
+    desc.format = Format::Compressed(compression, !srcFormat.isLinear);
+    if (desc.format.compression == Compression::None) {
+        throw std::runtime_error("Unknown compression!");
+    }
+
+    auto result = Buffer::Alloc(desc);
+    auto srcSubresources = source.desc.GetSubresourceDescs();
+    auto dstSubresources = desc.GetSubresourceDescs();
+    uint32_t mipCount = desc.GetMipCount();
+    uint32_t blockSize = desc.format.GetBlockByteSize();
+
+    // Split each subresource into bands of block rows
+    struct Band {
+        uint32_t subresource;
+        uint32_t blockRowBegin;
+        uint32_t blockRowEnd;
+    };
+    std::vector<Band> bands;
+    for (uint32_t i = 0; i < srcSubresources.size(); ++i) {
+        uint32_t mip = i % mipCount;
+        uint32_t blocksWide = (std::max(1u, desc.width >> mip) + 3) / 4;
+        uint32_t blocksHigh = (std::max(1u, desc.height >> mip) + 3) / 4;
+        uint32_t bandHeight = std::max(1u, kCompressBandBlocks / blocksWide);
+        for (uint32_t row = 0; row < blocksHigh; row += bandHeight) {
+            bands.emplace_back(Band{i, row, std::min(blocksHigh, row + bandHeight)});
+        }
+    }
+
+    pool.ParallelFor(bands.size(), [&](size_t job) {
+        auto const& band = bands[job];
+        uint32_t mip = band.subresource % mipCount;
+        uint32_t width = std::max(1u, desc.width >> mip);
+        uint32_t height = std::max(1u, desc.height >> mip);
+        uint32_t blocksWide = (width + 3) / 4;
+
+        auto const& srcSubDesc = srcSubresources[band.subresource];
+        auto const& dstSubDesc = dstSubresources[band.subresource];
+
+        uint8_t rgba[16][4];
+        for (uint32_t blockY = band.blockRowBegin; blockY < band.blockRowEnd; ++blockY) {
+            auto dest = &result.data[dstSubDesc.srcOffset + blockY * dstSubDesc.stride];
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX) {
+                GatherBlock(source, srcSubDesc, width, height, blockX, blockY, rgba);
+                EncodeBlock(compression, rgba, &dest[blockX * blockSize]);
+            }
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,496 @@
+#include <okami/texture_convert.hpp>
+#include <okami/mip_generator.hpp>
+#include <okami/simd.hpp>
+#include <okami/thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    // Pixels handed to a single job when converting in parallel
+    constexpr size_t kConvertBandPixels = 65536;
+    // Pixels decoded to float at a time by the generic path
+    constexpr size_t kConvertChunkPixels = 256;
+
+    bool IsConvertible(Format const& format) {
+        if (format.IsCompressed() || format.channels < 1 || format.channels > 4) {
+            return false;
+        }
+        switch (format.valueType) {
+            case ValueType::UINT8:
+                return format.isNormalized;
+            case ValueType::FLOAT16:
+            case ValueType::FLOAT32:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    inline bool IsUNorm8(Format const& format, uint32_t channels) {
+        return format.valueType == ValueType::UINT8 && format.channels == channels;
+    }
+
+    inline bool IsFloat(Format const& format, ValueType valueType, uint32_t channels) {
+        return format.valueType == valueType && format.channels == channels;
+    }
+
+    // NaN and negative values clamp to 0
+    inline float Saturate(float x) {
+        return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;
+    }
+
+    inline uint8_t EncodeUNorm8(float x) {
+        return static_cast<uint8_t>(Saturate(x) * 255.0f + 0.5f);
+    }
+
+    // Round to nearest even, with overflow to infinity and NaN kept quiet.
+    // Bit exact with FloatToHalf4, which is the same algorithm four wide.
+    uint16_t FloatToHalf(float value) {
+        uint32_t f = std::bit_cast<uint32_t>(value);
+        uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+
+        uint32_t half;
+        if (f >= (127u + 16u) << 23) {
+            half = f > 0x7F800000u ? 0x7E00u : 0x7C00u;
+        } else if (f < (113u << 23)) {
+            // Adding 0.5 lines the mantissa up with the half denormals
+            float magic = std::bit_cast<float>(126u << 23);
+            half = std::bit_cast<uint32_t>(std::bit_cast<float>(f) + magic) - (126u << 23);
+        } else {
+            uint32_t mantissaOdd = (f >> 13) & 1u;
+            f += 0xFFFu - (112u << 23);
+            f += mantissaOdd;
+            half = f >> 13;
+        }
+        return static_cast<uint16_t>(half | (sign >> 16));
+    }
+
+    float HalfToFloat(uint16_t half) {
+        uint32_t exponentMantissa = half & 0x7FFFu;
+        // Rebiases the exponent, and normalizes denormals for free
+        uint32_t bits = std::bit_cast<uint32_t>(
+            std::bit_cast<float>(exponentMantissa << 13) * std::bit_cast<float>(239u << 23));
+        if (exponentMantissa > 0x7BFFu) {
+            bits |= 255u << 23;
+        }
+        bits |= static_cast<uint32_t>(half & 0x8000u) << 16;
+        return std::bit_cast<float>(bits);
+    }
+
+#if OKAMI_SIMD_SSE2
+    // Returns the halves in the low 16 bits of each 32 bit lane
+    inline __m128i FloatToHalf4(__m128 value) {
+        __m128i f = _mm_castps_si128(value);
+        __m128i sign = _mm_and_si128(f, _mm_set1_epi32(int(0x80000000u)));
+        f = _mm_xor_si128(f, sign);
+
+        __m128i isSpecial = _mm_cmpgt_epi32(f, _mm_set1_epi32(int(((127u + 16u) << 23) - 1u)));
+        __m128i isNaN = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x7F800000));
+        __m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00),
+            _mm_and_si128(isNaN, _mm_set1_epi32(0x0200)));
+
+        __m128i isDenormal = _mm_cmplt_epi32(f, _mm_set1_epi32(int(113u << 23)));
+        __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(int(126u << 23)));
+        __m128i denormal = _mm_sub_epi32(
+            _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), magic)), _mm_castps_si128(magic));
+
+        __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(f, _mm_set1_epi32(int(0xFFFu - (112u << 23))));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+        __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal),
+            _mm_andnot_si128(isDenormal, normal));
+        __m128i half = _mm_or_si128(_mm_and_si128(isSpecial, special),
+            _mm_andnot_si128(isSpecial, finite));
+        return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+    }
+
+    // Takes the halves in the low 16 bits of each 32 bit lane
+    inline __m128 HalfToFloat4(__m128i half) {
+        __m128i exponentMantissa = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+        __m128i bits = _mm_castps_si128(_mm_mul_ps(
+            _mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)),
+            _mm_castsi128_ps(_mm_set1_epi32(int(239u << 23)))));
+        __m128i isSpecial = _mm_cmpgt_epi32(exponentMantissa, _mm_set1_epi32(0x7BFF));
+        bits = _mm_or_si128(bits, _mm_and_si128(isSpecial, _mm_set1_epi32(int(255u << 23))));
+        bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16));
+        return _mm_castsi128_ps(bits);
+    }
+
+    inline __m128i EncodeUNorm8x4(__m128 value, __m128 scale) {
+        value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), _mm_set1_ps(0.5f)));
+    }
+#endif
+
+    struct SRGBTables {
+        std::array<uint8_t, 256> toLinear;
+        std::array<uint8_t, 256> toSRGB;
+        // 16 bit linear values to the nearest sRGB byte
+        std::array<uint8_t, 65536> encode;
+
+        SRGBTables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                toLinear[i] = EncodeUNorm8(SRGBToLinear(static_cast<float>(i) / 255.0f));
+                toSRGB[i] = EncodeUNorm8(LinearToSRGB(static_cast<float>(i) / 255.0f));
+            }
+            for (uint32_t i = 0; i < encode.size(); ++i) {
+                encode[i] = EncodeUNorm8(LinearToSRGB(static_cast<float>(i) / 65535.0f));
+            }
+        }
+    };
+
+    SRGBTables const& GetSRGBTables() {
+        static const SRGBTables tables;
+        return tables;
+    }
+
+    inline uint8_t EncodeSRGB8(float x) {
+        return GetSRGBTables().encode[static_cast<uint32_t>(Saturate(x) * 65535.0f + 0.5f)];
+    }
+
+    // RGBA8 between sRGB and linear, alpha is never encoded
+    void TransferRGBA8(uint8_t const* src, uint8_t* dest, size_t count,
+        std::array<uint8_t, 256> const& table) {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            dest[i + 0] = table[src[i + 0]];
+            dest[i + 1] = table[src[i + 1]];
+            dest[i + 2] = table[src[i + 2]];
+            dest[i + 3] = src[i + 3];
+        }
+    }
+
+    // Four bytes are loaded per pixel with the alpha byte overwritten, so
+    // the last pixel, whose load would run past the end, is done bytewise
+    void ExpandRGB8(uint8_t const* src, uint8_t* dest, size_t count) {
+        size_t i = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            for (; i + 1 < count; ++i) {
+                uint32_t texel;
+                std::memcpy(&texel, &src[i * 3], 4);
+                texel |= 0xFF000000u;
+                std::memcpy(&dest[i * 4], &texel, 4);
+            }
+        }
+        for (; i < count; ++i) {
+            dest[i * 4 + 0] = src[i * 3 + 0];
+            dest[i * 4 + 1] = src[i * 3 + 1];
+            dest[i * 4 + 2] = src[i * 3 + 2];
+            dest[i * 4 + 3] = 0xFF;
+        }
+    }
+
+    void UNorm8ToFloat(uint8_t const* src, float* dest, size_t values) {
+        size_t i = 0;
+#if OKAMI_SIMD_SSE2
+        __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= values; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&src[i]));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_ps(&dest[i + 0], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+            _mm_storeu_ps(&dest[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+            _mm_storeu_ps(&dest[i + 8], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+            _mm_storeu_ps(&dest[i + 12], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+        }
+#endif
+        for (; i < values; ++i) {
+            dest[i] = static_cast<float>(src[i]) * (1.0f / 255.0f);
+        }
+    }
+
+    void SRGBA8ToFloat(uint8_t const* src, float* dest, size_t count) {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            dest[i + 0] = SRGBToLinear(src[i + 0]);
+            dest[i + 1] = SRGBToLinear(src[i + 1]);
+            dest[i + 2] = SRGBToLinear(src[i + 2]);
+            dest[i + 3] = static_cast<float>(src[i + 3]) * (1.0f / 255.0f);
+        }
+    }
+
+    void FloatToUNorm8(float const* src, uint8_t* dest, size_t values) {
+        size_t i = 0;
+#if OKAMI_SIMD_SSE2
+        __m128 scale = _mm_set1_ps(255.0f);
+        for (; i + 16 <= values; i += 16) {
+            __m128i a = EncodeUNorm8x4(_mm_loadu_ps(&src[i + 0]), scale);
+            __m128i b = EncodeUNorm8x4(_mm_loadu_ps(&src[i + 4]), scale);
+            __m128i c = EncodeUNorm8x4(_mm_loadu_ps(&src[i + 8]), scale);
+            __m128i d = EncodeUNorm8x4(_mm_loadu_ps(&src[i + 12]), scale);
+            __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), bytes);
+        }
+#endif
+        for (; i < values; ++i) {
+            dest[i] = EncodeUNorm8(src[i]);
+        }
+    }
+
+    void FloatToSRGBA8(float const* src, uint8_t* dest, size_t count) {
+        auto const& encode = GetSRGBTables().encode;
+        size_t i = 0;
+#if OKAMI_SIMD_SSE2
+        // Four pixels of table indices at a time, the lookups themselves
+        // stay scalar as there is no gather in SSE2
+        __m128 scale = _mm_set1_ps(65535.0f);
+        for (; i + 4 <= count; i += 4) {
+            alignas(16) uint32_t indices[16];
+            for (size_t k = 0; k < 4; ++k) {
+                _mm_store_si128(reinterpret_cast<__m128i*>(&indices[k * 4]),
+                    EncodeUNorm8x4(_mm_loadu_ps(&src[(i + k) * 4]), scale));
+            }
+            for (size_t k = 0; k < 4; ++k) {
+                dest[(i + k) * 4 + 0] = encode[indices[k * 4 + 0]];
+                dest[(i + k) * 4 + 1] = encode[indices[k * 4 + 1]];
+                dest[(i + k) * 4 + 2] = encode[indices[k * 4 + 2]];
+                dest[(i + k) * 4 + 3] = EncodeUNorm8(src[(i + k) * 4 + 3]);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            dest[i * 4 + 0] = EncodeSRGB8(src[i * 4 + 0]);
+            dest[i * 4 + 1] = EncodeSRGB8(src[i * 4 + 1]);
+            dest[i * 4 + 2] = EncodeSRGB8(src[i * 4 + 2]);
+            dest[i * 4 + 3] = EncodeUNorm8(src[i * 4 + 3]);
+        }
+    }
+
+    void FloatToHalf(float const* src, uint8_t* dest, size_t values) {
+        size_t i = 0;
+#if OKAMI_SIMD_SSE2
+        for (; i + 8 <= values; i += 8) {
+            __m128i lo = FloatToHalf4(_mm_loadu_ps(&src[i + 0]));
+            __m128i hi = FloatToHalf4(_mm_loadu_ps(&src[i + 4]));
+            // packs would saturate the halves with their top bit set
+            lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+            hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i * 2]), _mm_packs_epi32(lo, hi));
+        }
+#endif
+        for (; i < values; ++i) {
+            uint16_t half = FloatToHalf(src[i]);
+            std::memcpy(&dest[i * 2], &half, 2);
+        }
+    }
+
+    void HalfToFloat(uint8_t const* src, float* dest, size_t values) {
+        size_t i = 0;
+#if OKAMI_SIMD_SSE2
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= values; i += 8) {
+            __m128i halves = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&src[i * 2]));
+            _mm_storeu_ps(&dest[i + 0], HalfToFloat4(_mm_unpacklo_epi16(halves, zero)));
+            _mm_storeu_ps(&dest[i + 4], HalfToFloat4(_mm_unpackhi_epi16(halves, zero)));
+        }
+#endif
+        for (; i < values; ++i) {
+            uint16_t half;
+            std::memcpy(&half, &src[i * 2], 2);
+            dest[i] = HalfToFloat(half);
+        }
+    }
+
+    // Conversions that have a dedicated path, returns false for the rest
+    bool ConvertFast(Format const& srcFormat, Format const& dstFormat,
+        uint8_t const* src, uint8_t* dest, size_t count) {
+        bool sameEncoding = srcFormat.isLinear == dstFormat.isLinear;
+        uint32_t channels = srcFormat.channels;
+        size_t values = count * channels;
+
+        if (srcFormat.valueType == dstFormat.valueType && channels == dstFormat.channels) {
+            if (sameEncoding) {
+                std::memcpy(dest, src, count * srcFormat.GetPixelByteSize());
+                return true;
+            }
+            if (IsUNorm8(srcFormat, 4)) {
+                auto const& tables = GetSRGBTables();
+                TransferRGBA8(src, dest, count, dstFormat.isLinear ? tables.toLinear : tables.toSRGB);
+                return true;
+            }
+            return false;
+        }
+
+        if (IsUNorm8(srcFormat, 3) && IsUNorm8(dstFormat, 4) && sameEncoding) {
+            ExpandRGB8(src, dest, count);
+            return true;
+        }
+
+        if (channels != dstFormat.channels) {
+            return false;
+        }
+
+        if (srcFormat.valueType == ValueType::UINT8 && IsFloat(dstFormat, ValueType::FLOAT32, channels)) {
+            if (sameEncoding) {
+                UNorm8ToFloat(src, reinterpret_cast<float*>(dest), values);
+                return true;
+            } else if (channels == 4 && dstFormat.isLinear) {
+                SRGBA8ToFloat(src, reinterpret_cast<float*>(dest), count);
+                return true;
+            }
+        } else if (IsFloat(srcFormat, ValueType::FLOAT32, channels) && dstFormat.valueType == ValueType::UINT8) {
+            if (sameEncoding) {
+                FloatToUNorm8(reinterpret_cast<float const*>(src), dest, values);
+                return true;
+            } else if (channels == 4 && srcFormat.isLinear) {
+                FloatToSRGBA8(reinterpret_cast<float const*>(src), dest, count);
+                return true;
+            }
+        } else if (sameEncoding && IsFloat(srcFormat, ValueType::FLOAT32, channels)
+            && dstFormat.valueType == ValueType::FLOAT16) {
+            FloatToHalf(reinterpret_cast<float const*>(src), dest, values);
+            return true;
+        } else if (sameEncoding && IsFloat(srcFormat, ValueType::FLOAT16, channels)
+            && dstFormat.valueType == ValueType::FLOAT32) {
+            HalfToFloat(src, reinterpret_cast<float*>(dest), values);
+            return true;
+        }
+        return false;
+    }
+
+    // Expands to RGBA with missing channels as 0, and alpha as 1
+    void Decode(Format const& format, uint8_t const* src, size_t count,
+        bool toLinear, float* rgba) {
+        uint32_t channels = format.channels;
+        size_t valueSize = GetSize(format.valueType);
+        for (size_t i = 0; i < count; ++i) {
+            float* texel = &rgba[i * 4];
+            texel[0] = texel[1] = texel[2] = 0.0f;
+            texel[3] = 1.0f;
+
+            for (uint32_t c = 0; c < channels; ++c) {
+                uint8_t const* value = &src[(i * channels + c) * valueSize];
+                bool transfer = toLinear && c < 3;
+                switch (format.valueType) {
+                    case ValueType::UINT8:
+                        texel[c] = transfer ? SRGBToLinear(*value) : static_cast<float>(*value) * (1.0f / 255.0f);
+                        continue;
+                    case ValueType::FLOAT16: {
+                        uint16_t half;
+                        std::memcpy(&half, value, 2);
+                        texel[c] = HalfToFloat(half);
+                        break;
+                    }
+                    default:
+                        std::memcpy(&texel[c], value, 4);
+                        break;
+                }
+                if (transfer) {
+                    texel[c] = SRGBToLinear(texel[c]);
+                }
+            }
+        }
+    }
+
+    void Encode(Format const& format, float const* rgba, size_t count,
+        bool toSRGB, uint8_t* dest) {
+        uint32_t channels = format.channels;
+        size_t valueSize = GetSize(format.valueType);
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                uint8_t* value = &dest[(i * channels + c) * valueSize];
+                bool transfer = toSRGB && c < 3;
+                float x = rgba[i * 4 + c];
+                switch (format.valueType) {
+                    case ValueType::UINT8:
+                        *value = transfer ? EncodeSRGB8(x) : EncodeUNorm8(x);
+                        break;
+                    case ValueType::FLOAT16: {
+                        uint16_t half = FloatToHalf(transfer ? LinearToSRGB(x) : x);
+                        std::memcpy(value, &half, 2);
+                        break;
+                    }
+                    default:
+                        x = transfer ? LinearToSRGB(x) : x;
+                        std::memcpy(value, &x, 4);
+                        break;
+                }
+            }
+        }
+    }
+}
+
+void texture::ConvertPixels(Format const& srcFormat,
+    Format const& dstFormat,
+    std::span<uint8_t const> source,
+    std::span<uint8_t> dest) {
+
+    if (!IsConvertible(srcFormat) || !IsConvertible(dstFormat)) {
+        throw std::runtime_error("Pixel conversion is not supported for this format!");
+    }
+
+    size_t srcPixelSize = srcFormat.GetPixelByteSize();
+    size_t dstPixelSize = dstFormat.GetPixelByteSize();
+    size_t count = source.size() / srcPixelSize;
+    if (source.size() % srcPixelSize != 0 || dest.size() < count * dstPixelSize) {
+        throw std::runtime_error("Pixel conversion destination does not match the source!");
+    }
+
+    if (ConvertFast(srcFormat, dstFormat, source.data(), dest.data(), count)) {
+        return;
+    }
+
+    std::array<float, kConvertChunkPixels * 4> rgba;
+
+    // Chains two fast paths through FLOAT32 where there are both, such as
+    // for sRGB RGBA8 to linear FLOAT16. The formats decide whether they
+    // exist, so only the first chunk can fail.
+    size_t converted = 0;
+    if (srcFormat.channels == dstFormat.channels) {
+        Format floatFormat{srcFormat.channels, ValueType::FLOAT32, false, dstFormat.isLinear};
+        auto floats = reinterpret_cast<uint8_t*>(rgba.data());
+        for (; converted < count; converted += kConvertChunkPixels) {
+            size_t chunk = std::min(kConvertChunkPixels, count - converted);
+            if (!ConvertFast(srcFormat, floatFormat, &source[converted * srcPixelSize], floats, chunk)
+                || !ConvertFast(floatFormat, dstFormat, floats, &dest[converted * dstPixelSize], chunk)) {
+                break;
+            }
+        }
+    }
+
+    bool toLinear = !srcFormat.isLinear && dstFormat.isLinear;
+    bool toSRGB = srcFormat.isLinear && !dstFormat.isLinear;
+    for (size_t i = converted; i < count; i += kConvertChunkPixels) {
+        size_t chunk = std::min(kConvertChunkPixels, count - i);
+        Decode(srcFormat, &source[i * srcPixelSize], chunk, toLinear, rgba.data());
+        Encode(dstFormat, rgba.data(), chunk, toSRGB, &dest[i * dstPixelSize]);
+    }
+}
+
+Buffer texture::ConvertPixels(Buffer const& source, Format const& format) {
+    return ConvertPixels(ThreadPool::Default(), source, format);
+}
+
+Buffer texture::ConvertPixels(ThreadPool& pool, Buffer const& source, Format const& format) {
+    if (source.desc.format.IsCompressed() || format.IsCompressed()) {
+        throw std::runtime_error("Pixel conversion is not supported for compressed textures!");
+    }
+
+    Desc desc = source.desc;
+    desc.format = format;
+    auto result = Buffer::Alloc(desc);
+
+    // Subresources are packed back to back, so the data is one long run
+    size_t srcPixelSize = source.desc.format.GetPixelByteSize();
+    size_t dstPixelSize = format.GetPixelByteSize();
+    size_t count = source.data.size() / srcPixelSize;
+    size_t bandCount = (count + kConvertBandPixels - 1) / kConvertBandPixels;
+
+    pool.ParallelFor(bandCount, [&](size_t band) {
+        size_t begin = band * kConvertBandPixels;
+        size_t end = std::min(count, begin + kConvertBandPixels);
+        ConvertPixels(source.desc.format, format,
+            std::span{&source.data[begin * srcPixelSize], (end - begin) * srcPixelSize},
+            std::span{&result.data[begin * dstPixelSize], (end - begin) * dstPixelSize});
+    });
+
+    return result;
+}
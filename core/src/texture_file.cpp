@@ -0,0 +1,640 @@
+#include <okami/texture_file.hpp>
+#include <okami/mesh_file.hpp>
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    // Bumped whenever cooked output would change for the same input
+    constexpr uint32_t kTextureCookVersion = 2;
+
+    struct KTX2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(KTX2Header) == 80);
+
+    struct KTX2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    struct DDSPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rMask;
+        uint32_t gMask;
+        uint32_t bMask;
+        uint32_t aMask;
+    };
+
+    struct DDSHeader {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DDSPixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(DDSHeader) == 124);
+
+    struct DDSHeaderDX10 {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+        return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) |
+            ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+    }
+
+    constexpr uint32_t kDDSMagic = MakeFourCC('D', 'D', 'S', ' ');
+    constexpr uint32_t kDDSPixelFormatFourCC = 0x4;
+    constexpr uint32_t kDDSPixelFormatRGB = 0x40;
+    constexpr uint32_t kDDSPixelFormatLuminance = 0x20000;
+    constexpr uint32_t kDDSCaps2Cubemap = 0x200;
+    constexpr uint32_t kDDSCaps2Volume = 0x200000;
+    constexpr uint32_t kDDSResourceMiscCube = 0x4;
+    constexpr uint32_t kDDSDimensionTexture2D = 3;
+
+    Format MakeFormat(uint32_t channels, ValueType valueType, bool isNormalized, bool isLinear = true) {
+        return Format{channels, valueType, isNormalized, isLinear};
+    }
+
+    Format FromVkFormat(uint32_t vkFormat) {
+        switch (vkFormat) {
+            case 9: return MakeFormat(1, ValueType::UINT8, true);
+            case 15: return MakeFormat(1, ValueType::UINT8, true, false);
+            case 16: return MakeFormat(2, ValueType::UINT8, true);
+            case 22: return MakeFormat(2, ValueType::UINT8, true, false);
+            case 23: return MakeFormat(3, ValueType::UINT8, true);
+            case 29: return MakeFormat(3, ValueType::UINT8, true, false);
+            case 37: return Format::RGBA8_UNORM();
+            case 43: return Format::SRGBA8_UNORM();
+            case 70: return MakeFormat(1, ValueType::UINT16, true);
+            case 76: return MakeFormat(1, ValueType::FLOAT16, false);
+            case 77: return MakeFormat(2, ValueType::UINT16, true);
+            case 83: return MakeFormat(2, ValueType::FLOAT16, false);
+            case 84: return MakeFormat(3, ValueType::UINT16, true);
+            case 90: return MakeFormat(3, ValueType::FLOAT16, false);
+            case 91: return MakeFormat(4, ValueType::UINT16, true);
+            case 97: return MakeFormat(4, ValueType::FLOAT16, false);
+            case 100: return Format::R32_FLOAT();
+            case 103: return Format::RG32_FLOAT();
+            case 106: return Format::RGB32_FLOAT();
+            case 109: return Format::RGBA32_FLOAT();
+            // The RGBA variants of BC1 lose their punch through alpha
+            case 131: case 133: return Format::BC1_UNORM();
+            case 132: case 134: return Format::BC1_SRGB();
+            case 137: return Format::BC3_UNORM();
+            case 138: return Format::BC3_SRGB();
+            case 139: return Format::BC4_UNORM();
+            case 141: return Format::BC5_UNORM();
+            case 145: return Format::BC7_UNORM();
+            case 146: return Format::BC7_SRGB();
+            default: return Format::UNKNOWN();
+        }
+    }
+
+    uint32_t ToVkFormat(Format const& format) {
+        static constexpr uint32_t kVkFormats[] = {
+            9, 15, 16, 22, 23, 29, 37, 43, 70, 76, 77, 83, 84, 90, 91, 97,
+            100, 103, 106, 109, 131, 132, 137, 138, 139, 141, 145, 146
+        };
+        for (auto vkFormat : kVkFormats) {
+            if (FromVkFormat(vkFormat) == format) {
+                return vkFormat;
+            }
+        }
+        return 0;
+    }
+
+    Format FromDXGIFormat(uint32_t dxgiFormat) {
+        switch (dxgiFormat) {
+            case 2: return Format::RGBA32_FLOAT();
+            case 6: return Format::RGB32_FLOAT();
+            case 10: return MakeFormat(4, ValueType::FLOAT16, false);
+            case 11: return Format::RGBA16_UNORM();
+            case 16: return Format::RG32_FLOAT();
+            case 28: return Format::RGBA8_UNORM();
+            case 29: return Format::SRGBA8_UNORM();
+            case 34: return MakeFormat(2, ValueType::FLOAT16, false);
+            case 35: return MakeFormat(2, ValueType::UINT16, true);
+            case 41: return Format::R32_FLOAT();
+            case 49: return MakeFormat(2, ValueType::UINT8, true);
+            case 54: return MakeFormat(1, ValueType::FLOAT16, false);
+            case 56: return MakeFormat(1, ValueType::UINT16, true);
+            case 61: return MakeFormat(1, ValueType::UINT8, true);
+            case 71: return Format::BC1_UNORM();
+            case 72: return Format::BC1_SRGB();
+            case 77: return Format::BC3_UNORM();
+            case 78: return Format::BC3_SRGB();
+            case 80: return Format::BC4_UNORM();
+            case 83: return Format::BC5_UNORM();
+            case 98: return Format::BC7_UNORM();
+            case 99: return Format::BC7_SRGB();
+            default: return Format::UNKNOWN();
+        }
+    }
+
+    Format FromDDSPixelFormat(DDSPixelFormat const& pixelFormat) {
+        if (pixelFormat.flags & kDDSPixelFormatFourCC) {
+            switch (pixelFormat.fourCC) {
+                case MakeFourCC('D', 'X', 'T', '1'): return Format::BC1_UNORM();
+                case MakeFourCC('D', 'X', 'T', '5'): return Format::BC3_UNORM();
+                case MakeFourCC('A', 'T', 'I', '1'):
+                case MakeFourCC('B', 'C', '4', 'U'): return Format::BC4_UNORM();
+                case MakeFourCC('A', 'T', 'I', '2'):
+                case MakeFourCC('B', 'C', '5', 'U'): return Format::BC5_UNORM();
+                // D3DFORMAT values stored in place of a four character code
+                case 36: return Format::RGBA16_UNORM();
+                case 111: return MakeFormat(1, ValueType::FLOAT16, false);
+                case 112: return MakeFormat(2, ValueType::FLOAT16, false);
+                case 113: return MakeFormat(4, ValueType::FLOAT16, false);
+                case 114: return Format::R32_FLOAT();
+                case 115: return Format::RG32_FLOAT();
+                case 116: return Format::RGBA32_FLOAT();
+                default: return Format::UNKNOWN();
+            }
+        }
+
+        if ((pixelFormat.flags & kDDSPixelFormatRGB) && pixelFormat.rgbBitCount == 32 &&
+            pixelFormat.rMask == 0xFF && pixelFormat.gMask == 0xFF00 &&
+            pixelFormat.bMask == 0xFF0000) {
+            return Format::RGBA8_UNORM();
+        }
+
+        if ((pixelFormat.flags & kDDSPixelFormatLuminance) && pixelFormat.rgbBitCount == 8) {
+            return MakeFormat(1, ValueType::UINT8, true);
+        }
+
+        return Format::UNKNOWN();
+    }
+
+    uint64_t GetImageByteSize(Format const& format, uint32_t width, uint32_t height) {
+        uint32_t blockDim = format.GetBlockDimension();
+        uint64_t blocksWide = (width + blockDim - 1) / blockDim;
+        uint64_t blocksHigh = (height + blockDim - 1) / blockDim;
+        return blocksWide * blocksHigh * format.GetBlockByteSize();
+    }
+
+    bool InFile(uint64_t offset, uint64_t size, size_t fileSize) {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    // Sums the bytes of every image of every level, failing as soon as the
+    // sum could no longer fit in the file. Checked before allocating, so a
+    // corrupt header cannot ask for more memory than the file holds.
+    bool FitsInFile(Format const& format, uint32_t width, uint32_t height,
+        uint32_t levelCount, uint64_t imageCount, uint64_t fileSize) {
+        uint32_t blockDim = format.GetBlockDimension();
+        uint64_t total = 0;
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint64_t blocksWide = (std::max(1u, width >> level) + blockDim - 1) / blockDim;
+            uint64_t blocksHigh = (std::max(1u, height >> level) + blockDim - 1) / blockDim;
+            if (blocksHigh > fileSize / blocksWide) {
+                return false;
+            }
+            uint64_t imageSize = blocksWide * blocksHigh * format.GetBlockByteSize();
+            if (imageSize == 0 || imageCount > fileSize / imageSize) {
+                return false;
+            }
+            total += imageSize * imageCount;
+            if (total > fileSize) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Dimension GetDimension(uint32_t faceCount, bool isArray) {
+        if (faceCount == 6) {
+            return isArray ? Dimension::TextureCubeArray : Dimension::TextureCube;
+        } else {
+            return isArray ? Dimension::Texture2DArray : Dimension::Texture2D;
+        }
+    }
+
+    // Describes the texel layout of format as a KTX2 basic data format
+    // descriptor, which KTX2 requires even though we read vkFormat instead
+    std::vector<uint32_t> MakeDataFormatDescriptor(Format const& format) {
+        constexpr uint32_t kChannelAlpha = 15;
+        constexpr uint32_t kSampleLinear = 0x10;
+        constexpr uint32_t kSampleSigned = 0x40;
+        constexpr uint32_t kSampleFloat = 0x80;
+
+        struct Sample {
+            uint32_t bitOffset;
+            uint32_t bitLength;
+            uint32_t channelType;
+            uint32_t lower;
+            uint32_t upper;
+        };
+
+        std::vector<Sample> samples;
+        uint32_t colorModel = 1;
+        uint32_t alphaFlag = format.isLinear ? 0 : kSampleLinear;
+
+        switch (format.compression) {
+            case Compression::BC1:
+                colorModel = 128;
+                samples.emplace_back(Sample{0, 64, 0, 0, 0xFFFFFFFF});
+                break;
+            case Compression::BC3:
+                colorModel = 130;
+                samples.emplace_back(Sample{0, 64, kChannelAlpha | alphaFlag, 0, 0xFFFFFFFF});
+                samples.emplace_back(Sample{64, 64, 0, 0, 0xFFFFFFFF});
+                break;
+            case Compression::BC4:
+                colorModel = 131;
+                samples.emplace_back(Sample{0, 64, 0, 0, 0xFFFFFFFF});
+                break;
+            case Compression::BC5:
+                colorModel = 132;
+                samples.emplace_back(Sample{0, 64, 0, 0, 0xFFFFFFFF});
+                samples.emplace_back(Sample{64, 64, 1, 0, 0xFFFFFFFF});
+                break;
+            case Compression::BC7:
+                colorModel = 134;
+                samples.emplace_back(Sample{0, 128, 0, 0, 0xFFFFFFFF});
+                break;
+            default: {
+                uint32_t bits = GetSize(format.valueType) * 8;
+                bool isFloat = format.valueType == ValueType::FLOAT16 ||
+                    format.valueType == ValueType::FLOAT32;
+                uint32_t flags = isFloat ? kSampleFloat | kSampleSigned : 0;
+                uint32_t lower = isFloat ? 0xBF800000 : 0;
+                uint32_t upper = isFloat ? 0x3F800000 : (uint32_t)((1ull << bits) - 1);
+                for (uint32_t c = 0; c < format.channels; ++c) {
+                    uint32_t channel = c == 3 ? kChannelAlpha | alphaFlag : c;
+                    samples.emplace_back(Sample{c * bits, bits, channel | flags, lower, upper});
+                }
+                break;
+            }
+        }
+
+        uint32_t blockDim = format.GetBlockDimension() - 1;
+        uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+
+        std::vector<uint32_t> words;
+        words.emplace_back(4 + blockSize);
+        words.emplace_back(0);
+        words.emplace_back(2 | (blockSize << 16));
+        // BT.709 primaries, with a linear or sRGB transfer function
+        words.emplace_back(colorModel | (1u << 8) | ((format.isLinear ? 1u : 2u) << 16));
+        words.emplace_back(blockDim | (blockDim << 8));
+        words.emplace_back(format.GetBlockByteSize());
+        words.emplace_back(0);
+        for (auto const& sample : samples) {
+            words.emplace_back(sample.bitOffset | ((sample.bitLength - 1) << 16) |
+                (sample.channelType << 24));
+            words.emplace_back(0);
+            words.emplace_back(sample.lower);
+            words.emplace_back(sample.upper);
+        }
+        return words;
+    }
+
+    std::vector<uint8_t> MakeKeyValueData() {
+        constexpr char kEntry[] = "KTXwriter\0okami";
+        uint32_t length = sizeof(kEntry);
+
+        std::vector<uint8_t> bytes(sizeof(length) + length);
+        std::memcpy(bytes.data(), &length, sizeof(length));
+        std::memcpy(&bytes[sizeof(length)], kEntry, length);
+        bytes.resize((bytes.size() + 3) / 4 * 4, 0);
+        return bytes;
+    }
+
+    Error WriteFileAtomic(std::filesystem::path const& path, std::vector<uint8_t> const& file) {
+        // Write to a temporary first, so that readers never see a partial file
+        auto tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            OKAMI_ERR_RETURN_IF(!stream, InvalidPathError{tempPath.string()});
+            stream.write(reinterpret_cast<char const*>(file.data()), file.size());
+            OKAMI_ERR_RETURN_IF(!stream, RuntimeError{"Failed to write texture!"});
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        OKAMI_ERR_RETURN_IF(ec, RuntimeError{"Failed to move texture into place!"});
+
+        return {};
+    }
+}
+
+Expected<Buffer> okami::texture::ParseKTX2(std::span<uint8_t const> bytes) {
+    OKAMI_EXP_RETURN_IF(bytes.size() < sizeof(KTX2Header),
+        RuntimeError{"File is too small to be a KTX2!"});
+
+    KTX2Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    OKAMI_EXP_RETURN_IF(std::memcmp(header.identifier, kKTX2Identifier, sizeof(kKTX2Identifier)) != 0,
+        RuntimeError{"File is not a KTX2!"});
+    OKAMI_EXP_RETURN_IF(header.supercompressionScheme != 0,
+        RuntimeError{"Supercompressed KTX2 files are not supported!"});
+    OKAMI_EXP_RETURN_IF(header.pixelHeight == 0 || header.pixelDepth != 0,
+        RuntimeError{"Only 2D KTX2 textures are supported!"});
+    OKAMI_EXP_RETURN_IF(header.faceCount != 1 && header.faceCount != 6,
+        RuntimeError{"Corrupt KTX2 face count!"});
+
+    auto format = FromVkFormat(header.vkFormat);
+    OKAMI_EXP_RETURN_IF(format == Format::UNKNOWN(),
+        RuntimeError{"Unsupported KTX2 format!"});
+
+    // Zero levels asks the loader to generate mips, which we leave to
+    // whoever cooked the file
+    uint32_t levelCount = std::max(1u, header.levelCount);
+    uint64_t layerCount = std::max(1u, header.layerCount);
+    OKAMI_EXP_RETURN_IF(layerCount * header.faceCount > std::numeric_limits<uint32_t>::max(),
+        RuntimeError{"Corrupt KTX2 layer count!"});
+    uint32_t imageCount = (uint32_t)(layerCount * header.faceCount);
+
+    OKAMI_EXP_RETURN_IF(levelCount > MipCount(header.pixelWidth, header.pixelHeight),
+        RuntimeError{"Corrupt KTX2 level count!"});
+    OKAMI_EXP_RETURN_IF(!InFile(sizeof(KTX2Header), levelCount * sizeof(KTX2LevelIndex), bytes.size()),
+        RuntimeError{"Corrupt KTX2 level index!"});
+    OKAMI_EXP_RETURN_IF(!FitsInFile(format, header.pixelWidth, header.pixelHeight,
+        levelCount, imageCount, bytes.size()),
+        RuntimeError{"KTX2 file is truncated!"});
+
+    Desc desc;
+    desc.type = GetDimension(header.faceCount, header.layerCount > 0);
+    desc.width = header.pixelWidth;
+    desc.height = header.pixelHeight;
+    desc.arraySizeOrDepth = imageCount;
+    desc.format = format;
+    desc.mipLevels = levelCount;
+
+    auto result = Buffer::Alloc(desc);
+    auto subresources = desc.GetSubresourceDescs();
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        KTX2LevelIndex index;
+        std::memcpy(&index, &bytes[sizeof(KTX2Header) + level * sizeof(KTX2LevelIndex)], sizeof(index));
+
+        // Images of a level are stored layer by layer, face by face
+        uint64_t imageSize = GetImageByteSize(format,
+            std::max(1u, desc.width >> level), std::max(1u, desc.height >> level));
+        OKAMI_EXP_RETURN_IF(index.byteLength < imageSize * imageCount ||
+            !InFile(index.byteOffset, imageSize * imageCount, bytes.size()),
+            RuntimeError{"Corrupt KTX2 level index!"});
+
+        for (uint32_t image = 0; image < imageCount; ++image) {
+            auto const& subresource = subresources[image * levelCount + level];
+            std::memcpy(&result.data[subresource.srcOffset],
+                &bytes[index.byteOffset + image * imageSize], imageSize);
+        }
+    }
+
+    return result;
+}
+
+Expected<Buffer> okami::texture::ParseDDS(std::span<uint8_t const> bytes) {
+    OKAMI_EXP_RETURN_IF(bytes.size() < sizeof(uint32_t) + sizeof(DDSHeader),
+        RuntimeError{"File is too small to be a DDS!"});
+
+    uint32_t magic;
+    std::memcpy(&magic, bytes.data(), sizeof(magic));
+    OKAMI_EXP_RETURN_IF(magic != kDDSMagic, RuntimeError{"File is not a DDS!"});
+
+    DDSHeader header;
+    std::memcpy(&header, &bytes[sizeof(magic)], sizeof(header));
+    OKAMI_EXP_RETURN_IF(header.size != sizeof(DDSHeader),
+        RuntimeError{"Corrupt DDS header!"});
+    OKAMI_EXP_RETURN_IF(header.caps2 & kDDSCaps2Volume,
+        RuntimeError{"Only 2D DDS textures are supported!"});
+
+    size_t offset = sizeof(magic) + sizeof(DDSHeader);
+    Format format;
+    uint32_t faceCount = (header.caps2 & kDDSCaps2Cubemap) ? 6 : 1;
+    uint32_t arraySize = 1;
+    bool isArray = false;
+
+    if ((header.pixelFormat.flags & kDDSPixelFormatFourCC) &&
+        header.pixelFormat.fourCC == MakeFourCC('D', 'X', '1', '0')) {
+        OKAMI_EXP_RETURN_IF(bytes.size() < offset + sizeof(DDSHeaderDX10),
+            RuntimeError{"Corrupt DDS header!"});
+
+        DDSHeaderDX10 dx10;
+        std::memcpy(&dx10, &bytes[offset], sizeof(dx10));
+        offset += sizeof(dx10);
+
+        OKAMI_EXP_RETURN_IF(dx10.resourceDimension != kDDSDimensionTexture2D,
+            RuntimeError{"Only 2D DDS textures are supported!"});
+
+        format = FromDXGIFormat(dx10.dxgiFormat);
+        faceCount = (dx10.miscFlag & kDDSResourceMiscCube) ? 6 : 1;
+        arraySize = std::max(1u, dx10.arraySize);
+        isArray = arraySize > 1;
+    } else {
+        format = FromDDSPixelFormat(header.pixelFormat);
+    }
+
+    OKAMI_EXP_RETURN_IF(format == Format::UNKNOWN(),
+        RuntimeError{"Unsupported DDS format!"});
+
+    uint32_t levelCount = std::max(1u, header.mipMapCount);
+    OKAMI_EXP_RETURN_IF(levelCount > MipCount(header.width, header.height),
+        RuntimeError{"Corrupt DDS mip count!"});
+    OKAMI_EXP_RETURN_IF((uint64_t)arraySize * faceCount > std::numeric_limits<uint32_t>::max(),
+        RuntimeError{"Corrupt DDS array size!"});
+    OKAMI_EXP_RETURN_IF(!FitsInFile(format, header.width, header.height,
+        levelCount, (uint64_t)arraySize * faceCount, bytes.size() - offset),
+        RuntimeError{"DDS file is truncated!"});
+
+    Desc desc;
+    desc.type = GetDimension(faceCount, isArray);
+    desc.width = header.width;
+    desc.height = header.height;
+    desc.arraySizeOrDepth = arraySize * faceCount;
+    desc.format = format;
+    desc.mipLevels = levelCount;
+
+    auto result = Buffer::Alloc(desc);
+
+    // DDS stores every mip of a slice before the next slice, which is the
+    // layout of Buffer too
+    for (auto const& subresource : desc.GetSubresourceDescs()) {
+        uint64_t imageSize = GetImageByteSize(format,
+            std::max(1u, desc.width >> subresource.mip),
+            std::max(1u, desc.height >> subresource.mip));
+        OKAMI_EXP_RETURN_IF(!InFile(offset, imageSize, bytes.size()),
+            RuntimeError{"DDS file is truncated!"});
+
+        std::memcpy(&result.data[subresource.srcOffset], &bytes[offset], imageSize);
+        offset += imageSize;
+    }
+
+    return result;
+}
+
+Error okami::texture::WriteKTX2(std::filesystem::path const& path, Buffer const& buffer) {
+    auto const& desc = buffer.desc;
+    auto const& format = desc.format;
+
+    uint32_t vkFormat = ToVkFormat(format);
+    OKAMI_ERR_RETURN_IF(vkFormat == 0, RuntimeError{"Texture format has no KTX2 equivalent!"});
+
+    uint32_t faceCount = 1;
+    switch (desc.type) {
+        case Dimension::Texture2D:
+        case Dimension::Texture2DArray:
+            break;
+        case Dimension::TextureCube:
+        case Dimension::TextureCubeArray:
+            faceCount = 6;
+            break;
+        default:
+            return OKAMI_ERR_MAKE(RuntimeError{"Only 2D textures can be written to KTX2!"});
+    }
+
+    uint32_t levelCount = desc.GetMipCount();
+    uint32_t imageCount = desc.GetArraySize();
+    auto subresources = desc.GetSubresourceDescs();
+
+    KTX2Header header{};
+    std::memcpy(header.identifier, kKTX2Identifier, sizeof(kKTX2Identifier));
+    header.vkFormat = vkFormat;
+    header.typeSize = format.IsCompressed() ? 1 : GetSize(format.valueType);
+    header.pixelWidth = desc.width;
+    header.pixelHeight = desc.height;
+    header.layerCount = IsArray(desc.type) && desc.type != Dimension::TextureCube ?
+        imageCount / faceCount : 0;
+    header.faceCount = faceCount;
+    header.levelCount = levelCount;
+
+    auto dfd = MakeDataFormatDescriptor(format);
+    auto kvd = MakeKeyValueData();
+
+    size_t offset = sizeof(KTX2Header) + levelCount * sizeof(KTX2LevelIndex);
+    header.dfdByteOffset = (uint32_t)offset;
+    header.dfdByteLength = (uint32_t)(dfd.size() * sizeof(uint32_t));
+    offset += header.dfdByteLength;
+    header.kvdByteOffset = (uint32_t)offset;
+    header.kvdByteLength = (uint32_t)kvd.size();
+    offset += header.kvdByteLength;
+
+    // Levels are stored smallest first, each aligned to both the block
+    // size and 4 bytes
+    size_t alignment = std::lcm<size_t>(format.GetBlockByteSize(), 4);
+    std::vector<KTX2LevelIndex> levels(levelCount);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        uint64_t imageSize = GetImageByteSize(format,
+            std::max(1u, desc.width >> level), std::max(1u, desc.height >> level));
+        offset = (offset + alignment - 1) / alignment * alignment;
+        levels[level] = KTX2LevelIndex{offset, imageSize * imageCount, imageSize * imageCount};
+        offset += imageSize * imageCount;
+    }
+
+    std::vector<uint8_t> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(&file[sizeof(header)], levels.data(), levels.size() * sizeof(KTX2LevelIndex));
+    std::memcpy(&file[header.dfdByteOffset], dfd.data(), header.dfdByteLength);
+    std::memcpy(&file[header.kvdByteOffset], kvd.data(), kvd.size());
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        uint64_t imageSize = levels[level].byteLength / imageCount;
+        for (uint32_t image = 0; image < imageCount; ++image) {
+            auto const& subresource = subresources[image * levelCount + level];
+            std::memcpy(&file[levels[level].byteOffset + image * imageSize],
+                &buffer.data[subresource.srcOffset], imageSize);
+        }
+    }
+
+    return WriteFileAtomic(path, file);
+}
+
+Expected<std::filesystem::path> okami::texture::CookTexture(
+    std::filesystem::path const& source,
+    std::filesystem::path const& cacheDirectory,
+    LoadParams const& params) {
+
+    std::vector<uint8_t> sourceBytes;
+    {
+        std::ifstream stream(source, std::ios::binary);
+        OKAMI_EXP_RETURN_IF(!stream, InvalidPathError{source.string()});
+        sourceBytes.assign(std::istreambuf_iterator<char>(stream),
+            std::istreambuf_iterator<char>());
+    }
+
+    // The cooked result depends on the source and on how it is decoded
+    uint32_t key[] = {
+        kTextureCookVersion,
+        params.generateMips,
+        params.isSRGB,
+        (uint32_t)params.mipFilter,
+        params.alphaWeightedMips,
+        (uint32_t)params.compression,
+        (uint32_t)params.valueType
+    };
+    uint64_t hash = geometry::HashBytes(
+        std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(key), sizeof(key)),
+        geometry::HashBytes(sourceBytes));
+
+    std::stringstream name;
+    name << source.stem().string() << "."
+        << std::hex << std::setw(16) << std::setfill('0') << hash
+        << kKTX2Extension;
+    auto cooked = cacheDirectory / name.str();
+
+    // The hash is in the name and files are moved into place whole, so an
+    // existing file is up to date
+    if (std::filesystem::exists(cooked)) {
+        return cooked;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    OKAMI_EXP_RETURN_IF(ec, InvalidPathError{cacheDirectory.string()});
+
+    PLOG_INFO << "Cooking texture " << source << " to " << cooked;
+
+    Error err;
+    auto buffer = OKAMI_EXP_UNWRAP(Buffer::Load(source, params), err);
+
+    err = WriteKTX2(cooked, buffer);
+    OKAMI_EXP_RETURN(err);
+
+    return cooked;
+}
@@ -0,0 +1,124 @@
+#include <okami/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+using namespace okami;
+
+namespace {
+    struct ParallelForState {
+        std::function<void(size_t)> const* body;
+        size_t count;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        // Runs iterations until there are none left
+        void Work() {
+            size_t finished = 0;
+            for (size_t i = next++; i < count; i = next++) {
+                try {
+                    (*body)(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+                ++finished;
+            }
+
+            if (finished > 0 && (done += finished) == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                condition.notify_all();
+            }
+        }
+    };
+}
+
+okami::ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    _workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        _workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+okami::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void okami::ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void okami::ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.emplace_back(std::move(task));
+    }
+    _condition.notify_one();
+}
+
+void okami::ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> const& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || _workers.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    // Helpers may only get to run after the loop is over, so they share
+    // ownership of the state rather than referencing the stack
+    auto state = std::make_shared<ParallelForState>();
+    state->body = &body;
+    state->count = count;
+
+    size_t helpers = std::min(count - 1, _workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        Submit([state]() { state->Work(); });
+    }
+
+    state->Work();
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->condition.wait(lock, [&state]() { return state->done == state->count; });
+    }
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+ThreadPool& okami::ThreadPool::Default() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -1,4 +1,5 @@
 #include <okami/transform.hpp>
+#include <okami/simd.hpp>
 
 #include <array>
 #include <algorithm>
@@ -127,4 +128,122 @@ Transform Transform::LookAt(glm::vec3 eye, glm::vec3 target, glm::vec3 up) {
     
     auto rotation = ToQuaternion(glm::mat3{side, up, forward});
     return Transform(eye, rotation);
+}
+
+WorldTransform& okami::WorldTransform::operator*=(Transform const& other) {
+    translation += glm::dvec3(scale * (rotation * other.translation));
+    rotation = rotation * other.rotation;
+    scale *= other.scale;
+    return *this;
+}
+
+WorldTransform okami::operator*(WorldTransform const& a, Transform const& b) {
+    WorldTransform result = a;
+    result *= b;
+    return result;
+}
+
+Transform okami::WorldTransform::RelativeTo(glm::dvec3 origin) const {
+    return Transform(glm::vec3(translation - origin), rotation, scale);
+}
+
+glm::mat4 okami::WorldTransform::ToRelativeMatrix4x4(glm::dvec3 origin) const {
+    return RelativeTo(origin).ToMatrix4x4();
+}
+
+#if OKAMI_SIMD_SSE2
+// Converts four transforms at a time. Quaternions are transposed into
+// component registers so each rotation matrix entry is computed for all
+// four transforms at once, the translations are rebased in double precision
+// before rounding to float, and the resulting columns are transposed back
+// into four column-major matrices.
+static void ToRelativeMatrices4(
+    WorldTransform const* t,
+    glm::dvec3 origin,
+    glm::mat4* out) {
+    auto qx = _mm_setr_ps(t[0].rotation.x, t[1].rotation.x, t[2].rotation.x, t[3].rotation.x);
+    auto qy = _mm_setr_ps(t[0].rotation.y, t[1].rotation.y, t[2].rotation.y, t[3].rotation.y);
+    auto qz = _mm_setr_ps(t[0].rotation.z, t[1].rotation.z, t[2].rotation.z, t[3].rotation.z);
+    auto qw = _mm_setr_ps(t[0].rotation.w, t[1].rotation.w, t[2].rotation.w, t[3].rotation.w);
+    auto s = _mm_setr_ps(t[0].scale, t[1].scale, t[2].scale, t[3].scale);
+
+    auto one = _mm_set1_ps(1.0f);
+    auto two = _mm_set1_ps(2.0f);
+
+    auto xx = _mm_mul_ps(qx, qx);
+    auto yy = _mm_mul_ps(qy, qy);
+    auto zz = _mm_mul_ps(qz, qz);
+    auto xy = _mm_mul_ps(qx, qy);
+    auto xz = _mm_mul_ps(qx, qz);
+    auto yz = _mm_mul_ps(qy, qz);
+    auto wx = _mm_mul_ps(qw, qx);
+    auto wy = _mm_mul_ps(qw, qy);
+    auto wz = _mm_mul_ps(qw, qz);
+
+    auto s2 = _mm_mul_ps(s, two);
+
+    // Same expansion as glm::mat4_cast, with the uniform scale folded in
+    auto m00 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+    auto m01 = _mm_mul_ps(s2, _mm_add_ps(xy, wz));
+    auto m02 = _mm_mul_ps(s2, _mm_sub_ps(xz, wy));
+
+    auto m10 = _mm_mul_ps(s2, _mm_sub_ps(xy, wz));
+    auto m11 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+    auto m12 = _mm_mul_ps(s2, _mm_add_ps(yz, wx));
+
+    auto m20 = _mm_mul_ps(s2, _mm_add_ps(xz, wy));
+    auto m21 = _mm_mul_ps(s2, _mm_sub_ps(yz, wx));
+    auto m22 = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+
+    auto rebase = [](double a, double b, double o) {
+        auto diff = _mm_sub_pd(_mm_setr_pd(a, b), _mm_set1_pd(o));
+        return _mm_cvtpd_ps(diff);
+    };
+    auto rebase4 = [&](int axis) {
+        auto lo = rebase(t[0].translation[axis], t[1].translation[axis], origin[axis]);
+        auto hi = rebase(t[2].translation[axis], t[3].translation[axis], origin[axis]);
+        return _mm_movelh_ps(lo, hi);
+    };
+
+    auto tx = rebase4(0);
+    auto ty = rebase4(1);
+    auto tz = rebase4(2);
+
+    // Each transpose turns one column of all four matrices, held as one
+    // register per row, into four registers that each hold a whole column.
+    __m128 columns[4][4] = {
+        { m00, m01, m02, _mm_setzero_ps() },
+        { m10, m11, m12, _mm_setzero_ps() },
+        { m20, m21, m22, _mm_setzero_ps() },
+        { tx, ty, tz, one }
+    };
+
+    for (auto& column : columns) {
+        _MM_TRANSPOSE4_PS(column[0], column[1], column[2], column[3]);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            _mm_storeu_ps(&out[i][c][0], columns[c][i]);
+        }
+    }
+}
+#endif
+
+void okami::ToRelativeMatrices(
+    std::span<WorldTransform const> transforms,
+    glm::dvec3 origin,
+    std::span<glm::mat4> out) {
+    size_t count = std::min(transforms.size(), out.size());
+    size_t i = 0;
+
+#if OKAMI_SIMD_SSE2
+    for (; i + 4 <= count; i += 4) {
+        ToRelativeMatrices4(&transforms[i], origin, &out[i]);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        out[i] = transforms[i].ToRelativeMatrix4x4(origin);
+    }
 }
\ No newline at end of file
@@ -37,6 +37,8 @@ Expected<VertexFormatInfo> VertexFormatInfo::From(VertexFormat format) {
 		VERTEX_FORMAT_CASE(PositionUVNormal);
 		VERTEX_FORMAT_CASE(PositionUVNormalTangent);
 		VERTEX_FORMAT_CASE(PositionUVNormalTangentBitangent);
+		VERTEX_FORMAT_CASE(PositionUVCompact);
+		VERTEX_FORMAT_CASE(PositionUVNormalTangentCompact);
 		default:
 			Error err;
 			OKAMI_ERR_SET(err, RuntimeError{"Could not get vertex format info!"});
@@ -156,6 +158,45 @@ VertexFormatInfo VertexFormatInfo::PositionUV() {
 }
 
 
+VertexFormatInfo VertexFormatInfo::PositionUVCompact() {
+	VertexFormatInfo layout;
+	layout.formatTag = VertexFormat::PositionUVCompact;
+
+	layout.position = 0;
+	layout.uvs = {1};
+
+	// The fourth position component only pads the vertex to 4 byte alignment
+	std::vector<LayoutElement> layoutElements = {
+		LayoutElement(0, 0, 4, ValueType::UINT16, true, InputElementFrequency::PER_VERTEX),
+		LayoutElement(1, 0, 2, ValueType::FLOAT16, false, InputElementFrequency::PER_VERTEX),
+	};
+
+	layout.elements = std::move(layoutElements);
+	layout.AutoLayout();
+	return layout;
+}
+
+VertexFormatInfo VertexFormatInfo::PositionUVNormalTangentCompact() {
+	VertexFormatInfo layout;
+	layout.formatTag = VertexFormat::PositionUVNormalTangentCompact;
+
+	layout.position = 0;
+	layout.uvs = {1};
+	layout.normal = 2;
+	layout.tangent = 3;
+
+	std::vector<LayoutElement> layoutElements = {
+		LayoutElement(0, 0, 4, ValueType::UINT16, true, InputElementFrequency::PER_VERTEX),
+		LayoutElement(1, 0, 2, ValueType::FLOAT16, false, InputElementFrequency::PER_VERTEX),
+		LayoutElement(2, 0, 2, ValueType::INT16, true, InputElementFrequency::PER_VERTEX),
+		LayoutElement(3, 0, 2, ValueType::INT16, true, InputElementFrequency::PER_VERTEX),
+	};
+
+	layout.elements = std::move(layoutElements);
+	layout.AutoLayout();
+	return layout;
+}
+
 Error VertexFormatInfo::CheckValid() const {
 	int numElements = static_cast<int>(elements.size());
 
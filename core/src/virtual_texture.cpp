@@ -0,0 +1,455 @@
+#include <okami/virtual_texture.hpp>
+#include <okami/thread_pool.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+    constexpr char kVirtualTextureMagic[4] = {'O', 'K', 'V', 'T'};
+    constexpr uint32_t kVirtualTextureVersion = 1;
+    // Tile data starts at this alignment after the header
+    constexpr size_t kVirtualTextureDataAlignment = 64;
+
+    // Bits of the packed feedback, the mip is stored plus one so that a
+    // cleared feedback buffer reads as no request
+    constexpr uint32_t kPackedCoordBits = 14;
+    constexpr uint32_t kPackedCoordMask = (1u << kPackedCoordBits) - 1;
+    constexpr uint32_t kPackedMipShift = 2 * kPackedCoordBits;
+
+    struct VirtualTextureHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint32_t channels;
+        uint32_t valueType;
+        uint32_t isNormalized;
+        uint32_t isLinear;
+        uint32_t compression;
+        uint32_t tileSize;
+        uint32_t tileBorder;
+    };
+
+    size_t GetDataOffset() {
+        return (sizeof(VirtualTextureHeader) + kVirtualTextureDataAlignment - 1) /
+            kVirtualTextureDataAlignment * kVirtualTextureDataAlignment;
+    }
+
+    // Copies a tile and its border out of one mip of source. Texels past the
+    // edges of the mip repeat the last block, like clamp to edge.
+    void CopyTile(Buffer const& source,
+        SubResDataDesc const& mip,
+        uint32_t mipWidth,
+        uint32_t mipHeight,
+        VirtualTileId const& tile,
+        uint8_t* dest) {
+        auto const& format = source.desc.format;
+        int64_t blockDim = format.GetBlockDimension();
+        size_t blockSize = format.GetBlockByteSize();
+        int64_t blocksX = (mipWidth + blockDim - 1) / blockDim;
+        int64_t blocksY = (mipHeight + blockDim - 1) / blockDim;
+        int64_t tileBlocks = kVirtualTilePaddedSize / blockDim;
+        int64_t originX = ((int64_t)tile.x * kVirtualTileSize - kVirtualTileBorder) / blockDim;
+        int64_t originY = ((int64_t)tile.y * kVirtualTileSize - kVirtualTileBorder) / blockDim;
+
+        // Columns that are inside the mip are copied as a single run
+        int64_t runBegin = std::clamp<int64_t>(-originX, 0, tileBlocks);
+        int64_t runEnd = std::clamp<int64_t>(blocksX - originX, runBegin, tileBlocks);
+
+        for (int64_t row = 0; row < tileBlocks; ++row) {
+            int64_t srcY = std::clamp<int64_t>(originY + row, 0, blocksY - 1);
+            auto srcRow = &source.data[mip.srcOffset + srcY * mip.stride];
+            auto destRow = dest + row * tileBlocks * blockSize;
+
+            for (int64_t col = 0; col < runBegin; ++col) {
+                std::memcpy(destRow + col * blockSize, srcRow, blockSize);
+            }
+            if (runEnd > runBegin) {
+                std::memcpy(destRow + runBegin * blockSize,
+                    srcRow + (originX + runBegin) * blockSize,
+                    (runEnd - runBegin) * blockSize);
+            }
+            for (int64_t col = runEnd; col < tileBlocks; ++col) {
+                std::memcpy(destRow + col * blockSize,
+                    srcRow + (blocksX - 1) * blockSize, blockSize);
+            }
+        }
+    }
+}
+
+uint32_t VirtualTileId::Pack() const {
+    return ((mip + 1) << kPackedMipShift) |
+        ((y & kPackedCoordMask) << kPackedCoordBits) |
+        (x & kPackedCoordMask);
+}
+
+std::optional<VirtualTileId> VirtualTileId::Unpack(uint32_t packed) {
+    uint32_t mip = packed >> kPackedMipShift;
+    if (mip == 0) {
+        return {};
+    }
+    return VirtualTileId{
+        mip - 1,
+        packed & kPackedCoordMask,
+        (packed >> kPackedCoordBits) & kPackedCoordMask
+    };
+}
+
+size_t VirtualTextureDesc::GetTileByteSize() const {
+    size_t blocks = kVirtualTilePaddedSize / format.GetBlockDimension();
+    return blocks * blocks * format.GetBlockByteSize();
+}
+
+size_t VirtualTextureDesc::GetTileCount() const {
+    size_t count = 0;
+    for (uint32_t mip = 0; mip < mipLevels; ++mip) {
+        count += GetTilesX(mip) * GetTilesY(mip);
+    }
+    return count;
+}
+
+size_t VirtualTextureDesc::GetTileIndex(VirtualTileId const& tile) const {
+    size_t index = 0;
+    for (uint32_t mip = 0; mip < tile.mip; ++mip) {
+        index += GetTilesX(mip) * GetTilesY(mip);
+    }
+    return index + tile.y * GetTilesX(tile.mip) + tile.x;
+}
+
+Desc VirtualTextureDesc::GetTileDesc() const {
+    Desc desc;
+    desc.type = Dimension::Texture2D;
+    desc.width = kVirtualTilePaddedSize;
+    desc.height = kVirtualTilePaddedSize;
+    desc.format = format;
+    desc.mipLevels = 1;
+    return desc;
+}
+
+Desc VirtualTextureDesc::GetIndirectionDesc() const {
+    Desc desc;
+    desc.type = Dimension::Texture2D;
+    desc.width = std::bit_ceil(GetTilesX(0));
+    desc.height = std::bit_ceil(GetTilesY(0));
+    desc.format = Format::RGBA8_UINT();
+    desc.mipLevels = mipLevels;
+    return desc;
+}
+
+Error okami::texture::WriteVirtualTexture(std::filesystem::path const& path, Buffer const& source) {
+    auto const& sourceDesc = source.desc;
+    OKAMI_ERR_RETURN_IF(sourceDesc.type != Dimension::Texture2D,
+        RuntimeError{"Only 2D textures can be virtual textures!"});
+
+    VirtualTextureDesc desc;
+    desc.width = sourceDesc.width;
+    desc.height = sourceDesc.height;
+    desc.format = sourceDesc.format;
+    desc.mipLevels = 1;
+    while (desc.mipLevels < sourceDesc.GetMipCount() &&
+        (desc.GetTilesX(desc.mipLevels - 1) > 1 || desc.GetTilesY(desc.mipLevels - 1) > 1)) {
+        ++desc.mipLevels;
+    }
+    // The coarsest mip stays resident, so it has to fit a single tile
+    OKAMI_ERR_RETURN_IF(desc.GetTilesX(desc.mipLevels - 1) > 1 ||
+        desc.GetTilesY(desc.mipLevels - 1) > 1,
+        RuntimeError{"Virtual textures need mips down to a single tile!"});
+    OKAMI_ERR_RETURN_IF(desc.GetTilesX(0) > kPackedCoordMask + 1 ||
+        desc.GetTilesY(0) > kPackedCoordMask + 1,
+        RuntimeError{"Texture is too large to be a virtual texture!"});
+
+    VirtualTextureHeader header{};
+    std::memcpy(header.magic, kVirtualTextureMagic, sizeof(kVirtualTextureMagic));
+    header.version = kVirtualTextureVersion;
+    header.width = desc.width;
+    header.height = desc.height;
+    header.mipLevels = desc.mipLevels;
+    header.channels = desc.format.channels;
+    header.valueType = static_cast<uint32_t>(desc.format.valueType);
+    header.isNormalized = desc.format.isNormalized;
+    header.isLinear = desc.format.isLinear;
+    header.compression = static_cast<uint32_t>(desc.format.compression);
+    header.tileSize = kVirtualTileSize;
+    header.tileBorder = kVirtualTileBorder;
+
+    // Write to a temporary first, so that readers never see a partial file
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        OKAMI_ERR_RETURN_IF(!stream, InvalidPathError{tempPath.string()});
+
+        std::vector<uint8_t> prefix(GetDataOffset(), 0);
+        std::memcpy(prefix.data(), &header, sizeof(header));
+        stream.write(reinterpret_cast<char const*>(prefix.data()), prefix.size());
+
+        // Mips are split in parallel and written one at a time, so memory
+        // only grows with the largest mip
+        auto subresources = sourceDesc.GetSubresourceDescs();
+        size_t tileSize = desc.GetTileByteSize();
+        std::vector<uint8_t> tiles;
+        for (uint32_t mip = 0; mip < desc.mipLevels; ++mip) {
+            uint32_t tilesX = desc.GetTilesX(mip);
+            uint32_t tileCount = tilesX * desc.GetTilesY(mip);
+            tiles.resize(tileCount * tileSize);
+
+            ThreadPool::Default().ParallelFor(tileCount, [&](size_t i) {
+                VirtualTileId tile{mip, (uint32_t)(i % tilesX), (uint32_t)(i / tilesX)};
+                CopyTile(source, subresources[mip], desc.GetMipWidth(mip),
+                    desc.GetMipHeight(mip), tile, &tiles[i * tileSize]);
+            });
+
+            stream.write(reinterpret_cast<char const*>(tiles.data()), tiles.size());
+        }
+        OKAMI_ERR_RETURN_IF(!stream, RuntimeError{"Failed to write virtual texture!"});
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    OKAMI_ERR_RETURN_IF(ec, RuntimeError{"Failed to move virtual texture into place!"});
+
+    return {};
+}
+
+std::span<uint8_t const> VirtualTextureFile::GetTile(VirtualTileId const& tile) const {
+    size_t tileSize = _desc.GetTileByteSize();
+    return _file.GetBytes().subspan(_dataOffset + _desc.GetTileIndex(tile) * tileSize, tileSize);
+}
+
+Expected<VirtualTextureFile> VirtualTextureFile::Open(std::filesystem::path const& path) {
+    Error err;
+    VirtualTextureFile result;
+    result._file = OKAMI_EXP_UNWRAP(MappedFile::Open(path), err);
+    auto bytes = result._file.GetBytes();
+
+    VirtualTextureHeader header;
+    OKAMI_EXP_RETURN_IF(bytes.size() < sizeof(header),
+        RuntimeError{"Virtual texture is truncated!"});
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    OKAMI_EXP_RETURN_IF(std::memcmp(header.magic, kVirtualTextureMagic, sizeof(header.magic)) != 0,
+        RuntimeError{"File is not a virtual texture!"});
+    OKAMI_EXP_RETURN_IF(header.version != kVirtualTextureVersion ||
+        header.tileSize != kVirtualTileSize ||
+        header.tileBorder != kVirtualTileBorder,
+        RuntimeError{"Virtual texture was cooked with different settings!"});
+
+    auto& desc = result._desc;
+    desc.width = header.width;
+    desc.height = header.height;
+    desc.mipLevels = header.mipLevels;
+    desc.format.channels = header.channels;
+    desc.format.valueType = static_cast<ValueType>(header.valueType);
+    desc.format.isNormalized = header.isNormalized != 0;
+    desc.format.isLinear = header.isLinear != 0;
+    desc.format.compression = static_cast<Compression>(header.compression);
+
+    result._dataOffset = GetDataOffset();
+    OKAMI_EXP_RETURN_IF(desc.width == 0 || desc.height == 0 || desc.mipLevels == 0 ||
+        bytes.size() < result._dataOffset + desc.GetTileCount() * desc.GetTileByteSize(),
+        RuntimeError{"Virtual texture is truncated!"});
+
+    return result;
+}
+
+VirtualPageTable::VirtualPageTable(VirtualTextureDesc const& desc, uint32_t slotCount) :
+    _desc(desc),
+    _slots(slotCount),
+    _residency(desc.GetTileCount(), -1) {
+    uint32_t coarsest = desc.mipLevels - 1;
+    if (slotCount <= desc.GetTilesX(coarsest) * desc.GetTilesY(coarsest)) {
+        throw std::runtime_error("Virtual texture cache cannot hold the coarsest mip!");
+    }
+    if (slotCount > 0x10000) {
+        throw std::runtime_error("Virtual texture cache has more slots than the indirection can address!");
+    }
+
+    // Hand out the lowest slots first
+    _freeSlots.reserve(slotCount);
+    for (uint32_t slot = slotCount; slot > 0; --slot) {
+        _freeSlots.push_back(slot - 1);
+    }
+}
+
+int32_t& VirtualPageTable::Residency(VirtualTileId const& tile) {
+    return _residency[_desc.GetTileIndex(tile)];
+}
+
+int32_t VirtualPageTable::Residency(VirtualTileId const& tile) const {
+    return _residency[_desc.GetTileIndex(tile)];
+}
+
+void VirtualPageTable::Touch(uint32_t slot) {
+    auto& entry = _slots[slot];
+    entry.lastUsedFrame = _frame;
+    if (!entry.isPinned) {
+        _lru.splice(_lru.begin(), _lru, entry.lruPosition);
+    }
+}
+
+void VirtualPageTable::BeginFrame() {
+    ++_frame;
+    _missing.clear();
+}
+
+void VirtualPageTable::Request(VirtualTileId const& tile) {
+    if (tile.mip >= _desc.mipLevels ||
+        tile.x >= _desc.GetTilesX(tile.mip) ||
+        tile.y >= _desc.GetTilesY(tile.mip)) {
+        return;
+    }
+
+    if (auto slot = Residency(tile); slot >= 0) {
+        Touch(slot);
+        return;
+    }
+
+    _missing.insert(tile.Pack());
+
+    // Keep whatever is drawn in its place until it arrives
+    for (auto parent = tile; parent.mip + 1 < _desc.mipLevels;) {
+        parent = VirtualTileId{parent.mip + 1, parent.x / 2, parent.y / 2};
+        if (auto slot = Residency(parent); slot >= 0) {
+            Touch(slot);
+            break;
+        }
+    }
+}
+
+void VirtualPageTable::Request(std::span<uint32_t const> feedback) {
+    uint32_t last = 0;
+    for (auto packed : feedback) {
+        // Neighbouring texels mostly request the same tile
+        if (packed == last) {
+            continue;
+        }
+        last = packed;
+        if (auto tile = VirtualTileId::Unpack(packed)) {
+            Request(*tile);
+        }
+    }
+}
+
+std::vector<VirtualTileId> VirtualPageTable::GetMissing(size_t maxCount) const {
+    std::vector<VirtualTileId> missing;
+    missing.reserve(_missing.size());
+
+    uint32_t coarsest = _desc.mipLevels - 1;
+    for (uint32_t y = 0; y < _desc.GetTilesY(coarsest); ++y) {
+        for (uint32_t x = 0; x < _desc.GetTilesX(coarsest); ++x) {
+            VirtualTileId tile{coarsest, x, y};
+            if (Residency(tile) < 0 && !_missing.contains(tile.Pack())) {
+                missing.emplace_back(tile);
+            }
+        }
+    }
+    for (auto packed : _missing) {
+        missing.emplace_back(*VirtualTileId::Unpack(packed));
+    }
+
+    // Coarse tiles first, they cover the most texels
+    std::sort(missing.begin(), missing.end(), [](auto const& a, auto const& b) {
+        return std::make_tuple(b.mip, a.y, a.x) < std::make_tuple(a.mip, b.y, b.x);
+    });
+    if (missing.size() > maxCount) {
+        missing.resize(maxCount);
+    }
+    return missing;
+}
+
+std::optional<uint32_t> VirtualPageTable::FindSlot(VirtualTileId const& tile) const {
+    if (auto slot = Residency(tile); slot >= 0) {
+        return static_cast<uint32_t>(slot);
+    }
+    return {};
+}
+
+std::optional<uint32_t> VirtualPageTable::Insert(VirtualTileId const& tile) {
+    if (auto slot = FindSlot(tile)) {
+        return slot;
+    }
+
+    uint32_t slot;
+    if (!_freeSlots.empty()) {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    } else {
+        // The back of the list is the least recently used, if even that
+        // was used this frame then so was everything else
+        if (_lru.empty() || _slots[_lru.back()].lastUsedFrame == _frame) {
+            return {};
+        }
+        slot = _lru.back();
+        _lru.pop_back();
+        Residency(_slots[slot].tile) = -1;
+    }
+
+    auto& entry = _slots[slot];
+    entry.tile = tile;
+    entry.lastUsedFrame = _frame;
+    entry.isPinned = tile.mip == _desc.mipLevels - 1;
+    if (!entry.isPinned) {
+        _lru.push_front(slot);
+        entry.lruPosition = _lru.begin();
+    }
+
+    Residency(tile) = static_cast<int32_t>(slot);
+    _missing.erase(tile.Pack());
+    _isDirty = true;
+    return slot;
+}
+
+void VirtualPageTable::BuildIndirection(Buffer& indirection) {
+    auto desc = _desc.GetIndirectionDesc();
+    if (indirection.desc.width != desc.width ||
+        indirection.desc.height != desc.height ||
+        indirection.desc.mipLevels != desc.mipLevels ||
+        indirection.data.size() != desc.GetByteSize()) {
+        indirection = Buffer::Alloc(desc);
+    }
+
+    auto subresources = desc.GetSubresourceDescs();
+
+    // Coarsest first, so that texels without a resident tile of their own
+    // copy the entry of the texel that covers them one mip up
+    for (uint32_t mip = _desc.mipLevels; mip-- > 0;) {
+        uint32_t width = std::max(1u, desc.width >> mip);
+        uint32_t height = std::max(1u, desc.height >> mip);
+        auto texels = &indirection.data[subresources[mip].srcOffset];
+        uint8_t const* parent = mip + 1 < _desc.mipLevels ?
+            &indirection.data[subresources[mip + 1].srcOffset] : nullptr;
+        uint32_t parentWidth = std::max(1u, desc.width >> (mip + 1));
+
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                auto texel = &texels[(y * width + x) * 4];
+
+                int32_t slot = -1;
+                if (x < _desc.GetTilesX(mip) && y < _desc.GetTilesY(mip)) {
+                    slot = Residency(VirtualTileId{mip, x, y});
+                }
+
+                if (slot >= 0) {
+                    texel[0] = static_cast<uint8_t>(slot & 0xFF);
+                    texel[1] = static_cast<uint8_t>(slot >> 8);
+                    texel[2] = static_cast<uint8_t>(mip);
+                    texel[3] = 255;
+                } else if (parent) {
+                    std::memcpy(texel, &parent[((y / 2) * parentWidth + x / 2) * 4], 4);
+                } else {
+                    std::memset(texel, 0, 4);
+                }
+            }
+        }
+    }
+
+    _isDirty = false;
+}
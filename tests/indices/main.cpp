@@ -0,0 +1,84 @@
+#include <okami/geometry.hpp>
+
+#include <iostream>
+
+using namespace okami;
+using namespace okami::geometry;
+
+// Indices at both ends of the 16 bit range, so a signed saturating pack
+// or a sign extending widen would show up
+std::vector<uint32_t> MakeIndices(size_t count) {
+    std::vector<uint32_t> indices(count);
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 4) {
+            case 0: indices[i] = static_cast<uint32_t>(i % 0x10000); break;
+            case 1: indices[i] = 0xFFFF - static_cast<uint32_t>((i / 4) % 16); break;
+            case 2: indices[i] = 0x7FFF + static_cast<uint32_t>(i % 3); break;
+            default: indices[i] = static_cast<uint32_t>((i * 2654435761u) & 0xFFFF); break;
+        }
+    }
+    return indices;
+}
+
+// Lengths below, at and past the 8 wide vector loop, with ragged tails
+const size_t kLengths[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 1000, 1003};
+
+bool TestNarrowWiden() {
+    for (auto count : kLengths) {
+        auto indices = MakeIndices(count);
+        std::vector<uint16_t> narrow(count);
+        std::vector<uint32_t> wide(count);
+        ArraySliceNarrowIndices(narrow.data(), indices.data(), count);
+        ArraySliceWidenIndices(wide.data(), narrow.data(), count);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (narrow[i] != indices[i] || wide[i] != indices[i]) {
+                std::cout << "    length " << count << ": index " << i << " is "
+                    << indices[i] << ", narrowed " << narrow[i]
+                    << ", widened " << wide[i] << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TestPackUnpack(ValueType indexType) {
+    for (auto count : kLengths) {
+        auto indices = MakeIndices(count);
+
+        Desc desc{};
+        desc.layout = VertexFormatInfo::PositionUV();
+        desc.isIndexed = true;
+        desc.indexedAttribs.indexType = indexType;
+        desc.indexedAttribs.numIndices = static_cast<uint32_t>(count);
+        Geometry geometry(desc, {}, PackIndices(indices, indexType), BoundingBox{});
+
+        size_t expectedSize = count * GetSize(indexType);
+        if (geometry.GetIndexBuffer().bytes.size() != expectedSize) {
+            std::cout << "    length " << count << ": packed "
+                << geometry.GetIndexBuffer().bytes.size() << " bytes, expected "
+                << expectedSize << std::endl;
+            return false;
+        }
+        if (UnpackIndices(geometry) != indices) {
+            std::cout << "    length " << count << ": indices did not round trip" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "narrow and widen" << std::endl;
+    passed &= TestNarrowWiden();
+    std::cout << "pack and unpack 16 bit" << std::endl;
+    passed &= TestPackUnpack(ValueType::UINT16);
+    std::cout << "pack and unpack 32 bit" << std::endl;
+    passed &= TestPackUnpack(ValueType::UINT32);
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <okami/lod.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+using namespace okami;
+using namespace okami::geometry;
+
+size_t TriangleCount(Geometry const& geometry) {
+    return geometry.GetDesc().indexedAttribs.numIndices / 3;
+}
+
+bool IndicesInRange(Geometry const& geometry) {
+    auto numVertices = geometry.GetDesc().attribs.numVertices;
+    for (auto index : UnpackIndices(geometry)) {
+        if (index >= numVertices) {
+            std::cout << "    index " << index << " is past " << numVertices << " vertices" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Simplifying has to get close to the target without ever adding triangles
+bool TestSimplify(std::string_view name, std::function<Geometry(VertexFormatInfo const&)> prefab) {
+    auto geometry = prefab(VertexFormatInfo::PositionUVNormal());
+    auto triangles = TriangleCount(geometry);
+    std::cout << "    " << name << " (" << triangles << " triangles)" << std::endl;
+
+    size_t last = triangles;
+    for (float ratio : { 0.75f, 0.5f, 0.25f, 0.1f }) {
+        auto simplified = Simplify(geometry, SimplifyParams{ .targetRatio = ratio });
+        auto count = TriangleCount(simplified);
+        std::cout << "        ratio " << std::fixed << std::setprecision(2) << ratio
+            << ": " << count << " triangles" << std::endl;
+
+        if (!IndicesInRange(simplified)) {
+            return false;
+        }
+        // Locked boundaries and seams stop the teapot at about a fifth of
+        // its triangles, so only the milder ratios have to be reached
+        bool reachable = ratio >= 0.25f;
+        if (count == 0 || count > last || (reachable && count > triangles * ratio * 1.5f)) {
+            std::cout << "        expected about " << static_cast<size_t>(triangles * ratio)
+                << " triangles" << std::endl;
+            return false;
+        }
+        last = count;
+    }
+
+    // Nothing collapses for free on a curved mesh
+    auto untouched = Simplify(geometry, SimplifyParams{ .targetRatio = 0.1f, .maxError = 0.0f });
+    if (TriangleCount(untouched) * 2 < triangles) {
+        std::cout << "        a max error of zero still removed "
+            << triangles - TriangleCount(untouched) << " triangles" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Expect(uint32_t level, uint32_t expected, std::string_view what) {
+    if (level != expected) {
+        std::cout << "    " << what << ": level " << level << ", expected " << expected << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TestSelectLOD() {
+    float screenSizes[] = { 1.0f, 0.5f, 0.25f };
+
+    bool passed = true;
+    passed &= Expect(SelectLOD({}, 0.1f, 3, 0.0f), 0, "no levels");
+    passed &= Expect(SelectLOD(screenSizes, 2.0f, 2, 0.0f), 0, "large");
+    passed &= Expect(SelectLOD(screenSizes, 0.6f, 0, 0.0f), 1, "medium");
+    passed &= Expect(SelectLOD(screenSizes, 0.3f, 0, 0.0f), 2, "small");
+    passed &= Expect(SelectLOD(screenSizes, 0.01f, 0, 0.0f), 2, "tiny");
+    passed &= Expect(SelectLOD(screenSizes, 0.6f, 7, 0.0f), 1, "current level out of range");
+
+    // Within the hysteresis band the current level sticks
+    passed &= Expect(SelectLOD(screenSizes, 0.95f, 0, 0.1f), 0, "just below, coming from 0");
+    passed &= Expect(SelectLOD(screenSizes, 0.85f, 0, 0.1f), 1, "past the band, coming from 0");
+    passed &= Expect(SelectLOD(screenSizes, 1.05f, 1, 0.1f), 1, "just above, coming from 1");
+    passed &= Expect(SelectLOD(screenSizes, 1.15f, 1, 0.1f), 0, "past the band, coming from 1");
+    return passed;
+}
+
+bool TestLODGroup() {
+    float ratios[] = { 0.5f, 0.25f };
+    float screenSizes[] = { 0.5f, 0.2f, 0.05f };
+
+    auto group = LODGroup::Generate(prefabs::StanfordBunny(VertexFormatInfo::PositionUVNormal()),
+        ratios, screenSizes);
+    if (group.levels.size() != 3 || group.screenSizes.size() != 3) {
+        std::cout << "    expected 3 levels, got " << group.levels.size() << std::endl;
+        return false;
+    }
+
+    auto base = TriangleCount(group.levels[0]);
+    for (size_t i = 0; i < group.levels.size(); ++i) {
+        auto count = TriangleCount(group.levels[i]);
+        std::cout << "    level " << i << ": " << count << " triangles" << std::endl;
+        if (!IndicesInRange(group.levels[i])) {
+            return false;
+        }
+        if (i > 0 && (count >= TriangleCount(group.levels[i - 1]) ||
+            count > base * ratios[i - 1] * 1.5f)) {
+            std::cout << "    level " << i << " did not drop toward "
+                << static_cast<size_t>(base * ratios[i - 1]) << " triangles" << std::endl;
+            return false;
+        }
+    }
+
+    // Moving the bunny away has to walk down the levels and back up
+    auto proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f);
+    auto extents = group.GetBounds().mUpper - group.GetBounds().mLower;
+    float size = glm::length(extents);
+
+    auto select = [&](float distance, LODState& state) {
+        auto center = 0.5f * (group.GetBounds().mLower + group.GetBounds().mUpper);
+        auto worldView = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -distance) - center);
+        return group.Select(ProjectedScreenSize(group.GetBounds(), worldView, proj), state, 0.1f);
+    };
+
+    bool passed = true;
+    LODState state;
+    passed &= Expect(select(size * 0.1f, state), 0, "inside the bounds");
+    passed &= Expect(select(size, state), 0, "near");
+    passed &= Expect(select(size * 4.0f, state), 1, "middle");
+    passed &= Expect(select(size * 40.0f, state), 2, "far");
+    passed &= Expect(select(size, state), 0, "near again");
+
+    bool threw = false;
+    try {
+        LODGroup::Generate(prefabs::StanfordBunny(VertexFormatInfo::PositionUVNormal()),
+            ratios, std::span<float const>(screenSizes, 2));
+    } catch (std::runtime_error const&) {
+        threw = true;
+    }
+    if (!threw) {
+        std::cout << "    mismatched screen sizes were accepted" << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "simplify" << std::endl;
+    passed &= TestSimplify("bunny", &prefabs::StanfordBunny);
+    passed &= TestSimplify("teapot", &prefabs::UtahTeapot);
+    passed &= TestSimplify("matball", &prefabs::MaterialBall);
+    std::cout << "select LOD" << std::endl;
+    passed &= TestSelectLOD();
+    std::cout << "LOD group" << std::endl;
+    passed &= TestLODGroup();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
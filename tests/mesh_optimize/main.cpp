@@ -0,0 +1,101 @@
+#include <okami/geometry.hpp>
+#include <okami/mesh_optimize.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace okami;
+using namespace okami::geometry;
+
+void Report(std::string_view stage, Geometry const& geometry, double milliseconds) {
+    std::cout << "    " << std::left << std::setw(24) << stage
+        << std::fixed << std::setprecision(3)
+        << " ACMR(16): " << ComputeACMR(geometry, 16)
+        << " ACMR(32): " << ComputeACMR(geometry, 32)
+        << " time: " << milliseconds << " ms" << std::endl;
+}
+
+// Every triangle as the bytes of its three vertices, rotated so the
+// smallest comes first and sorted. Two meshes that render the same give
+// the same list, however their vertices and triangles are numbered.
+std::vector<std::string> GetTriangles(Geometry const& geometry) {
+    auto const& desc = geometry.GetDesc();
+    auto indices = UnpackIndices(geometry);
+
+    auto vertexBytes = [&](uint32_t index) {
+        std::string bytes;
+        for (auto const& buffer : geometry.GetVertexBuffers()) {
+            size_t stride = buffer.bytes.size() / desc.attribs.numVertices;
+            bytes.append(reinterpret_cast<char const*>(&buffer.bytes[index * stride]), stride);
+        }
+        return bytes;
+    };
+
+    std::vector<std::string> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::string corners[3] = {
+            vertexBytes(indices[i]), vertexBytes(indices[i + 1]), vertexBytes(indices[i + 2])
+        };
+        auto first = std::min_element(corners, corners + 3) - corners;
+        triangles.emplace_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// Optimizing may only reorder, so the ACMR cannot get worse and the same
+// triangles have to come out
+bool CheckOptimized(Geometry const& input, Geometry const& optimized) {
+    bool passed = true;
+    if (ComputeACMR(optimized, 16) > ComputeACMR(input, 16)) {
+        std::cout << "    ACMR got worse" << std::endl;
+        passed = false;
+    }
+    if (GetTriangles(optimized) != GetTriangles(input)) {
+        std::cout << "    triangles are not a permutation of the input" << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+bool Benchmark(std::string_view name, std::function<Geometry(VertexFormatInfo const&)> prefab) {
+    auto geometry = prefab(VertexFormatInfo::PositionUVNormal());
+    auto const& desc = geometry.GetDesc();
+
+    std::cout << name << " (" << desc.attribs.numVertices << " vertices, "
+        << desc.indexedAttribs.numIndices / 3 << " triangles, best possible ACMR "
+        << std::fixed << std::setprecision(3)
+        << static_cast<float>(desc.attribs.numVertices) / (desc.indexedAttribs.numIndices / 3)
+        << ")" << std::endl;
+
+    Report("input", geometry, 0.0);
+
+    auto run = [&geometry](std::string_view stage, OptimizeParams const& params) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto optimized = Optimize(geometry, params);
+        auto end = std::chrono::high_resolution_clock::now();
+        Report(stage, optimized, std::chrono::duration<double, std::milli>(end - start).count());
+        return CheckOptimized(geometry, optimized);
+    };
+
+    bool passed = true;
+    passed &= run("vertex cache", OptimizeParams{.overdraw = false});
+    passed &= run("vertex cache + overdraw", OptimizeParams{});
+
+    return passed;
+}
+
+int main() {
+    bool passed = true;
+
+    passed &= Benchmark("bunny", &prefabs::StanfordBunny);
+    passed &= Benchmark("teapot", &prefabs::UtahTeapot);
+    passed &= Benchmark("matball", &prefabs::MaterialBall);
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
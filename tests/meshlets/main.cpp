@@ -0,0 +1,135 @@
+#include <okami/geometry.hpp>
+#include <okami/meshlet.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+using namespace okami;
+using namespace okami::geometry;
+
+using Triangle = std::array<uint32_t, 3>;
+
+std::vector<Triangle> SortedTriangles(std::span<uint32_t const> indices) {
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// The meshlets have to tile the index buffer, stay within the limits and
+// bound their own vertices and normals
+bool CheckMeshlets(Geometry const& input, Geometry const& clustered, MeshletParams const& params) {
+    auto indices = UnpackIndices(clustered);
+    auto positions = UnpackPositions(clustered);
+    auto const& meshlets = clustered.GetMeshlets();
+
+    if (SortedTriangles(indices) != SortedTriangles(UnpackIndices(input))) {
+        std::cout << "    triangles are not a permutation of the input" << std::endl;
+        return false;
+    }
+
+    uint32_t next = 0;
+    for (size_t m = 0; m < meshlets.size(); ++m) {
+        auto const& meshlet = meshlets[m];
+        if (meshlet.indexOffset != next || meshlet.indexCount == 0 || meshlet.indexCount % 3 != 0) {
+            std::cout << "    meshlet " << m << " does not continue the index range" << std::endl;
+            return false;
+        }
+        next += meshlet.indexCount;
+        if (next > indices.size()) {
+            std::cout << "    meshlet " << m << " runs past the index buffer" << std::endl;
+            return false;
+        }
+
+        auto range = std::span<uint32_t const>(indices).subspan(meshlet.indexOffset, meshlet.indexCount);
+        std::set<uint32_t> vertices(range.begin(), range.end());
+        if (meshlet.vertexCount != vertices.size() ||
+            meshlet.vertexCount > params.maxVertices ||
+            meshlet.indexCount / 3 > params.maxTriangles) {
+            std::cout << "    meshlet " << m << " has " << meshlet.vertexCount << " vertices ("
+                << vertices.size() << " referenced) and " << meshlet.indexCount / 3
+                << " triangles" << std::endl;
+            return false;
+        }
+
+        float tolerance = 1e-4f * std::max(meshlet.radius, 1.0f);
+        for (auto v : vertices) {
+            if (glm::length(positions[v] - meshlet.center) > meshlet.radius + tolerance) {
+                std::cout << "    meshlet " << m << " vertex " << v
+                    << " is outside the bounding sphere" << std::endl;
+                return false;
+            }
+        }
+
+        if (meshlet.coneCutoff < 1.0f) {
+            float minDot = std::sqrt(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+            for (size_t i = 0; i < range.size(); i += 3) {
+                auto a = positions[range[i]];
+                auto n = glm::cross(positions[range[i + 1]] - a, positions[range[i + 2]] - a);
+                float length = glm::length(n);
+                if (length > 0.0f && glm::dot(n / length, meshlet.coneAxis) < minDot - 1e-4f) {
+                    std::cout << "    meshlet " << m << " triangle " << i / 3
+                        << " is outside the normal cone" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (next != indices.size()) {
+        std::cout << "    meshlets cover " << next << " of " << indices.size() << " indices" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Test(std::string_view name, std::function<Geometry(VertexFormatInfo const&)> prefab) {
+    auto geometry = prefab(VertexFormatInfo::PositionUVNormal());
+    auto const& desc = geometry.GetDesc();
+    std::cout << name << " (" << desc.indexedAttribs.numIndices / 3 << " triangles)" << std::endl;
+
+    bool passed = true;
+    for (auto const& params : { MeshletParams{}, MeshletParams{ .maxVertices = 16, .maxTriangles = 8 } }) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto clustered = BuildMeshlets(geometry, params);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto const& meshlets = clustered.GetMeshlets();
+        size_t backfaceCullable = 0;
+        for (auto const& meshlet : meshlets) {
+            backfaceCullable += meshlet.coneCutoff < 1.0f;
+        }
+        std::cout << "    " << params.maxVertices << "/" << params.maxTriangles
+            << " count: " << meshlets.size()
+            << " triangles per meshlet: " << std::fixed << std::setprecision(1)
+            << static_cast<float>(desc.indexedAttribs.numIndices / 3) / meshlets.size()
+            << " with cones: " << backfaceCullable
+            << std::setprecision(3)
+            << " time: " << std::chrono::duration<double, std::milli>(end - start).count()
+            << " ms" << std::endl;
+
+        passed &= CheckMeshlets(geometry, clustered, params);
+    }
+    return passed;
+}
+
+int main() {
+    bool passed = true;
+
+    passed &= Test("bunny", &prefabs::StanfordBunny);
+    passed &= Test("teapot", &prefabs::UtahTeapot);
+    passed &= Test("matball", &prefabs::MaterialBall);
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
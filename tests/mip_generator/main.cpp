@@ -0,0 +1,315 @@
+#include <okami/mip_generator.hpp>
+#include <okami/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace okami;
+using namespace okami::texture;
+
+struct Size {
+    uint32_t width;
+    uint32_t height;
+};
+
+// Odd and non power of two sizes, below and past the vector widths
+const Size kSizes[] = {
+    { 1, 1 }, { 2, 2 }, { 3, 5 }, { 7, 3 }, { 8, 8 }, { 9, 9 },
+    { 17, 13 }, { 33, 31 }, { 64, 48 }, { 100, 37 }, { 255, 129 }
+};
+
+uint32_t Coarse(uint32_t size) {
+    return std::max(1u, size / 2);
+}
+
+std::vector<uint8_t> MakeBytes(size_t count, std::mt19937& rng) {
+    std::vector<uint8_t> bytes(count);
+    for (auto& byte : bytes) {
+        byte = (uint8_t)rng();
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> FilterRGBA8(bool isSRGB, std::vector<uint8_t> const& fine, Size size) {
+    Size coarse{ Coarse(size.width), Coarse(size.height) };
+    std::vector<uint8_t> result(coarse.width * coarse.height * 4);
+    ComputeCoarseMip2D_RGBA8(4, isSRGB,
+        fine.data(), size.width * 4, size.width, size.height,
+        result.data(), coarse.width * 4, coarse.width, coarse.height,
+        0, coarse.height);
+    return result;
+}
+
+// Filtering one coarse column at a time never reaches the vector loops, so
+// it runs the scalar tail on every pixel
+std::vector<uint8_t> FilterRGBA8Scalar(bool isSRGB, std::vector<uint8_t> const& fine, Size size) {
+    Size coarse{ Coarse(size.width), Coarse(size.height) };
+    std::vector<uint8_t> result(coarse.width * coarse.height * 4);
+    for (uint32_t col = 0; col < coarse.width; ++col) {
+        ComputeCoarseMip2D_RGBA8(4, isSRGB,
+            &fine[col * 8], size.width * 4, std::min(2u, size.width - col * 2), size.height,
+            &result[col * 4], coarse.width * 4, 1, coarse.height,
+            0, coarse.height);
+    }
+    return result;
+}
+
+std::vector<uint8_t> FilterGeneric(bool isSRGB, std::vector<uint8_t> const& fine, Size size) {
+    Size coarse{ Coarse(size.width), Coarse(size.height) };
+    std::vector<uint8_t> result(coarse.width * coarse.height * 4);
+    ComputeCoarseMip2D<uint8_t>(4, isSRGB,
+        fine.data(), size.width * 4, size.width, size.height,
+        result.data(), coarse.width * 4, coarse.width, coarse.height,
+        0, coarse.height);
+    return result;
+}
+
+// Largest difference between two images, reporting the first byte that
+// differs by more than tolerance
+bool Compare(std::vector<uint8_t> const& a, std::vector<uint8_t> const& b, int tolerance,
+    std::string_view what, Size size) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(a[i] - b[i]) > tolerance) {
+            std::cout << "    " << size.width << "x" << size.height << " byte " << i
+                << " is " << (int)a[i] << " but " << what << " gives " << (int)b[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestRGBA8Box() {
+    std::mt19937 rng(6);
+    for (auto size : kSizes) {
+        auto fine = MakeBytes(size.width * size.height * 4, rng);
+
+        auto linear = FilterRGBA8(false, fine, size);
+        if (!Compare(linear, FilterRGBA8Scalar(false, fine, size), 0, "the scalar path", size) ||
+            !Compare(linear, FilterGeneric(false, fine, size), 0, "the generic box filter", size)) {
+            return false;
+        }
+
+        // The 16 bit tables round where the float path truncates, so they
+        // only have to agree with it to within a step. Alpha is linear.
+        auto srgb = FilterRGBA8(true, fine, size);
+        auto reference = FilterGeneric(true, fine, size);
+        auto linearReference = FilterGeneric(false, fine, size);
+        for (size_t i = 3; i < reference.size(); i += 4) {
+            reference[i] = linearReference[i];
+        }
+        if (!Compare(srgb, FilterRGBA8Scalar(true, fine, size), 0, "the scalar path", size) ||
+            !Compare(srgb, reference, 1, "the float sRGB average", size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const MipFilter kFilters[] = {
+    MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos3, MipFilter::Mitchell
+};
+
+const char* GetName(MipFilter filter) {
+    switch (filter) {
+        case MipFilter::Kaiser:
+            return "Kaiser";
+        case MipFilter::Lanczos3:
+            return "Lanczos3";
+        case MipFilter::Mitchell:
+            return "Mitchell";
+        default:
+            return "box";
+    }
+}
+
+// A row of ones filtered down one axis gives the sum of the tap weights of
+// every coarse pixel, with the other axis a single tap of weight one. Alpha
+// weighting picks the polyphase box filter too, and does nothing to a
+// single channel.
+bool TestTapWeights() {
+    for (auto filter : kFilters) {
+        auto generate = GetMipGenerator(ValueType::FLOAT32, 1, filter, true);
+        for (uint32_t size = 1; size <= 70; ++size) {
+            std::vector<float> ones(size, 1.0f);
+            std::vector<float> sums(Coarse(size));
+            for (bool vertical : { false, true }) {
+                uint32_t width = vertical ? 1 : size;
+                uint32_t height = vertical ? size : 1;
+                generate(1, false,
+                    ones.data(), width * sizeof(float), width, height,
+                    sums.data(), Coarse(width) * sizeof(float), Coarse(width), Coarse(height),
+                    0, Coarse(height));
+                for (size_t i = 0; i < sums.size(); ++i) {
+                    if (std::abs(sums[i] - 1.0f) > 1e-5f) {
+                        std::cout << "    " << GetName(filter) << " weights of pixel " << i
+                            << " of " << size << (vertical ? " rows" : " columns")
+                            << " sum to " << sums[i] << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+Buffer MakeBuffer(Format const& format, Size size) {
+    Desc desc;
+    desc.type = Dimension::Texture2D;
+    desc.width = size.width;
+    desc.height = size.height;
+    desc.format = format;
+    desc.mipLevels = 0;
+    return Buffer::Alloc(desc);
+}
+
+// Constant images have to stay constant down to the last mip, with every
+// filter, which catches both tap weights and edge clamping going wrong
+bool TestConstant() {
+    struct Case {
+        const char* name;
+        Format format;
+        uint8_t value[16];
+    };
+    float floats[4] = { 0.2f, 0.5f, 0.7f, 1.0f };
+    Case cases[] = {
+        { "RGBA8", Format::RGBA8_UNORM(), { 10, 128, 200, 255 } },
+        { "sRGBA8", Format::SRGBA8_UNORM(), { 10, 128, 200, 77 } },
+        { "RGBA16", Format{ 4, ValueType::UINT16, true, true }, { 0x12, 0x34, 0xFF, 0x80, 0x00, 0x01, 0xFF, 0xFF } },
+        { "RGBA32F", Format::RGBA32_FLOAT(), {} },
+    };
+    std::memcpy(cases[3].value, floats, sizeof(floats));
+
+    for (auto const& c : cases) {
+        auto pixelSize = c.format.GetPixelByteSize();
+        for (auto filter : kFilters) {
+            for (bool alphaWeighted : { false, true }) {
+                for (auto size : { Size{ 37, 20 }, Size{ 64, 64 }, Size{ 1, 9 } }) {
+                    auto buffer = MakeBuffer(c.format, size);
+                    for (size_t i = 0; i < buffer.data.size(); i += pixelSize) {
+                        std::memcpy(&buffer.data[i], c.value, pixelSize);
+                    }
+                    buffer.GenerateMips(filter, alphaWeighted);
+
+                    for (size_t i = 0; i < buffer.data.size(); i += pixelSize) {
+                        bool same = std::memcmp(&buffer.data[i], c.value, pixelSize) == 0;
+                        if (!same && c.format.valueType == ValueType::FLOAT32) {
+                            auto value = reinterpret_cast<float const*>(&buffer.data[i]);
+                            same = true;
+                            for (int k = 0; k < 4; ++k) {
+                                same &= std::abs(value[k] - floats[k]) <= 1e-5f;
+                            }
+                        }
+                        if (!same) {
+                            std::cout << "    " << c.name << " " << size.width << "x" << size.height
+                                << " with " << GetName(filter) << (alphaWeighted ? ", alpha weighted" : "")
+                                << " changed at pixel " << i / pixelSize << std::endl;
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Filters a whole mip as bands of the given height
+void FilterBands(mip_generator_2d_t generate, uint32_t pixelSize, bool isSRGB,
+    std::vector<uint8_t> const& fine, Size size, std::vector<uint8_t>& coarse, uint32_t bandHeight) {
+    Size coarseSize{ Coarse(size.width), Coarse(size.height) };
+    coarse.assign(coarseSize.width * coarseSize.height * pixelSize, 0);
+    for (uint32_t row = 0; row < coarseSize.height; row += bandHeight) {
+        generate(4, isSRGB,
+            fine.data(), size.width * pixelSize, size.width, size.height,
+            coarse.data(), coarseSize.width * pixelSize, coarseSize.width, coarseSize.height,
+            row, std::min(coarseSize.height, row + bandHeight));
+    }
+}
+
+// Every band reads the fine rows under its kernel itself, so splitting a
+// mip into bands must not change a single byte
+bool TestBands() {
+    std::mt19937 rng(7);
+    for (auto filter : kFilters) {
+        for (bool alphaWeighted : { false, true }) {
+            for (auto size : { Size{ 37, 29 }, Size{ 64, 64 }, Size{ 100, 15 } }) {
+                for (auto format : { Format::SRGBA8_UNORM(), Format::RGBA32_FLOAT() }) {
+                    auto pixelSize = format.GetPixelByteSize();
+                    auto generate = GetMipGenerator(format.valueType, 4, filter, alphaWeighted);
+                    auto fine = MakeBytes(size.width * size.height * pixelSize, rng);
+                    if (format.valueType == ValueType::FLOAT32) {
+                        auto values = reinterpret_cast<float*>(fine.data());
+                        for (size_t i = 0; i < fine.size() / 4; ++i) {
+                            values[i] = static_cast<float>(fine[i * 4]) / 255.0f;
+                        }
+                    }
+
+                    std::vector<uint8_t> whole;
+                    std::vector<uint8_t> banded;
+                    FilterBands(generate, pixelSize, !format.isLinear, fine, size, whole, size.height);
+                    for (uint32_t bandHeight : { 1u, 3u, 7u }) {
+                        FilterBands(generate, pixelSize, !format.isLinear, fine, size, banded, bandHeight);
+                        if (banded != whole) {
+                            std::cout << "    " << GetName(filter) << (alphaWeighted ? ", alpha weighted" : "")
+                                << " " << size.width << "x" << size.height << " differs in bands of "
+                                << bandHeight << " rows" << std::endl;
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Wide enough for GenerateMips to split the first mips into several
+    // bands, which have to match a chain filtered a whole mip at a time
+    Size size{ 1000, 300 };
+    auto source = MakeBytes(size.width * size.height * 4, rng);
+    ThreadPool pool(4);
+    for (auto filter : kFilters) {
+        auto buffer = MakeBuffer(Format::SRGBA8_UNORM(), size);
+        std::memcpy(buffer.data.data(), source.data(), source.size());
+        buffer.GenerateMips(pool, filter);
+
+        auto generate = GetMipGenerator(ValueType::UINT8, 4, filter, false);
+        auto subresources = buffer.desc.GetSubresourceDescs();
+        std::vector<uint8_t> fine = source;
+        std::vector<uint8_t> coarse;
+        Size mipSize = size;
+        for (size_t mip = 1; mip < subresources.size(); ++mip) {
+            FilterBands(generate, 4, true, fine, mipSize, coarse, Coarse(mipSize.height));
+            auto const& sub = subresources[mip];
+            if (sub.length != coarse.size() ||
+                std::memcmp(&buffer.data[sub.srcOffset], coarse.data(), coarse.size()) != 0) {
+                std::cout << "    " << GetName(filter) << " mip " << mip
+                    << " differs from a single band" << std::endl;
+                return false;
+            }
+            fine.swap(coarse);
+            mipSize = { Coarse(mipSize.width), Coarse(mipSize.height) };
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "RGBA8 box" << std::endl;
+    passed &= TestRGBA8Box();
+    std::cout << "tap weights" << std::endl;
+    passed &= TestTapWeights();
+    std::cout << "constant images" << std::endl;
+    passed &= TestConstant();
+    std::cout << "bands" << std::endl;
+    passed &= TestBands();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <okami/occlusion.hpp>
+#include <okami/ogl/staticmesh.hpp>
+
+#include <iostream>
+
+using namespace okami;
+
+RenderView MakeView() {
+    RenderView view;
+    view.camera.variant = CameraVariantPerspective{};
+    view.camera.near = 0.1f;
+    view.camera.far = 100.0f;
+    view.viewport = glm::vec2(800.0f, 600.0f);
+    view.viewTransform = Transform{};
+    return view;
+}
+
+// A quad five units in front of the camera, covering the middle of the view
+void RasterizeWall(OcclusionBuffer& buffer) {
+    std::vector<glm::vec3> positions{{-5, -5, 5}, {5, -5, 5}, {5, 5, 5}, {-5, 5, 5}};
+    std::vector<uint32_t> indices{0, 1, 2, 0, 2, 3};
+    buffer.RasterizeOccluder(positions, indices, WorldTransform(glm::dvec3(0.0, 0.0, 0.0)));
+    buffer.BuildHierarchy();
+}
+
+bool Expect(std::string_view name, bool value, bool expected) {
+    std::cout << "    " << name << ": " << (value ? "visible" : "culled") << std::endl;
+    return value == expected;
+}
+
+bool TestBuffer() {
+    OcclusionBuffer buffer;
+    buffer.Clear(MakeView());
+    RasterizeWall(buffer);
+
+    BoundingBox box{{-1, -1, -1}, {1, 1, 1}};
+    bool passed = true;
+    passed &= Expect("behind", buffer.IsVisible(box, WorldTransform(glm::dvec3(0, 0, 20))), false);
+    passed &= Expect("in front", buffer.IsVisible(box, WorldTransform(glm::dvec3(0, 0, 3))), true);
+    passed &= Expect("beside", buffer.IsVisible(box, WorldTransform(glm::dvec3(30, 0, 20))), true);
+    passed &= Expect("straddling the edge", buffer.IsVisible(box, WorldTransform(glm::dvec3(19, 0, 20))), true);
+    return passed;
+}
+
+// No GL calls are made, so the geometry does not need a context
+bool TestCullOccluded() {
+    OcclusionBuffer buffer;
+    buffer.Clear(MakeView());
+    RasterizeWall(buffer);
+
+    GLGeometry geometry;
+    geometry.bounds = BoundingBox{{-1, -1, -1}, {1, 1, 1}};
+
+    std::vector<GLStaticMeshRenderCall> calls{
+        GLStaticMeshRenderCall{geometry, std::nullopt, WorldTransform(glm::dvec3(0, 0, 20))},
+        GLStaticMeshRenderCall{geometry, std::nullopt, WorldTransform(glm::dvec3(30, 0, 20))},
+    };
+    auto visible = CullOccluded(calls, buffer);
+    return visible.size() == 1 && visible[0].transform.translation.x == 30.0;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "occlusion buffer" << std::endl;
+    passed &= TestBuffer();
+    std::cout << "cull occluded" << std::endl;
+    passed &= TestCullOccluded();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
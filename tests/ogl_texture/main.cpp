@@ -1,6 +1,7 @@
 #include <okami/okami.hpp>
 
 #include <okami/ogl/staticmesh.hpp>
+#include <okami/ogl/texture_loader.hpp>
 
 #include <okami/test/gfx_env.hpp>
 
@@ -25,12 +26,13 @@ Error TestMain() {
         Geometry geometry = geometry::prefabs::MaterialBall(layout);
         GLGeometry gpuGeometry = OKAMI_ERR_UNWRAP(GLGeometry::Create(geometry), err);
 
-        auto cpuTexture = OKAMI_ERR_UNWRAP(
-            texture::Load("tests/common/assets/texture.png", TextureLoadParams{
+        // Draws the checkerboard until the texture has streamed in
+        GLTextureLoader textureLoader;
+        auto const& gpuTexture = textureLoader.Load("tests/common/assets/texture.png", 
+            TextureLoadParams{
                 .isSRGB = true,
                 .generateMips = true
-        }), err);
-        auto gpuTexture = OKAMI_ERR_UNWRAP(GLTexture::Create(std::move(cpuTexture)), err);
+        });
 
         GLTexturedMaterial material{
             .texture = &gpuTexture,
@@ -46,6 +48,9 @@ Error TestMain() {
             err += env.MessagePump();
             OKAMI_ERR_RETURN(err);
 
+            err += textureLoader.Update();
+            OKAMI_ERR_RETURN(err);
+
             glEnable(GL_DEPTH_TEST);
 
             glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
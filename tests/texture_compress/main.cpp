@@ -0,0 +1,360 @@
+#include <okami/texture_compress.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace okami;
+using namespace okami::texture;
+
+// Reference decoders, written from the format specifications rather than
+// from the encoder, so both have to agree on the bit layout
+
+uint64_t LoadLittleEndian(uint8_t const* bytes, size_t count) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < count; ++i) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+void DecodeRGB565(uint16_t packed, int (&color)[3]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+void DecodeBC1(uint8_t const* block, uint8_t (&rgba)[16][4]) {
+    auto color0 = (uint16_t)LoadLittleEndian(block, 2);
+    auto color1 = (uint16_t)LoadLittleEndian(block + 2, 2);
+    auto indices = (uint32_t)LoadLittleEndian(block + 4, 4);
+
+    int palette[4][4];
+    DecodeRGB565(color0, reinterpret_cast<int (&)[3]>(palette[0]));
+    DecodeRGB565(color1, reinterpret_cast<int (&)[3]>(palette[1]));
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; ++c) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (color0 <= color1) {
+        palette[3][3] = 0;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        auto const& color = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 4; ++c) {
+            rgba[i][c] = (uint8_t)color[c];
+        }
+    }
+}
+
+void DecodeBC4(uint8_t const* block, uint8_t (&values)[16]) {
+    uint64_t bits = LoadLittleEndian(block, 8);
+    int value0 = bits & 0xFF;
+    int value1 = (bits >> 8) & 0xFF;
+
+    int palette[8] = { value0, value1 };
+    if (value0 > value1) {
+        for (int k = 1; k < 7; ++k) {
+            palette[k + 1] = ((7 - k) * value0 + k * value1 + 3) / 7;
+        }
+    } else {
+        for (int k = 1; k < 5; ++k) {
+            palette[k + 1] = ((5 - k) * value0 + k * value1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        values[i] = (uint8_t)palette[(bits >> (16 + 3 * i)) & 7];
+    }
+}
+
+// Only mode 6 is decoded, any other mode fails the block
+bool DecodeBC7(uint8_t const* block, uint8_t (&rgba)[16][4]) {
+    static constexpr int kWeights[16] = {
+        0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+    };
+
+    uint32_t position = 0;
+    auto read = [&](uint32_t bitCount) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bitCount; ++i, ++position) {
+            value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+        }
+        return value;
+    };
+
+    if (read(7) != (1u << 6)) {
+        return false;
+    }
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = (int)read(7);
+        endpoints[1][c] = (int)read(7);
+    }
+    uint32_t pBit0 = read(1);
+    uint32_t pBit1 = read(1);
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = (endpoints[0][c] << 1) | pBit0;
+        endpoints[1][c] = (endpoints[1][c] << 1) | pBit1;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int weight = kWeights[read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c) {
+            rgba[i][c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+// Decodes one block to RGBA8, with the channels the format drops set to
+// what the GL would return for them
+bool DecodeBlock(Compression compression, uint8_t const* block, uint8_t (&rgba)[16][4]) {
+    uint8_t values[16];
+    switch (compression) {
+        case Compression::BC1:
+            DecodeBC1(block, rgba);
+            return true;
+        case Compression::BC3:
+            DecodeBC1(block + 8, rgba);
+            DecodeBC4(block, values);
+            for (int i = 0; i < 16; ++i) {
+                rgba[i][3] = values[i];
+            }
+            return true;
+        case Compression::BC4:
+            DecodeBC4(block, values);
+            for (int i = 0; i < 16; ++i) {
+                rgba[i][0] = values[i];
+                rgba[i][1] = rgba[i][2] = 0;
+                rgba[i][3] = 255;
+            }
+            return true;
+        case Compression::BC5:
+            DecodeBC4(block, values);
+            for (int i = 0; i < 16; ++i) {
+                rgba[i][0] = values[i];
+            }
+            DecodeBC4(block + 8, values);
+            for (int i = 0; i < 16; ++i) {
+                rgba[i][1] = values[i];
+                rgba[i][2] = 0;
+                rgba[i][3] = 255;
+            }
+            return true;
+        case Compression::BC7:
+            return DecodeBC7(block, rgba);
+        default:
+            return false;
+    }
+}
+
+std::array<uint8_t, 16> EncodeBlock(Compression compression, uint8_t const (&rgba)[16][4]) {
+    std::array<uint8_t, 16> result{};
+    auto store = [&](auto const& block) {
+        std::memcpy(result.data(), block.data(), block.size());
+    };
+    uint8_t values[16];
+    switch (compression) {
+        case Compression::BC1: store(EncodeBC1(rgba)); break;
+        case Compression::BC3: store(EncodeBC3(rgba)); break;
+        case Compression::BC4:
+            for (int i = 0; i < 16; ++i) {
+                values[i] = rgba[i][0];
+            }
+            store(EncodeBC4(values));
+            break;
+        case Compression::BC5: store(EncodeBC5(rgba)); break;
+        case Compression::BC7: store(EncodeBC7(rgba)); break;
+        default: break;
+    }
+    return result;
+}
+
+struct FormatCase {
+    std::string_view name;
+    Compression compression;
+    // Which of the RGBA channels survive compression
+    bool channels[4];
+    // Largest error allowed on a single colour block
+    int solidError;
+    // Largest RMS error allowed over a smooth image
+    double rmsError;
+};
+
+const FormatCase kFormats[] = {
+    { "BC1", Compression::BC1, { true, true, true, false }, 5, 6.0 },
+    { "BC3", Compression::BC3, { true, true, true, true }, 5, 6.0 },
+    { "BC4", Compression::BC4, { true, false, false, false }, 0, 1.5 },
+    { "BC5", Compression::BC5, { true, true, false, false }, 0, 1.5 },
+    // Mode 6 fits all four channels to one line, so noise costs more
+    { "BC7", Compression::BC7, { true, true, true, true }, 1, 5.0 },
+};
+
+// A smooth image with some noise, roughly what photographs and
+// painted textures look like at block scale. The gradients are the same
+// at every size, so small mips are no harder than large ones.
+uint8_t SmoothTexel(uint32_t x, uint32_t y, int channel, std::mt19937& rng) {
+    float u = x / 255.0f;
+    float v = y / 255.0f;
+    float value = 0.0f;
+    switch (channel) {
+        case 0: value = 255.0f * u; break;
+        case 1: value = 255.0f * v; break;
+        case 2: value = 128.0f + 100.0f * std::sin(6.0f * u + 4.0f * v); break;
+        default: value = 255.0f - 127.0f * u * v; break;
+    }
+    value += (float)(rng() % 17) - 8.0f;
+    return (uint8_t)std::clamp(value, 0.0f, 255.0f);
+}
+
+Buffer MakeImage(Dimension type, uint32_t width, uint32_t height, uint32_t layers, uint32_t mipLevels) {
+    Desc desc;
+    desc.type = type;
+    desc.width = width;
+    desc.height = height;
+    desc.arraySizeOrDepth = layers;
+    desc.mipLevels = mipLevels;
+    desc.format = Format::RGBA8_UNORM();
+
+    std::mt19937 rng(7);
+    auto buffer = Buffer::Alloc(desc);
+    for (auto const& subresource : desc.GetSubresourceDescs()) {
+        uint32_t mipWidth = std::max(1u, width >> subresource.mip);
+        uint32_t mipHeight = std::max(1u, height >> subresource.mip);
+        for (uint32_t y = 0; y < mipHeight; ++y) {
+            auto row = &buffer.data[subresource.srcOffset + y * subresource.stride];
+            for (uint32_t x = 0; x < mipWidth; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    row[x * 4 + c] = SmoothTexel(x, y, c, rng);
+                }
+            }
+        }
+    }
+    return buffer;
+}
+
+bool TestSolidBlocks(FormatCase const& format) {
+    std::mt19937 rng(1);
+    int worst = 0;
+    for (int trial = 0; trial < 1000; ++trial) {
+        uint8_t color[4] = { (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+        uint8_t rgba[16][4];
+        for (auto& texel : rgba) {
+            std::memcpy(texel, color, 4);
+        }
+
+        auto block = EncodeBlock(format.compression, rgba);
+        uint8_t decoded[16][4];
+        if (!DecodeBlock(format.compression, block.data(), decoded)) {
+            std::cout << "    block is not in a mode the decoder knows" << std::endl;
+            return false;
+        }
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                if (format.channels[c]) {
+                    worst = std::max(worst, std::abs(decoded[i][c] - color[c]));
+                }
+            }
+        }
+    }
+    std::cout << "    solid blocks, worst error " << worst << std::endl;
+    return worst <= format.solidError;
+}
+
+// Encodes a smooth image with the parallel Compress, checks every block
+// against the single block encoder and decodes it to measure the error
+bool TestImage(FormatCase const& format, Dimension type, uint32_t width, uint32_t height, uint32_t layers) {
+    auto source = MakeImage(type, width, height, layers, 0);
+    auto compressed = Compress(source, format.compression);
+
+    auto srcSubresources = source.desc.GetSubresourceDescs();
+    auto dstSubresources = compressed.desc.GetSubresourceDescs();
+    if (srcSubresources.size() != dstSubresources.size()) {
+        std::cout << "    subresource count changed" << std::endl;
+        return false;
+    }
+
+    uint32_t blockSize = compressed.desc.format.GetBlockByteSize();
+    double errorSum = 0.0;
+    size_t sampleCount = 0;
+    for (size_t s = 0; s < srcSubresources.size(); ++s) {
+        auto const& src = srcSubresources[s];
+        auto const& dst = dstSubresources[s];
+        uint32_t mipWidth = std::max(1u, width >> src.mip);
+        uint32_t mipHeight = std::max(1u, height >> src.mip);
+
+        for (uint32_t blockY = 0; blockY < (mipHeight + 3) / 4; ++blockY) {
+            for (uint32_t blockX = 0; blockX < (mipWidth + 3) / 4; ++blockX) {
+                // Edge blocks repeat the last row and column
+                uint8_t rgba[16][4];
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = std::min(blockX * 4 + i % 4, mipWidth - 1);
+                    uint32_t y = std::min(blockY * 4 + i / 4, mipHeight - 1);
+                    std::memcpy(rgba[i], &source.data[src.srcOffset + y * src.stride + x * 4], 4);
+                }
+
+                auto block = &compressed.data[dst.srcOffset + blockY * dst.stride + blockX * blockSize];
+                auto expected = EncodeBlock(format.compression, rgba);
+                if (std::memcmp(block, expected.data(), blockSize) != 0) {
+                    std::cout << "    mip " << src.mip << " slice " << src.slice
+                        << " block (" << blockX << ", " << blockY
+                        << ") differs from the single block encoder" << std::endl;
+                    return false;
+                }
+
+                uint8_t decoded[16][4];
+                if (!DecodeBlock(format.compression, block, decoded)) {
+                    std::cout << "    block is not in a mode the decoder knows" << std::endl;
+                    return false;
+                }
+                for (uint32_t i = 0; i < 16; ++i) {
+                    if (blockX * 4 + i % 4 >= mipWidth || blockY * 4 + i / 4 >= mipHeight) {
+                        continue;
+                    }
+                    for (int c = 0; c < 4; ++c) {
+                        if (format.channels[c]) {
+                            double d = (double)decoded[i][c] - rgba[i][c];
+                            errorSum += d * d;
+                            ++sampleCount;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    double rms = std::sqrt(errorSum / std::max<size_t>(1, sampleCount));
+    std::cout << "    " << width << "x" << height << "x" << layers
+        << " with mips, RMS error " << std::fixed << std::setprecision(3) << rms << std::endl;
+    return rms <= format.rmsError;
+}
+
+int main() {
+    bool passed = true;
+
+    for (auto const& format : kFormats) {
+        std::cout << format.name << std::endl;
+        passed &= TestSolidBlocks(format);
+        passed &= TestImage(format, Dimension::Texture2D, 256, 256, 1);
+        passed &= TestImage(format, Dimension::Texture2DArray, 37, 23, 3);
+    }
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+#include <okami/mip_generator.hpp>
+#include <okami/texture_convert.hpp>
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+using namespace okami;
+using namespace okami::texture;
+
+template <typename T>
+std::span<uint8_t const> AsBytes(std::vector<T> const& values) {
+    return { reinterpret_cast<uint8_t const*>(values.data()), values.size() * sizeof(T) };
+}
+
+template <typename T>
+std::span<uint8_t> AsBytes(std::vector<T>& values) {
+    return { reinterpret_cast<uint8_t*>(values.data()), values.size() * sizeof(T) };
+}
+
+// Converting one pixel at a time never reaches the vector loops, so it
+// runs the scalar tail on every pixel. The whole span goes through the
+// vector loops, and both have to give the same bytes.
+std::vector<uint8_t> ConvertScalar(Format const& srcFormat, Format const& dstFormat,
+    std::span<uint8_t const> source) {
+    size_t srcPixel = srcFormat.GetPixelByteSize();
+    size_t dstPixel = dstFormat.GetPixelByteSize();
+    size_t count = source.size() / srcPixel;
+
+    std::vector<uint8_t> dest(count * dstPixel);
+    for (size_t i = 0; i < count; ++i) {
+        ConvertPixels(srcFormat, dstFormat,
+            source.subspan(i * srcPixel, srcPixel),
+            std::span<uint8_t>(dest).subspan(i * dstPixel, dstPixel));
+    }
+    return dest;
+}
+
+std::vector<uint8_t> ConvertAll(Format const& srcFormat, Format const& dstFormat,
+    std::span<uint8_t const> source) {
+    size_t count = source.size() / srcFormat.GetPixelByteSize();
+    std::vector<uint8_t> dest(count * dstFormat.GetPixelByteSize());
+    ConvertPixels(srcFormat, dstFormat, source, dest);
+    return dest;
+}
+
+bool MatchesScalar(Format const& srcFormat, Format const& dstFormat,
+    std::span<uint8_t const> source) {
+    auto vector = ConvertAll(srcFormat, dstFormat, source);
+    auto scalar = ConvertScalar(srcFormat, dstFormat, source);
+    for (size_t i = 0; i < vector.size(); ++i) {
+        if (vector[i] != scalar[i]) {
+            std::cout << "    byte " << i << " is " << (int)vector[i]
+                << " but the scalar path gives " << (int)scalar[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pixel counts below, at and past each vector width, with ragged tails
+const size_t kCounts[] = { 1, 3, 4, 5, 7, 8, 15, 16, 17, 33, 1003 };
+
+std::vector<float> MakeFloats(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> distribution(-0.25f, 1.25f);
+    std::vector<float> values(count);
+    for (auto& value : values) {
+        value = distribution(rng);
+    }
+    // Out of range and special values have to clamp the same way
+    float specials[] = { 0.0f, -0.0f, 1.0f, NAN, INFINITY, -INFINITY, 0.5f / 255.0f, 1e-8f };
+    for (size_t i = 0; i < std::min(count, std::size(specials)); ++i) {
+        values[i * 3 % count] = specials[i];
+    }
+    return values;
+}
+
+std::vector<uint8_t> MakeBytes(size_t count, std::mt19937& rng) {
+    std::vector<uint8_t> bytes(count);
+    for (auto& byte : bytes) {
+        byte = (uint8_t)rng();
+    }
+    return bytes;
+}
+
+bool TestHalfRoundTrip() {
+    Format r16f{ 1, ValueType::FLOAT16, false, true };
+    std::vector<uint16_t> halves(65536);
+    for (size_t i = 0; i < halves.size(); ++i) {
+        halves[i] = (uint16_t)i;
+    }
+
+    std::vector<float> floats(halves.size());
+    std::vector<uint16_t> back(halves.size());
+    ConvertPixels(r16f, Format::R32_FLOAT(), AsBytes(halves), AsBytes(floats));
+    ConvertPixels(Format::R32_FLOAT(), r16f, AsBytes(floats), AsBytes(back));
+
+    for (size_t i = 0; i < halves.size(); ++i) {
+        bool isNaN = (halves[i] & 0x7C00) == 0x7C00 && (halves[i] & 0x3FF);
+        bool matches = isNaN ?
+            std::isnan(floats[i]) && (back[i] & 0x7C00) == 0x7C00 && (back[i] & 0x3FF) :
+            back[i] == halves[i];
+        if (!matches) {
+            std::cout << "    half 0x" << std::hex << halves[i] << " came back as 0x"
+                << back[i] << std::dec << std::endl;
+            return false;
+        }
+    }
+
+    std::mt19937 rng(2);
+    for (auto count : kCounts) {
+        std::vector<uint16_t> some(count * 4);
+        for (auto& half : some) {
+            half = (uint16_t)rng();
+        }
+        std::vector<float> values(count * 4);
+        for (auto& value : values) {
+            value = std::bit_cast<float>((uint32_t)rng());
+        }
+        if (!MatchesScalar(Format::RGBA16_FLOAT(), Format::RGBA32_FLOAT(), AsBytes(some)) ||
+            !MatchesScalar(Format::RGBA32_FLOAT(), Format::RGBA16_FLOAT(), AsBytes(values))) {
+            std::cout << "    " << count << " pixels" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestRGBA8Float() {
+    std::mt19937 rng(3);
+    for (auto count : kCounts) {
+        auto bytes = MakeBytes(count * 4, rng);
+        auto floats = MakeFloats(count * 4, rng);
+        if (!MatchesScalar(Format::RGBA8_UNORM(), Format::RGBA32_FLOAT(), bytes) ||
+            !MatchesScalar(Format::RGBA32_FLOAT(), Format::RGBA8_UNORM(), AsBytes(floats))) {
+            std::cout << "    " << count << " pixels" << std::endl;
+            return false;
+        }
+
+        // Bytes have to survive the trip through float exactly
+        auto back = ConvertAll(Format::RGBA32_FLOAT(), Format::RGBA8_UNORM(),
+            ConvertAll(Format::RGBA8_UNORM(), Format::RGBA32_FLOAT(), bytes));
+        if (back != bytes) {
+            std::cout << "    " << count << " pixels did not round trip" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestSRGB() {
+    std::mt19937 rng(4);
+    for (auto count : kCounts) {
+        auto bytes = MakeBytes(count * 4, rng);
+        auto floats = MakeFloats(count * 4, rng);
+        if (!MatchesScalar(Format::SRGBA8_UNORM(), Format::RGBA32_FLOAT(), bytes) ||
+            !MatchesScalar(Format::RGBA32_FLOAT(), Format::SRGBA8_UNORM(), AsBytes(floats)) ||
+            !MatchesScalar(Format::SRGBA8_UNORM(), Format::RGBA8_UNORM(), bytes) ||
+            !MatchesScalar(Format::RGBA8_UNORM(), Format::SRGBA8_UNORM(), bytes)) {
+            std::cout << "    " << count << " pixels" << std::endl;
+            return false;
+        }
+
+        auto linear = ConvertAll(Format::SRGBA8_UNORM(), Format::RGBA32_FLOAT(), bytes);
+        auto back = ConvertAll(Format::RGBA32_FLOAT(), Format::SRGBA8_UNORM(), linear);
+        if (back != bytes) {
+            std::cout << "    " << count << " pixels did not round trip" << std::endl;
+            return false;
+        }
+    }
+
+    // Against the reference curve, alpha is never encoded
+    std::vector<uint8_t> ramp(256 * 4);
+    for (size_t i = 0; i < ramp.size(); ++i) {
+        ramp[i] = (uint8_t)(i / 4);
+    }
+    auto linear = ConvertAll(Format::SRGBA8_UNORM(), Format::RGBA32_FLOAT(), ramp);
+    for (size_t i = 0; i < ramp.size(); ++i) {
+        float value = reinterpret_cast<float const*>(linear.data())[i];
+        float expected = i % 4 == 3 ? ramp[i] / 255.0f : SRGBToLinear(ramp[i] / 255.0f);
+        if (std::abs(value - expected) > 1e-6f) {
+            std::cout << "    sRGB " << (int)ramp[i] << " decoded to " << value
+                << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestRGB8() {
+    std::mt19937 rng(5);
+    for (auto count : kCounts) {
+        auto bytes = MakeBytes(count * 3, rng);
+        if (!MatchesScalar(Format::RGB8_UNORM(), Format::RGBA8_UNORM(), bytes)) {
+            std::cout << "    " << count << " pixels" << std::endl;
+            return false;
+        }
+
+        auto rgba = ConvertAll(Format::RGB8_UNORM(), Format::RGBA8_UNORM(), bytes);
+        for (size_t i = 0; i < count; ++i) {
+            if (std::memcmp(&rgba[i * 4], &bytes[i * 3], 3) != 0 || rgba[i * 4 + 3] != 255) {
+                std::cout << "    " << count << " pixels, pixel " << i << " is wrong" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "half round trip" << std::endl;
+    passed &= TestHalfRoundTrip();
+    std::cout << "RGBA8 and float" << std::endl;
+    passed &= TestRGBA8Float();
+    std::cout << "sRGB and linear" << std::endl;
+    passed &= TestSRGB();
+    std::cout << "RGB8 to RGBA8" << std::endl;
+    passed &= TestRGB8();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
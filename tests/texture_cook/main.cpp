@@ -0,0 +1,59 @@
+#include <okami/texture_file.hpp>
+
+#include <iostream>
+
+using namespace okami;
+using namespace okami::texture;
+
+const std::filesystem::path kSource = "tests/common/assets/texture.png";
+
+// Cooks of the same source with different value types have to land in
+// different cache entries, in their own formats
+bool TestValueTypes(std::filesystem::path const& cache) {
+    LoadParams u8Params;
+    LoadParams f16Params;
+    f16Params.valueType = ValueType::FLOAT16;
+
+    auto u8Path = CookTexture(kSource, cache, u8Params);
+    auto f16Path = CookTexture(kSource, cache, f16Params);
+    if (!u8Path || !f16Path) {
+        std::cout << "    failed to cook " << kSource << std::endl;
+        return false;
+    }
+    std::cout << "    " << u8Path->filename() << std::endl;
+    std::cout << "    " << f16Path->filename() << std::endl;
+    if (*u8Path == *f16Path) {
+        return false;
+    }
+
+    // Cooking again has to hit the cache, not the other entry
+    auto u8Again = CookTexture(kSource, cache, u8Params);
+    if (!u8Again || *u8Again != *u8Path) {
+        std::cout << "    second cook missed the cache" << std::endl;
+        return false;
+    }
+
+    auto u8 = Buffer::Load(*u8Path, LoadParams{});
+    auto f16 = Buffer::Load(*f16Path, LoadParams{});
+    if (!u8 || !f16) {
+        std::cout << "    failed to load the cooked textures" << std::endl;
+        return false;
+    }
+    return u8->desc.format.valueType == ValueType::UINT8 &&
+        f16->desc.format.valueType == ValueType::FLOAT16;
+}
+
+int main() {
+    auto cache = std::filesystem::temp_directory_path() / "okami-test-texture-cook";
+    std::filesystem::remove_all(cache);
+
+    bool passed = true;
+
+    std::cout << "value types" << std::endl;
+    passed &= TestValueTypes(cache);
+
+    std::filesystem::remove_all(cache);
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
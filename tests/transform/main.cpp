@@ -0,0 +1,72 @@
+#include <okami/transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace okami;
+
+// Far from the world origin, where float translations lose their precision
+const glm::dvec3 kOrigin(12345678.25, -9876543.5, 4000000.125);
+
+std::vector<WorldTransform> MakeTransforms(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<double> offset(-1000.0, 1000.0);
+    std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+
+    std::vector<WorldTransform> transforms;
+    for (size_t i = 0; i < count; ++i) {
+        glm::dvec3 translation(offset(rng), offset(rng), offset(rng));
+        auto rotation = glm::normalize(glm::quat(component(rng), component(rng), component(rng), component(rng)));
+        transforms.emplace_back(kOrigin + translation, rotation, scale(rng));
+    }
+    return transforms;
+}
+
+// The batch has to match the scalar camera relative matrix of every
+// transform, whether it went through the four wide loop or the tail
+bool TestToRelativeMatrices() {
+    std::mt19937 rng(8);
+    for (size_t count : { 1, 3, 4, 5, 8, 17 }) {
+        auto transforms = MakeTransforms(count, rng);
+
+        // One more than needed, which has to be left alone
+        glm::mat4 sentinel(-7.0f);
+        std::vector<glm::mat4> matrices(count + 1, sentinel);
+        ToRelativeMatrices(transforms, kOrigin, matrices);
+
+        for (size_t i = 0; i < count; ++i) {
+            auto expected = transforms[i].ToRelativeMatrix4x4(kOrigin);
+            for (int c = 0; c < 4; ++c) {
+                for (int r = 0; r < 4; ++r) {
+                    // Translations are rebased in double precision on both
+                    // paths, so they have to agree exactly
+                    float tolerance = c == 3 ? 0.0f : 1e-5f * transforms[i].scale;
+                    if (std::abs(matrices[i][c][r] - expected[c][r]) > tolerance) {
+                        std::cout << "    " << count << " transforms, matrix " << i
+                            << " [" << c << "][" << r << "] is " << matrices[i][c][r]
+                            << ", expected " << expected[c][r] << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+
+        if (matrices[count] != sentinel) {
+            std::cout << "    " << count << " transforms wrote past the last matrix" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "relative matrices" << std::endl;
+    passed &= TestToRelativeMatrices();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include <okami/virtual_texture.hpp>
+
+#include <cstring>
+#include <iostream>
+
+using namespace okami;
+using namespace okami::texture;
+
+// Feedback of a camera looking down at a point of a huge texture, with
+// the tiles getting coarser with distance
+std::vector<uint32_t> MakeFeedback(VirtualTextureDesc const& desc, uint32_t centerX, uint32_t centerY) {
+    std::vector<uint32_t> feedback;
+    for (uint32_t mip = 0; mip < desc.mipLevels; ++mip) {
+        int64_t x = (centerX >> mip) / kVirtualTileSize;
+        int64_t y = (centerY >> mip) / kVirtualTileSize;
+        for (int64_t dy = -2; dy <= 2; ++dy) {
+            for (int64_t dx = -2; dx <= 2; ++dx) {
+                if (x + dx >= 0 && y + dy >= 0) {
+                    feedback.emplace_back(VirtualTileId{mip, uint32_t(x + dx), uint32_t(y + dy)}.Pack());
+                }
+            }
+        }
+    }
+    return feedback;
+}
+
+// Every texel must point at a resident tile that covers it
+bool CheckIndirection(VirtualPageTable const& table, Buffer const& indirection) {
+    auto const& desc = table.GetDesc();
+    auto subresources = indirection.desc.GetSubresourceDescs();
+    for (uint32_t mip = 0; mip < desc.mipLevels; ++mip) {
+        for (uint32_t y = 0; y < desc.GetTilesY(mip); ++y) {
+            for (uint32_t x = 0; x < desc.GetTilesX(mip); ++x) {
+                auto texel = &indirection.data[subresources[mip].srcOffset + subresources[mip].stride * y + x * 4];
+                uint32_t slot = texel[0] | (texel[1] << 8);
+                uint32_t residentMip = texel[2];
+                VirtualTileId covering{residentMip, x >> (residentMip - mip), y >> (residentMip - mip)};
+                if (texel[3] != 255 || residentMip < mip || table.FindSlot(covering) != slot) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool TestPageTable() {
+    VirtualTextureDesc desc;
+    desc.width = 65536;
+    desc.height = 32768;
+    desc.mipLevels = 10;
+    desc.format = Format::RGBA8_UNORM();
+
+    constexpr uint32_t kSlots = 256;
+    VirtualPageTable table(desc, kSlots);
+    Buffer indirection;
+
+    size_t uploads = 0;
+    size_t maxMissing = 0;
+    for (uint32_t frame = 0; frame < 2000; ++frame) {
+        // Fly across the texture, stopping every now and then
+        uint32_t distance = std::min(frame, 1500u) * 40;
+        auto feedback = MakeFeedback(desc, 1000 + distance, 900 + distance / 2);
+
+        table.BeginFrame();
+        table.Request(feedback);
+        auto missing = table.GetMissing(16);
+        maxMissing = std::max(maxMissing, missing.size());
+        for (auto const& tile : missing) {
+            if (!table.Insert(tile)) {
+                std::cout << "    frame " << frame << ": cache full" << std::endl;
+                return false;
+            }
+            ++uploads;
+        }
+
+        if (table.GetResidentCount() > kSlots) {
+            std::cout << "    frame " << frame << ": more tiles resident than slots" << std::endl;
+            return false;
+        }
+        if (table.IsDirty()) {
+            table.BuildIndirection(indirection);
+            if (!CheckIndirection(table, indirection)) {
+                std::cout << "    frame " << frame << ": indirection is wrong" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // Once the camera stops, everything it looks at has to arrive
+    table.BeginFrame();
+    table.Request(MakeFeedback(desc, 1000 + 60000, 900 + 30000));
+    if (!table.GetMissing(16).empty()) {
+        std::cout << "    tiles still missing after the camera stopped" << std::endl;
+        return false;
+    }
+
+    std::cout << "    " << desc.GetTileCount() << " virtual tiles, " << kSlots << " slots, "
+        << uploads << " uploads, at most " << maxMissing << " missing per frame" << std::endl;
+    return true;
+}
+
+bool TestTileFile() {
+    Desc desc;
+    desc.type = Dimension::Texture2D;
+    desc.width = 300;
+    desc.height = 200;
+    desc.format = Format::RGBA8_UNORM();
+    desc.mipLevels = MipCount(desc.width, desc.height);
+
+    // Every texel holds its own coordinates and mip
+    auto source = Buffer::Alloc(desc);
+    auto subresources = desc.GetSubresourceDescs();
+    for (auto const& subresource : subresources) {
+        uint32_t width = std::max(1u, desc.width >> subresource.mip);
+        uint32_t height = std::max(1u, desc.height >> subresource.mip);
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                auto texel = &source.data[subresource.srcOffset + subresource.stride * y + x * 4];
+                texel[0] = x & 0xFF;
+                texel[1] = y & 0xFF;
+                texel[2] = x >> 8 | (y >> 8) << 4;
+                texel[3] = subresource.mip;
+            }
+        }
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "okami_test.okvt";
+    if (auto err = WriteVirtualTexture(path, source); err.IsError()) {
+        std::cout << "    failed to write: " << err << std::endl;
+        return false;
+    }
+    auto file = VirtualTextureFile::Open(path);
+    if (!file) {
+        std::cout << "    failed to open: " << file.error() << std::endl;
+        return false;
+    }
+
+    auto const& vtDesc = file->GetDesc();
+    bool isValid = vtDesc.mipLevels == 3;
+    for (uint32_t mip = 0; mip < vtDesc.mipLevels; ++mip) {
+        int64_t width = vtDesc.GetMipWidth(mip);
+        int64_t height = vtDesc.GetMipHeight(mip);
+        for (uint32_t tileY = 0; tileY < vtDesc.GetTilesY(mip); ++tileY) {
+            for (uint32_t tileX = 0; tileX < vtDesc.GetTilesX(mip); ++tileX) {
+                auto tile = file->GetTile(VirtualTileId{mip, tileX, tileY});
+                for (int64_t y = 0; y < kVirtualTilePaddedSize; ++y) {
+                    for (int64_t x = 0; x < kVirtualTilePaddedSize; ++x) {
+                        // Borders past the edges repeat the edge texel
+                        int64_t srcX = std::clamp<int64_t>(tileX * kVirtualTileSize + x - kVirtualTileBorder, 0, width - 1);
+                        int64_t srcY = std::clamp<int64_t>(tileY * kVirtualTileSize + y - kVirtualTileBorder, 0, height - 1);
+                        auto texel = &tile[(y * kVirtualTilePaddedSize + x) * 4];
+                        auto expected = &source.data[subresources[mip].srcOffset + subresources[mip].stride * srcY + srcX * 4];
+                        isValid &= std::memcmp(texel, expected, 4) == 0;
+                    }
+                }
+            }
+        }
+    }
+
+    file = {};
+    std::filesystem::remove(path);
+    return isValid;
+}
+
+int main() {
+    bool passed = true;
+
+    std::cout << "page table" << std::endl;
+    passed &= TestPageTable();
+    std::cout << "tile file" << std::endl;
+    passed &= TestTileFile();
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <set>
 #include <sstream>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
@@ -30,6 +31,49 @@ set<string> important_ext = {
 	".gs"
 };
 
+// Embedded as arrays of words rather than as string literals
+set<string> binary_ext = {
+	".okmesh"
+};
+
+void write_binary(const std::filesystem::path& path, const string& name, ofstream& out) {
+	ifstream f(path, std::ios::binary);
+	if (!f.is_open()) {
+		stringstream err_ss;
+		err_ss << "Failed to open file: " << path;
+		throw std::runtime_error(err_ss.str());
+	}
+
+	std::string str((std::istreambuf_iterator<char>(f)),
+		std::istreambuf_iterator<char>());
+	size_t size = str.size();
+
+	// Emitted as 64 bit words, which compiles far faster than one literal
+	// per byte. The words are in host byte order, so the bytes come back out
+	// unchanged on a target of the same endianness.
+	size_t wordCount = (str.size() + 7) / 8;
+	str.resize(wordCount * 8, '\0');
+
+	out << "alignas(16) static const unsigned long long " << name << "_words[] = {";
+	out << std::hex;
+	for (size_t i = 0; i < wordCount; ++i) {
+		if (i % 8 == 0) {
+			out << "\n\t";
+		}
+		unsigned long long word = 0;
+		std::memcpy(&word, &str[i * 8], 8);
+		out << "0x" << word << "ull,";
+	}
+	out << std::dec;
+	if (wordCount == 0) {
+		out << "0";
+	}
+	out << "\n};\n";
+	out << "std::string_view " << name << "(reinterpret_cast<const char*>(" << name << "_words), "
+		<< size << ");";
+	out << "\n\n";
+}
+
 void write_into_lookup(
 	const std::filesystem::path& base,
 	const fs::directory_entry& path,
@@ -42,6 +86,14 @@ void write_into_lookup(
 	string name = ss.str();
 	std::replace(name.begin(), name.end(), '.', '_');
 	std::replace(name.begin(), name.end(), '/', '_');
+	std::replace(name.begin(), name.end(), '-', '_');
+
+	if (binary_ext.find(path.path().extension().string()) != binary_ext.end()) {
+		write_binary(path.path(), name, out);
+		(*map)[path.path()] = name;
+		return;
+	}
+
 	out << "std::string_view " << name << " = R\"(";
 	ifstream f(path.path());
 	if (!f.is_open()) {
@@ -65,7 +117,9 @@ void do_search(
 	unordered_map<std::filesystem::path, string, PathHasher>* map, ofstream& out) {
 	for (const auto& entry : it) {
 		if (entry.is_regular_file()) {
-			if (important_ext.find(entry.path().extension().string()) != important_ext.end()) {
+			auto ext = entry.path().extension().string();
+			if (important_ext.find(ext) != important_ext.end() ||
+				binary_ext.find(ext) != binary_ext.end()) {
 				write_into_lookup(base, entry, map, out);
 			}
 		} else if (entry.is_directory()) {
@@ -0,0 +1,99 @@
+#include <okami/geometry.hpp>
+#include <okami/mesh_file.hpp>
+
+#include <filesystem>
+#include <iostream>
+
+using namespace okami;
+using namespace okami::geometry;
+
+namespace matball {
+	#include <matballmesh.hpp>
+}
+
+namespace box {
+	#include <boxmesh.hpp>
+}
+
+namespace bunny {
+	#include <bunnymesh.hpp>
+}
+
+namespace monkey {
+	#include <monkeymesh.hpp>
+}
+
+namespace plane {
+	#include <planemesh.hpp>
+}
+
+namespace sphere {
+	#include <spheremesh.hpp>
+}
+
+namespace torus {
+	#include <torusmesh.hpp>
+}
+
+namespace teapot {
+	#include <teapotmesh.hpp>
+}
+
+#define PREFAB_SOURCE(name) \
+	PrefabSource{#name, DataView<uint32_t, float, float, float>( \
+		name::vertexCount, \
+		name::indexCount, \
+		name::indices, \
+		name::positions, \
+		name::uvs, \
+		name::normals, \
+		name::tangents, \
+		name::bitangents)}
+
+struct PrefabSource {
+	std::string_view name;
+	DataView<uint32_t, float, float, float> data;
+};
+
+// Packs every prefab into every embedded layout and writes the okmesh files
+// into the directory given, normally core/embed/meshes
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: cookprefabs <output directory>" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path output(argv[1]);
+	std::filesystem::create_directories(output);
+
+	PrefabSource sources[] = {
+		PREFAB_SOURCE(matball),
+		PREFAB_SOURCE(box),
+		PREFAB_SOURCE(bunny),
+		PREFAB_SOURCE(monkey),
+		PREFAB_SOURCE(plane),
+		PREFAB_SOURCE(sphere),
+		PREFAB_SOURCE(torus),
+		PREFAB_SOURCE(teapot)
+	};
+
+	for (auto const& source : sources) {
+		for (auto format : prefabs::kPrefabMeshFormats) {
+			auto layout = VertexFormatInfo::From(format);
+			if (!layout) {
+				std::cerr << "Unknown vertex format!" << std::endl;
+				return 1;
+			}
+
+			Geometry geometry(*layout, source.data);
+			auto path = output / prefabs::GetPrefabMeshName(source.name, format);
+			if (auto err = MeshFile::Write(path, geometry); err.IsError()) {
+				std::cerr << "Failed to write " << path << std::endl;
+				return 1;
+			}
+			std::cout << path.string() << std::endl;
+		}
+	}
+
+	return 0;
+}
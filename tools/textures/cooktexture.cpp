@@ -0,0 +1,105 @@
+#include <okami/texture_file.hpp>
+#include <okami/virtual_texture.hpp>
+
+#include <iostream>
+#include <string_view>
+
+using namespace okami;
+using namespace okami::texture;
+
+namespace {
+	bool ParseFilter(std::string_view name, MipFilter& filter) {
+		if (name == "box") {
+			filter = MipFilter::Box;
+		} else if (name == "kaiser") {
+			filter = MipFilter::Kaiser;
+		} else if (name == "lanczos3") {
+			filter = MipFilter::Lanczos3;
+		} else if (name == "mitchell") {
+			filter = MipFilter::Mitchell;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	bool ParseCompression(std::string_view name, Compression& compression) {
+		if (name == "none") {
+			compression = Compression::None;
+		} else if (name == "bc1") {
+			compression = Compression::BC1;
+		} else if (name == "bc3") {
+			compression = Compression::BC3;
+		} else if (name == "bc4") {
+			compression = Compression::BC4;
+		} else if (name == "bc5") {
+			compression = Compression::BC5;
+		} else if (name == "bc7") {
+			compression = Compression::BC7;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	bool ParseValueType(std::string_view name, ValueType& valueType) {
+		if (name == "u8") {
+			valueType = ValueType::UINT8;
+		} else if (name == "f16") {
+			valueType = ValueType::FLOAT16;
+		} else if (name == "f32") {
+			valueType = ValueType::FLOAT32;
+		} else {
+			return false;
+		}
+		return true;
+	}
+}
+
+// Decodes an image, generates its mips, optionally block compresses it and
+// writes the result as KTX2, or as virtual texture tiles for .okvt outputs
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "Usage: cooktexture <input> <output.ktx2|output.okvt> [--srgb] [--no-mips] "
+			"[--alpha-weighted] [--filter box|kaiser|lanczos3|mitchell] "
+			"[--compress none|bc1|bc3|bc4|bc5|bc7] [--type u8|f16|f32]" << std::endl;
+		return 1;
+	}
+
+	LoadParams params;
+	for (int i = 3; i < argc; ++i) {
+		std::string_view arg(argv[i]);
+		if (arg == "--srgb") {
+			params.isSRGB = true;
+		} else if (arg == "--no-mips") {
+			params.generateMips = false;
+		} else if (arg == "--alpha-weighted") {
+			params.alphaWeightedMips = true;
+		} else if (arg == "--filter" && i + 1 < argc && ParseFilter(argv[i + 1], params.mipFilter)) {
+			++i;
+		} else if (arg == "--compress" && i + 1 < argc && ParseCompression(argv[i + 1], params.compression)) {
+			++i;
+		} else if (arg == "--type" && i + 1 < argc && ParseValueType(argv[i + 1], params.valueType)) {
+			++i;
+		} else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	auto buffer = Buffer::Load(argv[1], params);
+	if (!buffer) {
+		std::cerr << "Failed to load " << argv[1] << ": " << buffer.error() << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path output(argv[2]);
+	auto err = output.extension() == kVirtualTextureExtension ?
+		WriteVirtualTexture(output, *buffer) : WriteKTX2(output, *buffer);
+	if (err.IsError()) {
+		std::cerr << "Failed to write " << argv[2] << ": " << err << std::endl;
+		return 1;
+	}
+
+	return 0;
+}